@@ -0,0 +1,34 @@
+#!/bin/bash
+
+# clean and incremental build times of every target for the base build options, e.g.
+#   ./buildtime.sh                      default (pch)
+#   ./buildtime.sh -DBASE_PCH=OFF       nothing precompiled
+#   ./buildtime.sh -DBASE_UNITY=ON      unity build of base
+
+set -e
+
+BUILD=build-time
+
+seconds() {
+	local start=$(date +%s.%N)
+	cmake --build $BUILD -- -j "$(nproc)" > /dev/null
+	echo "$(date +%s.%N) - $start" | bc
+}
+
+rm -rf $BUILD
+cmake -B $BUILD -DCMAKE_BUILD_TYPE=Release -G Ninja "$@" > /dev/null
+
+# thirdparty is built first so the clean number only covers our own code
+cmake --build $BUILD --target glad glfw assimp -- -j "$(nproc)" > /dev/null
+echo "clean: $(seconds)s"
+
+# a source of base only rebuilds base and relinks
+touch src/base/model.cc
+echo "touch model.cc: $(seconds)s"
+
+# a header included by every example rebuilds all of them
+touch src/base/mesh.h
+echo "touch mesh.h: $(seconds)s"
+
+touch example/stencil-testing/main.cc
+echo "touch stencil-testing: $(seconds)s"
@@ -0,0 +1,404 @@
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <base/bounds.h>
+#include <base/camera.h>
+#include <base/command_list.h>
+#include <base/components.h>
+#include <base/ecs.h>
+#include <base/job_system.h>
+#include <base/shader.h>
+
+// settings
+const int WIN_WIDTH = 800;
+const int WIN_HEIGHT = 600;
+const int OBJECT_COUNT = 50000;
+
+// camera
+Camera camera(glm::vec3(.0f, .0f, 60.0f));
+bool firstMouse = true;
+double lastX = .0;
+double lastY = .0;
+
+// timing
+float deltaTime = .0f; // time between current frame and last frame
+float lastFrame = .0f;
+
+// spins an entity's Transform around a fixed axis
+struct Spin {
+  glm::vec3 axis;
+  float speed;
+};
+
+// the geometry an object can use
+struct Shape {
+  GLuint vao;
+  GLsizei count;
+  AABB bounds;
+};
+
+void framebufferSizeCallback(GLFWwindow *window, int width, int height);
+void mouseCallback(GLFWwindow *window, double x, double y);
+void scrollCallback(GLFWwindow *window, double xOffset, double yOffset);
+void processInput(GLFWwindow *window);
+// everything that owns GL objects, which are deleted when it returns, while the context is still current
+int run(GLFWwindow *window, bool bench);
+
+double msSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv) {
+  // --bench compares recording on one thread with recording on all of them
+  bool bench = argc > 1 && std::string(argv[1]) == "--bench";
+
+  if (!glfwInit()) {
+    std::cerr << "failed to init GLFW" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+  GLFWwindow *window;
+  // create a windowed mode window and its OpenGL context
+  if (window = glfwCreateWindow(WIN_WIDTH, WIN_HEIGHT, "Hello CG", nullptr, nullptr); !window) {
+    glfwTerminate();
+    return EXIT_FAILURE;
+  }
+
+  glfwMakeContextCurrent(window); // make the window's context current
+  glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+  camera.setViewport(WIN_WIDTH, WIN_HEIGHT);
+  camera.setProjection(0.1f, 500.0f);
+  glfwSetCursorPosCallback(window, mouseCallback);
+  glfwSetScrollCallback(window, scrollCallback);
+  glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+  // load all OpenGL function pointers
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+    std::cerr << "failed to initialize GLAD" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  int result = run(window, bench);
+  glfwTerminate();
+  return result;
+}
+
+int run(GLFWwindow *window, bool bench) {
+  if (bench) {
+    glfwSwapInterval(0);
+  }
+
+  // configure global opengl state
+  glad_glEnable(GL_DEPTH_TEST);
+
+  // build and compile shaders
+  Shader shader("shaders/command-list.vert", "shaders/command-list.frag");
+
+  // set up vertex data
+
+  float vertices[] = {
+      // clang-format off
+      // positions          // normals           // texture coords
+      -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
+       0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 0.0f,
+       0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
+       0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
+      -0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 1.0f,
+      -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
+
+      -0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
+       0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 0.0f,
+       0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
+       0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
+      -0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 1.0f,
+      -0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
+
+      -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+      -0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
+      -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+      -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+      -0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
+      -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+
+      0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+      0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
+      0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+      0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+      0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
+      0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+
+      -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
+       0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 1.0f,
+       0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
+       0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
+      -0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 0.0f,
+      -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
+
+      -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f,
+       0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 1.0f,
+       0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
+       0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
+      -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 0.0f,
+      -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f
+      // clang-format on
+  };
+
+  // octahedron with flat normals, same layout as the cube
+  std::vector<float> octahedron;
+  for (int i = 0; i < 8; ++i) {
+    glm::vec3 s(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f);
+    glm::vec3 corners[3] = {glm::vec3(s.x * 0.6f, 0, 0), glm::vec3(0, s.y * 0.6f, 0), glm::vec3(0, 0, s.z * 0.6f)};
+    // keep the winding counter clockwise seen from outside
+    if (s.x * s.y * s.z < 0)
+      std::swap(corners[1], corners[2]);
+    glm::vec3 normal = glm::normalize(s);
+    for (auto &c : corners) {
+      octahedron.insert(octahedron.end(), {c.x, c.y, c.z, normal.x, normal.y, normal.z, 0.0f, 0.0f});
+    }
+  }
+
+  unsigned int VBOs[2], VAOs[2];
+  glGenVertexArrays(2, VAOs);
+  glGenBuffers(2, VBOs);
+  auto setupShape = [&](int i, const float *data, size_t bytes) {
+    glBindVertexArray(VAOs[i]);
+    glBindBuffer(GL_ARRAY_BUFFER, VBOs[i]);
+    glBufferData(GL_ARRAY_BUFFER, bytes, data, GL_STATIC_DRAW);
+    // position attribute
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GL_FLOAT), nullptr);
+    glEnableVertexAttribArray(0);
+    // normal attribute
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GL_FLOAT), (void *)(3 * sizeof(GL_FLOAT)));
+    glEnableVertexAttribArray(1);
+  };
+  setupShape(0, vertices, sizeof(vertices));
+  setupShape(1, octahedron.data(), octahedron.size() * sizeof(float));
+  glBindVertexArray(0);
+
+  Shape shapes[2];
+  shapes[0] = {VAOs[0], 36, {glm::vec3(-0.5f), glm::vec3(0.5f)}};
+  shapes[1] = {VAOs[1], (GLsizei)(octahedron.size() / 8), {glm::vec3(-0.6f), glm::vec3(0.6f)}};
+
+  // scatter the objects through a slab in front of the camera, everything a worker needs to record a draw lives in the
+  // registry
+  ecs::Registry registry;
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  for (int i = 0; i < OBJECT_COUNT; ++i) {
+    Transform transform;
+    transform.position = glm::vec3(unit(rng) * 120.0f - 60.0f, unit(rng) * 80.0f - 40.0f, unit(rng) * -150.0f);
+    transform.scale = glm::vec3(0.4f + unit(rng) * 0.6f);
+    Spin spin;
+    spin.axis = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) + glm::vec3(0.01f));
+    spin.speed = 0.5f + unit(rng) * 2.0f;
+    glm::vec4 color(0.3f + 0.7f * unit(rng), 0.3f + 0.7f * unit(rng), 0.3f + 0.7f * unit(rng), 1.0f);
+    const Shape &shape = shapes[unit(rng) < 0.5f ? 0 : 1];
+    registry.create(transform, WorldTransform(), Bounds{shape.bounds, AABB()}, MeshRef{shape.vao, shape.count, 0},
+                    MaterialRef{shader.get_id(), color}, spin);
+  }
+
+  auto animate = [&](JobSystem &jobs, float time) {
+    registry.parallelEach<Transform, Spin>(jobs, 4096, [&](Transform &transform, Spin &spin) {
+      transform.rotation = glm::angleAxis(time * spin.speed, spin.axis);
+    });
+    updateTransforms(registry, jobs);
+  };
+
+  // the way every other example draws: one thread computes, culls and talks to GL object by object
+  JobSystem serialJobs(1);
+  auto drawImmediate = [&](float time) {
+    animate(serialJobs, time);
+    const Frustum &frustum = camera.getFrustum();
+    shader.use();
+    shader.setMat4("viewProjection", camera.getViewProjectionMatrix());
+    registry.each<WorldTransform, Bounds, MeshRef, MaterialRef>(
+        [&](WorldTransform &world, Bounds &bounds, MeshRef &mesh, MaterialRef &material) {
+          if (!frustum.intersects(bounds.world))
+            return;
+          shader.setMat4("model", world.matrix);
+          shader.setVec4("color", material.color);
+          glBindVertexArray(mesh.vao);
+          glDrawArrays(GL_TRIANGLES, 0, mesh.count);
+        });
+    glBindVertexArray(0);
+  };
+
+  // workers animate, cull and record disjoint ranges of entities into their own command list, sort it, and the GL
+  // thread only replays the merged result
+  double recordMs = 0.0, submitMs = 0.0;
+  auto drawQueued = [&](JobSystem &jobs, RenderQueue &queue, float time) {
+    auto start = std::chrono::steady_clock::now();
+    animate(jobs, time);
+    const glm::mat4 &viewProj = camera.getViewProjectionMatrix();
+    recordDraws(registry, jobs, queue, viewProj, camera.getPosition(), camera.getFront());
+    recordMs += msSince(start);
+
+    start = std::chrono::steady_clock::now();
+    queue.submit(viewProj);
+    submitMs += msSince(start);
+  };
+
+  if (bench) {
+    const int WARMUP_FRAMES = 10;
+    const int BENCH_FRAMES = 100;
+    unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << OBJECT_COUNT << " objects, " << hardwareThreads << " hardware threads" << std::endl;
+
+    auto run = [&](auto &&drawFrame) {
+      double start = 0.0;
+      recordMs = submitMs = 0.0;
+      for (int frame = 0; frame < WARMUP_FRAMES + BENCH_FRAMES; ++frame) {
+        if (frame == WARMUP_FRAMES) {
+          glFinish();
+          start = glfwGetTime();
+          recordMs = submitMs = 0.0;
+        }
+        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        drawFrame(frame * 0.016f);
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+      }
+      glFinish();
+      return (glfwGetTime() - start) * 1000.0 / BENCH_FRAMES;
+    };
+
+    double frameMs = run(drawImmediate);
+    std::cout << "immediate: frame " << frameMs << " ms" << std::endl;
+
+    // 1, 2, 4, ... and finally every hardware thread
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int threads = 1; threads < hardwareThreads; threads *= 2) {
+      threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(hardwareThreads);
+
+    double singleRecordMs = 0.0;
+    for (unsigned int threads : threadCounts) {
+      JobSystem jobs(threads);
+      RenderQueue queue(jobs.threadCount());
+      frameMs = run([&](float time) { drawQueued(jobs, queue, time); });
+      double record = recordMs / BENCH_FRAMES;
+      if (threads == 1)
+        singleRecordMs = record;
+      std::cout << threads << " thread(s): record " << record << " ms (x" << singleRecordMs / record << "), submit "
+                << submitMs / BENCH_FRAMES << " ms, frame " << frameMs << " ms, " << queue.getStats().draws
+                << " draws, " << queue.getStats().programChanges + queue.getStats().vaoChanges << " state changes"
+                << std::endl;
+    }
+    return EXIT_SUCCESS;
+  }
+
+  JobSystem jobs;
+  RenderQueue queue(jobs.threadCount());
+  std::cout << "recording on " << jobs.threadCount() << " threads, press TAB to toggle immediate drawing" << std::endl;
+  bool immediate = false;
+  bool tabDown = false;
+  double statsTime = glfwGetTime();
+  int frames = 0;
+
+  while (!glfwWindowShouldClose(window)) {
+    double currentFrame = glfwGetTime();
+    deltaTime = currentFrame - lastFrame;
+    lastFrame = currentFrame;
+
+    processInput(window);
+    bool tab = glfwGetKey(window, GLFW_KEY_TAB) == GLFW_PRESS;
+    if (tab && !tabDown)
+      immediate = !immediate;
+    tabDown = tab;
+
+    // render
+    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    if (immediate)
+      drawImmediate(currentFrame);
+    else
+      drawQueued(jobs, queue, currentFrame);
+
+    ++frames;
+    if (currentFrame - statsTime >= 1.0) {
+      std::cout << (immediate ? "immediate" : "queued") << ": frame " << (currentFrame - statsTime) * 1000.0 / frames
+                << " ms";
+      if (!immediate)
+        std::cout << ", record " << recordMs / frames << " ms, submit " << submitMs / frames << " ms, "
+                  << queue.getStats().draws << " draws";
+      std::cout << std::endl;
+      statsTime = currentFrame;
+      recordMs = submitMs = 0.0;
+      frames = 0;
+    }
+
+    /* Swap front and back buffers */
+    glfwSwapBuffers(window);
+
+    /* Poll for and process events */
+    glfwPollEvents();
+  }
+
+  glad_glDeleteVertexArrays(2, VAOs);
+  glad_glDeleteBuffers(2, VBOs);
+
+  return EXIT_SUCCESS;
+}
+
+void mouseCallback(GLFWwindow *window, double x, double y) {
+  if (firstMouse) {
+    lastX = x;
+    lastY = y;
+    firstMouse = false;
+  }
+
+  auto xOffset = lastX - x;
+  auto yOffset = y - lastY;
+  lastX = x;
+  lastY = y;
+
+  camera.processMouseMovement(xOffset, yOffset);
+}
+
+void scrollCallback(GLFWwindow *window, double xOffset, double yOffset) { camera.processMouseScroll(yOffset); }
+
+// glfw: whenever the window size changed, this callback function executes
+void framebufferSizeCallback(GLFWwindow *window, int width, int height) {
+  // make sure the viewport matches the new window dimensions; note that width and height will be significantly larger
+  // than specified on retina displays
+  glViewport(0, 0, width, height);
+  camera.setViewport(width, height);
+}
+
+void processInput(GLFWwindow *window) {
+  if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+    glfwSetWindowShouldClose(window, true);
+
+  if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
+    camera.processKeyboard(FORWARD, deltaTime);
+  } else if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
+    camera.processKeyboard(BACKWARD, deltaTime);
+  } else if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
+    camera.processKeyboard(LEFT, deltaTime);
+  } else if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
+    camera.processKeyboard(RIGHT, deltaTime);
+  }
+}
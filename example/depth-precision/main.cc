@@ -0,0 +1,257 @@
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <base/camera.h>
+#include <base/depth.h>
+#include <base/framebuffer.h>
+#include <base/gl_resource.h>
+#include <base/shader.h>
+
+// pairs of quads from 1 to 65536 units in front of the camera. the back quad of a pair sits GAP times its distance
+// behind the front one and covers the same pixels, wherever the depth buffer can't tell the two apart it bleeds
+// through. both modes use an infinite far plane: the standard one with a 24 bit fixed point depth buffer, reversed-Z
+// with a 32 bit float one.
+
+// settings
+const int WIN_WIDTH = 800;
+const int WIN_HEIGHT = 600;
+const int PAIR_COUNT = 17;
+const float GAP = 1e-4f;
+const float NEAR_PLANE = 0.1f;
+
+depth::Mode mode = depth::Mode::STANDARD;
+bool modeChanged = false;
+
+struct Pair {
+  float distance;
+  glm::mat4 front;
+  glm::mat4 back;
+};
+
+void framebufferSizeCallback(GLFWwindow *window, int width, int height);
+void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods);
+// everything that owns GL objects, which are deleted when it returns, while the context is still current
+int run(GLFWwindow *window, bool bench);
+
+// the value the depth buffer of the mode stores for a point at the given distance, as raw bits so that the difference
+// of two of them counts the representable depths in between
+int64_t storedDepth(float distance, depth::Mode mode) {
+  if (mode == depth::Mode::REVERSED) {
+    // the reversed infinite projection leaves near / distance
+    float d = NEAR_PLANE / distance;
+    int32_t bits;
+    std::memcpy(&bits, &d, sizeof(bits));
+    return bits;
+  }
+  // the standard infinite projection gives 1 - 2 near / distance, which the viewport maps to 1 - near / distance
+  double d = 1.0 - (double)NEAR_PLANE / distance;
+  return (int64_t)std::llround(d * 16777215.0);
+}
+
+Camera camera(glm::vec3(0.0f));
+
+int main(int argc, char **argv) {
+  // --bench measures both modes once and exits
+  bool bench = argc > 1 && std::string(argv[1]) == "--bench";
+
+  if (!glfwInit()) {
+    std::cerr << "failed to init GLFW" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+  GLFWwindow *window;
+  // create a windowed mode window and its OpenGL context
+  if (window = glfwCreateWindow(WIN_WIDTH, WIN_HEIGHT, "Hello CG", nullptr, nullptr); !window) {
+    glfwTerminate();
+    return EXIT_FAILURE;
+  }
+
+  glfwMakeContextCurrent(window); // make the window's context current
+  glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+  camera.setViewport(WIN_WIDTH, WIN_HEIGHT);
+  glfwSetKeyCallback(window, keyCallback);
+
+  // load all OpenGL function pointers
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+    std::cerr << "failed to initialize GLAD" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  int result = run(window, bench);
+  glfwTerminate();
+  return result;
+}
+
+int run(GLFWwindow *window, bool bench) {
+  if (!depth::reversedSupported())
+    std::cerr << "reversed-Z needs GL 4.5 or GL_ARB_clip_control, only the standard depth range is available"
+              << std::endl;
+
+  glEnable(GL_DEPTH_TEST);
+  Shader shader("shaders/depth-precision.vert", "shaders/depth-precision.frag");
+
+  // a unit quad facing +z
+  float quad[] = {-0.5f, -0.5f, 0.0f, 0.5f, -0.5f, 0.0f, 0.5f, 0.5f, 0.0f,
+                  -0.5f, -0.5f, 0.0f, 0.5f, 0.5f,  0.0f, -0.5f, 0.5f, 0.0f};
+  GLVertexArray quadVAO = GLVertexArray::create("quad");
+  GLBuffer quadVBO = GLBuffer::create("quad");
+  glBindVertexArray(quadVAO.get());
+  glBindBuffer(GL_ARRAY_BUFFER, quadVBO.get());
+  glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+  quadVBO.setBytes(sizeof(quad));
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
+  glBindVertexArray(0);
+
+  // the pairs side by side across the view, turned towards the camera and scaled with their distance so every pair
+  // gets the same share of the screen
+  float halfWidth = std::atan(std::tan(glm::radians(camera.getZoom()) * 0.5f) * camera.getAspect());
+  float step = 2.0f * halfWidth / PAIR_COUNT;
+  std::vector<Pair> pairs;
+  for (int i = 0; i < PAIR_COUNT; ++i) {
+    float angle = -halfWidth + (i + 0.5f) * step;
+    glm::vec3 dir(std::sin(angle), 0.0f, -std::cos(angle));
+    auto place = [&](float distance) {
+      glm::mat4 m = glm::translate(glm::mat4(1.0f), dir * distance);
+      m = glm::rotate(m, -angle, glm::vec3(0.0f, 1.0f, 0.0f));
+      return glm::scale(m, glm::vec3(2.0f * std::tan(step * 0.4f) * distance));
+    };
+    float distance = std::ldexp(1.0f, i);
+    pairs.push_back({distance, place(distance), place(distance * (1.0f + GAP))});
+  }
+
+  int fbWidth, fbHeight;
+  glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+  std::unique_ptr<Framebuffer> scene;
+
+  // switch the depth mode along with the projection and a depth buffer of the matching format
+  auto setMode = [&](depth::Mode requested) {
+    mode = depth::setMode(requested);
+    camera.setProjection(NEAR_PLANE, Camera::INFINITE_FAR, mode == depth::Mode::REVERSED);
+    scene = std::make_unique<Framebuffer>(fbWidth, fbHeight);
+    scene->addColor(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+    scene->setDepth(depth::attachmentFormat(), GL_DEPTH_COMPONENT, depth::attachmentType());
+    return scene->complete();
+  };
+
+  auto render = [&]() {
+    scene->bind();
+    glClearColor(0.1f, 0.1f, 0.1f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    shader.use();
+    shader.setMat4("viewProjection", camera.getViewProjectionMatrix());
+    glBindVertexArray(quadVAO.get());
+    for (int i = 0; i < PAIR_COUNT; ++i) {
+      // the back quad goes first, a depth test that can't separate the two lets it through instead of hiding it
+      float id = (i + 1) / 255.0f;
+      shader.setMat4("model", pairs[i].back);
+      shader.setVec4("color", glm::vec4(0.2f, 0.8f, 0.3f, id));
+      glDrawArrays(GL_TRIANGLES, 0, 6);
+      shader.setMat4("model", pairs[i].front);
+      shader.setVec4("color", glm::vec4(0.9f, 0.3f, 0.2f, id));
+      glDrawArrays(GL_TRIANGLES, 0, 6);
+    }
+    glBindVertexArray(0);
+  };
+
+  // read the frame back and print how much of every pair the back quad shows through, next to how many depth values
+  // separate the two quads in the buffer
+  auto report = [&]() {
+    render();
+    std::vector<unsigned char> pixels(fbWidth * fbHeight * 4);
+    glReadPixels(0, 0, fbWidth, fbHeight, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    std::vector<int> covered(PAIR_COUNT, 0), bled(PAIR_COUNT, 0);
+    for (size_t p = 0; p < pixels.size(); p += 4) {
+      int pair = pixels[p + 3] - 1;
+      if (pair < 0 || pair >= PAIR_COUNT)
+        continue;
+      ++covered[pair];
+      bled[pair] += pixels[p + 1] > pixels[p];
+    }
+    bool reversed = mode == depth::Mode::REVERSED;
+    std::cout << (reversed ? "reversed-Z, 32 bit float depth" : "standard, 24 bit depth") << ", infinite far plane"
+              << std::endl;
+    std::cout << std::setw(10) << "distance" << std::setw(14) << "depth steps" << std::setw(10) << "bleed" << std::endl;
+    for (int i = 0; i < PAIR_COUNT; ++i) {
+      int64_t steps = std::llabs(storedDepth(pairs[i].distance, mode) -
+                                 storedDepth(pairs[i].distance * (1.0f + GAP), mode));
+      float bleed = covered[i] ? 100.0f * bled[i] / covered[i] : 0.0f;
+      std::cout << std::setw(10) << pairs[i].distance << std::setw(14) << steps << std::setw(9) << std::fixed
+                << std::setprecision(1) << bleed << "%" << std::defaultfloat << std::endl;
+    }
+  };
+
+  if (bench) {
+    setMode(depth::Mode::STANDARD);
+    report();
+    if (setMode(depth::Mode::REVERSED) && mode == depth::Mode::REVERSED)
+      report();
+    return EXIT_SUCCESS;
+  }
+
+  std::cout << "space switches between the standard depth range and reversed-Z" << std::endl;
+  setMode(depth::Mode::STANDARD);
+  report();
+  while (!glfwWindowShouldClose(window)) {
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    if (width != fbWidth || height != fbHeight) {
+      fbWidth = width;
+      fbHeight = height;
+      scene->resize(fbWidth, fbHeight);
+    }
+    if (modeChanged) {
+      modeChanged = false;
+      setMode(mode == depth::Mode::STANDARD ? depth::Mode::REVERSED : depth::Mode::STANDARD);
+      report();
+    }
+
+    render();
+    scene->blitToScreen(fbWidth, fbHeight);
+
+    /* Swap front and back buffers */
+    glfwSwapBuffers(window);
+
+    /* Poll for and process events */
+    glfwPollEvents();
+  }
+
+  return EXIT_SUCCESS;
+}
+
+void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+  if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
+    glfwSetWindowShouldClose(window, true);
+  if (key == GLFW_KEY_SPACE && action == GLFW_PRESS)
+    modeChanged = true;
+}
+
+// glfw: whenever the window size changed, this callback function executes
+void framebufferSizeCallback(GLFWwindow *window, int width, int height) {
+  // make sure the viewport matches the new window dimensions; note that width and height will be significantly larger
+  // than specified on retina displays
+  glViewport(0, 0, width, height);
+  camera.setViewport(width, height);
+}
@@ -0,0 +1,379 @@
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cmath>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <base/bounds.h>
+#include <base/camera.h>
+#include <base/frame_pipeline.h>
+#include <base/job_system.h>
+#include <base/shader.h>
+
+// settings
+const int WIN_WIDTH = 800;
+const int WIN_HEIGHT = 600;
+const int OBJECT_COUNT = 20000;
+
+// input gathered on the main thread (glfw callbacks only run there) and consumed by the next update
+struct Input {
+  float mouseX = 0.0f, mouseY = 0.0f;
+  float scroll = 0.0f;
+  // the new framebuffer size, 0 when it didn't change
+  int width = 0, height = 0;
+  bool forward = false, backward = false, left = false, right = false;
+};
+std::mutex inputMutex;
+Input pendingInput;
+bool firstMouse = true;
+double lastX = .0;
+double lastY = .0;
+
+// everything the renderer needs from a frame, one copy per frame in flight
+struct Scene {
+  Camera camera = Camera(glm::vec3(.0f, .0f, 60.0f));
+  double time = 0.0;
+  glm::mat4 viewProjection = glm::mat4(1.0f);
+  std::vector<glm::mat4> transforms;
+  std::vector<unsigned char> visible;
+  unsigned int visibleCount = 0;
+};
+
+// static description of a spinning cube
+struct Object {
+  glm::vec3 position;
+  glm::vec3 axis;
+  float speed;
+  glm::vec4 color;
+};
+
+void framebufferSizeCallback(GLFWwindow *window, int width, int height);
+void mouseCallback(GLFWwindow *window, double x, double y);
+void scrollCallback(GLFWwindow *window, double xOffset, double yOffset);
+void processInput(GLFWwindow *window);
+// everything that owns GL objects, which are deleted when it returns, while the context is still current
+int run(GLFWwindow *window, bool bench, int latency);
+
+int main(int argc, char **argv) {
+  // --latency 0|1|2 picks how far the update may run ahead, --bench compares all three
+  bool bench = false;
+  int latency = 1;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--bench")
+      bench = true;
+    else if (arg == "--latency" && i + 1 < argc)
+      latency = std::stoi(argv[++i]);
+  }
+
+  if (!glfwInit()) {
+    std::cerr << "failed to init GLFW" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+  GLFWwindow *window;
+  // create a windowed mode window and its OpenGL context
+  if (window = glfwCreateWindow(WIN_WIDTH, WIN_HEIGHT, "Hello CG", nullptr, nullptr); !window) {
+    glfwTerminate();
+    return EXIT_FAILURE;
+  }
+
+  glfwMakeContextCurrent(window); // make the window's context current
+  glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+  glfwSetCursorPosCallback(window, mouseCallback);
+  glfwSetScrollCallback(window, scrollCallback);
+  glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+  // load all OpenGL function pointers
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+    std::cerr << "failed to initialize GLAD" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  int result = run(window, bench, latency);
+  glfwTerminate();
+  return result;
+}
+
+int run(GLFWwindow *window, bool bench, int latency) {
+  if (bench) {
+    glfwSwapInterval(0);
+  }
+
+  // configure global opengl state
+  glad_glEnable(GL_DEPTH_TEST);
+
+  // build and compile shaders
+  Shader shader("shaders/command-list.vert", "shaders/command-list.frag");
+
+  // set up vertex data
+
+  float vertices[] = {
+      // clang-format off
+      // positions          // normals           // texture coords
+      -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
+       0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 0.0f,
+       0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
+       0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
+      -0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 1.0f,
+      -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
+
+      -0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
+       0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 0.0f,
+       0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
+       0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
+      -0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 1.0f,
+      -0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
+
+      -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+      -0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
+      -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+      -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+      -0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
+      -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+
+      0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+      0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
+      0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+      0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+      0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
+      0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+
+      -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
+       0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 1.0f,
+       0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
+       0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
+      -0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 0.0f,
+      -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
+
+      -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f,
+       0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 1.0f,
+       0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
+       0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
+      -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 0.0f,
+      -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f
+      // clang-format on
+  };
+
+  unsigned int VBO, cubeVAO;
+  glGenVertexArrays(1, &cubeVAO);
+  glGenBuffers(1, &VBO);
+
+  glBindBuffer(GL_ARRAY_BUFFER, VBO);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+  glBindVertexArray(cubeVAO);
+
+  // position attribute
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GL_FLOAT), nullptr);
+  glEnableVertexAttribArray(0);
+  // normal attribute
+  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GL_FLOAT), (void *)(3 * sizeof(GL_FLOAT)));
+  glEnableVertexAttribArray(1);
+  glBindVertexArray(0);
+
+  std::vector<Object> objects(OBJECT_COUNT);
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  for (auto &o : objects) {
+    o.position = glm::vec3(unit(rng) * 120.0f - 60.0f, unit(rng) * 80.0f - 40.0f, unit(rng) * -150.0f);
+    o.axis = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) + glm::vec3(0.01f));
+    o.speed = 0.5f + unit(rng) * 2.0f;
+    o.color = glm::vec4(0.3f + 0.7f * unit(rng), 0.3f + 0.7f * unit(rng), 0.3f + 0.7f * unit(rng), 1.0f);
+  }
+  AABB cubeBounds = {glm::vec3(-0.5f), glm::vec3(0.5f)};
+
+  Scene initial;
+  initial.camera.setProjection(0.1f, 500.0f);
+  initial.camera.setViewport(WIN_WIDTH, WIN_HEIGHT);
+  initial.transforms.resize(OBJECT_COUNT);
+  initial.visible.resize(OBJECT_COUNT);
+
+  // the update only ever runs on one thread at a time, so it can own the job system
+  JobSystem jobs;
+  double startTime = glfwGetTime();
+
+  // runs on the pipeline's thread: never touches GL or glfw windows
+  auto update = [&](Scene &next, const Scene &previous, uint64_t frame) {
+    Input input;
+    {
+      std::lock_guard<std::mutex> lock(inputMutex);
+      input = pendingInput;
+      pendingInput.mouseX = pendingInput.mouseY = pendingInput.scroll = 0.0f;
+      pendingInput.width = pendingInput.height = 0;
+    }
+
+    double time = bench ? frame * 0.016 : glfwGetTime() - startTime;
+    float deltaTime = frame == 0 ? 0.0f : (float)(time - previous.time);
+    next.time = time;
+    next.camera = previous.camera;
+    next.camera.processMouseMovement(input.mouseX, input.mouseY);
+    next.camera.processMouseScroll(input.scroll);
+    if (input.width > 0 && input.height > 0)
+      next.camera.setViewport(input.width, input.height);
+    if (input.forward)
+      next.camera.processKeyboard(FORWARD, deltaTime);
+    else if (input.backward)
+      next.camera.processKeyboard(BACKWARD, deltaTime);
+    else if (input.left)
+      next.camera.processKeyboard(LEFT, deltaTime);
+    else if (input.right)
+      next.camera.processKeyboard(RIGHT, deltaTime);
+
+    next.viewProjection = next.camera.getViewProjectionMatrix();
+    const Frustum &frustum = next.camera.getFrustum();
+
+    std::vector<unsigned int> counts(jobs.threadCount(), 0);
+    jobs.parallelFor(objects.size(), 1024, [&](size_t begin, size_t end, unsigned int thread) {
+      for (size_t i = begin; i < end; ++i) {
+        const Object &o = objects[i];
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), o.position);
+        model = glm::rotate(model, (float)time * o.speed, o.axis);
+        next.transforms[i] = model;
+        next.visible[i] = frustum.intersects(cubeBounds.transformed(model));
+        counts[thread] += next.visible[i];
+      }
+    });
+    next.visibleCount = 0;
+    for (unsigned int c : counts) {
+      next.visibleCount += c;
+    }
+  };
+
+  // the render thread only reads the scene it was handed
+  auto render = [&](const Scene &scene) {
+    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    shader.use();
+    shader.setMat4("viewProjection", scene.viewProjection);
+    glBindVertexArray(cubeVAO);
+    for (size_t i = 0; i < objects.size(); ++i) {
+      if (!scene.visible[i])
+        continue;
+      shader.setMat4("model", scene.transforms[i]);
+      shader.setVec4("color", objects[i].color);
+      glDrawArrays(GL_TRIANGLES, 0, 36);
+    }
+    glBindVertexArray(0);
+  };
+
+  auto printStats = [](const char *name, const FramePipeline<Scene>::Stats &stats) {
+    std::cout << name << ": frame " << stats.frameMs << " ms (p50 " << stats.frameP50Ms << ", p99 " << stats.frameP99Ms
+              << ", jitter " << stats.jitterMs << "), update " << stats.updateMs << " ms, render waited "
+              << stats.renderWaitMs << " ms, update waited " << stats.updateWaitMs << " ms, latency "
+              << stats.latencyMs << " ms" << std::endl;
+  };
+
+  if (bench) {
+    const int WARMUP_FRAMES = 30;
+    const int BENCH_FRAMES = 300;
+    const char *names[] = {"lock-step", "latency 1", "latency 2"};
+    std::cout << OBJECT_COUNT << " objects, update on " << jobs.threadCount() << " threads" << std::endl;
+    for (int l = 0; l <= 2; ++l) {
+      FramePipeline<Scene> pipeline(l, initial, update);
+      for (int frame = 0; frame < WARMUP_FRAMES + BENCH_FRAMES; ++frame) {
+        if (frame == WARMUP_FRAMES)
+          pipeline.resetStats();
+        render(pipeline.acquire());
+        pipeline.release();
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+      }
+      printStats(names[l], pipeline.getStats());
+    }
+    return EXIT_SUCCESS;
+  }
+
+  FramePipeline<Scene> pipeline(latency, initial, update);
+  double statsTime = glfwGetTime();
+
+  while (!glfwWindowShouldClose(window)) {
+    processInput(window);
+
+    const Scene &scene = pipeline.acquire();
+    render(scene);
+    unsigned int visible = scene.visibleCount;
+    // the scene may be reused by the update as soon as the GL commands reading it are issued
+    pipeline.release();
+
+    double currentFrame = glfwGetTime();
+    if (currentFrame - statsTime >= 1.0) {
+      std::cout << visible << " visible, ";
+      printStats(latency == 0 ? "lock-step" : latency == 1 ? "latency 1" : "latency 2", pipeline.getStats());
+      pipeline.resetStats();
+      statsTime = currentFrame;
+    }
+
+    /* Swap front and back buffers */
+    glfwSwapBuffers(window);
+
+    /* Poll for and process events */
+    glfwPollEvents();
+  }
+
+  glad_glDeleteVertexArrays(1, &cubeVAO);
+  glad_glDeleteBuffers(1, &VBO);
+
+  return EXIT_SUCCESS;
+}
+
+void mouseCallback(GLFWwindow *window, double x, double y) {
+  if (firstMouse) {
+    lastX = x;
+    lastY = y;
+    firstMouse = false;
+  }
+
+  auto xOffset = lastX - x;
+  auto yOffset = y - lastY;
+  lastX = x;
+  lastY = y;
+
+  std::lock_guard<std::mutex> lock(inputMutex);
+  pendingInput.mouseX += xOffset;
+  pendingInput.mouseY += yOffset;
+}
+
+void scrollCallback(GLFWwindow *window, double xOffset, double yOffset) {
+  std::lock_guard<std::mutex> lock(inputMutex);
+  pendingInput.scroll += yOffset;
+}
+
+// glfw: whenever the window size changed, this callback function executes
+void framebufferSizeCallback(GLFWwindow *window, int width, int height) {
+  // make sure the viewport matches the new window dimensions; note that width and height will be significantly larger
+  // than specified on retina displays
+  glViewport(0, 0, width, height);
+  // the camera belongs to the update thread, it picks the size up with the next input
+  std::lock_guard<std::mutex> lock(inputMutex);
+  pendingInput.width = width;
+  pendingInput.height = height;
+}
+
+void processInput(GLFWwindow *window) {
+  if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+    glfwSetWindowShouldClose(window, true);
+
+  std::lock_guard<std::mutex> lock(inputMutex);
+  pendingInput.forward = glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS;
+  pendingInput.backward = glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS;
+  pendingInput.left = glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS;
+  pendingInput.right = glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS;
+}
@@ -2,17 +2,23 @@
 #include <GLFW/glfw3.h>
 #include <glad/glad.h>
 
-#define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <cstddef>
 #include <iostream>
+#include <vector>
 
 #include <base/camera.h>
+#include <base/components.h>
+#include <base/ecs.h>
+#include <base/job_system.h>
 #include <base/shader.h>
+#include <base/shadows.h>
+#include <base/transform_batch.h>
 
 // settings
 const int WIN_WIDTH = 800;
@@ -31,14 +37,13 @@ float lastFrame = .0f;
 // how much we're seeing of either texture
 float mixValue = 0.2f;
 
-// lighting
-glm::vec3 lightPos(1.2f, 1.0f, 2.0f);
-
 void framebufferSizeCallback(GLFWwindow *window, int width, int height);
 void mouseCallback(GLFWwindow *window, double x, double y);
 void scrollCallback(GLFWwindow *window, double xOffset, double yOffset);
 void processInput(GLFWwindow *window);
 unsigned int loadTexture(const char *path);
+// everything that owns GL objects, which are deleted when it returns, while the context is still current
+int run(GLFWwindow *window);
 
 int main(int argc, char **argv) {
   if (!glfwInit()) {
@@ -62,6 +67,7 @@ int main(int argc, char **argv) {
 
   glfwMakeContextCurrent(window); // make the window's context current
   glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+  camera.setViewport(WIN_WIDTH, WIN_HEIGHT);
   glfwSetCursorPosCallback(window, mouseCallback);
   glfwSetScrollCallback(window, scrollCallback);
   glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -72,6 +78,12 @@ int main(int argc, char **argv) {
     return EXIT_FAILURE;
   }
 
+  int result = run(window);
+  glfwTerminate();
+  return result;
+}
+
+int run(GLFWwindow *window) {
   int attrCount;
   glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &attrCount);
   std::cout << "GL_MAX_VERTEX_ATTRIBS: " << attrCount << std::endl;
@@ -133,30 +145,6 @@ int main(int argc, char **argv) {
       // clang-format on
   };
 
-  glm::vec3 cubePositions[] = {
-      // clang-format off
-      glm::vec3( 0.0f,  0.0f,  0.0f),
-      glm::vec3( 2.0f,  5.0f, -15.0f),
-      glm::vec3(-1.5f, -2.2f, -2.5f),
-      glm::vec3(-3.8f, -2.0f, -12.3f),
-      glm::vec3( 2.4f, -0.4f, -3.5f),
-      glm::vec3(-1.7f,  3.0f, -7.5f),
-      glm::vec3( 1.3f, -2.0f, -2.5f),
-      glm::vec3( 1.5f,  2.0f, -2.5f),
-      glm::vec3( 1.5f,  0.2f, -1.5f),
-      glm::vec3(-1.3f,  1.0f, -1.5f)
-      // clang-format on
-  };
-
-  glm::vec3 pointLightPositions[] = {
-      // clang-format off
-      glm::vec3( 0.7f,  0.2f,  2.0f),
-      glm::vec3( 2.3f, -3.3f, -4.0f),
-      glm::vec3(-4.0f,  2.0f, -12.0f),
-      glm::vec3( 0.0f,  0.0f, -3.0f)
-      // clang-format on
-  };
-
   // first, configure the cube's VAO
   unsigned int VBO, cubeVAO;
   glGenVertexArrays(1, &cubeVAO);
@@ -177,6 +165,23 @@ int main(int argc, char **argv) {
   glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GL_FLOAT), (void *)(6 * sizeof(GL_FLOAT)));
   glEnableVertexAttribArray(2);
 
+  // per instance model and normal matrices, refilled every frame
+  unsigned int instanceVBO;
+  glGenBuffers(1, &instanceVBO);
+  glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+  for (unsigned int i = 0; i < 4; i++) {
+    glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, sizeof(transform::Instance),
+                          (void *)(offsetof(transform::Instance, model) + i * sizeof(glm::vec4)));
+    glEnableVertexAttribArray(3 + i);
+    glVertexAttribDivisor(3 + i, 1);
+  }
+  for (unsigned int i = 0; i < 3; i++) {
+    glVertexAttribPointer(7 + i, 3, GL_FLOAT, GL_FALSE, sizeof(transform::Instance),
+                          (void *)(offsetof(transform::Instance, normal) + i * sizeof(glm::vec4)));
+    glEnableVertexAttribArray(7 + i);
+    glVertexAttribDivisor(7 + i, 1);
+  }
+
   // second, configure the light's VAO
   unsigned int lightCubeVAO;
   glad_glGenVertexArrays(1, &lightCubeVAO);
@@ -194,6 +199,67 @@ int main(int argc, char **argv) {
   lightingShader.setInt("material.diffuse", 0);
   lightingShader.setInt("material.specular", 1);
 
+  // the scene lives in the registry: containers are drawn with the lighting shader, lights feed its pointLights[] and
+  // are drawn as small cubes
+  ecs::Registry registry;
+  JobSystem jobs;
+  const glm::vec3 cubePositions[] = {
+      // clang-format off
+      glm::vec3( 0.0f,  0.0f,  0.0f),
+      glm::vec3( 2.0f,  5.0f, -15.0f),
+      glm::vec3(-1.5f, -2.2f, -2.5f),
+      glm::vec3(-3.8f, -2.0f, -12.3f),
+      glm::vec3( 2.4f, -0.4f, -3.5f),
+      glm::vec3(-1.7f,  3.0f, -7.5f),
+      glm::vec3( 1.3f, -2.0f, -2.5f),
+      glm::vec3( 1.5f,  2.0f, -2.5f),
+      glm::vec3( 1.5f,  0.2f, -1.5f),
+      glm::vec3(-1.3f,  1.0f, -1.5f)
+      // clang-format on
+  };
+
+  const glm::vec3 pointLightPositions[] = {
+      // clang-format off
+      glm::vec3( 0.7f,  0.2f,  2.0f),
+      glm::vec3( 2.3f, -3.3f, -4.0f),
+      glm::vec3(-4.0f,  2.0f, -12.0f),
+      glm::vec3( 0.0f,  0.0f, -3.0f)
+      // clang-format on
+  };
+
+  for (unsigned int i = 0; i < 10; i++) {
+    Transform transform;
+    transform.position = cubePositions[i];
+    float angle = 20.0f * i;
+    transform.rotation = glm::angleAxis(glm::radians(angle), glm::normalize(glm::vec3(1.0f, 0.3f, 0.5f)));
+    registry.create(transform, WorldTransform(), MeshRef{cubeVAO, 36, 0});
+  }
+  // a flattened container as the ground so there is something to cast shadows onto
+  {
+    Transform transform;
+    transform.position = glm::vec3(0.0f, -4.0f, -6.0f);
+    transform.scale = glm::vec3(30.0f, 0.2f, 30.0f);
+    registry.create(transform, WorldTransform(), MeshRef{cubeVAO, 36, 0});
+  }
+  for (unsigned int i = 0; i < 4; i++) {
+    Transform transform;
+    transform.position = pointLightPositions[i];
+    transform.scale = glm::vec3(0.2f); // make it smaller
+    registry.create(transform, WorldTransform(), PointLight());
+  }
+  updateTransforms(registry, jobs);
+
+  transform::Batch batch;
+  std::vector<transform::Instance> instances;
+  std::cout << "transform batches: " << transform::pathName(transform::bestPath()) << std::endl;
+
+  // shadows of the directional light, the containers never move so they are all static casters
+  const glm::vec3 lightDirection(-0.2f, -1.0f, -0.3f);
+  CascadedShadowMap shadows;
+  AABB casterBox;
+  const AABB unitCube{glm::vec3(-0.5f), glm::vec3(0.5f)};
+  double lastReport = glfwGetTime();
+
   while (!glfwWindowShouldClose(window)) {
     double currentFrame = glfwGetTime();
     deltaTime = currentFrame - lastFrame;
@@ -201,64 +267,55 @@ int main(int argc, char **argv) {
 
     processInput(window);
 
+    // view/projection transformations
+    const glm::mat4 &projection = camera.getProjectionMatrix();
+    const glm::mat4 &view = camera.getViewMatrix();
+
+    // gather the container transforms and compose all model and normal matrices in one batch, both the shadow and
+    // the lighting pass draw them with a single instanced call
+    size_t containers = 0;
+    registry.eachChunk<Transform, MeshRef>([&](size_t n, Transform *, MeshRef *) { containers += n; });
+    batch.resize(containers);
+    size_t next = 0;
+    registry.each<Transform, MeshRef>(
+        [&](Transform &t, MeshRef &) { batch.set(next++, t.position, t.rotation, t.scale); });
+    instances.resize(batch.size());
+    transform::compose(batch, instances.data());
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(transform::Instance), instances.data(), GL_STREAM_DRAW);
+    casterBox = AABB();
+    for (const auto &instance : instances)
+      casterBox.expand(unitCube.transformed(instance.model));
+
+    shadows.update(view, glm::radians(camera.getZoom()), camera.getAspect(), camera.getNear(), lightDirection);
+    shadows.render([&](Shader &depthShader) {
+      if (!shadows.beginCaster(casterBox))
+        return;
+      depthShader.setBool("instanced", true);
+      glBindVertexArray(cubeVAO);
+      glDrawArraysInstanced(GL_TRIANGLES, 0, 36, (GLsizei)instances.size());
+    });
+
     // render
     glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     lightingShader.use();
     // directional light
-    lightingShader.setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
+    lightingShader.setVec3("dirLight.direction", lightDirection);
     lightingShader.setVec3("dirLight.ambient", 0.05f, 0.05f, 0.05f);
     lightingShader.setVec3("dirLight.diffuse", 0.4f, 0.4f, 0.4f);
     lightingShader.setVec3("dirLight.specular", 0.5f, 0.5f, 0.5f);
-    // point light 1
-    lightingShader.setVec3("pointLights[0].position", pointLightPositions[0]);
-    lightingShader.setVec3("pointLights[0].ambient", 0.05f, 0.05f, 0.05f);
-    lightingShader.setVec3("pointLights[0].diffuse", 0.8f, 0.8f, 0.8f);
-    lightingShader.setVec3("pointLights[0].specular", 1.0f, 1.0f, 1.0f);
-    lightingShader.setFloat("pointLights[0].constant", 1.0f);
-    lightingShader.setFloat("pointLights[0].linear", 0.09);
-    lightingShader.setFloat("pointLights[0].quadratic", 0.032);
-    // point light 2
-    lightingShader.setVec3("pointLights[1].position", pointLightPositions[1]);
-    lightingShader.setVec3("pointLights[1].ambient", 0.05f, 0.05f, 0.05f);
-    lightingShader.setVec3("pointLights[1].diffuse", 0.8f, 0.8f, 0.8f);
-    lightingShader.setVec3("pointLights[1].specular", 1.0f, 1.0f, 1.0f);
-    lightingShader.setFloat("pointLights[1].constant", 1.0f);
-    lightingShader.setFloat("pointLights[1].linear", 0.09);
-    lightingShader.setFloat("pointLights[1].quadratic", 0.032);
-    // point light 3
-    lightingShader.setVec3("pointLights[2].position", pointLightPositions[2]);
-    lightingShader.setVec3("pointLights[2].ambient", 0.05f, 0.05f, 0.05f);
-    lightingShader.setVec3("pointLights[2].diffuse", 0.8f, 0.8f, 0.8f);
-    lightingShader.setVec3("pointLights[2].specular", 1.0f, 1.0f, 1.0f);
-    lightingShader.setFloat("pointLights[2].constant", 1.0f);
-    lightingShader.setFloat("pointLights[2].linear", 0.09);
-    lightingShader.setFloat("pointLights[2].quadratic", 0.032);
-    // point light 4
-    lightingShader.setVec3("pointLights[3].position", pointLightPositions[3]);
-    lightingShader.setVec3("pointLights[3].ambient", 0.05f, 0.05f, 0.05f);
-    lightingShader.setVec3("pointLights[3].diffuse", 0.8f, 0.8f, 0.8f);
-    lightingShader.setVec3("pointLights[3].specular", 1.0f, 1.0f, 1.0f);
-    lightingShader.setFloat("pointLights[3].constant", 1.0f);
-    lightingShader.setFloat("pointLights[3].linear", 0.09);
-    lightingShader.setFloat("pointLights[3].quadratic", 0.032);
+    // point lights
+    uploadPointLights(registry, lightingShader, 4);
 
     lightingShader.setFloat("material.shininess", 32.0f);
 
-    lightingShader.setVec3("viewPos", camera.position);
+    lightingShader.setVec3("viewPos", camera.getPosition());
 
-    // view/projection transformations
-    glm::mat4 projection =
-        glm::perspective(glm::radians(camera.zoom), (float)WIN_WIDTH / (float)WIN_HEIGHT, 0.1f, 100.0f);
-    glm::mat4 view = camera.getViewMatrix();
     lightingShader.setMat4("projection", projection);
     lightingShader.setMat4("view", view);
 
-    // world transformation
-    glm::mat4 model = glm::mat4(1.0f);
-    lightingShader.setMat4("model", model);
-
     // bind diffuse map
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, diffuseMap);
@@ -266,17 +323,11 @@ int main(int argc, char **argv) {
     glActiveTexture(GL_TEXTURE1);
     glBindTexture(GL_TEXTURE_2D, specularMap);
 
-    // render the cube
-    glBindVertexArray(cubeVAO);
-    for (unsigned int i = 0; i < 10; i++) {
-      glm::mat4 model(1.0f);
-      model = glm::translate(model, cubePositions[i]);
-      float angle = 20.0f * i;
-      model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-      lightingShader.setMat4("model", model);
+    shadows.bind(lightingShader, 2);
 
-      glDrawArrays(GL_TRIANGLES, 0, 36);
-    }
+    // render the containers
+    glBindVertexArray(cubeVAO);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 36, (GLsizei)instances.size());
 
     // also draw the lamp object(s)
     lightCubeShader.use();
@@ -285,12 +336,23 @@ int main(int argc, char **argv) {
 
     // we now draw as many light bulbs as we have point lights
     glBindVertexArray(lightCubeVAO);
-    for (unsigned int i = 0; i < 4; i++) {
-      model = glm::mat4(1.0f);
-      model = glm::translate(model, pointLightPositions[i]);
-      model = glm::scale(model, glm::vec3(0.2f)); // make it smaller
-      lightCubeShader.setMat4("model", model);
+    registry.each<WorldTransform, PointLight>([&](WorldTransform &world, PointLight &) {
+      lightCubeShader.setMat4("model", world.matrix);
       glDrawArrays(GL_TRIANGLES, 0, 36);
+    });
+
+    if (currentFrame - lastReport >= 1.0) {
+      lastReport = currentFrame;
+      const auto &stats = shadows.getStats();
+      std::cout << "shadows: " << stats.passes << " pass(es), " << stats.draws << " draw(s), " << stats.gpuMs
+                << " ms, " << stats.cacheHits << " cache hit(s)" << std::endl;
+      for (int i = 0; i < stats.cascades; ++i) {
+        const auto &cascade = stats.cascade[i];
+        std::cout << "  cascade " << i << ": to " << cascade.splitFar << ", " << cascade.draws << " draw(s), "
+                  << cascade.gpuMs << " ms" << (cascade.cached ? (cascade.rendered ? ", cached (rendered)" : ", cached")
+                                                               : "")
+                  << std::endl;
+      }
     }
 
     /* Swap front and back buffers */
@@ -303,8 +365,7 @@ int main(int argc, char **argv) {
   glad_glDeleteVertexArrays(1, &cubeVAO);
   glad_glDeleteVertexArrays(1, &lightCubeVAO);
   glad_glDeleteBuffers(1, &VBO);
-
-  glfwTerminate();
+  glad_glDeleteBuffers(1, &instanceVBO);
 
   return EXIT_SUCCESS;
 }
@@ -331,6 +392,7 @@ void framebufferSizeCallback(GLFWwindow *window, int width, int height) {
   // make sure the viewport matches the new window dimensions; note that width and height will be significantly larger
   // than specified on retina displays
   glViewport(0, 0, width, height);
+  camera.setViewport(width, height);
 }
 
 void processInput(GLFWwindow *window) {
@@ -6,7 +6,10 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <memory>
 
 #include <base/camera.h>
 #include <base/model.h>
@@ -30,6 +33,8 @@ void framebufferSizeCallback(GLFWwindow *window, int width, int height);
 void mouseCallback(GLFWwindow *window, double x, double y);
 void scrollCallback(GLFWwindow *window, double xOffset, double yOffset);
 void processInput(GLFWwindow *window);
+// everything that owns GL objects, which are deleted when it returns, while the context is still current
+int run(GLFWwindow *window, int argc, char **argv);
 
 int main(int argc, char **argv) {
   if (!glfwInit()) {
@@ -53,6 +58,7 @@ int main(int argc, char **argv) {
 
   glfwMakeContextCurrent(window); // make the window's context current
   glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+  camera.setViewport(WIN_WIDTH, WIN_HEIGHT);
   glfwSetCursorPosCallback(window, mouseCallback);
   glfwSetScrollCallback(window, scrollCallback);
   glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -63,6 +69,12 @@ int main(int argc, char **argv) {
     return EXIT_FAILURE;
   }
 
+  int result = run(window, argc, argv);
+  glfwTerminate();
+  return result;
+}
+
+int run(GLFWwindow *window, int argc, char **argv) {
   int attrCount;
   glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &attrCount);
   std::cout << "GL_MAX_VERTEX_ATTRIBS: " << attrCount << std::endl;
@@ -71,12 +83,46 @@ int main(int argc, char **argv) {
   // configure global opengl state
   glad_glEnable(GL_DEPTH_TEST);
 
+  // --legacy binds each mesh's textures by name like before, by default all materials share one texture array and
+  // one uniform buffer
+  // --stream <MB> implies --legacy and streams the textures' mip levels in under a VRAM budget
+  // any other argument is the model to load instead of the nanosuit, .obj, .glb/.gltf or whatever assimp reads
+  bool legacy = false;
+  size_t streamBudget = 0;
+  const char *path = "nanosuit/nanosuit.obj";
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--legacy") == 0) {
+      legacy = true;
+    } else if (std::strcmp(argv[i], "--stream") == 0 && i + 1 < argc) {
+      legacy = true;
+      streamBudget = (size_t)std::atoi(argv[++i]) << 20;
+    } else {
+      path = argv[i];
+    }
+  }
+
   // build and compile shaders
-  Shader shader("shaders/model_loading.vert", "shaders/model_loading.frag");
+  Shader shader("shaders/model_loading.vert", legacy ? "shaders/model_loading.frag" : "shaders/material.frag");
 
   // load model
-  Model ourModel("nanosuit/nanosuit.obj");
+  std::unique_ptr<MaterialLibrary> materials;
+  if (!legacy)
+    materials = std::make_unique<MaterialLibrary>();
+  std::unique_ptr<TextureStreamer> streamer;
+  if (streamBudget > 0)
+    streamer = std::make_unique<TextureStreamer>(streamBudget);
+  JobSystem jobs;
+  double loadStart = glfwGetTime();
+  Model ourModel(path, materials.get(), streamer.get(), &jobs);
+  std::cout << "loaded " << path << " in " << (glfwGetTime() - loadStart) * 1000.0 << " ms" << std::endl;
+  if (materials) {
+    materials->upload();
+    auto stats = materials->getStats();
+    std::cout << "materials: " << stats.materials << ", texture array layers: " << stats.layers << " ("
+              << stats.textureBytes / (1024 * 1024) << " MB)" << std::endl;
+  }
 
+  double lastReport = glfwGetTime();
   while (!glfwWindowShouldClose(window)) {
     double currentFrame = glfwGetTime();
     deltaTime = currentFrame - lastFrame;
@@ -89,21 +135,39 @@ int main(int argc, char **argv) {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     shader.use();
+    if (materials)
+      materials->bind(shader);
 
     // view/projection transformations
-    glm::mat4 projection =
-        glm::perspective(glm::radians(camera.zoom), (float)WIN_WIDTH / (float)WIN_HEIGHT, 0.1f, 100.0f);
-    glm::mat4 view = camera.getViewMatrix();
-    shader.setMat4("projection", projection);
-    shader.setMat4("view", view);
+    shader.setMat4("projection", camera.getProjectionMatrix());
+    shader.setMat4("view", camera.getViewMatrix());
 
     // render the loaded model
     glm::mat4 model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f)); // translate it down so it's at the center of the scene
     model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));     // it's a bit too big for our scene, so scale it down
-    shader.setMat4("model", model);
 
-    ourModel.draw(shader);
+    // the streamer uploads the levels the meshes need at their size on screen before they are drawn
+    if (streamer) {
+      int viewport[4];
+      glGetIntegerv(GL_VIEWPORT, viewport);
+      streamer->beginFrame(camera.getViewMatrix(), camera.getProjectionMatrix(), viewport[3]);
+      ourModel.requestTextures(model);
+      streamer->update();
+      if (currentFrame - lastReport >= 1.0) {
+        auto stats = streamer->getStats();
+        std::cout << "streaming: " << stats.residentBytes / 1024 << " / " << stats.budgetBytes / 1024
+                  << " KB resident, " << stats.uploadBytesPerSecond / (1024 * 1024) << " MB/s, " << stats.pending
+                  << " textures pending, " << stats.totalEvictedBytes / 1024 << " KB evicted" << std::endl;
+        lastReport = currentFrame;
+      }
+    }
+
+    // places every mesh by its node transform
+    if (materials)
+      ourModel.drawMaterials(shader, model);
+    else
+      ourModel.draw(shader, model);
 
     /* Swap front and back buffers */
     glfwSwapBuffers(window);
@@ -112,8 +176,6 @@ int main(int argc, char **argv) {
     glfwPollEvents();
   }
 
-  glfwTerminate();
-
   return EXIT_SUCCESS;
 }
 
@@ -139,6 +201,7 @@ void framebufferSizeCallback(GLFWwindow *window, int width, int height) {
   // make sure the viewport matches the new window dimensions; note that width and height will be significantly larger
   // than specified on retina displays
   glViewport(0, 0, width, height);
+  camera.setViewport(width, height);
 }
 
 void processInput(GLFWwindow *window) {
@@ -0,0 +1,302 @@
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <base/camera.h>
+#include <base/depth.h>
+#include <base/framebuffer.h>
+#include <base/gpu_timer.h>
+#include <base/hiz.h>
+#include <base/model.h>
+#include <base/shader.h>
+
+// settings
+const int WIN_WIDTH = 800;
+const int WIN_HEIGHT = 600;
+// nanosuits hidden behind the wall
+const int GRID_SIZE = 12;
+const float GRID_SPACING = 8.0f;
+
+// camera
+Camera camera(glm::vec3(.0f, 10.0f, 30.0f));
+bool firstMouse = true;
+double lastX = .0;
+double lastY = .0;
+
+// timing
+float deltaTime = .0f; // time between current frame and last frame
+float lastFrame = .0f;
+
+// toggles
+bool occlusionCulling = true;
+bool depthPrepass = true;
+
+void framebufferSizeCallback(GLFWwindow *window, int width, int height);
+void mouseCallback(GLFWwindow *window, double x, double y);
+void scrollCallback(GLFWwindow *window, double xOffset, double yOffset);
+void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods);
+void processInput(GLFWwindow *window);
+// everything that owns GL objects, which are deleted when it returns, while the context is still current
+int run(GLFWwindow *window, bool reversedZ);
+
+int main(int argc, char **argv) {
+  // --reversed-z: reversed float depth with an infinite far plane instead of a far plane at 200
+  bool reversedZ = false;
+  for (int i = 1; i < argc; ++i) {
+    if (std::string(argv[i]) == "--reversed-z")
+      reversedZ = true;
+  }
+
+  if (!glfwInit()) {
+    std::cerr << "failed to init GLFW" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+  GLFWwindow *window;
+  // create a windowed mode window and its OpenGL context
+  if (window = glfwCreateWindow(WIN_WIDTH, WIN_HEIGHT, "Hello CG", nullptr, nullptr); !window) {
+    glfwTerminate();
+    return EXIT_FAILURE;
+  }
+
+  glfwMakeContextCurrent(window); // make the window's context current
+  glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+  camera.setViewport(WIN_WIDTH, WIN_HEIGHT);
+  glfwSetCursorPosCallback(window, mouseCallback);
+  glfwSetScrollCallback(window, scrollCallback);
+  glfwSetKeyCallback(window, keyCallback);
+  glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+  // load all OpenGL function pointers
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+    std::cerr << "failed to initialize GLAD" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  int result = run(window, reversedZ);
+  glfwTerminate();
+  return result;
+}
+
+int run(GLFWwindow *window, bool reversedZ) {
+  // configure global opengl state
+  glad_glEnable(GL_DEPTH_TEST);
+  if (reversedZ && depth::setMode(depth::Mode::REVERSED) != depth::Mode::REVERSED) {
+    std::cerr << "reversed-Z needs GL 4.5 or GL_ARB_clip_control, using the standard depth range" << std::endl;
+    reversedZ = false;
+  }
+  camera.setProjection(0.1f, reversedZ ? Camera::INFINITE_FAR : 200.0f, reversedZ);
+
+  // build and compile shaders
+  Shader shader("shaders/model_loading.vert", "shaders/model_loading.frag");
+  Shader depthShader("shaders/depth-prepass.vert", "shaders/depth-prepass.frag");
+
+  // load model
+  Model ourModel("nanosuit/nanosuit.obj");
+
+  // the occluder is a single wall made of a textured cube, laid out like Vertex so the model shader can draw it
+  std::vector<Vertex> wallVertices;
+  std::vector<unsigned int> wallIndices;
+  for (int face = 0; face < 6; ++face) {
+    int axis = face / 2;
+    float sign = (face & 1) ? 1.0f : -1.0f;
+    glm::vec3 normal(0.0f);
+    normal[axis] = sign;
+    glm::vec3 u(0.0f), v(0.0f);
+    u[(axis + 1) % 3] = 0.5f;
+    v[(axis + 2) % 3] = 0.5f;
+    unsigned int base = wallVertices.size();
+    for (int corner = 0; corner < 4; ++corner) {
+      float cu = (corner & 1) ? 1.0f : -1.0f, cv = (corner & 2) ? 1.0f : -1.0f;
+      wallVertices.push_back({normal * 0.5f + u * cu + v * cv, normal, glm::vec2(cu, cv) * 0.5f + 0.5f});
+    }
+    wallIndices.insert(wallIndices.end(), {base, base + 1, base + 3, base, base + 3, base + 2});
+  }
+  GLTexture wallImage(textureFromFile("wall.jpg", "textures"));
+  Texture wallTexture;
+  wallTexture.id = wallImage.get();
+  wallTexture.type = "texture_diffuse";
+  wallTexture.path = "wall.jpg";
+  Mesh wall(wallVertices, wallIndices, {wallTexture});
+  glm::mat4 wallModel = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 20.0f, -5.0f));
+  wallModel = glm::scale(wallModel, glm::vec3(80.0f, 40.0f, 1.0f));
+
+  std::vector<glm::mat4> instances;
+  for (int z = 0; z < GRID_SIZE; ++z) {
+    for (int x = 0; x < GRID_SIZE; ++x) {
+      glm::vec3 offset((x - GRID_SIZE / 2) * GRID_SPACING * 0.5f, 0.0f, -10.0f - z * GRID_SPACING);
+      instances.push_back(glm::translate(glm::mat4(1.0f), offset));
+    }
+  }
+
+  // the scene is rendered offscreen so the depth can be sampled to build the pyramid
+  int fbWidth, fbHeight;
+  glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+  Framebuffer scene(fbWidth, fbHeight);
+  scene.addColor(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+  scene.setDepth(GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT);
+  if (!scene.complete()) {
+    return EXIT_FAILURE;
+  }
+  HiZBuffer hiz(fbWidth, fbHeight);
+  hiz.setReversedZ(reversedZ);
+  GpuTimer gpuTimer;
+
+  std::vector<Mesh> &meshes = ourModel.getMeshes();
+  std::vector<const glm::mat4 *> drawInstances;
+  std::vector<std::pair<Mesh *, const glm::mat4 *>> drawList;
+  double statsTime = glfwGetTime();
+  int frames = 0;
+
+  while (!glfwWindowShouldClose(window)) {
+    double currentFrame = glfwGetTime();
+    deltaTime = currentFrame - lastFrame;
+    lastFrame = currentFrame;
+
+    processInput(window);
+
+    glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+    scene.resize(fbWidth, fbHeight);
+    hiz.resize(fbWidth, fbHeight);
+
+    const glm::mat4 &projection = camera.getProjectionMatrix();
+    const glm::mat4 &view = camera.getViewMatrix();
+
+    // cull against the depth of a previous frame, first whole instances and then the meshes of the survivors
+    drawList.clear();
+    for (const auto &instance : instances) {
+      if (occlusionCulling && !hiz.isVisible(ourModel.getBounds().transformed(instance)))
+        continue;
+      for (auto &mesh : meshes) {
+        if (occlusionCulling && !hiz.isVisible(mesh.getBounds().transformed(instance)))
+          continue;
+        drawList.emplace_back(&mesh, &instance);
+      }
+    }
+
+    gpuTimer.begin();
+    scene.bind();
+    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    if (depthPrepass) {
+      // lay down depth first so the shading pass only runs for the visible fragments
+      glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+      depthShader.use();
+      depthShader.setMat4("projection", projection);
+      depthShader.setMat4("view", view);
+      depthShader.setMat4("model", wallModel);
+      wall.drawGeometry();
+      for (auto &item : drawList) {
+        depthShader.setMat4("model", *item.second);
+        item.first->drawGeometry();
+      }
+      glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+      glDepthFunc(depth::less(true));
+      glDepthMask(GL_FALSE);
+    }
+
+    shader.use();
+    shader.setMat4("projection", projection);
+    shader.setMat4("view", view);
+    shader.setMat4("model", wallModel);
+    wall.draw(shader);
+    for (auto &item : drawList) {
+      shader.setMat4("model", *item.second);
+      item.first->draw(shader);
+    }
+
+    glDepthFunc(depth::less());
+    glDepthMask(GL_TRUE);
+
+    hiz.build(scene.depthTexture(), camera.getViewProjectionMatrix());
+    scene.blitToScreen(fbWidth, fbHeight);
+    gpuTimer.end();
+
+    ++frames;
+    if (currentFrame - statsTime >= 1.0) {
+      const HiZBuffer::Stats &stats = hiz.getStats();
+      std::cout << "frame: " << (currentFrame - statsTime) * 1000.0 / frames << " ms, gpu: " << gpuTimer.getMs()
+                << " ms, meshes drawn: " << drawList.size() << "/" << instances.size() * meshes.size()
+                << ", occlusion culled: " << stats.occluded / frames << "/" << stats.tested / frames
+                << " bounds (culling " << (occlusionCulling ? "on" : "off") << ", pre-pass "
+                << (depthPrepass ? "on" : "off") << ")" << std::endl;
+      hiz.resetStats();
+      statsTime = currentFrame;
+      frames = 0;
+    }
+
+    /* Swap front and back buffers */
+    glfwSwapBuffers(window);
+
+    /* Poll for and process events */
+    glfwPollEvents();
+  }
+
+  return EXIT_SUCCESS;
+}
+
+void mouseCallback(GLFWwindow *window, double x, double y) {
+  if (firstMouse) {
+    lastX = x;
+    lastY = y;
+    firstMouse = false;
+  }
+
+  auto xOffset = lastX - x;
+  auto yOffset = y - lastY;
+  lastX = x;
+  lastY = y;
+
+  camera.processMouseMovement(xOffset, yOffset);
+}
+
+void scrollCallback(GLFWwindow *window, double xOffset, double yOffset) { camera.processMouseScroll(yOffset); }
+
+// O toggles occlusion culling, P toggles the depth pre-pass
+void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+  if (action != GLFW_PRESS)
+    return;
+  if (key == GLFW_KEY_O)
+    occlusionCulling = !occlusionCulling;
+  else if (key == GLFW_KEY_P)
+    depthPrepass = !depthPrepass;
+}
+
+// glfw: whenever the window size changed, this callback function executes
+void framebufferSizeCallback(GLFWwindow *window, int width, int height) {
+  // make sure the viewport matches the new window dimensions; note that width and height will be significantly larger
+  // than specified on retina displays
+  glViewport(0, 0, width, height);
+  camera.setViewport(width, height);
+}
+
+void processInput(GLFWwindow *window) {
+  if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+    glfwSetWindowShouldClose(window, true);
+
+  if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
+    camera.processKeyboard(FORWARD, deltaTime);
+  } else if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
+    camera.processKeyboard(BACKWARD, deltaTime);
+  } else if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
+    camera.processKeyboard(LEFT, deltaTime);
+  } else if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
+    camera.processKeyboard(RIGHT, deltaTime);
+  }
+}
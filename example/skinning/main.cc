@@ -0,0 +1,333 @@
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <base/animation.h>
+#include <base/camera.h>
+#include <base/job_system.h>
+#include <base/model.h>
+#include <base/shader.h>
+
+// settings
+const int WIN_WIDTH = 800;
+const int WIN_HEIGHT = 600;
+
+// camera
+Camera camera(glm::vec3(.0f, 4.0f, 18.0f));
+bool firstMouse = true;
+double lastX = .0;
+double lastY = .0;
+
+// timing
+float deltaTime = .0f; // time between current frame and last frame
+float lastFrame = .0f;
+
+// the procedural character: a tentacle of SEGMENTS joints stacked along +y
+const int SEGMENTS = 8;
+const float SEGMENT_LENGTH = 0.5f;
+
+void framebufferSizeCallback(GLFWwindow *window, int width, int height);
+void mouseCallback(GLFWwindow *window, double x, double y);
+void scrollCallback(GLFWwindow *window, double xOffset, double yOffset);
+void processInput(GLFWwindow *window);
+// everything that owns GL objects, which are deleted when it returns, while the context is still current
+int run(GLFWwindow *window, int argc, char **argv);
+void buildTentacle(animation::Skeleton &skeleton, std::vector<animation::Clip> &clips, std::vector<Vertex> &vertices,
+                   std::vector<unsigned int> &indices);
+
+int main(int argc, char **argv) {
+  if (!glfwInit()) {
+    std::cerr << "failed to init GLFW" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+  GLFWwindow *window;
+  // create a windowed mode window and its OpenGL context
+  if (window = glfwCreateWindow(WIN_WIDTH, WIN_HEIGHT, "Hello CG", nullptr, nullptr); !window) {
+    glfwTerminate();
+    return EXIT_FAILURE;
+  }
+
+  glfwMakeContextCurrent(window); // make the window's context current
+  glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+  camera.setViewport(WIN_WIDTH, WIN_HEIGHT);
+  glfwSetCursorPosCallback(window, mouseCallback);
+  glfwSetScrollCallback(window, scrollCallback);
+  glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+  // load all OpenGL function pointers
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+    std::cerr << "failed to initialize GLAD" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  int result = run(window, argc, argv);
+  glfwTerminate();
+  return result;
+}
+
+int run(GLFWwindow *window, int argc, char **argv) {
+  // configure global opengl state
+  glEnable(GL_DEPTH_TEST);
+
+  // --cpu skins the vertices on the CPU and re-uploads them for every character instead of using the palette buffer
+  // --count <n> sets the number of characters, any other argument is an animated model to use instead of the tentacle
+  bool cpu = false;
+  int count = 400;
+  const char *path = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--cpu") == 0)
+      cpu = true;
+    else if (std::strcmp(argv[i], "--count") == 0 && i + 1 < argc)
+      count = std::max(1, std::atoi(argv[++i]));
+    else
+      path = argv[i];
+  }
+
+  Shader shader("shaders/skinning.vert", "shaders/skinning.frag");
+
+  // either a loaded model with its own clips or the tentacle with a sway and a twist clip
+  std::unique_ptr<Model> model;
+  std::unique_ptr<Mesh> tentacle;
+  animation::Skeleton tentacleSkeleton;
+  std::vector<animation::Clip> tentacleClips;
+  if (path) {
+    model = std::make_unique<Model>(path);
+    if (model->getClips().empty()) {
+      std::cerr << path << " has no animations" << std::endl;
+      return EXIT_FAILURE;
+    }
+  } else {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    buildTentacle(tentacleSkeleton, tentacleClips, vertices, indices);
+    tentacle = std::make_unique<Mesh>(vertices, indices, std::vector<Texture>());
+  }
+  const animation::Skeleton &skeleton = model ? model->getSkeleton() : tentacleSkeleton;
+  const std::vector<animation::Clip> &clips = model ? model->getClips() : tentacleClips;
+  const animation::Clip &first = clips[0];
+  const animation::Clip &second = clips[clips.size() > 1 ? 1 : 0];
+  std::cout << skeleton.nodeCount() << " nodes, " << skeleton.jointCount() << " joints, " << clips.size()
+            << " clips, " << count << " characters" << (cpu ? ", CPU skinning" : "") << std::endl;
+
+  JobSystem jobs;
+  transform::Batch poses;
+  poses.resize((size_t)count * skeleton.nodeCount());
+  std::vector<animation::JointMatrix> palettes((size_t)count * skeleton.jointCount());
+  std::vector<transform::Instance> scratch;
+  PaletteBuffer paletteBuffer((size_t)count * skeleton.jointCount());
+  std::vector<Vertex> skinned;
+
+  int side = (int)std::ceil(std::sqrt((float)count));
+  double animationMs = 0.0;
+  int frames = 0;
+  double lastReport = glfwGetTime();
+  while (!glfwWindowShouldClose(window)) {
+    double currentFrame = glfwGetTime();
+    deltaTime = currentFrame - lastFrame;
+    lastFrame = currentFrame;
+
+    processInput(window);
+
+    // every character plays the first clip with its own phase and blends the second one in and out
+    double animationStart = glfwGetTime();
+    size_t nodes = skeleton.nodeCount(), joints = skeleton.jointCount();
+    for (int c = 0; c < count; ++c) {
+      float time = (float)currentFrame + c * 0.37f;
+      animation::sample(skeleton, first, time, poses, c * nodes);
+      animation::sample(skeleton, second, time, poses, c * nodes, 0.5f + 0.5f * std::sin(time * 0.5f));
+    }
+    animation::computePalettes(skeleton, poses, count, palettes.data(), scratch, &jobs);
+    animationMs += (glfwGetTime() - animationStart) * 1000.0;
+
+    // render
+    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    shader.use();
+    shader.setMat4("projection", camera.getProjectionMatrix());
+    shader.setMat4("view", camera.getViewMatrix());
+    shader.setVec3("color", glm::vec3(0.9f, 0.6f, 0.4f));
+
+    paletteBuffer.beginFrame();
+    std::vector<GLint> offsets(count, 0);
+    if (!cpu) {
+      for (int c = 0; c < count; ++c) {
+        offsets[c] = paletteBuffer.upload(&palettes[c * joints], joints);
+      }
+      paletteBuffer.bind(shader);
+    }
+    for (int c = 0; c < count; ++c) {
+      glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3((c % side - side / 2) * 1.5f, 0.0f,
+                                                                      -(c / side) * 1.5f));
+      const animation::JointMatrix *palette = &palettes[c * joints];
+      if (cpu) {
+        // the shader leaves vertices without weights alone, the skinned copies have their weights cleared
+        auto skinMesh = [&](Mesh &mesh) {
+          const auto &vertices = mesh.getVertices();
+          skinned.resize(vertices.size());
+          animation::skin(vertices.data(), vertices.size(), palette, skinned.data());
+          for (auto &v : skinned) {
+            std::fill(v.boneWeights, v.boneWeights + MAX_BONE_INFLUENCE, 0);
+          }
+          mesh.updateVertices(skinned.data(), skinned.size());
+        };
+        if (model) {
+          for (auto &mesh : model->getMeshes()) {
+            if (mesh.isSkinned())
+              skinMesh(mesh);
+          }
+        } else {
+          skinMesh(*tentacle);
+        }
+      } else {
+        shader.setInt("paletteOffset", offsets[c]);
+      }
+      if (model) {
+        model->drawSkinned(shader, transform);
+      } else {
+        shader.setMat4("model", transform);
+        tentacle->draw(shader);
+      }
+    }
+    paletteBuffer.endFrame();
+
+    ++frames;
+    if (currentFrame - lastReport >= 1.0) {
+      std::cout << "animation: " << animationMs / frames << " ms per frame, "
+                << count / std::max(animationMs / frames, 1e-6) << " characters per ms (" << jobs.threadCount()
+                << " threads)" << std::endl;
+      animationMs = 0.0;
+      frames = 0;
+      lastReport = currentFrame;
+    }
+
+    /* Swap front and back buffers */
+    glfwSwapBuffers(window);
+
+    /* Poll for and process events */
+    glfwPollEvents();
+  }
+
+  return EXIT_SUCCESS;
+}
+
+void buildTentacle(animation::Skeleton &skeleton, std::vector<animation::Clip> &clips, std::vector<Vertex> &vertices,
+                   std::vector<unsigned int> &indices) {
+  // a chain of joints, each one segment above its parent
+  skeleton.rest.resize(SEGMENTS);
+  for (int j = 0; j < SEGMENTS; ++j) {
+    skeleton.parents.push_back(j - 1);
+    skeleton.names.push_back("joint" + std::to_string(j));
+    skeleton.rest.set(j, glm::vec3(0.0f, j == 0 ? 0.0f : SEGMENT_LENGTH, 0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+                      glm::vec3(1.0f));
+    skeleton.jointNodes.push_back(j);
+    skeleton.inverseBind.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -j * SEGMENT_LENGTH, 0.0f)));
+  }
+
+  // a cylinder tapering towards the tip, every ring blends between the two joints around it
+  const int SIDES = 12, RINGS = SEGMENTS * 4;
+  for (int r = 0; r <= RINGS; ++r) {
+    float y = (float)r / RINGS * SEGMENTS * SEGMENT_LENGTH;
+    float radius = 0.2f * (1.0f - 0.8f * r / RINGS);
+    float along = y / SEGMENT_LENGTH;
+    int joint = std::min((int)along, SEGMENTS - 1);
+    float blend = std::min(along - joint, 1.0f);
+    for (int s = 0; s < SIDES; ++s) {
+      float a = s * 2.0f * 3.14159265f / SIDES;
+      Vertex v;
+      v.normal = glm::vec3(std::cos(a), 0.0f, std::sin(a));
+      v.position = glm::vec3(v.normal.x * radius, y, v.normal.z * radius);
+      v.texCoords = glm::vec2((float)s / SIDES, (float)r / RINGS);
+      int joints[2] = {joint, std::min(joint + 1, SEGMENTS - 1)};
+      float weights[2] = {1.0f - blend, blend};
+      animation::packWeights(v, joints, weights, 2);
+      vertices.push_back(v);
+    }
+  }
+  for (int r = 0; r < RINGS; ++r) {
+    for (int s = 0; s < SIDES; ++s) {
+      unsigned int a = r * SIDES + s, b = r * SIDES + (s + 1) % SIDES;
+      indices.insert(indices.end(), {a, a + SIDES, b, b, a + SIDES, b + SIDES});
+    }
+  }
+
+  // sway bends every joint around z, twist around x, both loop after two seconds
+  const char *names[2] = {"sway", "twist"};
+  for (int c = 0; c < 2; ++c) {
+    animation::Clip clip;
+    clip.name = names[c];
+    clip.duration = 2.0f;
+    for (int j = 1; j < SEGMENTS; ++j) {
+      animation::Channel channel;
+      channel.node = j;
+      for (int k = 0; k <= 8; ++k) {
+        float t = k * 0.25f;
+        float angle = 0.3f * std::sin(t * 3.14159265f + j * 0.4f);
+        channel.rotations.times.push_back(t);
+        channel.rotations.values.push_back(
+            glm::angleAxis(angle, c == 0 ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f)));
+      }
+      clip.channels.push_back(std::move(channel));
+    }
+    clips.push_back(std::move(clip));
+  }
+}
+
+void mouseCallback(GLFWwindow *window, double x, double y) {
+  if (firstMouse) {
+    lastX = x;
+    lastY = y;
+    firstMouse = false;
+  }
+
+  auto xOffset = lastX - x;
+  auto yOffset = y - lastY;
+  lastX = x;
+  lastY = y;
+
+  camera.processMouseMovement(xOffset, yOffset);
+}
+
+void scrollCallback(GLFWwindow *window, double xOffset, double yOffset) { camera.processMouseScroll(yOffset); }
+
+// glfw: whenever the window size changed, this callback function executes
+void framebufferSizeCallback(GLFWwindow *window, int width, int height) {
+  // make sure the viewport matches the new window dimensions; note that width and height will be significantly larger
+  // than specified on retina displays
+  glViewport(0, 0, width, height);
+  camera.setViewport(width, height);
+}
+
+void processInput(GLFWwindow *window) {
+  if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+    glfwSetWindowShouldClose(window, true);
+
+  if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
+    camera.processKeyboard(FORWARD, deltaTime);
+  } else if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
+    camera.processKeyboard(BACKWARD, deltaTime);
+  } else if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
+    camera.processKeyboard(LEFT, deltaTime);
+  } else if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
+    camera.processKeyboard(RIGHT, deltaTime);
+  }
+}
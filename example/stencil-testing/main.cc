@@ -2,14 +2,22 @@
 #include <GLFW/glfw3.h>
 #include <glad/glad.h>
 
+#include <stb_image.h>
+
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #include <iostream>
+#include <string>
+#include <vector>
 
 #include <base/camera.h>
+#include <base/framebuffer.h>
+#include <base/gl_trace.h>
+#include <base/gpu_timer.h>
 #include <base/model.h>
+#include <base/outline.h>
 #include <base/shader.h>
 
 // settings
@@ -26,13 +34,38 @@ double lastY = .0;
 float deltaTime = .0f; // time between current frame and last frame
 float lastFrame = .0f;
 
+// outlines are either drawn with the classic stencil technique (redraw every selected object scaled up where the
+// stencil is not set) or in screen space with a jump flood over the object id buffer
+enum OutlineTechnique { STENCIL, JUMP_FLOOD };
+OutlineTechnique technique = JUMP_FLOOD;
+const float OUTLINE_WIDTH = 4.0f;
+const glm::vec3 OUTLINE_COLOR(1.0f, 0.28f, 0.26f);
+
 void framebufferSizeCallback(GLFWwindow *window, int width, int height);
 void mouseCallback(GLFWwindow *window, double x, double y);
 void scrollCallback(GLFWwindow *window, double xOffset, double yOffset);
+void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods);
 void processInput(GLFWwindow *window);
 unsigned int loadTexture(char const *path);
+// everything that owns GL objects, which are deleted when it returns, while the context is still current
+int run(GLFWwindow *window, bool bench, bool glStats, const char *tracePath);
 
 int main(int argc, char **argv) {
+  // --bench renders both techniques with growing numbers of outlined objects and prints their frame times,
+  // --gl-stats adds the GL calls of a frame to the stats, --trace records the first frames for tools/glreplay
+  bool bench = false, glStats = false;
+  const char *tracePath = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--bench") {
+      bench = true;
+    } else if (arg == "--gl-stats") {
+      glStats = true;
+    } else if (arg == "--trace" && i + 1 < argc) {
+      tracePath = argv[++i];
+    }
+  }
+
   if (!glfwInit()) {
     std::cerr << "failed to init GLFW" << std::endl;
     return EXIT_FAILURE;
@@ -54,8 +87,10 @@ int main(int argc, char **argv) {
 
   glfwMakeContextCurrent(window); // make the window's context current
   glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+  camera.setViewport(WIN_WIDTH, WIN_HEIGHT);
   glfwSetCursorPosCallback(window, mouseCallback);
   glfwSetScrollCallback(window, scrollCallback);
+  glfwSetKeyCallback(window, keyCallback);
   glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
   // load all OpenGL function pointers
@@ -64,6 +99,25 @@ int main(int argc, char **argv) {
     return EXIT_FAILURE;
   }
 
+  int result = run(window, bench, glStats, tracePath);
+  gltrace::uninstall();
+  glfwTerminate();
+  return result;
+}
+
+int run(GLFWwindow *window, bool bench, bool glStats, const char *tracePath) {
+  const int TRACE_FRAMES = 120;
+  // intercept before anything is created so the trace can recreate it
+  if (glStats || tracePath) {
+    gltrace::install();
+  }
+  if (tracePath && !gltrace::startRecording(tracePath)) {
+    std::cerr << "failed to record " << tracePath << std::endl;
+  }
+  if (bench) {
+    glfwSwapInterval(0);
+  }
+
   int attrCount;
   glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &attrCount);
   std::cout << "GL_MAX_VERTEX_ATTRIBS: " << attrCount << std::endl;
@@ -172,79 +226,171 @@ int main(int argc, char **argv) {
   shader.use();
   shader.setInt("texture1", 0);
 
-  while (!glfwWindowShouldClose(window)) {
-    double currentFrame = glfwGetTime();
-    deltaTime = currentFrame - lastFrame;
-    lastFrame = currentFrame;
+  std::vector<glm::vec3> cubePositions = {glm::vec3(-1.0f, 0.0f, -1.0f), glm::vec3(2.0f, 0.0f, 0.0f)};
 
-    processInput(window);
+  // the scene goes to an offscreen target whose second attachment receives the object ids
+  int fbWidth, fbHeight;
+  glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+  Framebuffer scene(fbWidth, fbHeight);
+  scene.addColor(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+  unsigned int idAttachment = scene.addColor(GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT);
+  scene.setDepth(GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8);
+  if (!scene.complete()) {
+    return EXIT_FAILURE;
+  }
+  Outline outline(fbWidth, fbHeight);
+  GpuTimer gpuTimer;
 
-    // render
-    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+  auto drawCubes = [&](const Shader &s, float scale, bool writeIds) {
+    glBindVertexArray(cubeVAO);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, cubeTexture);
+    for (unsigned int i = 0; i < cubePositions.size(); ++i) {
+      glm::mat4 model = glm::translate(glm::mat4(1.0f), cubePositions[i]);
+      model = glm::scale(model, glm::vec3(scale, scale, scale));
+      s.setMat4("model", model);
+      if (writeIds)
+        s.setUint("objectId", i + 1);
+      glDrawArrays(GL_TRIANGLES, 0, 36);
+    }
+    glBindVertexArray(0);
+  };
+
+  auto renderFrame = [&]() {
+    glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+    scene.resize(fbWidth, fbHeight);
+    outline.resize(fbWidth, fbHeight);
+
+    gpuTimer.begin();
+    scene.bind();
+    // integer attachments can't be cleared with glClear
+    const GLfloat clearColor[] = {0.2f, 0.3f, 0.3f, 1.0f};
+    const GLuint clearId[] = {0, 0, 0, 0};
+    glStencilMask(0xFF);
+    glClearBufferfv(GL_COLOR, 0, clearColor);
+    glClearBufferuiv(GL_COLOR, idAttachment, clearId);
+    glClear(GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
     // set uniforms
+    const glm::mat4 &view = camera.getViewMatrix();
+    const glm::mat4 &projection = camera.getProjectionMatrix();
     shaderSingleColor.use();
-    glm::mat4 model = glm::mat4(1.0f);
-    glm::mat4 view = camera.getViewMatrix();
-    glm::mat4 projection =
-        glm::perspective(glm::radians(camera.zoom), (float)WIN_WIDTH / (float)WIN_HEIGHT, 0.1f, 100.0f);
     shaderSingleColor.setMat4("view", view);
     shaderSingleColor.setMat4("projection", projection);
 
     shader.use();
     shader.setMat4("view", view);
     shader.setMat4("projection", projection);
+    shader.setUint("objectId", 0);
 
     // draw floor as normal, but don't write the floor to the stencil buffer, we only care about the containers.
     glStencilMask(0x00); // 关闭模板缓冲写入
     // floor
     glBindVertexArray(planeVAO);
+    glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, floorTexture);
     shader.setMat4("model", glm::mat4(1.0f));
     glDrawArrays(GL_TRIANGLES, 0, 6);
     glBindVertexArray(0);
 
-    // 1st. render pass, draw objects as normal, writing to the stencil buffer
-    glStencilFunc(GL_ALWAYS, 1, 0xFF);
-    glStencilMask(0xFF); // 启用模板缓冲写入
-    // cubes
-    glBindVertexArray(cubeVAO);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, cubeTexture);
-    model = glm::translate(model, glm::vec3(-1.0f, 0.0f, -1.0f));
-    shader.setMat4("model", model);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(2.0f, 0.0f, 0.0f));
-    shader.setMat4("model", model);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-
-    // 2nd. render pass: now draw slightly scaled versions of the objects, this time disabling stencil writing.
-    // Because the stencil buffer is now filled with several 1s. The parts of the buffer that are 1 are not drawn, thus
-    // only drawing the objects' size differences, making it look like borders.
-    glStencilFunc(GL_NOTEQUAL, 1, 0xFF); // 只绘制箱子上模板值不为1的部分
-    glStencilMask(0x00);
-    glDisable(GL_DEPTH_TEST);
-    shaderSingleColor.use();
-    float scale = 1.05;
-    // cubes
-    glBindVertexArray(cubeVAO);
-    glBindTexture(GL_TEXTURE_2D, cubeTexture);
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(-1.0f, 0.0f, -1.0f));
-    model = glm::scale(model, glm::vec3(scale, scale, scale));
-    shaderSingleColor.setMat4("model", model);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(2.0f, 0.0f, 0.0f));
-    model = glm::scale(model, glm::vec3(scale, scale, scale));
-    shaderSingleColor.setMat4("model", model);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
-    glStencilMask(0xFF);
-    glStencilFunc(GL_ALWAYS, 0, 0xFF);
-    glEnable(GL_DEPTH_TEST);
+    if (technique == STENCIL) {
+      // 1st. render pass, draw objects as normal, writing to the stencil buffer
+      glStencilFunc(GL_ALWAYS, 1, 0xFF);
+      glStencilMask(0xFF); // 启用模板缓冲写入
+      drawCubes(shader, 1.0f, false);
+
+      // 2nd. render pass: now draw slightly scaled versions of the objects, this time disabling stencil writing.
+      // Because the stencil buffer is now filled with several 1s. The parts of the buffer that are 1 are not drawn,
+      // thus only drawing the objects' size differences, making it look like borders.
+      glStencilFunc(GL_NOTEQUAL, 1, 0xFF); // 只绘制箱子上模板值不为1的部分
+      glStencilMask(0x00);
+      glDisable(GL_DEPTH_TEST);
+      shaderSingleColor.use();
+      drawCubes(shaderSingleColor, 1.05f, false);
+      glStencilMask(0xFF);
+      glStencilFunc(GL_ALWAYS, 0, 0xFF);
+      glEnable(GL_DEPTH_TEST);
+
+      scene.blitToScreen(fbWidth, fbHeight);
+    } else {
+      // a single pass draws the objects and tags the selected ones in the id buffer, the outline is derived from it
+      drawCubes(shader, 1.0f, true);
+      shader.setUint("objectId", 0);
+
+      scene.blitToScreen(fbWidth, fbHeight);
+      glViewport(0, 0, fbWidth, fbHeight);
+      outline.draw(scene.colorTexture(idAttachment), OUTLINE_COLOR, OUTLINE_WIDTH);
+    }
+    gpuTimer.end();
+  };
+
+  if (bench) {
+    const int WARMUP_FRAMES = 30;
+    const int BENCH_FRAMES = 300;
+    std::cout << "technique   objects   cpu ms   gpu ms" << std::endl;
+    for (int count : {2, 64, 256, 1024, 4096}) {
+      // a square grid of cubes in front of the camera
+      int side = (int)std::ceil(std::sqrt((float)count));
+      cubePositions.clear();
+      for (int i = 0; i < count; ++i) {
+        cubePositions.push_back(glm::vec3((i % side - side / 2) * 1.5f, 0.0f, -(i / side) * 1.5f));
+      }
+      for (OutlineTechnique t : {STENCIL, JUMP_FLOOD}) {
+        technique = t;
+        double gpuMs = 0.0;
+        int gpuFrames = 0;
+        unsigned int gpuResults = 0;
+        double start = 0.0;
+        for (int frame = 0; frame < WARMUP_FRAMES + BENCH_FRAMES; ++frame) {
+          if (frame == WARMUP_FRAMES)
+            start = glfwGetTime();
+          renderFrame();
+          // only results read this frame, the timer repeats the last one while its queries are in flight
+          if (frame >= WARMUP_FRAMES && gpuTimer.getResults() != gpuResults) {
+            gpuMs += gpuTimer.getMs();
+            ++gpuFrames;
+          }
+          gpuResults = gpuTimer.getResults();
+          glfwSwapBuffers(window);
+          glfwPollEvents();
+        }
+        double cpuMs = (glfwGetTime() - start) * 1000.0 / BENCH_FRAMES;
+        std::cout << (t == STENCIL ? "stencil     " : "jump-flood  ") << count << "\t  " << cpuMs << "\t   "
+                  << (gpuFrames ? gpuMs / gpuFrames : 0.0) << std::endl;
+      }
+    }
+    return EXIT_SUCCESS;
+  }
+
+  double statsTime = glfwGetTime();
+  int frames = 0, tracedFrames = 0;
+
+  while (!glfwWindowShouldClose(window)) {
+    double currentFrame = glfwGetTime();
+    deltaTime = currentFrame - lastFrame;
+    lastFrame = currentFrame;
+
+    processInput(window);
+
+    renderFrame();
+    if (gltrace::installed()) {
+      gltrace::frame();
+      if (gltrace::recording() && ++tracedFrames == TRACE_FRAMES) {
+        gltrace::stopRecording();
+        std::cout << "recorded " << TRACE_FRAMES << " frames to " << tracePath << std::endl;
+      }
+    }
+
+    ++frames;
+    if (currentFrame - statsTime >= 1.0) {
+      std::cout << (technique == STENCIL ? "stencil" : "jump flood") << " outline, frame: "
+                << (currentFrame - statsTime) * 1000.0 / frames << " ms, gpu: " << gpuTimer.getMs() << " ms"
+                << std::endl;
+      if (glStats)
+        std::cout << gltrace::report(gltrace::getStats()) << std::endl;
+      statsTime = currentFrame;
+      frames = 0;
+    }
 
     /* Swap front and back buffers */
     glfwSwapBuffers(window);
@@ -253,8 +399,6 @@ int main(int argc, char **argv) {
     glfwPollEvents();
   }
 
-  glfwTerminate();
-
   return EXIT_SUCCESS;
 }
 
@@ -275,11 +419,18 @@ void mouseCallback(GLFWwindow *window, double x, double y) {
 
 void scrollCallback(GLFWwindow *window, double xOffset, double yOffset) { camera.processMouseScroll(yOffset); }
 
+// tab switches between the stencil and the jump flood outline
+void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+  if (key == GLFW_KEY_TAB && action == GLFW_PRESS)
+    technique = technique == STENCIL ? JUMP_FLOOD : STENCIL;
+}
+
 // glfw: whenever the window size changed, this callback function executes
 void framebufferSizeCallback(GLFWwindow *window, int width, int height) {
   // make sure the viewport matches the new window dimensions; note that width and height will be significantly larger
   // than specified on retina displays
   glViewport(0, 0, width, height);
+  camera.setViewport(width, height);
 }
 
 void processInput(GLFWwindow *window) {
@@ -0,0 +1,287 @@
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <base/camera.h>
+#include <base/shader.h>
+#include <base/stream_buffer.h>
+
+// settings
+const int WIN_WIDTH = 800;
+const int WIN_HEIGHT = 600;
+// every particle is rewritten every frame
+const int PARTICLE_COUNT = 1 << 18;
+const GLsizeiptr PARTICLE_BYTES = PARTICLE_COUNT * sizeof(glm::vec4);
+
+// camera
+Camera camera(glm::vec3(.0f, .0f, 30.0f));
+bool firstMouse = true;
+double lastX = .0;
+double lastY = .0;
+
+// timing
+float deltaTime = .0f; // time between current frame and last frame
+float lastFrame = .0f;
+
+// how the particle data reaches the GPU
+enum UploadMethod { BUFFER_DATA, STREAM_SUB_DATA, STREAM_PERSISTENT };
+const char *methodNames[] = {"glBufferData", "stream buffer (glBufferSubData)", "stream buffer (persistent)"};
+
+void framebufferSizeCallback(GLFWwindow *window, int width, int height);
+void mouseCallback(GLFWwindow *window, double x, double y);
+void scrollCallback(GLFWwindow *window, double xOffset, double yOffset);
+void processInput(GLFWwindow *window);
+// everything that owns GL objects, which are deleted when it returns, while the context is still current
+int run(GLFWwindow *window, bool bench);
+
+// particles on a set of rotating rings
+void simulate(std::vector<glm::vec4> &particles, float time) {
+  for (int i = 0; i < PARTICLE_COUNT; ++i) {
+    float t = (float)i / PARTICLE_COUNT;
+    float ring = std::floor(t * 64.0f);
+    float angle = t * 6.28318f * 64.0f + time * (0.2f + ring * 0.01f);
+    float radius = 4.0f + ring * 0.2f;
+    particles[i] = glm::vec4(std::cos(angle) * radius, std::sin(ring + time) * 2.0f, std::sin(angle) * radius, t);
+  }
+}
+
+int main(int argc, char **argv) {
+  // --bench streams the particles with every method and prints the upload throughput
+  bool bench = argc > 1 && std::string(argv[1]) == "--bench";
+
+  if (!glfwInit()) {
+    std::cerr << "failed to init GLFW" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+  GLFWwindow *window;
+  // create a windowed mode window and its OpenGL context
+  if (window = glfwCreateWindow(WIN_WIDTH, WIN_HEIGHT, "Hello CG", nullptr, nullptr); !window) {
+    glfwTerminate();
+    return EXIT_FAILURE;
+  }
+
+  glfwMakeContextCurrent(window); // make the window's context current
+  glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+  camera.setViewport(WIN_WIDTH, WIN_HEIGHT);
+  glfwSetCursorPosCallback(window, mouseCallback);
+  glfwSetScrollCallback(window, scrollCallback);
+  glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+  // load all OpenGL function pointers
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+    std::cerr << "failed to initialize GLAD" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  int result = run(window, bench);
+  glfwTerminate();
+  return result;
+}
+
+int run(GLFWwindow *window, bool bench) {
+  if (bench) {
+    glfwSwapInterval(0);
+  }
+
+  // configure global opengl state
+  glad_glEnable(GL_DEPTH_TEST);
+  glEnable(GL_PROGRAM_POINT_SIZE);
+
+  // build and compile shaders
+  Shader shader("shaders/particles.vert", "shaders/particles.frag");
+
+  std::vector<glm::vec4> particles(PARTICLE_COUNT);
+
+  // reference path: reallocate ("orphan") a plain buffer every frame
+  unsigned int dynamicVBO, dynamicVAO;
+  glGenVertexArrays(1, &dynamicVAO);
+  glGenBuffers(1, &dynamicVBO);
+  glBindVertexArray(dynamicVAO);
+  glBindBuffer(GL_ARRAY_BUFFER, dynamicVBO);
+  glBufferData(GL_ARRAY_BUFFER, PARTICLE_BYTES, nullptr, GL_STREAM_DRAW);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), nullptr);
+  glBindVertexArray(0);
+
+  // stream buffers, the attribute always points at the start of the buffer and draws pick their region through the
+  // first vertex
+  auto makeStream = [&](bool persistent, unsigned int &vao) {
+    auto stream = std::make_unique<StreamBuffer>(PARTICLE_BYTES, 3, persistent);
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, stream->get_id());
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), nullptr);
+    glBindVertexArray(0);
+    return stream;
+  };
+  unsigned int subDataVAO, persistentVAO;
+  auto subDataStream = makeStream(false, subDataVAO);
+  auto persistentStream = makeStream(true, persistentVAO);
+  if (!persistentStream->persistent()) {
+    std::cout << "GL_ARB_buffer_storage is not available, the persistent stream falls back to glBufferSubData"
+              << std::endl;
+  }
+
+  UploadMethod method = persistentStream->persistent() ? STREAM_PERSISTENT : STREAM_SUB_DATA;
+  double uploadSeconds = 0.0;
+
+  auto renderFrame = [&](float time) {
+    simulate(particles, time);
+
+    glClearColor(0.05f, 0.05f, 0.08f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    shader.use();
+    shader.setMat4("projection", camera.getProjectionMatrix());
+    shader.setMat4("view", camera.getViewMatrix());
+
+    auto start = std::chrono::steady_clock::now();
+    if (method == BUFFER_DATA) {
+      glBindBuffer(GL_ARRAY_BUFFER, dynamicVBO);
+      glBufferData(GL_ARRAY_BUFFER, PARTICLE_BYTES, nullptr, GL_STREAM_DRAW);
+      glBufferSubData(GL_ARRAY_BUFFER, 0, PARTICLE_BYTES, particles.data());
+      uploadSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      glBindVertexArray(dynamicVAO);
+      glDrawArrays(GL_POINTS, 0, PARTICLE_COUNT);
+    } else {
+      StreamBuffer &stream = method == STREAM_PERSISTENT ? *persistentStream : *subDataStream;
+      stream.beginFrame();
+      StreamBuffer::Allocation a = stream.allocate(PARTICLE_BYTES, sizeof(glm::vec4));
+      std::memcpy(a.ptr, particles.data(), PARTICLE_BYTES);
+      stream.flush();
+      uploadSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      glBindVertexArray(method == STREAM_PERSISTENT ? persistentVAO : subDataVAO);
+      glDrawArrays(GL_POINTS, a.offset / sizeof(glm::vec4), PARTICLE_COUNT);
+      stream.endFrame();
+    }
+    glBindVertexArray(0);
+  };
+
+  if (bench) {
+    const int WARMUP_FRAMES = 30;
+    const int BENCH_FRAMES = 300;
+    std::cout << "streaming " << PARTICLE_BYTES / (1024 * 1024) << " MiB per frame" << std::endl;
+    for (UploadMethod m : {BUFFER_DATA, STREAM_SUB_DATA, STREAM_PERSISTENT}) {
+      if (m == STREAM_PERSISTENT && !persistentStream->persistent())
+        continue;
+      method = m;
+      double start = 0.0;
+      for (int frame = 0; frame < WARMUP_FRAMES + BENCH_FRAMES; ++frame) {
+        if (frame == WARMUP_FRAMES) {
+          start = glfwGetTime();
+          uploadSeconds = 0.0;
+          subDataStream->resetStats();
+          persistentStream->resetStats();
+        }
+        renderFrame(frame * 0.016f);
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+      }
+      double seconds = glfwGetTime() - start;
+      double bytes = (double)PARTICLE_BYTES * BENCH_FRAMES;
+      unsigned int stalls = (m == STREAM_PERSISTENT ? persistentStream : subDataStream)->getStats().stalls;
+      std::cout << methodNames[m] << ": upload " << bytes / uploadSeconds / 1.0e9 << " GB/s, sustained "
+                << bytes / seconds / 1.0e9 << " GB/s, frame " << seconds * 1000.0 / BENCH_FRAMES << " ms";
+      if (m != BUFFER_DATA)
+        std::cout << ", stalls " << stalls;
+      std::cout << std::endl;
+    }
+    return EXIT_SUCCESS;
+  }
+
+  double statsTime = glfwGetTime();
+  int frames = 0;
+
+  while (!glfwWindowShouldClose(window)) {
+    double currentFrame = glfwGetTime();
+    deltaTime = currentFrame - lastFrame;
+    lastFrame = currentFrame;
+
+    processInput(window);
+
+    renderFrame(currentFrame);
+
+    ++frames;
+    if (currentFrame - statsTime >= 1.0) {
+      std::cout << methodNames[method] << ": upload " << (double)PARTICLE_BYTES * frames / uploadSeconds / 1.0e9
+                << " GB/s, frame " << (currentFrame - statsTime) * 1000.0 / frames << " ms" << std::endl;
+      statsTime = currentFrame;
+      uploadSeconds = 0.0;
+      frames = 0;
+    }
+
+    /* Swap front and back buffers */
+    glfwSwapBuffers(window);
+
+    /* Poll for and process events */
+    glfwPollEvents();
+  }
+
+  glad_glDeleteVertexArrays(1, &dynamicVAO);
+  glad_glDeleteVertexArrays(1, &subDataVAO);
+  glad_glDeleteVertexArrays(1, &persistentVAO);
+  glad_glDeleteBuffers(1, &dynamicVBO);
+
+  return EXIT_SUCCESS;
+}
+
+void mouseCallback(GLFWwindow *window, double x, double y) {
+  if (firstMouse) {
+    lastX = x;
+    lastY = y;
+    firstMouse = false;
+  }
+
+  auto xOffset = lastX - x;
+  auto yOffset = y - lastY;
+  lastX = x;
+  lastY = y;
+
+  camera.processMouseMovement(xOffset, yOffset);
+}
+
+void scrollCallback(GLFWwindow *window, double xOffset, double yOffset) { camera.processMouseScroll(yOffset); }
+
+// glfw: whenever the window size changed, this callback function executes
+void framebufferSizeCallback(GLFWwindow *window, int width, int height) {
+  // make sure the viewport matches the new window dimensions; note that width and height will be significantly larger
+  // than specified on retina displays
+  glViewport(0, 0, width, height);
+  camera.setViewport(width, height);
+}
+
+void processInput(GLFWwindow *window) {
+  if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+    glfwSetWindowShouldClose(window, true);
+
+  if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
+    camera.processKeyboard(FORWARD, deltaTime);
+  } else if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
+    camera.processKeyboard(BACKWARD, deltaTime);
+  } else if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
+    camera.processKeyboard(LEFT, deltaTime);
+  } else if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
+    camera.processKeyboard(RIGHT, deltaTime);
+  }
+}
@@ -19,6 +19,17 @@ uniform DirLight dirLight;
 
 vec3 calcDirLight(DirLight light, vec3 normal, vec3 viewDir);
 
+// cascaded shadow map of the directional light, see base/shadows.h
+#define MAX_CASCADES 4
+
+uniform sampler2DArrayShadow shadowMap;
+uniform int cascadeCount;
+uniform float cascadeSplits[MAX_CASCADES];
+uniform float cascadeTexels[MAX_CASCADES];
+uniform mat4 lightViewProj[MAX_CASCADES];
+
+float calcShadow(vec3 normal, vec3 lightDir);
+
 // 点光源
 struct PointLight {
     vec3 position;
@@ -56,6 +67,7 @@ struct Light {
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
+in float ViewDepth;
 
 uniform vec3 viewPos;
 uniform Material material;
@@ -85,12 +97,38 @@ vec3 calcDirLight(DirLight light, vec3 normal, vec3 viewDir) {
     // specular shading
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    float shadow = calcShadow(normal, lightDir);
 
     // 合并
     vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
     vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
     vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
-    return ambient + diffuse + specular;
+    return ambient + (diffuse + specular) * shadow;
+}
+
+// 1 where the fragment is lit, 0 where it is in shadow
+float calcShadow(vec3 normal, vec3 lightDir) {
+    int cascade = 0;
+    while (cascade < cascadeCount && ViewDepth > cascadeSplits[cascade])
+        ++cascade;
+    if (cascade == cascadeCount)
+        return 1.0;
+
+    // normal offset: look the depth up a texel or so above the surface, further where the light grazes it
+    float slope = 1.0 - max(dot(normal, lightDir), 0.0);
+    vec3 position = FragPos + normal * cascadeTexels[cascade] * (1.0 + 2.0 * slope);
+    vec4 clip = lightViewProj[cascade] * vec4(position, 1.0);
+    vec3 coords = clip.xyz / clip.w * 0.5 + 0.5;
+
+    // 3x3 PCF on top of the bilinear comparison
+    vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+    for (int x = -1; x <= 1; ++x) {
+        for (int y = -1; y <= 1; ++y) {
+            lit += texture(shadowMap, vec4(coords.xy + vec2(x, y) * texel, float(cascade), min(coords.z, 1.0)));
+        }
+    }
+    return lit / 9.0;
 }
 
 vec3 calcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir) {
@@ -23,20 +23,25 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+// per instance, composed in batches on the CPU (see base/transform_batch.h)
+layout (location = 3) in mat4 aModel;        // locations 3-6
+layout (location = 7) in mat3 aNormalMatrix; // locations 7-9
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
+// distance along the view axis, selects the shadow cascade
+out float ViewDepth;
 
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    FragPos = vec3(aModel * vec4(aPos, 1.0));
+    Normal = aNormalMatrix * aNormal;
     TexCoords = aTexCoords;
+    ViewDepth = -(view * vec4(FragPos, 1.0)).z;
 
     gl_Position = projection * view * vec4(FragPos, 1.0);
 }
@@ -0,0 +1,37 @@
+#version 410 core
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec3 Normal;
+
+// has to match MAX_LIGHTS in tools/bench
+#define MAX_LIGHTS 256
+
+layout (std140) uniform Lights {
+    // xyz position, w radius
+    vec4 positionRadius[MAX_LIGHTS];
+    vec4 color[MAX_LIGHTS];
+};
+
+uniform int lightCount;
+uniform vec3 viewPos;
+uniform vec3 albedo;
+
+void main()
+{
+    vec3 normal = normalize(Normal);
+    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 result = 0.05 * albedo;
+    for (int i = 0; i < lightCount; ++i) {
+        vec3 toLight = positionRadius[i].xyz - FragPos;
+        float distance = length(toLight);
+        // smooth window so every light ends at its radius
+        float window = clamp(1.0 - pow(distance / positionRadius[i].w, 4.0), 0.0, 1.0);
+        float attenuation = window * window / (distance * distance + 1.0);
+        vec3 lightDir = toLight / max(distance, 1e-4);
+        float diffuse = max(dot(normal, lightDir), 0.0);
+        float specular = pow(max(dot(normal, normalize(lightDir + viewDir)), 0.0), 32.0);
+        result += (diffuse * albedo + 0.3 * specular) * color[i].rgb * attenuation;
+    }
+    FragColor = vec4(result, 1.0);
+}
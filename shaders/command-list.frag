@@ -0,0 +1,13 @@
+#version 410 core
+out vec4 FragColor;
+
+in vec3 Normal;
+
+uniform vec4 color;
+
+void main()
+{
+    vec3 lightDir = normalize(vec3(0.3, 1.0, 0.5));
+    float diff = max(dot(normalize(Normal), lightDir), 0.0);
+    FragColor = vec4(color.rgb * (0.2 + 0.8 * diff), color.a);
+}
@@ -0,0 +1,15 @@
+#version 410 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+
+out vec3 Normal;
+
+uniform mat4 model;
+uniform mat4 viewProjection;
+
+void main()
+{
+    // objects are only rotated and uniformly scaled, so the model matrix can transform normals directly
+    Normal = mat3(model) * aNormal;
+    gl_Position = viewProjection * model * vec4(aPos, 1.0);
+}
@@ -0,0 +1,10 @@
+#version 410 core
+out vec4 FragColor;
+
+// alpha carries the pair index so the readback can tell the pairs apart
+uniform vec4 color;
+
+void main()
+{
+    FragColor = color;
+}
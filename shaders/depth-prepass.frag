@@ -0,0 +1,6 @@
+#version 410 core
+
+void main()
+{
+    // depth only, color writes are masked off during the pre-pass
+}
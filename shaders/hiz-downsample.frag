@@ -0,0 +1,36 @@
+#version 410 core
+out float Depth;
+
+// the source level is selected through GL_TEXTURE_BASE_LEVEL so level 0 here is always the previous pyramid level
+uniform sampler2D srcDepth;
+uniform ivec2 srcSize;
+uniform ivec2 dstSize;
+// copy the scene depth into the first pyramid level instead of reducing it
+uniform bool copyDepth;
+// reversed-Z depth, the farthest depth is the smallest
+uniform bool reversedZ;
+
+void main()
+{
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+    if (copyDepth) {
+        Depth = texelFetch(srcDepth, coord, 0).r;
+        return;
+    }
+
+    // keep the farthest depth of the footprint, so a texel never claims to occlude more than it does. odd source sizes
+    // fold their last row/column into the last destination texel
+    ivec2 base = coord * 2;
+    int countX = (coord.x == dstSize.x - 1 && (srcSize.x & 1) == 1) ? 3 : 2;
+    int countY = (coord.y == dstSize.y - 1 && (srcSize.y & 1) == 1) ? 3 : 2;
+    ivec2 last = srcSize - 1;
+
+    float d = reversedZ ? 1.0 : 0.0;
+    for (int y = 0; y < countY; ++y) {
+        for (int x = 0; x < countX; ++x) {
+            float s = texelFetch(srcDepth, min(base + ivec2(x, y), last), 0).r;
+            d = reversedZ ? min(d, s) : max(d, s);
+        }
+    }
+    Depth = d;
+}
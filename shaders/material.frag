@@ -0,0 +1,29 @@
+#version 410 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+// must match Material in base/material.h
+struct Material {
+    vec4 color;
+    float shininess;
+    int diffuseLayer;
+    int specularLayer;
+    int normalLayer;
+};
+
+layout (std140) uniform Materials {
+    Material materials[256];
+};
+
+uniform sampler2DArray textures;
+uniform int materialIndex;
+
+void main()
+{
+    Material material = materials[materialIndex];
+    vec4 color = material.color;
+    if (material.diffuseLayer >= 0)
+        color *= texture(textures, vec3(TexCoords, material.diffuseLayer));
+    FragColor = color;
+}
@@ -0,0 +1,20 @@
+#version 410 core
+out vec4 FragColor;
+
+uniform sampler2D accumulation;
+uniform sampler2D revealage;
+
+void main()
+{
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+    float reveal = texelFetch(revealage, coord, 0).r;
+    // nothing transparent covers the pixel
+    if (reveal >= 1.0)
+        discard;
+    vec4 accum = texelFetch(accumulation, coord, 0);
+    // many bright layers can overflow the half floats
+    if (isinf(max(max(abs(accum.r), abs(accum.g)), abs(accum.b))))
+        accum.rgb = vec3(accum.a);
+    // the weighted average color, the blend lays it over the opaque image with 1 - reveal coverage
+    FragColor = vec4(accum.rgb / max(accum.a, 1e-5), reveal);
+}
@@ -0,0 +1,23 @@
+#version 410 core
+out vec4 FragColor;
+
+uniform usampler2D objectIds;
+uniform isampler2D seeds;
+uniform vec3 color;
+uniform float width;
+
+void main()
+{
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+    // the outline only surrounds the selected objects, it never covers them
+    if (texelFetch(objectIds, coord, 0).r != 0u)
+        discard;
+    ivec2 seed = texelFetch(seeds, coord, 0).rg;
+    if (seed.x < 0)
+        discard;
+    float dist = length(vec2(seed - coord));
+    if (dist > width)
+        discard;
+    // fade the last pixel for a smooth edge
+    FragColor = vec4(color, clamp(width - dist + 0.5, 0.0, 1.0));
+}
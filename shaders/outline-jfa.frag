@@ -0,0 +1,31 @@
+#version 410 core
+out ivec2 Seed;
+
+uniform isampler2D seeds;
+uniform int stepSize;
+
+void main()
+{
+    // jump flood: look at the seeds found by the 8 neighbours stepSize pixels away and keep the nearest one
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+    ivec2 size = textureSize(seeds, 0);
+    ivec2 best = ivec2(-1);
+    float bestDist = 1e20;
+    for (int y = -1; y <= 1; ++y) {
+        for (int x = -1; x <= 1; ++x) {
+            ivec2 p = coord + ivec2(x, y) * stepSize;
+            if (any(lessThan(p, ivec2(0))) || any(greaterThanEqual(p, size)))
+                continue;
+            ivec2 seed = texelFetch(seeds, p, 0).rg;
+            if (seed.x < 0)
+                continue;
+            vec2 d = vec2(seed - coord);
+            float dist = dot(d, d);
+            if (dist < bestDist) {
+                bestDist = dist;
+                best = seed;
+            }
+        }
+    }
+    Seed = best;
+}
@@ -0,0 +1,11 @@
+#version 410 core
+out ivec2 Seed;
+
+uniform usampler2D objectIds;
+
+void main()
+{
+    // every pixel covered by a selected object is its own nearest seed, the rest start out empty
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+    Seed = texelFetch(objectIds, coord, 0).r != 0u ? coord : ivec2(-1);
+}
@@ -0,0 +1,9 @@
+#version 410 core
+out vec4 FragColor;
+
+in vec3 Color;
+
+void main()
+{
+    FragColor = vec4(Color, 1.0);
+}
@@ -0,0 +1,14 @@
+#version 410 core
+layout (location = 0) in vec4 aParticle; // xyz position, w hue
+
+out vec3 Color;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    Color = 0.5 + 0.5 * cos(6.28318 * (aParticle.w + vec3(0.0, 0.33, 0.67)));
+    gl_PointSize = 2.0;
+    gl_Position = projection * view * vec4(aParticle.xyz, 1.0);
+}
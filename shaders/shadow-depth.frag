@@ -0,0 +1,6 @@
+#version 410 core
+
+void main()
+{
+    // depth only, the shadow framebuffer has no color attachment
+}
@@ -0,0 +1,12 @@
+#version 410 core
+layout (location = 0) in vec3 aPos;
+layout (location = 3) in mat4 aModel; // locations 3-6
+
+uniform mat4 model;
+uniform bool instanced;
+
+void main()
+{
+    // world space, the geometry shader projects into every cascade
+    gl_Position = (instanced ? aModel : model) * vec4(aPos, 1.0);
+}
@@ -0,0 +1,14 @@
+#version 410 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+in vec3 Normal;
+
+uniform vec3 color;
+
+void main()
+{
+    // a fixed light from above and a bit of ambient, enough to see the joints bend
+    float diffuse = max(dot(normalize(Normal), normalize(vec3(0.3, 1.0, 0.5))), 0.0);
+    FragColor = vec4(color * (0.2 + 0.8 * diffuse), 1.0);
+}
@@ -0,0 +1,36 @@
+#version 410 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in uvec4 aJoints;
+layout (location = 4) in vec4 aWeights;
+
+out vec2 TexCoords;
+out vec3 Normal;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+// three rows of an affine matrix per joint, the character's palette starts at paletteOffset
+uniform samplerBuffer palette;
+uniform int paletteOffset;
+
+mat4 joint(uint index)
+{
+    int base = paletteOffset + int(index) * 3;
+    return transpose(mat4(texelFetch(palette, base), texelFetch(palette, base + 1), texelFetch(palette, base + 2),
+                          vec4(0.0, 0.0, 0.0, 1.0)));
+}
+
+void main()
+{
+    // rigid vertices have no weights and stay where they are
+    mat4 skin = mat4(1.0);
+    if (aWeights.x > 0.0)
+        skin = joint(aJoints.x) * aWeights.x + joint(aJoints.y) * aWeights.y + joint(aJoints.z) * aWeights.z +
+               joint(aJoints.w) * aWeights.w;
+    TexCoords = aTexCoords;
+    Normal = mat3(model) * mat3(skin) * aNormal;
+    gl_Position = projection * view * model * skin * vec4(aPos, 1.0);
+}
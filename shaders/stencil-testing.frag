@@ -1,11 +1,15 @@
 #version 410 core
-out vec4 FragColor;
+layout (location = 0) out vec4 FragColor;
+// non-zero for selected objects, read by the screen space outline
+layout (location = 1) out uint ObjectId;
 
 in vec2 TexCoords;
 
 uniform sampler2D texture1;
+uniform uint objectId;
 
 void main()
 {
     FragColor = texture(texture1, TexCoords);
+    ObjectId = objectId;
 }
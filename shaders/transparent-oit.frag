@@ -0,0 +1,22 @@
+#version 410 core
+layout (location = 0) out vec4 Accumulation;
+layout (location = 1) out float Revealage;
+
+in vec3 Normal;
+in vec4 Color;
+in float ViewDepth;
+
+// shaders/transparent.frag for the weighted blended pass, see src/base/oit.h
+void main()
+{
+    vec3 lightDir = normalize(vec3(0.3, 1.0, 0.5));
+    float diff = abs(dot(normalize(Normal), lightDir));
+    vec4 color = vec4(Color.rgb * (0.3 + 0.7 * diff), Color.a);
+
+    // nearer surfaces weigh more (equation 7 of the paper). it uses the view distance rather than the window depth so
+    // it is the same for the standard and the reversed depth range
+    float z = ViewDepth;
+    float weight = color.a * clamp(10.0 / (1e-5 + pow(z / 5.0, 2.0) + pow(z / 200.0, 6.0)), 1e-2, 3e3);
+    Accumulation = vec4(color.rgb * color.a, color.a) * weight;
+    Revealage = color.a;
+}
@@ -0,0 +1,14 @@
+#version 410 core
+out vec4 FragColor;
+
+in vec3 Normal;
+in vec4 Color;
+in float ViewDepth;
+
+// straight alpha for GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA blending of sorted geometry
+void main()
+{
+    vec3 lightDir = normalize(vec3(0.3, 1.0, 0.5));
+    float diff = abs(dot(normalize(Normal), lightDir));
+    FragColor = vec4(Color.rgb * (0.3 + 0.7 * diff), Color.a);
+}
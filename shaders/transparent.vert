@@ -0,0 +1,24 @@
+#version 410 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+// per instance: model matrix in 3-6 and the color with its alpha in 7
+layout (location = 3) in mat4 aModel;
+layout (location = 7) in vec4 aColor;
+
+out vec3 Normal;
+out vec4 Color;
+// distance along the view direction, for the weight of the order independent pass
+out float ViewDepth;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    // instances are only rotated and uniformly scaled, so the model matrix can transform normals directly
+    Normal = mat3(aModel) * aNormal;
+    Color = aColor;
+    vec4 viewPos = view * aModel * vec4(aPos, 1.0);
+    ViewDepth = -viewPos.z;
+    gl_Position = projection * viewPos;
+}
@@ -0,0 +1,405 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <base/job_system.h>
+#include <base/mesh.h>
+#include <base/shader.h>
+#include <base/stream_buffer.h>
+#include <base/transform_batch.h>
+
+// skeletal animation: keyframed clips sampled into poses, poses turned into skinning matrices, and those matrices
+// applied on the GPU from a texture buffer or on the CPU.
+//
+// a pose is the local TRS of every node of the skeleton, stored in a transform::Batch so the poses of many characters
+// sit back to back as structure of arrays. the local matrices of all of them are then composed with the SIMD paths of
+// transform::compose in one go, the parent chains and inverse bind matrices are multiplied per character with SSE.
+//
+//   transform::Batch poses;
+//   poses.resize(characters * skeleton.nodeCount());
+//   for (size_t c = 0; c < characters; ++c) {
+//     animation::sample(skeleton, walk, time[c], poses, c * skeleton.nodeCount());
+//     animation::sample(skeleton, run, time[c], poses, c * skeleton.nodeCount(), speed[c]);
+//   }
+//   animation::computePalettes(skeleton, poses, characters, palettes.data(), scratch, &jobs);
+namespace animation {
+
+// bone ids are bytes
+const size_t MAX_JOINTS = 256;
+
+template <typename T> struct Keys {
+  // seconds, ascending
+  std::vector<float> times;
+  std::vector<T> values;
+};
+
+// the keys of one node
+struct Channel {
+  int node = -1;
+  Keys<glm::vec3> positions;
+  Keys<glm::quat> rotations;
+  Keys<glm::vec3> scales;
+};
+
+struct Clip {
+  std::string name;
+  // seconds
+  float duration = 0.0f;
+  std::vector<Channel> channels;
+};
+
+// the node hierarchy the joints hang off, in depth first order like SceneGraph, and the joints the meshes are skinned
+// to. nodes that aren't joints still carry transforms down to the joints below them
+struct Skeleton {
+  std::vector<int> parents;
+  std::vector<std::string> names;
+  // local transforms of the bind pose
+  transform::Batch rest;
+  // node and inverse bind matrix (mesh space to joint space) of each joint, Vertex::boneIds index these
+  std::vector<int> jointNodes;
+  std::vector<glm::mat4> inverseBind;
+
+  size_t nodeCount() const { return parents.size(); }
+  size_t jointCount() const { return jointNodes.size(); }
+  // first node with the given name or -1
+  int findNode(const std::string &name) const {
+    auto it = std::find(names.begin(), names.end(), name);
+    return it == names.end() ? -1 : (int)(it - names.begin());
+  }
+};
+
+// the top three rows of an affine skinning matrix, three RGBA32F texels in the palette buffer
+struct JointMatrix {
+  glm::vec4 rows[3];
+};
+
+// store up to MAX_BONE_INFLUENCE joint weights in a vertex: the largest ones are kept, normalized and quantized so
+// they sum to exactly 255
+inline void packWeights(Vertex &vertex, const int *joints, const float *weights, int count) {
+  int order[16];
+  count = std::min(count, 16);
+  for (int i = 0; i < count; ++i) {
+    order[i] = i;
+  }
+  std::sort(order, order + count, [&](int a, int b) { return weights[a] > weights[b]; });
+  count = std::min(count, MAX_BONE_INFLUENCE);
+  float total = 0.0f;
+  for (int i = 0; i < count; ++i) {
+    total += weights[order[i]];
+  }
+  int sum = 0;
+  for (int i = 0; i < MAX_BONE_INFLUENCE; ++i) {
+    int w = i < count && total > 0.0f ? (int)std::lround(weights[order[i]] / total * 255.0f) : 0;
+    vertex.boneIds[i] = i < count ? (uint8_t)joints[order[i]] : 0;
+    vertex.boneWeights[i] = (uint8_t)w;
+    sum += w;
+  }
+  // rounding error goes to the largest weight
+  if (sum > 0)
+    vertex.boneWeights[0] = (uint8_t)(vertex.boneWeights[0] + 255 - sum);
+}
+
+namespace detail {
+
+// index of the last key at or before t
+inline size_t findKey(const std::vector<float> &times, float t) {
+  auto it = std::upper_bound(times.begin(), times.end(), t);
+  return it == times.begin() ? 0 : (size_t)(it - times.begin()) - 1;
+}
+
+inline float keyFraction(const std::vector<float> &times, size_t i, float t) {
+  float span = times[i + 1] - times[i];
+  return span > 0.0f ? std::min(1.0f, std::max(0.0f, (t - times[i]) / span)) : 0.0f;
+}
+
+inline glm::vec3 mix(const glm::vec3 &a, const glm::vec3 &b, float f) { return a + (b - a) * f; }
+
+// normalized lerp along the shorter arc, close enough to slerp between keys that are a frame apart
+inline glm::quat nlerp(const glm::quat &a, const glm::quat &b, float f) {
+  float sign = a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z < 0.0f ? -1.0f : 1.0f;
+  glm::vec4 q = glm::vec4(a.x, a.y, a.z, a.w) * (1.0f - f) + glm::vec4(b.x, b.y, b.z, b.w) * (sign * f);
+  q = glm::normalize(q);
+  return glm::quat(q.w, q.x, q.y, q.z);
+}
+
+inline glm::vec3 interpolate(const Keys<glm::vec3> &keys, float t) {
+  size_t i = findKey(keys.times, t);
+  if (i + 1 >= keys.values.size())
+    return keys.values[i];
+  return mix(keys.values[i], keys.values[i + 1], keyFraction(keys.times, i, t));
+}
+
+inline glm::quat interpolate(const Keys<glm::quat> &keys, float t) {
+  size_t i = findKey(keys.times, t);
+  if (i + 1 >= keys.values.size())
+    return keys.values[i];
+  return nlerp(keys.values[i], keys.values[i + 1], keyFraction(keys.times, i, t));
+}
+
+#if TRANSFORM_X86
+// out = a * b for column major 4x4 matrices. out may alias b, each column of out only reads the same column of b
+inline void mulSse2(const float *a, const float *b, float *out) {
+  __m128 a0 = _mm_loadu_ps(a), a1 = _mm_loadu_ps(a + 4), a2 = _mm_loadu_ps(a + 8), a3 = _mm_loadu_ps(a + 12);
+  for (int c = 0; c < 4; ++c) {
+    __m128 r = _mm_mul_ps(a0, _mm_set1_ps(b[c * 4]));
+    r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(b[c * 4 + 1])));
+    r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(b[c * 4 + 2])));
+    r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(b[c * 4 + 3])));
+    _mm_storeu_ps(out + c * 4, r);
+  }
+}
+
+// world * inverseBind, transposed into rows
+inline void jointSse2(const float *world, const float *inverseBind, JointMatrix &out) {
+  __m128 a0 = _mm_loadu_ps(world), a1 = _mm_loadu_ps(world + 4), a2 = _mm_loadu_ps(world + 8),
+         a3 = _mm_loadu_ps(world + 12);
+  __m128 columns[4];
+  for (int c = 0; c < 4; ++c) {
+    const float *b = inverseBind + c * 4;
+    __m128 r = _mm_mul_ps(a0, _mm_set1_ps(b[0]));
+    r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(b[1])));
+    r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(b[2])));
+    columns[c] = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(b[3])));
+  }
+  _MM_TRANSPOSE4_PS(columns[0], columns[1], columns[2], columns[3]);
+  _mm_storeu_ps(&out.rows[0][0], columns[0]);
+  _mm_storeu_ps(&out.rows[1][0], columns[1]);
+  _mm_storeu_ps(&out.rows[2][0], columns[2]);
+}
+#endif
+
+// walk the parent chains of one character's local matrices, turning them into model space in place, then write its
+// palette
+inline void paletteOne(const Skeleton &skeleton, transform::Instance *nodes, JointMatrix *palette, bool simd) {
+  size_t count = skeleton.nodeCount();
+  for (size_t i = 0; i < count; ++i) {
+    int parent = skeleton.parents[i];
+    if (parent < 0)
+      continue;
+#if TRANSFORM_X86
+    if (simd) {
+      mulSse2(&nodes[parent].model[0][0], &nodes[i].model[0][0], &nodes[i].model[0][0]);
+      continue;
+    }
+#endif
+    nodes[i].model = nodes[parent].model * nodes[i].model;
+  }
+  for (size_t j = 0; j < skeleton.jointCount(); ++j) {
+    const glm::mat4 &world = nodes[skeleton.jointNodes[j]].model;
+#if TRANSFORM_X86
+    if (simd) {
+      jointSse2(&world[0][0], &skeleton.inverseBind[j][0][0], palette[j]);
+      continue;
+    }
+#endif
+    glm::mat4 m = world * skeleton.inverseBind[j];
+    for (int r = 0; r < 3; ++r) {
+      palette[j].rows[r] = glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+    }
+  }
+}
+
+} // namespace detail
+
+// write the clip's pose at time (seconds, wrapped around its duration) into nodes [offset, offset + nodeCount) of
+// pose. with weight 1 the pose starts from the rest pose and the clip overwrites the nodes it animates, a smaller
+// weight blends the clip over what is in the pose already, e.g. a walk sampled at 1 then a run at 0.3
+inline void sample(const Skeleton &skeleton, const Clip &clip, float time, transform::Batch &pose, size_t offset,
+                   float weight = 1.0f) {
+  if (weight >= 1.0f) {
+    for (size_t i = 0; i < skeleton.nodeCount(); ++i) {
+      pose.px[offset + i] = skeleton.rest.px[i], pose.py[offset + i] = skeleton.rest.py[i];
+      pose.pz[offset + i] = skeleton.rest.pz[i];
+      pose.qx[offset + i] = skeleton.rest.qx[i], pose.qy[offset + i] = skeleton.rest.qy[i];
+      pose.qz[offset + i] = skeleton.rest.qz[i], pose.qw[offset + i] = skeleton.rest.qw[i];
+      pose.sx[offset + i] = skeleton.rest.sx[i], pose.sy[offset + i] = skeleton.rest.sy[i];
+      pose.sz[offset + i] = skeleton.rest.sz[i];
+    }
+  }
+  if (weight <= 0.0f)
+    return;
+  weight = std::min(weight, 1.0f);
+  float t = clip.duration > 0.0f ? std::fmod(time, clip.duration) : 0.0f;
+  if (t < 0.0f)
+    t += clip.duration;
+
+  for (const Channel &channel : clip.channels) {
+    if (channel.node < 0 || channel.node >= (int)skeleton.nodeCount())
+      continue;
+    size_t i = offset + channel.node;
+    if (!channel.positions.values.empty()) {
+      glm::vec3 p = detail::mix(glm::vec3(pose.px[i], pose.py[i], pose.pz[i]),
+                                detail::interpolate(channel.positions, t), weight);
+      pose.px[i] = p.x, pose.py[i] = p.y, pose.pz[i] = p.z;
+    }
+    if (!channel.rotations.values.empty()) {
+      glm::quat q = detail::nlerp(glm::quat(pose.qw[i], pose.qx[i], pose.qy[i], pose.qz[i]),
+                                  detail::interpolate(channel.rotations, t), weight);
+      pose.qx[i] = q.x, pose.qy[i] = q.y, pose.qz[i] = q.z, pose.qw[i] = q.w;
+    }
+    if (!channel.scales.values.empty()) {
+      glm::vec3 s =
+          detail::mix(glm::vec3(pose.sx[i], pose.sy[i], pose.sz[i]), detail::interpolate(channel.scales, t), weight);
+      pose.sx[i] = s.x, pose.sy[i] = s.y, pose.sz[i] = s.z;
+    }
+  }
+}
+
+// skinning matrices of count characters whose poses sit back to back in poses. palettes receives count * jointCount
+// matrices in the same order, scratch is resized to hold the local matrices of every node. with a job system the
+// characters are spread over its threads
+inline void computePalettes(const Skeleton &skeleton, const transform::Batch &poses, size_t count, JointMatrix *palettes,
+                            std::vector<transform::Instance> &scratch, JobSystem *jobs = nullptr,
+                            transform::Path path = transform::bestPath()) {
+  size_t nodes = skeleton.nodeCount(), joints = skeleton.jointCount();
+  scratch.resize(count * nodes);
+  bool simd = path != transform::Path::SCALAR;
+  auto run = [&](size_t begin, size_t end, unsigned int) {
+    transform::compose(poses, begin * nodes, end * nodes, scratch.data(), path);
+    for (size_t c = begin; c < end; ++c) {
+      detail::paletteOne(skeleton, scratch.data() + c * nodes, palettes + c * joints, simd);
+    }
+  };
+  if (jobs)
+    jobs->parallelFor(count, 16, run);
+  else
+    run(0, count, 0);
+}
+
+namespace detail {
+
+inline void skinScalar(const Vertex &in, const JointMatrix *palette, Vertex &out) {
+  glm::vec4 rows[3] = {glm::vec4(0.0f), glm::vec4(0.0f), glm::vec4(0.0f)};
+  for (int k = 0; k < MAX_BONE_INFLUENCE; ++k) {
+    float w = in.boneWeights[k] * (1.0f / 255.0f);
+    for (int r = 0; r < 3; ++r) {
+      rows[r] += palette[in.boneIds[k]].rows[r] * w;
+    }
+  }
+  glm::vec4 p(in.position, 1.0f);
+  glm::vec3 n = in.normal;
+  out = in;
+  out.position = glm::vec3(glm::dot(rows[0], p), glm::dot(rows[1], p), glm::dot(rows[2], p));
+  glm::vec3 normal(glm::dot(glm::vec3(rows[0]), n), glm::dot(glm::vec3(rows[1]), n), glm::dot(glm::vec3(rows[2]), n));
+  float length = glm::length(normal);
+  out.normal = length > 0.0f ? normal / length : normal;
+}
+
+#if TRANSFORM_X86
+inline void skinSse2(const Vertex &in, const JointMatrix *palette, Vertex &out) {
+  __m128 r0 = _mm_setzero_ps(), r1 = _mm_setzero_ps(), r2 = _mm_setzero_ps(), r3 = _mm_setzero_ps();
+  for (int k = 0; k < MAX_BONE_INFLUENCE; ++k) {
+    if (in.boneWeights[k] == 0)
+      continue;
+    __m128 w = _mm_set1_ps(in.boneWeights[k] * (1.0f / 255.0f));
+    const float *m = &palette[in.boneIds[k]].rows[0][0];
+    r0 = _mm_add_ps(r0, _mm_mul_ps(_mm_loadu_ps(m), w));
+    r1 = _mm_add_ps(r1, _mm_mul_ps(_mm_loadu_ps(m + 4), w));
+    r2 = _mm_add_ps(r2, _mm_mul_ps(_mm_loadu_ps(m + 8), w));
+  }
+  // rows to columns, the position is then a sum of scaled columns
+  _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+  __m128 p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r0, _mm_set1_ps(in.position.x)),
+                                   _mm_mul_ps(r1, _mm_set1_ps(in.position.y))),
+                        _mm_add_ps(_mm_mul_ps(r2, _mm_set1_ps(in.position.z)), r3));
+  __m128 n = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r0, _mm_set1_ps(in.normal.x)), _mm_mul_ps(r1, _mm_set1_ps(in.normal.y))),
+                        _mm_mul_ps(r2, _mm_set1_ps(in.normal.z)));
+  // the fourth lane of n is zero, a horizontal add gives the squared length
+  __m128 sq = _mm_mul_ps(n, n);
+  sq = _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 3, 0, 1)));
+  sq = _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(1, 0, 3, 2)));
+  __m128 scale = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(_mm_max_ps(sq, _mm_set1_ps(1e-30f))));
+  n = _mm_mul_ps(n, scale);
+  float pv[4], nv[4];
+  _mm_storeu_ps(pv, p);
+  _mm_storeu_ps(nv, n);
+  out = in;
+  out.position = glm::vec3(pv[0], pv[1], pv[2]);
+  out.normal = glm::vec3(nv[0], nv[1], nv[2]);
+}
+#endif
+
+} // namespace detail
+
+// CPU skinning for count vertices with the palette of one character, e.g. for meshes drawn without the skinning shader
+// or to pick against the posed mesh. normals go through the same matrices, fine as long as joints scale uniformly.
+// vertices without weights are copied as they are
+inline void skin(const Vertex *in, size_t count, const JointMatrix *palette, Vertex *out,
+                 transform::Path path = transform::bestPath()) {
+  for (size_t i = 0; i < count; ++i) {
+    if (in[i].boneWeights[0] == 0) {
+      out[i] = in[i];
+      continue;
+    }
+#if TRANSFORM_X86
+    if (path != transform::Path::SCALAR) {
+      detail::skinSse2(in[i], palette, out[i]);
+      continue;
+    }
+#endif
+    detail::skinScalar(in[i], palette, out[i]);
+  }
+}
+
+} // namespace animation
+
+// the palettes of every character drawn in a frame, in one texture buffer on top of a StreamBuffer. GL 4.1 has no
+// storage buffers and a 16KB uniform block holds only about 340 affine joints, the texture buffer takes all characters
+// at once and a draw passes just the texel offset of its palette. shaders/skinning.vert reads it.
+//
+//   palettes.beginFrame();
+//   GLint offset = palettes.upload(character.data(), skeleton.jointCount());
+//   palettes.bind(shader);
+//   shader.setInt("paletteOffset", offset);
+//   ... draw ...
+//   palettes.endFrame();
+class PaletteBuffer {
+public:
+  // room for this many joints per frame
+  explicit PaletteBuffer(size_t maxJoints, int frames = 3)
+      : stream((GLsizeiptr)(maxJoints * sizeof(animation::JointMatrix)), frames) {
+    // a view of the stream's storage, the bytes are counted with the buffer
+    texture = GLTexture::create("joint palettes");
+    glBindTexture(GL_TEXTURE_BUFFER, texture.get());
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, stream.get_id());
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+  }
+  PaletteBuffer(const PaletteBuffer &) = delete;
+  PaletteBuffer &operator=(const PaletteBuffer &) = delete;
+
+  void beginFrame() { stream.beginFrame(); }
+  // copy a palette in, returns the texel offset to pass as "paletteOffset" or -1 when the frame is full
+  GLint upload(const animation::JointMatrix *joints, size_t count) {
+    auto allocation = stream.allocate((GLsizeiptr)(count * sizeof(animation::JointMatrix)), 16);
+    if (!allocation.ptr)
+      return -1;
+    std::copy(joints, joints + count, static_cast<animation::JointMatrix *>(allocation.ptr));
+    dirty = true;
+    return (GLint)(allocation.offset / 16);
+  }
+  // make the uploads visible and point the shader's "palette" sampler at the buffer, the shader has to be in use
+  void bind(const Shader &shader, GLuint unit = 0) {
+    if (dirty)
+      stream.flush();
+    dirty = false;
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_BUFFER, texture.get());
+    glActiveTexture(GL_TEXTURE0);
+    shader.setInt("palette", (int)unit);
+  }
+  void endFrame() { stream.endFrame(); }
+
+private:
+  StreamBuffer stream;
+  GLTexture texture;
+  bool dirty = false;
+};
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// block compression encoders for BC1 (DXT1), BC3 (DXT5), BC4 and BC5 (RGTC1/2).
+//
+// every encoder takes tightly packed 8-bit pixels with `channels` components per pixel and returns the compressed
+// blocks row by row. partial blocks at the right and bottom edges repeat the last row/column. the color encoder fits
+// the endpoints along the principal axis of the block and picks each index against the actual decoded palette, which
+// is a good balance between quality and speed for a build step.
+namespace bcn {
+
+enum class Format { BC1, BC3, BC4, BC5 };
+
+inline int blockBytes(Format format) { return (format == Format::BC1 || format == Format::BC4) ? 8 : 16; }
+
+inline size_t compressedSize(Format format, int width, int height) {
+  return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+}
+
+namespace detail {
+
+// gather a 4x4 block as RGBA, missing channels are 0 and missing alpha is opaque
+inline void fetchBlock(const uint8_t *pixels, int width, int height, int channels, int bx, int by, uint8_t out[16][4]) {
+  for (int y = 0; y < 4; ++y) {
+    int sy = std::min(by * 4 + y, height - 1);
+    for (int x = 0; x < 4; ++x) {
+      int sx = std::min(bx * 4 + x, width - 1);
+      const uint8_t *p = pixels + ((size_t)sy * width + sx) * channels;
+      uint8_t *o = out[y * 4 + x];
+      o[0] = p[0];
+      o[1] = channels > 1 ? p[1] : 0;
+      o[2] = channels > 2 ? p[2] : 0;
+      o[3] = channels > 3 ? p[3] : 255;
+    }
+  }
+}
+
+inline uint16_t pack565(const float c[3]) {
+  int r = std::clamp((int)std::lround(c[0] * 31.0f / 255.0f), 0, 31);
+  int g = std::clamp((int)std::lround(c[1] * 63.0f / 255.0f), 0, 63);
+  int b = std::clamp((int)std::lround(c[2] * 31.0f / 255.0f), 0, 31);
+  return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+inline void unpack565(uint16_t c, int out[3]) {
+  int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+  out[0] = (r << 3) | (r >> 2);
+  out[1] = (g << 2) | (g >> 4);
+  out[2] = (b << 3) | (b >> 2);
+}
+
+inline void encodeColorBlock(const uint8_t block[16][4], uint8_t *dst) {
+  // principal axis of the colors through a few rounds of power iteration on the covariance matrix
+  float mean[3] = {0, 0, 0};
+  for (int i = 0; i < 16; ++i) {
+    for (int c = 0; c < 3; ++c) {
+      mean[c] += block[i][c];
+    }
+  }
+  for (float &m : mean) {
+    m /= 16.0f;
+  }
+  float cov[6] = {0, 0, 0, 0, 0, 0};
+  for (int i = 0; i < 16; ++i) {
+    float r = block[i][0] - mean[0], g = block[i][1] - mean[1], b = block[i][2] - mean[2];
+    cov[0] += r * r;
+    cov[1] += r * g;
+    cov[2] += r * b;
+    cov[3] += g * g;
+    cov[4] += g * b;
+    cov[5] += b * b;
+  }
+  // start from the covariance row of the channel that varies most. a fixed start like (1, 1, 1) is in the null space
+  // of anticorrelated channels, e.g. a red|green edge, and the block would collapse to its mean. a flat block has no
+  // axis at all and keeps the gray one
+  float axis[3] = {1.0f, 1.0f, 1.0f};
+  const float rows[3][3] = {{cov[0], cov[1], cov[2]}, {cov[1], cov[3], cov[4]}, {cov[2], cov[4], cov[5]}};
+  int widest = cov[0] >= cov[3] && cov[0] >= cov[5] ? 0 : cov[3] >= cov[5] ? 1 : 2;
+  if (rows[widest][widest] > 0.0f) {
+    for (int c = 0; c < 3; ++c) {
+      axis[c] = rows[widest][c] / rows[widest][widest];
+    }
+  }
+  for (int iter = 0; iter < 4; ++iter) {
+    float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+    float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+    float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+    float len = std::max(std::max(std::abs(x), std::abs(y)), std::abs(z));
+    if (len < 1e-6f)
+      break;
+    axis[0] = x / len;
+    axis[1] = y / len;
+    axis[2] = z / len;
+  }
+
+  // the extremes along the axis, pulled in slightly since the palette never reaches the outliers exactly
+  float lo = 1e30f, hi = -1e30f;
+  for (int i = 0; i < 16; ++i) {
+    float t = (block[i][0] - mean[0]) * axis[0] + (block[i][1] - mean[1]) * axis[1] + (block[i][2] - mean[2]) * axis[2];
+    lo = std::min(lo, t);
+    hi = std::max(hi, t);
+  }
+  float inset = (hi - lo) / 16.0f;
+  lo += inset;
+  hi -= inset;
+  float axisLen2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+  if (axisLen2 > 0.0f) {
+    lo /= axisLen2;
+    hi /= axisLen2;
+  }
+  float maxColor[3], minColor[3];
+  for (int c = 0; c < 3; ++c) {
+    maxColor[c] = mean[c] + axis[c] * hi;
+    minColor[c] = mean[c] + axis[c] * lo;
+  }
+  uint16_t c0 = pack565(maxColor), c1 = pack565(minColor);
+  if (c0 < c1) {
+    std::swap(c0, c1);
+  }
+
+  uint32_t indices = 0;
+  if (c0 != c1) {
+    // four color mode needs c0 > c1
+    int palette[4][3];
+    unpack565(c0, palette[0]);
+    unpack565(c1, palette[1]);
+    for (int c = 0; c < 3; ++c) {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+    for (int i = 0; i < 16; ++i) {
+      int best = 0, bestDist = INT32_MAX;
+      for (int p = 0; p < 4; ++p) {
+        int dr = block[i][0] - palette[p][0], dg = block[i][1] - palette[p][1], db = block[i][2] - palette[p][2];
+        int dist = dr * dr + dg * dg + db * db;
+        if (dist < bestDist) {
+          bestDist = dist;
+          best = p;
+        }
+      }
+      indices |= (uint32_t)best << (2 * i);
+    }
+  }
+  dst[0] = c0 & 0xFF;
+  dst[1] = c0 >> 8;
+  dst[2] = c1 & 0xFF;
+  dst[3] = c1 >> 8;
+  std::memcpy(dst + 4, &indices, 4);
+}
+
+// BC4 block for one channel of the RGBA block
+inline void encodeChannelBlock(const uint8_t block[16][4], int channel, uint8_t *dst) {
+  int lo = 255, hi = 0;
+  for (int i = 0; i < 16; ++i) {
+    lo = std::min(lo, (int)block[i][channel]);
+    hi = std::max(hi, (int)block[i][channel]);
+  }
+  // eight value mode: a0 > a1, palette interpolates from a0 (index 0) to a1 (index 1) through indices 2..7
+  dst[0] = (uint8_t)hi;
+  dst[1] = (uint8_t)lo;
+  uint64_t bits = 0;
+  if (hi != lo) {
+    for (int i = 0; i < 16; ++i) {
+      int step = (int)std::lround((hi - block[i][channel]) * 7.0f / (hi - lo));
+      int index = step == 0 ? 0 : step == 7 ? 1 : step + 1;
+      bits |= (uint64_t)index << (3 * i);
+    }
+  }
+  for (int b = 0; b < 6; ++b) {
+    dst[2 + b] = (bits >> (8 * b)) & 0xFF;
+  }
+}
+
+} // namespace detail
+
+// compress a whole image, BC4 encodes the first channel and BC5 the first two
+inline std::vector<uint8_t> encode(Format format, const uint8_t *pixels, int width, int height, int channels) {
+  std::vector<uint8_t> out(compressedSize(format, width, height));
+  int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+  uint8_t block[16][4];
+  uint8_t *dst = out.data();
+  for (int by = 0; by < blocksY; ++by) {
+    for (int bx = 0; bx < blocksX; ++bx) {
+      detail::fetchBlock(pixels, width, height, channels, bx, by, block);
+      switch (format) {
+      case Format::BC1:
+        detail::encodeColorBlock(block, dst);
+        break;
+      case Format::BC3:
+        detail::encodeChannelBlock(block, 3, dst);
+        detail::encodeColorBlock(block, dst + 8);
+        break;
+      case Format::BC4:
+        detail::encodeChannelBlock(block, 0, dst);
+        break;
+      case Format::BC5:
+        detail::encodeChannelBlock(block, 0, dst);
+        detail::encodeChannelBlock(block, 1, dst + 8);
+        break;
+      }
+      dst += blockBytes(format);
+    }
+  }
+  return out;
+}
+
+} // namespace bcn
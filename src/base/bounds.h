@@ -0,0 +1,108 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cfloat>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define BOUNDS_X86 1
+#endif
+
+// axis aligned bounding box, used for culling meshes and instances
+struct AABB {
+  glm::vec3 min = glm::vec3(FLT_MAX);
+  glm::vec3 max = glm::vec3(-FLT_MAX);
+
+  bool valid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+  glm::vec3 center() const { return (min + max) * 0.5f; }
+  glm::vec3 extent() const { return (max - min) * 0.5f; }
+
+  void expand(const glm::vec3 &p) {
+    min = glm::min(min, p);
+    max = glm::max(max, p);
+  }
+  void expand(const AABB &other) {
+    min = glm::min(min, other.min);
+    max = glm::max(max, other.max);
+  }
+
+  // return the box enclosing this box after it has been transformed by the given matrix
+  AABB transformed(const glm::mat4 &m) const {
+    // transform the center and project the extent onto the world axes (Arvo's method), which gives the same result as
+    // transforming all 8 corners but with a fraction of the work
+    glm::vec3 c = glm::vec3(m * glm::vec4(center(), 1.0f));
+    glm::vec3 e = extent();
+    glm::vec3 r;
+    for (int i = 0; i < 3; ++i) {
+      r[i] = std::abs(m[0][i]) * e.x + std::abs(m[1][i]) * e.y + std::abs(m[2][i]) * e.z;
+    }
+    AABB box;
+    box.min = c - r;
+    box.max = c + r;
+    return box;
+  }
+};
+
+// the six planes of a view frustum with their normals pointing inwards, extracted from a view-projection matrix
+// (Gribb/Hartmann) so they are in world space and not normalized
+struct Frustum {
+  // left, right, bottom, top, near, far. with a [0, 1] clip depth the last two are z >= 0 and z <= w, which are far and
+  // near for a reversed depth projection. an infinite far plane degenerates to one every point is in front of
+  glm::vec4 planes[6];
+  // the planes transposed to structure of arrays and padded to 8 with a plane everything is in front of, so the test
+  // checks 4 planes per instruction and the planes can be uploaded as they are
+  alignas(16) float px[8], py[8], pz[8], pw[8];
+
+  Frustum() = default;
+  explicit Frustum(const glm::mat4 &viewProj, bool zeroToOne = false) {
+    // glm is column major, row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i])
+    auto row = [&](int i) { return glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]); };
+    glm::vec4 x = row(0), y = row(1), z = row(2), w = row(3);
+    planes[0] = w + x;
+    planes[1] = w - x;
+    planes[2] = w + y;
+    planes[3] = w - y;
+    planes[4] = zeroToOne ? z : w + z;
+    planes[5] = w - z;
+    for (int i = 0; i < 8; ++i) {
+      glm::vec4 p = i < 6 ? planes[i] : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+      px[i] = p.x, py[i] = p.y, pz[i] = p.z, pw[i] = p.w;
+    }
+  }
+
+  void setPlane(int i, const glm::vec4 &p) {
+    planes[i] = p;
+    px[i] = p.x, py[i] = p.y, pz[i] = p.z, pw[i] = p.w;
+  }
+
+  // conservative test, boxes near a frustum corner may pass although they are outside
+  bool intersects(const AABB &box) const {
+    glm::vec3 c = box.center();
+    glm::vec3 e = box.extent();
+#if BOUNDS_X86
+    // distance of the box corner furthest along each plane normal, 4 planes at a time
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 cx = _mm_set1_ps(c.x), cy = _mm_set1_ps(c.y), cz = _mm_set1_ps(c.z);
+    __m128 ex = _mm_set1_ps(e.x), ey = _mm_set1_ps(e.y), ez = _mm_set1_ps(e.z);
+    for (int i = 0; i < 8; i += 4) {
+      __m128 nx = _mm_load_ps(px + i), ny = _mm_load_ps(py + i), nz = _mm_load_ps(pz + i);
+      __m128 d = _mm_add_ps(_mm_load_ps(pw + i), _mm_add_ps(_mm_mul_ps(nx, cx), _mm_add_ps(_mm_mul_ps(ny, cy),
+                                                                                             _mm_mul_ps(nz, cz))));
+      __m128 r = _mm_add_ps(_mm_mul_ps(_mm_andnot_ps(sign, nx), ex),
+                            _mm_add_ps(_mm_mul_ps(_mm_andnot_ps(sign, ny), ey), _mm_mul_ps(_mm_andnot_ps(sign, nz), ez)));
+      if (_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(d, r), _mm_setzero_ps())))
+        return false;
+    }
+    return true;
+#else
+    for (int i = 0; i < 6; ++i) {
+      // distance of the box corner furthest along the plane normal
+      glm::vec3 n(px[i], py[i], pz[i]);
+      if (glm::dot(n, c) + glm::dot(glm::abs(n), e) + pw[i] < 0.0f)
+        return false;
+    }
+    return true;
+#endif
+  }
+};
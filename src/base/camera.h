@@ -1,6 +1,12 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <limits>
+
+#include <base/bounds.h>
 
 enum Movement { FORWARD, BACKWARD, LEFT, RIGHT };
 
@@ -13,22 +19,100 @@ const float SENSITIVITY = 0.1f;
 const float ZOOM = 45.0f;
 
 // an abstract camera class that processes input and calculates the corresponding Euler Angles, Vectors and Matrices for
-// use in OpenGL
+// use in OpenGL. the camera owns its projection too, the matrices and the frustum are computed when they are asked for
+// after something they depend on changed and cached until then
 class Camera {
 public:
-  glm::vec3 position;
-  glm::vec3 front;
-  float zoom;
+  // pass as the far plane for a projection without one
+  static constexpr float INFINITE_FAR = std::numeric_limits<float>::infinity();
 
   Camera(glm::vec3 pos = glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f), float yaw = YAW,
          float pitch = PITCH)
-      : position(pos), worldUp(up), yaw(yaw), pitch(pitch), front(glm::vec3(0.0f, 0.0f, -1.0f)), movementSpeed(SPEED),
-        mouseSensitivity(SENSITIVITY), zoom(ZOOM) {
+      : position(pos), front(glm::vec3(0.0f, 0.0f, -1.0f)), zoom(ZOOM), worldUp(up), yaw(yaw), pitch(pitch),
+        movementSpeed(SPEED), mouseSensitivity(SENSITIVITY) {
     update();
   }
 
+  // clip distances of the projection, zFar may be INFINITE_FAR. a reversed projection maps the near plane to depth
+  // 1 and the far plane to 0, it needs a [0, 1] clip depth range (glClipControl) and a GL_GREATER depth test
+  void setProjection(float zNear, float zFar, bool reversedZ = false) {
+    nearPlane = zNear;
+    farPlane = zFar;
+    reversed = reversedZ;
+    invalidate(PROJECTION);
+  }
+
+  // the framebuffer size the projection's aspect ratio follows, call it from the framebuffer size callback. a
+  // minimized window reports 0x0, the last aspect ratio is kept then
+  void setViewport(int width, int height) {
+    if (width <= 0 || height <= 0)
+      return;
+    aspect = (float)width / (float)height;
+    invalidate(PROJECTION);
+  }
+
   // return the view matrix calculated using Euler Angles and the LookAt Matrix
-  glm::mat4 getViewMatrix() { return glm::lookAt(position, position + front, up); }
+  const glm::mat4 &getViewMatrix() const {
+    if (dirty & VIEW) {
+      view = glm::lookAt(position, position + front, up);
+      dirty &= ~VIEW;
+    }
+    return view;
+  }
+
+  const glm::mat4 &getProjectionMatrix() const {
+    if (dirty & PROJECTION) {
+      projection = perspective(glm::radians(zoom), aspect, nearPlane, farPlane, reversed);
+      dirty &= ~PROJECTION;
+    }
+    return projection;
+  }
+
+  const glm::mat4 &getViewProjectionMatrix() const {
+    if (dirty & VIEW_PROJECTION) {
+      viewProjection = getProjectionMatrix() * getViewMatrix();
+      dirty &= ~VIEW_PROJECTION;
+    }
+    return viewProjection;
+  }
+
+  // world space planes of the view frustum, for culling or uploading
+  const Frustum &getFrustum() const {
+    if (dirty & FRUSTUM) {
+      frustum = Frustum(getViewProjectionMatrix(), reversed);
+      dirty &= ~FRUSTUM;
+    }
+    return frustum;
+  }
+
+  const glm::vec3 &getPosition() const { return position; }
+  const glm::vec3 &getFront() const { return front; }
+  // vertical field of view in degrees
+  float getZoom() const { return zoom; }
+  float getAspect() const { return aspect; }
+  float getNear() const { return nearPlane; }
+  float getFar() const { return farPlane; }
+  bool isReversedZ() const { return reversed; }
+
+  // perspective projection for a [-1, 1] clip depth range, or [0, 1] reversed. a far plane at infinity takes the
+  // limit of the matrix, which keeps the precision of the finite one near the camera
+  static glm::mat4 perspective(float fovy, float aspect, float zNear, float zFar, bool reversed) {
+    if (!reversed)
+      return std::isinf(zFar) ? glm::infinitePerspective(fovy, aspect, zNear)
+                              : glm::perspective(fovy, aspect, zNear, zFar);
+    float f = 1.0f / std::tan(fovy * 0.5f);
+    glm::mat4 m(0.0f);
+    m[0][0] = f / aspect;
+    m[1][1] = f;
+    m[2][3] = -1.0f;
+    if (std::isinf(zFar)) {
+      m[3][2] = zNear;
+    } else {
+      m[2][2] = zNear / (zFar - zNear);
+      m[3][2] = zFar * zNear / (zFar - zNear);
+    }
+    return m;
+  }
 
   // process input received from any keyboard-like input system
   void processKeyboard(Movement direction, float deltaTime) {
@@ -47,6 +131,7 @@ public:
       position += right * velocity;
       break;
     }
+    invalidate(VIEW);
   }
 
   // process input received from a mouse input system. expects the offset value in both the x and y direction.
@@ -74,10 +159,16 @@ public:
       zoom = 1.0f;
     if (zoom > 45.0f)
       zoom = 45.0f;
+    invalidate(PROJECTION);
   }
 
 private:
+  enum : unsigned int { VIEW = 1, PROJECTION = 2, VIEW_PROJECTION = 4, FRUSTUM = 8 };
+
   // attributes
+  glm::vec3 position;
+  glm::vec3 front;
+  float zoom;
   glm::vec3 up;
   glm::vec3 right;
   glm::vec3 worldUp;
@@ -87,6 +178,20 @@ private:
   // options
   float movementSpeed;
   float mouseSensitivity;
+  // projection
+  float nearPlane = 0.1f;
+  float farPlane = 100.0f;
+  float aspect = 4.0f / 3.0f;
+  bool reversed = false;
+  // cached matrices, a set bit means the matrix is out of date
+  mutable unsigned int dirty = VIEW | PROJECTION | VIEW_PROJECTION | FRUSTUM;
+  mutable glm::mat4 view;
+  mutable glm::mat4 projection;
+  mutable glm::mat4 viewProjection;
+  mutable Frustum frustum;
+
+  // the view projection and the frustum depend on everything else
+  void invalidate(unsigned int bits) { dirty |= bits | VIEW_PROJECTION | FRUSTUM; }
 
   // calculate the front, right, up vectors from the camera's Euler Angles
   void update() {
@@ -98,5 +203,6 @@ private:
 
     right = glm::normalize(glm::cross(front, worldUp));
     up = glm::normalize(glm::cross(right, front));
+    invalidate(VIEW);
   }
 };
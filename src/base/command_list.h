@@ -0,0 +1,184 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <base/job_system.h>
+
+// per draw uniforms, packed at record time so replay only has to hand them to GL
+struct ObjectUniforms {
+  glm::mat4 model;
+  glm::vec4 color;
+};
+
+// a draw recorded on any thread. it only holds GL names and an index into the recording list's uniform data, building
+// one never calls GL
+struct DrawCommand {
+  // program, then vertex array, then depth front to back, so sorting minimizes state changes
+  uint64_t key;
+  GLuint program;
+  GLuint vao;
+  GLenum mode;
+  GLsizei count;
+  // GL_UNSIGNED_INT etc. for glDrawElements, 0 for glDrawArrays
+  GLenum indexType;
+  uint32_t uniforms;
+};
+
+// commands recorded by one thread, the lists of different threads are merged by RenderQueue
+class CommandList {
+public:
+  void clear() {
+    commands.clear();
+    uniforms.clear();
+  }
+
+  // depth is the view space distance used to order draws sharing the same state
+  void draw(GLuint program, GLuint vao, GLenum mode, GLsizei count, GLenum indexType, float depth,
+            const glm::mat4 &model, const glm::vec4 &color) {
+    DrawCommand cmd;
+    cmd.key = sortKey(program, vao, depth);
+    cmd.program = program;
+    cmd.vao = vao;
+    cmd.mode = mode;
+    cmd.count = count;
+    cmd.indexType = indexType;
+    cmd.uniforms = (uint32_t)uniforms.size();
+    commands.push_back(cmd);
+    uniforms.push_back({model, color});
+  }
+
+  void sort() {
+    std::sort(commands.begin(), commands.end(),
+              [](const DrawCommand &a, const DrawCommand &b) { return a.key < b.key; });
+  }
+
+  static uint64_t sortKey(GLuint program, GLuint vao, float depth) {
+    // 12 bits of program, 20 bits of vertex array and 32 bits of depth. non negative floats keep their order when
+    // compared as integers
+    uint32_t depthBits;
+    depth = std::max(depth, 0.0f);
+    std::memcpy(&depthBits, &depth, sizeof(depthBits));
+    return (uint64_t)(program & 0xfff) << 52 | (uint64_t)(vao & 0xfffff) << 32 | depthBits;
+  }
+
+  std::vector<DrawCommand> commands;
+  std::vector<ObjectUniforms> uniforms;
+};
+
+// one command list per recording thread plus the GL side replay. workers fill list(thread) in parallel, sort() orders
+// each list on the worker threads and submit() merges the sorted lists and issues the GL calls on the calling thread,
+// which has to own the context. programs read the per frame matrix from `viewProjection` and the per draw data from
+// `model` and `color`.
+class RenderQueue {
+public:
+  struct Stats {
+    unsigned int draws = 0;
+    unsigned int programChanges = 0;
+    unsigned int vaoChanges = 0;
+  };
+
+  explicit RenderQueue(unsigned int threads) : lists(threads) {}
+
+  CommandList &list(unsigned int thread) { return lists[thread]; }
+  unsigned int listCount() const { return (unsigned int)lists.size(); }
+
+  void reset() {
+    for (auto &list : lists) {
+      list.clear();
+    }
+  }
+
+  void sort(JobSystem &jobs) {
+    jobs.parallelFor(lists.size(), 1, [this](size_t begin, size_t end, unsigned int) {
+      for (size_t i = begin; i < end; ++i) {
+        lists[i].sort();
+      }
+    });
+  }
+
+  size_t size() const {
+    size_t n = 0;
+    for (const auto &list : lists) {
+      n += list.commands.size();
+    }
+    return n;
+  }
+
+  void submit(const glm::mat4 &viewProjection);
+
+  const Stats &getStats() const { return stats; }
+
+private:
+  struct Locations {
+    GLint viewProjection, model, color;
+  };
+  const Locations &locations(GLuint program);
+
+  std::vector<CommandList> lists;
+  std::unordered_map<GLuint, Locations> programs;
+  Stats stats;
+};
+
+inline const RenderQueue::Locations &RenderQueue::locations(GLuint program) {
+  auto it = programs.find(program);
+  if (it != programs.end())
+    return it->second;
+  Locations loc;
+  loc.viewProjection = glGetUniformLocation(program, "viewProjection");
+  loc.model = glGetUniformLocation(program, "model");
+  loc.color = glGetUniformLocation(program, "color");
+  return programs[program] = loc;
+}
+
+inline void RenderQueue::submit(const glm::mat4 &viewProjection) {
+  stats = Stats();
+  // k-way merge of the sorted lists, the number of lists is the number of threads so a linear scan for the smallest
+  // head is cheaper than a heap
+  std::vector<size_t> heads(lists.size(), 0);
+  GLuint program = 0, vao = 0;
+  const Locations *loc = nullptr;
+  while (true) {
+    int best = -1;
+    for (size_t i = 0; i < lists.size(); ++i) {
+      if (heads[i] < lists[i].commands.size() &&
+          (best < 0 || lists[i].commands[heads[i]].key < lists[best].commands[heads[best]].key))
+        best = (int)i;
+    }
+    if (best < 0)
+      break;
+
+    const CommandList &list = lists[best];
+    const DrawCommand &cmd = list.commands[heads[best]++];
+    if (cmd.program != program) {
+      program = cmd.program;
+      glUseProgram(program);
+      loc = &locations(program);
+      glUniformMatrix4fv(loc->viewProjection, 1, GL_FALSE, glm::value_ptr(viewProjection));
+      ++stats.programChanges;
+    }
+    if (cmd.vao != vao) {
+      vao = cmd.vao;
+      glBindVertexArray(vao);
+      ++stats.vaoChanges;
+    }
+    const ObjectUniforms &u = list.uniforms[cmd.uniforms];
+    glUniformMatrix4fv(loc->model, 1, GL_FALSE, glm::value_ptr(u.model));
+    glUniform4fv(loc->color, 1, glm::value_ptr(u.color));
+    if (cmd.indexType)
+      glDrawElements(cmd.mode, cmd.count, cmd.indexType, nullptr);
+    else
+      glDrawArrays(cmd.mode, 0, cmd.count);
+    ++stats.draws;
+  }
+  glBindVertexArray(0);
+}
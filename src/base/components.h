@@ -0,0 +1,114 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <string>
+
+#include <base/bounds.h>
+#include <base/command_list.h>
+#include <base/ecs.h>
+#include <base/job_system.h>
+#include <base/scene_graph.h>
+#include <base/shader.h>
+
+// the components the renderer understands and the systems that read them straight out of an ecs::Registry
+
+// local placement, turned into a WorldTransform by updateTransforms
+struct Transform {
+  glm::vec3 position = glm::vec3(0.0f);
+  glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+  glm::vec3 scale = glm::vec3(1.0f);
+};
+
+struct WorldTransform {
+  glm::mat4 matrix = glm::mat4(1.0f);
+};
+
+// geometry to draw, indexType is 0 for glDrawArrays
+struct MeshRef {
+  GLuint vao = 0;
+  GLsizei count = 0;
+  GLenum indexType = 0;
+};
+
+// program and per object parameters
+struct MaterialRef {
+  GLuint program = 0;
+  glm::vec4 color = glm::vec4(1.0f);
+};
+
+// object space bounds and their world space box as of the last updateTransforms
+struct Bounds {
+  AABB local;
+  AABB world;
+};
+
+// parameters of the PointLight struct in the lighting shaders, positioned by the entity's Transform
+struct PointLight {
+  glm::vec3 ambient = glm::vec3(0.05f);
+  glm::vec3 diffuse = glm::vec3(0.8f);
+  glm::vec3 specular = glm::vec3(1.0f);
+  float constant = 1.0f;
+  float linear = 0.09f;
+  float quadratic = 0.032f;
+};
+
+// Transform -> WorldTransform, then the world bounds of everything that has them
+inline void updateTransforms(ecs::Registry &registry, JobSystem &jobs) {
+  registry.parallelEachChunk<Transform, WorldTransform>(
+      jobs, 4096, [](unsigned int, size_t n, Transform *transforms, WorldTransform *worlds) {
+        for (size_t i = 0; i < n; ++i) {
+          worlds[i].matrix = SceneGraph::compose(transforms[i].position, transforms[i].rotation, transforms[i].scale);
+        }
+      });
+  registry.parallelEachChunk<WorldTransform, Bounds>(
+      jobs, 4096, [](unsigned int, size_t n, WorldTransform *worlds, Bounds *bounds) {
+        for (size_t i = 0; i < n; ++i) {
+          bounds[i].world = bounds[i].local.transformed(worlds[i].matrix);
+        }
+      });
+}
+
+// frustum cull every drawable entity and record the survivors into the queue, one command list per thread. returns the
+// number of recorded draws
+inline size_t recordDraws(ecs::Registry &registry, JobSystem &jobs, RenderQueue &queue, const glm::mat4 &viewProj,
+                          const glm::vec3 &eye, const glm::vec3 &forward) {
+  Frustum frustum(viewProj);
+  queue.reset();
+  registry.parallelEachChunk<WorldTransform, Bounds, MeshRef, MaterialRef>(
+      jobs, 1024,
+      [&](unsigned int thread, size_t n, WorldTransform *worlds, Bounds *bounds, MeshRef *meshes,
+          MaterialRef *materials) {
+        CommandList &list = queue.list(thread);
+        for (size_t i = 0; i < n; ++i) {
+          if (!frustum.intersects(bounds[i].world))
+            continue;
+          float depth = glm::dot(bounds[i].world.center() - eye, forward);
+          list.draw(materials[i].program, meshes[i].vao, GL_TRIANGLES, meshes[i].count, meshes[i].indexType, depth,
+                    worlds[i].matrix, materials[i].color);
+        }
+      });
+  queue.sort(jobs);
+  return queue.size();
+}
+
+// set the pointLights[] array of a lighting shader from the first maxLights light entities, returns how many were set
+inline int uploadPointLights(ecs::Registry &registry, const Shader &shader, int maxLights) {
+  int count = 0;
+  registry.each<Transform, PointLight>([&](Transform &transform, PointLight &light) {
+    if (count >= maxLights)
+      return;
+    std::string name = "pointLights[" + std::to_string(count++) + "].";
+    shader.setVec3(name + "position", transform.position);
+    shader.setVec3(name + "ambient", light.ambient);
+    shader.setVec3(name + "diffuse", light.diffuse);
+    shader.setVec3(name + "specular", light.specular);
+    shader.setFloat(name + "constant", light.constant);
+    shader.setFloat(name + "linear", light.linear);
+    shader.setFloat(name + "quadratic", light.quadratic);
+  });
+  return count;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <base/gl_ext.h>
+
+// reversed-Z depth.
+//
+// a perspective projection spreads depth as 1/z, so with the usual [-1, 1] mapping and a fixed point buffer almost all
+// of the values go to the first few units in front of the camera. reversed-Z maps the near plane to 1 and the far
+// plane (usually at infinity) to 0 in a [0, 1] clip depth range. the exponent of a float buffer then cancels the 1/z
+// falloff and the precision is nearly even over the whole view distance. the [0, 1] range comes from glClipControl,
+// without it the mapping back to [0, 1] adds the float error at 0.5 and most of the benefit is lost, so the mode is
+// only offered when the context has GL 4.5 or ARB_clip_control. clip control is context state: passes with projections
+// of their own, like the shadow cascades, need [0, 1] reversed projections too or have to switch back around them.
+namespace depth {
+
+enum class Mode { STANDARD, REVERSED };
+
+namespace detail {
+inline Mode &mode() {
+  static Mode current = Mode::STANDARD;
+  return current;
+}
+} // namespace detail
+
+inline bool reversedSupported() { return glext::clipControl() != nullptr; }
+
+// set clip control, depth test and clear value for the mode on the current context. returns the mode in effect,
+// STANDARD when reversed-Z isn't supported. projections have to match, see Camera::setProjection()
+inline Mode setMode(Mode mode) {
+  if (mode == Mode::REVERSED && !reversedSupported())
+    mode = Mode::STANDARD;
+  bool reversed = mode == Mode::REVERSED;
+  if (auto clipControl = glext::clipControl())
+    clipControl(GL_LOWER_LEFT, reversed ? GL_ZERO_TO_ONE : GL_NEGATIVE_ONE_TO_ONE);
+  glDepthFunc(reversed ? GL_GREATER : GL_LESS);
+  glClearDepth(reversed ? 0.0 : 1.0);
+  detail::mode() = mode;
+  return mode;
+}
+
+inline Mode getMode() { return detail::mode(); }
+inline bool reversed() { return detail::mode() == Mode::REVERSED; }
+
+// the depth test for "nearer than", use it wherever GL_LESS or GL_LEQUAL would be hard coded
+inline GLenum less(bool orEqual = false) {
+  if (reversed())
+    return orEqual ? GL_GEQUAL : GL_GREATER;
+  return orEqual ? GL_LEQUAL : GL_LESS;
+}
+
+// depth of the far plane, the value a cleared depth buffer holds
+inline float farValue() { return reversed() ? 0.0f : 1.0f; }
+
+// internal format for depth attachments: reversed-Z needs a float buffer, the standard mapping gets nothing from one
+inline GLenum attachmentFormat() { return reversed() ? GL_DEPTH_COMPONENT32F : GL_DEPTH_COMPONENT24; }
+inline GLenum attachmentType() { return reversed() ? GL_FLOAT : GL_UNSIGNED_INT; }
+
+} // namespace depth
@@ -0,0 +1,308 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <base/job_system.h>
+
+// an archetype based entity/component store.
+//
+// entities with the same set of component types share an archetype, which keeps one tightly packed array per component
+// type. systems iterate over the archetypes that have everything they ask for and get plain arrays, so a loop over
+// transforms only touches transforms, in order, with nothing in between. components must be trivially copyable, they
+// are moved around with memcpy when entities change archetype or get removed.
+//
+//   ecs::Registry registry;
+//   ecs::Entity e = registry.create(Transform{...}, MeshRef{...});
+//   registry.each<Transform, MeshRef>([](Transform &t, MeshRef &m) { ... });
+namespace ecs {
+
+struct Entity {
+  uint32_t index = UINT32_MAX;
+  uint32_t generation = 0;
+
+  bool valid() const { return index != UINT32_MAX; }
+  bool operator==(const Entity &other) const { return index == other.index && generation == other.generation; }
+  bool operator!=(const Entity &other) const { return !(*this == other); }
+};
+
+// one bit per component type
+using ComponentMask = uint64_t;
+const unsigned int MAX_COMPONENTS = 64;
+
+namespace detail {
+inline unsigned int nextComponentId() {
+  static unsigned int next = 0;
+  return next++;
+}
+} // namespace detail
+
+// ids are handed out the first time a component type is used
+template <typename T> unsigned int componentId() {
+  static const unsigned int id = detail::nextComponentId();
+  return id;
+}
+
+template <typename... Ts> ComponentMask componentMask() { return ((ComponentMask(1) << componentId<Ts>()) | ... | 0); }
+
+class Archetype {
+public:
+  struct Column {
+    unsigned int id;
+    size_t elementSize;
+    std::vector<unsigned char> data;
+  };
+
+  Archetype(ComponentMask mask, const std::vector<std::pair<unsigned int, size_t>> &components) : mask(mask) {
+    std::fill(std::begin(columnIndex), std::end(columnIndex), -1);
+    for (const auto &c : components) {
+      columnIndex[c.first] = (int)columns.size();
+      columns.push_back({c.first, c.second, {}});
+    }
+  }
+
+  ComponentMask getMask() const { return mask; }
+  size_t size() const { return entities.size(); }
+  const std::vector<Entity> &getEntities() const { return entities; }
+  const std::vector<Column> &getColumns() const { return columns; }
+
+  bool has(unsigned int id) const { return columnIndex[id] >= 0; }
+  template <typename T> T *data() { return reinterpret_cast<T *>(columns[columnIndex[componentId<T>()]].data.data()); }
+  void *element(unsigned int id, size_t row) {
+    Column &column = columns[columnIndex[id]];
+    return column.data.data() + row * column.elementSize;
+  }
+
+  // append a zeroed row
+  size_t addRow(Entity entity) {
+    entities.push_back(entity);
+    for (auto &column : columns) {
+      column.data.resize(column.data.size() + column.elementSize);
+    }
+    return entities.size() - 1;
+  }
+
+  // swap the last row into the removed one, returns the entity that moved or an invalid one
+  Entity removeRow(size_t row) {
+    size_t last = entities.size() - 1;
+    Entity moved;
+    if (row != last) {
+      entities[row] = entities[last];
+      moved = entities[row];
+      for (auto &column : columns) {
+        std::memcpy(column.data.data() + row * column.elementSize, column.data.data() + last * column.elementSize,
+                    column.elementSize);
+      }
+    }
+    entities.pop_back();
+    for (auto &column : columns) {
+      column.data.resize(column.data.size() - column.elementSize);
+    }
+    return moved;
+  }
+
+private:
+  ComponentMask mask;
+  std::vector<Entity> entities;
+  std::vector<Column> columns;
+  int columnIndex[MAX_COMPONENTS];
+};
+
+class Registry {
+public:
+  template <typename... Ts> Entity create(const Ts &...components);
+  void destroy(Entity entity);
+  bool alive(Entity entity) const {
+    return entity.index < records.size() && records[entity.index].generation == entity.generation &&
+           records[entity.index].archetype;
+  }
+  size_t size() const { return count; }
+
+  // null when the entity is dead or doesn't have the component
+  template <typename T> T *get(Entity entity);
+  // moves the entity to the archetype with T added, or overwrites T if it is already there
+  template <typename T> void add(Entity entity, const T &component);
+  template <typename T> void remove(Entity entity);
+
+  // fn(size_t count, Ts *...arrays) once per archetype that has all of Ts
+  template <typename... Ts, typename Fn> void eachChunk(Fn &&fn);
+  // fn(Ts &...) for every entity that has all of Ts
+  template <typename... Ts, typename Fn> void each(Fn &&fn);
+  // like eachChunk but archetypes are split into ranges of at least grain entities spread over the job system,
+  // fn(unsigned int thread, size_t count, Ts *...arrays) where the arrays start at the range
+  template <typename... Ts, typename Fn> void parallelEachChunk(JobSystem &jobs, size_t grain, Fn &&fn);
+  // fn(Ts &...) for every entity that has all of Ts, spread over the job system
+  template <typename... Ts, typename Fn> void parallelEach(JobSystem &jobs, size_t grain, Fn &&fn);
+
+  const std::vector<Archetype *> &getArchetypes() const { return archetypeList; }
+
+private:
+  struct Record {
+    Archetype *archetype = nullptr;
+    size_t row = 0;
+    uint32_t generation = 0;
+  };
+
+  Archetype &archetype(ComponentMask mask, const std::vector<std::pair<unsigned int, size_t>> &components);
+  Entity allocate();
+  // move an entity's row into another archetype, components missing in the target are dropped, new ones are zeroed
+  void move(Entity entity, Archetype &target);
+
+  std::vector<Record> records;
+  std::vector<uint32_t> freeIndices;
+  size_t count = 0;
+  std::unordered_map<ComponentMask, std::unique_ptr<Archetype>> archetypes;
+  // in creation order so iteration is deterministic
+  std::vector<Archetype *> archetypeList;
+};
+
+inline Archetype &Registry::archetype(ComponentMask mask,
+                                      const std::vector<std::pair<unsigned int, size_t>> &components) {
+  auto it = archetypes.find(mask);
+  if (it != archetypes.end())
+    return *it->second;
+  auto sorted = components;
+  std::sort(sorted.begin(), sorted.end());
+  auto &a = archetypes[mask] = std::make_unique<Archetype>(mask, sorted);
+  archetypeList.push_back(a.get());
+  return *a;
+}
+
+inline Entity Registry::allocate() {
+  Entity entity;
+  if (!freeIndices.empty()) {
+    entity.index = freeIndices.back();
+    freeIndices.pop_back();
+  } else {
+    entity.index = (uint32_t)records.size();
+    records.emplace_back();
+  }
+  entity.generation = records[entity.index].generation;
+  ++count;
+  return entity;
+}
+
+template <typename... Ts> Entity Registry::create(const Ts &...components) {
+  static_assert((std::is_trivially_copyable<Ts>::value && ...), "components must be trivially copyable");
+  Archetype &a = archetype(componentMask<Ts...>(), {{componentId<Ts>(), sizeof(Ts)}...});
+  Entity entity = allocate();
+  size_t row = a.addRow(entity);
+  (std::memcpy(a.element(componentId<Ts>(), row), &components, sizeof(Ts)), ...);
+  records[entity.index].archetype = &a;
+  records[entity.index].row = row;
+  return entity;
+}
+
+inline void Registry::destroy(Entity entity) {
+  if (!alive(entity))
+    return;
+  Record &record = records[entity.index];
+  Entity moved = record.archetype->removeRow(record.row);
+  if (moved.valid())
+    records[moved.index].row = record.row;
+  record.archetype = nullptr;
+  ++record.generation;
+  freeIndices.push_back(entity.index);
+  --count;
+}
+
+template <typename T> T *Registry::get(Entity entity) {
+  if (!alive(entity))
+    return nullptr;
+  Record &record = records[entity.index];
+  unsigned int id = componentId<T>();
+  if (!record.archetype->has(id))
+    return nullptr;
+  return reinterpret_cast<T *>(record.archetype->element(id, record.row));
+}
+
+inline void Registry::move(Entity entity, Archetype &target) {
+  Record &record = records[entity.index];
+  Archetype &source = *record.archetype;
+  size_t row = target.addRow(entity);
+  for (const auto &column : source.getColumns()) {
+    if (target.has(column.id))
+      std::memcpy(target.element(column.id, row), source.element(column.id, record.row), column.elementSize);
+  }
+  Entity moved = source.removeRow(record.row);
+  if (moved.valid())
+    records[moved.index].row = record.row;
+  record.archetype = &target;
+  record.row = row;
+}
+
+template <typename T> void Registry::add(Entity entity, const T &component) {
+  static_assert(std::is_trivially_copyable<T>::value, "components must be trivially copyable");
+  if (!alive(entity))
+    return;
+  unsigned int id = componentId<T>();
+  Archetype *current = records[entity.index].archetype;
+  if (!current->has(id)) {
+    std::vector<std::pair<unsigned int, size_t>> components = {{id, sizeof(T)}};
+    for (const auto &column : current->getColumns()) {
+      components.emplace_back(column.id, column.elementSize);
+    }
+    move(entity, archetype(current->getMask() | ComponentMask(1) << id, components));
+  }
+  *get<T>(entity) = component;
+}
+
+template <typename T> void Registry::remove(Entity entity) {
+  if (!alive(entity))
+    return;
+  unsigned int id = componentId<T>();
+  Archetype *current = records[entity.index].archetype;
+  if (!current->has(id))
+    return;
+  std::vector<std::pair<unsigned int, size_t>> components;
+  for (const auto &column : current->getColumns()) {
+    if (column.id != id)
+      components.emplace_back(column.id, column.elementSize);
+  }
+  move(entity, archetype(current->getMask() & ~(ComponentMask(1) << id), components));
+}
+
+template <typename... Ts, typename Fn> void Registry::eachChunk(Fn &&fn) {
+  ComponentMask mask = componentMask<Ts...>();
+  for (Archetype *a : archetypeList) {
+    if ((a->getMask() & mask) == mask && a->size() > 0)
+      fn(a->size(), a->template data<Ts>()...);
+  }
+}
+
+template <typename... Ts, typename Fn> void Registry::each(Fn &&fn) {
+  eachChunk<Ts...>([&](size_t n, Ts *...arrays) {
+    for (size_t i = 0; i < n; ++i) {
+      fn(arrays[i]...);
+    }
+  });
+}
+
+template <typename... Ts, typename Fn> void Registry::parallelEachChunk(JobSystem &jobs, size_t grain, Fn &&fn) {
+  ComponentMask mask = componentMask<Ts...>();
+  for (Archetype *a : archetypeList) {
+    if ((a->getMask() & mask) != mask || a->size() == 0)
+      continue;
+    std::tuple<Ts *...> arrays(a->template data<Ts>()...);
+    jobs.parallelFor(a->size(), grain, [&](size_t begin, size_t end, unsigned int thread) {
+      std::apply([&](Ts *...base) { fn(thread, end - begin, (base + begin)...); }, arrays);
+    });
+  }
+}
+
+template <typename... Ts, typename Fn> void Registry::parallelEach(JobSystem &jobs, size_t grain, Fn &&fn) {
+  parallelEachChunk<Ts...>(jobs, grain, [&](unsigned int, size_t n, Ts *...arrays) {
+    for (size_t i = 0; i < n; ++i) {
+      fn(arrays[i]...);
+    }
+  });
+}
+
+} // namespace ecs
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// runs the update of frame N+1 (input, camera, transforms, culling...) on its own thread while the render thread
+// submits frame N.
+//
+// the scene state is kept in latency + 1 copies, the update fills one copy while the renderer reads another, so the two
+// stages never touch the same data and need no locking beyond the hand over. latency is the number of frames the
+// update may run ahead of the frame being rendered: 1 double buffers the state, 2 triple buffers it and hides update
+// spikes at the cost of another frame of input lag. latency 0 runs the update inline in acquire(), which is the
+// classic lock-step loop and handy as a baseline.
+//
+//   FramePipeline<Scene> pipeline(1, initial, [](Scene &next, const Scene &previous, uint64_t frame) { ... });
+//   while (...) {
+//     const Scene &scene = pipeline.acquire();
+//     ... draw scene ...
+//     pipeline.release();
+//     glfwSwapBuffers(window);
+//   }
+template <typename State> class FramePipeline {
+public:
+  // next is the copy to fill, previous the state the last update produced. with latency 0 both are the same copy
+  using UpdateFn = std::function<void(State &next, const State &previous, uint64_t frame)>;
+
+  struct Stats {
+    unsigned int frames = 0;
+    // interval between consecutive acquire() calls on the render thread
+    double frameMs = 0.0;
+    double frameP50Ms = 0.0;
+    double frameP99Ms = 0.0;
+    // standard deviation of the frame interval
+    double jitterMs = 0.0;
+    // time spent in the update callback
+    double updateMs = 0.0;
+    // time the render thread waited for the update, high values mean the update is the bottleneck
+    double renderWaitMs = 0.0;
+    // time the update thread waited for a free copy, high values mean rendering is the bottleneck
+    double updateWaitMs = 0.0;
+    // from the start of a frame's update to its release on the render thread
+    double latencyMs = 0.0;
+  };
+
+  FramePipeline(int latency, const State &initial, UpdateFn update);
+  ~FramePipeline();
+  FramePipeline(const FramePipeline &) = delete;
+  FramePipeline &operator=(const FramePipeline &) = delete;
+
+  // wait for the next updated frame, it stays untouched until release()
+  const State &acquire();
+  void release();
+
+  int getLatency() const { return (int)states.size() - 1; }
+  Stats getStats() const;
+  void resetStats();
+
+private:
+  void updateLoop();
+  static double now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  std::vector<State> states;
+  UpdateFn update;
+  std::thread thread;
+
+  mutable std::mutex mutex;
+  std::condition_variable frameReady;
+  std::condition_variable slotFree;
+  bool quit = false;
+  // frames the update has finished and frames the renderer has released
+  uint64_t produced = 0;
+  uint64_t consumed = 0;
+  // update start time of the frame in each copy
+  std::vector<double> startTimes;
+
+  // samples since the last reset, guarded by mutex
+  double lastAcquire = -1.0;
+  std::vector<double> intervals;
+  double updateSeconds = 0.0, renderWaitSeconds = 0.0, updateWaitSeconds = 0.0, latencySeconds = 0.0;
+  unsigned int updates = 0, releases = 0;
+};
+
+template <typename State>
+FramePipeline<State>::FramePipeline(int latency, const State &initial, UpdateFn update)
+    : states(std::max(latency, 0) + 1, initial), update(std::move(update)), startTimes(states.size(), 0.0) {
+  if (latency > 0)
+    thread = std::thread(&FramePipeline::updateLoop, this);
+}
+
+template <typename State> FramePipeline<State>::~FramePipeline() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    quit = true;
+  }
+  slotFree.notify_all();
+  if (thread.joinable())
+    thread.join();
+}
+
+template <typename State> void FramePipeline<State>::updateLoop() {
+  while (true) {
+    uint64_t frame;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      double waitStart = now();
+      // the copy for this frame is free once the renderer released the frame that used it last
+      slotFree.wait(lock, [this] { return quit || produced - consumed < states.size(); });
+      if (quit)
+        return;
+      updateWaitSeconds += now() - waitStart;
+      frame = produced;
+    }
+
+    size_t slot = frame % states.size();
+    const State &previous = states[frame == 0 ? slot : (frame - 1) % states.size()];
+    double start = now();
+    update(states[slot], previous, frame);
+    double end = now();
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      startTimes[slot] = start;
+      updateSeconds += end - start;
+      ++updates;
+      ++produced;
+    }
+    frameReady.notify_one();
+  }
+}
+
+template <typename State> const State &FramePipeline<State>::acquire() {
+  std::unique_lock<std::mutex> lock(mutex);
+  double waitStart = now();
+  if (!thread.joinable()) {
+    // lock-step, update right here
+    lock.unlock();
+    size_t slot = 0;
+    update(states[slot], states[slot], produced);
+    double end = now();
+    lock.lock();
+    startTimes[slot] = waitStart;
+    updateSeconds += end - waitStart;
+    ++updates;
+    ++produced;
+  } else {
+    frameReady.wait(lock, [this] { return produced > consumed; });
+    renderWaitSeconds += now() - waitStart;
+  }
+
+  double t = now();
+  if (lastAcquire >= 0.0)
+    intervals.push_back(t - lastAcquire);
+  lastAcquire = t;
+  return states[consumed % states.size()];
+}
+
+template <typename State> void FramePipeline<State>::release() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    latencySeconds += now() - startTimes[consumed % states.size()];
+    ++releases;
+    ++consumed;
+  }
+  slotFree.notify_one();
+}
+
+template <typename State> typename FramePipeline<State>::Stats FramePipeline<State>::getStats() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  Stats stats;
+  stats.frames = (unsigned int)intervals.size();
+  if (!intervals.empty()) {
+    double sum = 0.0;
+    for (double i : intervals) {
+      sum += i;
+    }
+    double mean = sum / intervals.size();
+    double variance = 0.0;
+    for (double i : intervals) {
+      variance += (i - mean) * (i - mean);
+    }
+    std::vector<double> sorted = intervals;
+    std::sort(sorted.begin(), sorted.end());
+    stats.frameMs = mean * 1000.0;
+    stats.frameP50Ms = sorted[sorted.size() / 2] * 1000.0;
+    stats.frameP99Ms = sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)] * 1000.0;
+    stats.jitterMs = std::sqrt(variance / intervals.size()) * 1000.0;
+  }
+  if (updates > 0) {
+    stats.updateMs = updateSeconds * 1000.0 / updates;
+    stats.updateWaitMs = updateWaitSeconds * 1000.0 / updates;
+  }
+  if (releases > 0) {
+    stats.renderWaitMs = renderWaitSeconds * 1000.0 / releases;
+    stats.latencyMs = latencySeconds * 1000.0 / releases;
+  }
+  return stats;
+}
+
+template <typename State> void FramePipeline<State>::resetStats() {
+  std::lock_guard<std::mutex> lock(mutex);
+  lastAcquire = -1.0;
+  intervals.clear();
+  updateSeconds = renderWaitSeconds = updateWaitSeconds = latencySeconds = 0.0;
+  updates = releases = 0;
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <iostream>
+#include <vector>
+
+#include <base/gl_resource.h>
+
+// an offscreen render target with any number of color attachments and an optional depth attachment, all of them
+// textures so later passes can sample them
+class Framebuffer {
+public:
+  struct Attachment {
+    GLenum internalFormat;
+    GLenum format;
+    GLenum type;
+    GLuint texture;
+  };
+
+  Framebuffer(int width, int height) : width(width), height(height) { glGenFramebuffers(1, &fbo); }
+  ~Framebuffer() {
+    release();
+    glDeleteFramebuffers(1, &fbo);
+  }
+  Framebuffer(const Framebuffer &) = delete;
+  Framebuffer &operator=(const Framebuffer &) = delete;
+
+  // attach a color texture, returns its attachment index
+  unsigned int addColor(GLenum internalFormat, GLenum format, GLenum type) {
+    colors.push_back({internalFormat, format, type, 0});
+    allocate(colors.back());
+    std::vector<GLenum> drawBuffers;
+    for (unsigned int i = 0; i < colors.size(); ++i) {
+      drawBuffers.push_back(GL_COLOR_ATTACHMENT0 + i);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + colors.size() - 1, GL_TEXTURE_2D,
+                           colors.back().texture, 0);
+    glDrawBuffers(drawBuffers.size(), drawBuffers.data());
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return colors.size() - 1;
+  }
+
+  void setDepth(GLenum internalFormat, GLenum format, GLenum type) {
+    if (hasDepth)
+      destroy(depth);
+    depth = {internalFormat, format, type, 0};
+    hasDepth = true;
+    allocate(depth);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, depthAttachment(), GL_TEXTURE_2D, depth.texture, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  }
+
+  // reallocate all attachments, e.g. after the window has been resized
+  void resize(int w, int h) {
+    if (w == width && h == height)
+      return;
+    width = w;
+    height = h;
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    for (unsigned int i = 0; i < colors.size(); ++i) {
+      destroy(colors[i]);
+      allocate(colors[i]);
+      glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, colors[i].texture, 0);
+    }
+    if (hasDepth) {
+      destroy(depth);
+      allocate(depth);
+      glFramebufferTexture2D(GL_FRAMEBUFFER, depthAttachment(), GL_TEXTURE_2D, depth.texture, 0);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  }
+
+  bool complete() const {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+      std::cerr << "framebuffer incomplete: 0x" << std::hex << status << std::dec << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  void bind() const {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, width, height);
+  }
+
+  // copy the first color attachment into the default framebuffer
+  void blitToScreen(int screenWidth, int screenHeight) const {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, screenWidth, screenHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  }
+
+  GLuint get_id() const { return fbo; }
+  GLuint colorTexture(unsigned int i = 0) const { return colors[i].texture; }
+  GLuint depthTexture() const { return depth.texture; }
+  int getWidth() const { return width; }
+  int getHeight() const { return height; }
+
+private:
+  GLuint fbo;
+  int width, height;
+  std::vector<Attachment> colors;
+  Attachment depth{};
+  bool hasDepth = false;
+
+  GLenum depthAttachment() const {
+    return depth.format == GL_DEPTH_STENCIL ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+  }
+
+  void allocate(Attachment &a) {
+    glGenTextures(1, &a.texture);
+    glBindTexture(GL_TEXTURE_2D, a.texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, a.internalFormat, width, height, 0, a.format, a.type, nullptr);
+    vram::track(vram::Category::TEXTURE, a.texture, vram::textureBytes(a.internalFormat, width, height),
+                "framebuffer attachment");
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+  }
+
+  static void destroy(Attachment &a) {
+    vram::untrack(vram::Category::TEXTURE, a.texture);
+    glDeleteTextures(1, &a.texture);
+  }
+
+  void release() {
+    for (auto &c : colors) {
+      destroy(c);
+    }
+    if (hasDepth) {
+      destroy(depth);
+    }
+  }
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include <glad/glad.h>
+
+#include <cstring>
+
+// entry points and tokens newer than the GL 4.1 core profile the examples create. they are looked up at runtime and
+// are null when neither the context version nor an extension provides them, callers fall back to 4.1 paths.
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#define GL_CLIENT_STORAGE_BIT 0x0200
+#endif
+
+#ifndef GL_ZERO_TO_ONE
+#define GL_NEGATIVE_ONE_TO_ONE 0x935E
+#define GL_ZERO_TO_ONE 0x935F
+#endif
+
+namespace glext {
+
+typedef void(APIENTRYP PFNBUFFERSTORAGE)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+typedef void(APIENTRYP PFNCLIPCONTROL)(GLenum origin, GLenum depth);
+
+// version of the current context as major * 10 + minor
+inline int contextVersion() {
+  GLint major = 0, minor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+  return major * 10 + minor;
+}
+
+inline bool hasExtension(const char *name) {
+  GLint count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (GLint i = 0; i < count; ++i) {
+    if (std::strcmp((const char *)glGetStringi(GL_EXTENSIONS, i), name) == 0)
+      return true;
+  }
+  return false;
+}
+
+// look a function up if it is core in `version` or the extension is present
+inline GLFWglproc load(const char *function, int version, const char *extension) {
+  if (contextVersion() >= version || hasExtension(extension))
+    return glfwGetProcAddress(function);
+  return nullptr;
+}
+
+// glBufferStorage, GL 4.4 / ARB_buffer_storage
+inline PFNBUFFERSTORAGE bufferStorage() {
+  static PFNBUFFERSTORAGE fn = (PFNBUFFERSTORAGE)load("glBufferStorage", 44, "GL_ARB_buffer_storage");
+  return fn;
+}
+
+// glClipControl, GL 4.5 / ARB_clip_control. the pointer is kept in a glad style slot that gltrace swaps like the
+// glad ones, so reversed-Z frames are counted, recorded and replayed too
+inline PFNCLIPCONTROL glad_glClipControl = nullptr;
+
+inline PFNCLIPCONTROL clipControl() {
+  static bool loaded = (glad_glClipControl = (PFNCLIPCONTROL)load("glClipControl", 45, "GL_ARB_clip_control"), true);
+  (void)loaded;
+  return glad_glClipControl;
+}
+
+} // namespace glext
@@ -0,0 +1,211 @@
+#include <base/gl_resource.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vram {
+
+namespace {
+
+struct Object {
+  size_t bytes = 0;
+  std::string label;
+};
+
+struct Registry {
+  std::mutex mutex;
+  // per category, by GL name
+  std::unordered_map<GLuint, Object> objects[(int)Category::COUNT];
+  Usage usage[(int)Category::COUNT];
+};
+
+// never destroyed, handles in globals and statics are released after every destructor in this file has run
+Registry &registry() {
+  static Registry *instance = new Registry;
+  return *instance;
+}
+
+// prints what is left once main() has returned and its locals are gone
+struct LeakReport {
+  ~LeakReport() {
+    if (totalObjects() == 0)
+      return;
+    std::cerr << "vram: " << totalObjects() << " GL objects holding " << totalBytes() / 1024 << " KB were not deleted"
+              << std::endl;
+    report(std::cerr);
+  }
+} leakReport;
+
+} // namespace
+
+const char *categoryName(Category category) {
+  switch (category) {
+  case Category::BUFFER:
+    return "buffer";
+  case Category::TEXTURE:
+    return "texture";
+  case Category::RENDERBUFFER:
+    return "renderbuffer";
+  case Category::VERTEX_ARRAY:
+    return "vertex array";
+  case Category::PROGRAM:
+    return "program";
+  default:
+    return "?";
+  }
+}
+
+void track(Category category, GLuint id, size_t bytes, const char *label) {
+  Registry &r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  auto [it, inserted] = r.objects[(int)category].try_emplace(id);
+  Usage &usage = r.usage[(int)category];
+  if (inserted)
+    ++usage.objects;
+  if (bytes) {
+    usage.bytes = usage.bytes - it->second.bytes + bytes;
+    it->second.bytes = bytes;
+  }
+  if (label)
+    it->second.label = label;
+}
+
+void setBytes(Category category, GLuint id, size_t bytes) {
+  Registry &r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  auto it = r.objects[(int)category].find(id);
+  if (it == r.objects[(int)category].end())
+    return;
+  Usage &usage = r.usage[(int)category];
+  usage.bytes = usage.bytes - it->second.bytes + bytes;
+  it->second.bytes = bytes;
+}
+
+void untrack(Category category, GLuint id) {
+  Registry &r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  auto it = r.objects[(int)category].find(id);
+  if (it == r.objects[(int)category].end())
+    return;
+  Usage &usage = r.usage[(int)category];
+  usage.bytes -= it->second.bytes;
+  --usage.objects;
+  r.objects[(int)category].erase(it);
+}
+
+Usage usage(Category category) {
+  Registry &r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  return r.usage[(int)category];
+}
+
+size_t totalBytes() {
+  Registry &r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  size_t bytes = 0;
+  for (const Usage &u : r.usage)
+    bytes += u.bytes;
+  return bytes;
+}
+
+size_t totalObjects() {
+  Registry &r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  size_t objects = 0;
+  for (const Usage &u : r.usage)
+    objects += u.objects;
+  return objects;
+}
+
+size_t report(std::ostream &out) {
+  struct Line {
+    Category category;
+    GLuint id;
+    const Object *object;
+  };
+  Registry &r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  std::vector<Line> lines;
+  for (int c = 0; c < (int)Category::COUNT; ++c) {
+    for (const auto &[id, object] : r.objects[c])
+      lines.push_back({(Category)c, id, &object});
+  }
+  std::sort(lines.begin(), lines.end(), [](const Line &a, const Line &b) { return a.object->bytes > b.object->bytes; });
+  for (const Line &line : lines) {
+    out << "  " << std::left << std::setw(14) << categoryName(line.category) << std::right << std::setw(6) << line.id
+        << std::setw(10) << (line.object->bytes + 1023) / 1024 << " KB  " << line.object->label << std::endl;
+  }
+  return lines.size();
+}
+
+size_t textureBytes(GLenum internalFormat, int width, int height, int levels, int layers) {
+  // bytes per 4x4 block for the compressed formats, per texel for the rest
+  size_t block = 0, texel = 4;
+  switch (internalFormat) {
+  case 0x83F0: // GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+  case 0x83F1: // GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+  case 0x8C4C: // GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+  case 0x8C4D: // GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+  case GL_COMPRESSED_RED_RGTC1:
+  case GL_COMPRESSED_SIGNED_RED_RGTC1:
+    block = 8;
+    break;
+  case 0x83F2: // GL_COMPRESSED_RGBA_S3TC_DXT3_EXT
+  case 0x83F3: // GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+  case 0x8C4E: // GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT
+  case 0x8C4F: // GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+  case GL_COMPRESSED_RG_RGTC2:
+  case GL_COMPRESSED_SIGNED_RG_RGTC2:
+  case 0x8E8C: // GL_COMPRESSED_RGBA_BPTC_UNORM
+  case 0x8E8D: // GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM
+  case 0x8E8E: // GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT
+  case 0x8E8F: // GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT
+    block = 16;
+    break;
+  case GL_RED:
+  case GL_R8:
+  case GL_R8UI:
+  case GL_STENCIL_INDEX8:
+    texel = 1;
+    break;
+  case GL_RG:
+  case GL_RG8:
+  case GL_R16F:
+  case GL_R16UI:
+  case GL_DEPTH_COMPONENT16:
+    texel = 2;
+    break;
+  case GL_RG32F:
+  case GL_RGB16F:
+  case GL_RGBA16F:
+  case GL_DEPTH32F_STENCIL8:
+    texel = 8;
+    break;
+  case GL_RGB32F:
+  case GL_RGBA32F:
+  case GL_RGBA32UI:
+    texel = 16;
+    break;
+  default:
+    // the 8 bit RGB(A) formats, RG16F, R32F, R32UI, R11F_G11F_B10F, RGB10_A2 and the 24 and 32 bit depth formats
+    break;
+  }
+
+  size_t bytes = 0;
+  for (int level = 0; level < levels; ++level) {
+    if (block)
+      bytes += (size_t)((width + 3) / 4) * ((height + 3) / 4) * block;
+    else
+      bytes += (size_t)width * height * texel;
+    width = std::max(1, width / 2);
+    height = std::max(1, height / 2);
+  }
+  return bytes * layers;
+}
+
+} // namespace vram
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <ostream>
+#include <utility>
+
+// ownership and memory accounting of GL objects.
+//
+// GLObject is a move-only handle that deletes its object when it goes out of scope, so a copy can't delete an object
+// that is still in use and a forgotten object is freed with its owner. every object created through a handle, and
+// the ones the texture loaders return, is registered here with the bytes of storage it holds. vram::usage() gives the
+// live count and size per category while running. whatever is still registered when the process exits is printed as
+// a leak on stderr, with the label it was given. sizes are what the objects were specified with, drivers pad and
+// compress on their own, so the totals are an estimate of what the application asked for, not of what the GPU holds.
+//
+//   GLBuffer vbo = GLBuffer::create("particles");
+//   glBindBuffer(GL_ARRAY_BUFFER, vbo.get());
+//   glBufferData(GL_ARRAY_BUFFER, bytes, data, GL_STATIC_DRAW);
+//   vbo.setBytes(bytes);
+//
+// objects deleted with the raw glDelete* calls have to be untracked by hand. handles owned by globals outlive the
+// report and show up in it.
+namespace vram {
+
+enum class Category { BUFFER, TEXTURE, RENDERBUFFER, VERTEX_ARRAY, PROGRAM, COUNT };
+
+struct Usage {
+  size_t objects = 0;
+  size_t bytes = 0;
+};
+
+const char *categoryName(Category category);
+
+// register a live object. bytes and label replace those of an object registered already unless they are 0 and null
+void track(Category category, GLuint id, size_t bytes = 0, const char *label = nullptr);
+// the object's storage was (re)specified
+void setBytes(Category category, GLuint id, size_t bytes);
+// the object was deleted
+void untrack(Category category, GLuint id);
+
+Usage usage(Category category);
+size_t totalBytes();
+size_t totalObjects();
+// list the live objects with their labels and sizes, largest first, returns how many there are
+size_t report(std::ostream &out);
+
+// bytes of a 2D image and `levels` of its mips. block compressed formats count their blocks, three channel formats
+// are counted as four because that is how drivers store them
+size_t textureBytes(GLenum internalFormat, int width, int height, int levels = 1, int layers = 1);
+
+} // namespace vram
+
+template <vram::Category C> class GLObject {
+public:
+  GLObject() = default;
+  // take ownership of an existing object, e.g. one a loader returned
+  explicit GLObject(GLuint id, size_t bytes = 0, const char *label = nullptr) : id(id) {
+    if (id)
+      vram::track(C, id, bytes, label);
+  }
+  // generate a new object, programs are created empty
+  static GLObject create(const char *label = nullptr) { return GLObject(generate(), 0, label); }
+  ~GLObject() { reset(); }
+  GLObject(const GLObject &) = delete;
+  GLObject &operator=(const GLObject &) = delete;
+  GLObject(GLObject &&other) noexcept : id(std::exchange(other.id, 0)) {}
+  GLObject &operator=(GLObject &&other) noexcept {
+    if (this != &other) {
+      reset();
+      id = std::exchange(other.id, 0);
+    }
+    return *this;
+  }
+
+  GLuint get() const { return id; }
+  explicit operator bool() const { return id != 0; }
+  void setBytes(size_t bytes) const {
+    if (id)
+      vram::setBytes(C, id, bytes);
+  }
+  // delete the object now
+  void reset() {
+    if (!id)
+      return;
+    vram::untrack(C, id);
+    destroy(id);
+    id = 0;
+  }
+  // give up ownership without deleting, the object is no longer tracked either
+  GLuint release() {
+    if (id)
+      vram::untrack(C, id);
+    return std::exchange(id, 0);
+  }
+
+private:
+  GLuint id = 0;
+
+  static GLuint generate();
+  static void destroy(GLuint id);
+};
+
+using GLBuffer = GLObject<vram::Category::BUFFER>;
+using GLTexture = GLObject<vram::Category::TEXTURE>;
+using GLRenderbuffer = GLObject<vram::Category::RENDERBUFFER>;
+using GLVertexArray = GLObject<vram::Category::VERTEX_ARRAY>;
+using GLProgram = GLObject<vram::Category::PROGRAM>;
+
+template <vram::Category C> inline GLuint GLObject<C>::generate() {
+  GLuint id = 0;
+  if constexpr (C == vram::Category::BUFFER)
+    glGenBuffers(1, &id);
+  else if constexpr (C == vram::Category::TEXTURE)
+    glGenTextures(1, &id);
+  else if constexpr (C == vram::Category::RENDERBUFFER)
+    glGenRenderbuffers(1, &id);
+  else if constexpr (C == vram::Category::VERTEX_ARRAY)
+    glGenVertexArrays(1, &id);
+  else
+    id = glCreateProgram();
+  return id;
+}
+
+template <vram::Category C> inline void GLObject<C>::destroy(GLuint id) {
+  if constexpr (C == vram::Category::BUFFER)
+    glDeleteBuffers(1, &id);
+  else if constexpr (C == vram::Category::TEXTURE)
+    glDeleteTextures(1, &id);
+  else if constexpr (C == vram::Category::RENDERBUFFER)
+    glDeleteRenderbuffers(1, &id);
+  else if constexpr (C == vram::Category::VERTEX_ARRAY)
+    glDeleteVertexArrays(1, &id);
+  else
+    glDeleteProgram(id);
+}
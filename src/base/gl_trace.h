@@ -0,0 +1,1097 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <base/gl_ext.h>
+
+// GL call interception. install() swaps the glad function pointers of the entry points used in this tree for
+// wrappers that count every call and the CPU time it took, flag state changes that set what is already set, and,
+// while recording, append the call to a compact binary trace. Player replays a trace against any context (see
+// tools/glreplay), which measures the API overhead of a frame deterministically and without the application.
+namespace gltrace {
+
+// the state a state setting call is relative to besides its key arguments
+enum Context { NONE, PROGRAM, UNIT, VAO };
+
+// X(name, arguments, state, context, result) for every intercepted entry point.
+//
+// arguments has one character per parameter:
+//   v value, x pointer kept as a raw value (buffer offsets), l uniform location of the program used
+//   b t a f r P s q y  buffer, texture, vertex array, framebuffer, renderbuffer, program, shader, query and sync names
+//   B T A F R Q  arrays of as many names as argument 0, written by glGen* and read by glDelete*
+//   d input data sized by the call, an offset while a pixel unpack buffer is bound for texture uploads
+//   c input string, S the strings of glShaderSource, z pointer replayed as null
+//   o output written by GL, O pixels written by GL, an offset while a pixel pack buffer is bound
+// state is -1 for calls that don't set state, otherwise the number of leading arguments selecting the state the
+// remaining arguments set. result is v when the return value doesn't matter for replay, else its argument kind.
+#define GLTRACE_FUNCTIONS(X)                                                                                          \
+  X(Enable, "v", 1, NONE, 'v')                                                                                         \
+  X(Disable, "v", 1, NONE, 'v')                                                                                        \
+  X(IsEnabled, "v", -1, NONE, 'v')                                                                                     \
+  X(GetIntegerv, "vo", -1, NONE, 'v')                                                                                  \
+  X(GetStringi, "vv", -1, NONE, 'v')                                                                                   \
+  X(Viewport, "vvvv", 0, NONE, 'v')                                                                                    \
+  X(ClearColor, "vvvv", 0, NONE, 'v')                                                                                  \
+  X(ClearDepth, "v", 0, NONE, 'v')                                                                                     \
+  X(ClearStencil, "v", 0, NONE, 'v')                                                                                   \
+  X(Clear, "v", -1, NONE, 'v')                                                                                         \
+  X(ClearBufferfv, "vvd", -1, NONE, 'v')                                                                               \
+  X(ClearBufferuiv, "vvd", -1, NONE, 'v')                                                                              \
+  X(DepthFunc, "v", 0, NONE, 'v')                                                                                      \
+  X(DepthMask, "v", 0, NONE, 'v')                                                                                      \
+  X(ColorMask, "vvvv", 0, NONE, 'v')                                                                                   \
+  X(StencilFunc, "vvv", 0, NONE, 'v')                                                                                  \
+  X(StencilOp, "vvv", 0, NONE, 'v')                                                                                    \
+  X(StencilMask, "v", 0, NONE, 'v')                                                                                    \
+  X(CullFace, "v", 0, NONE, 'v')                                                                                       \
+  X(BlendFunc, "vv", 0, NONE, 'v')                                                                                     \
+  X(BlendFunci, "vvv", 1, NONE, 'v')                                                                                   \
+  X(PolygonOffset, "vv", 0, NONE, 'v')                                                                                 \
+  X(ClipControl, "vv", 0, NONE, 'v')                                                                                   \
+  X(PixelStorei, "vv", 1, NONE, 'v')                                                                                   \
+  X(Finish, "", -1, NONE, 'v')                                                                                         \
+  X(GenBuffers, "vB", -1, NONE, 'v')                                                                                   \
+  X(DeleteBuffers, "vB", -1, NONE, 'v')                                                                                \
+  X(BindBuffer, "vb", 1, VAO, 'v')                                                                                     \
+  X(BindBufferBase, "vvb", 2, NONE, 'v')                                                                               \
+  X(BufferData, "vvdv", -1, NONE, 'v')                                                                                 \
+  X(BufferSubData, "vvvd", -1, NONE, 'v')                                                                              \
+  X(MapBufferRange, "vvvv", -1, NONE, 'v')                                                                             \
+  X(UnmapBuffer, "v", -1, NONE, 'v')                                                                                   \
+  X(GenVertexArrays, "vA", -1, NONE, 'v')                                                                              \
+  X(DeleteVertexArrays, "vA", -1, NONE, 'v')                                                                           \
+  X(BindVertexArray, "a", 0, NONE, 'v')                                                                                \
+  X(EnableVertexAttribArray, "v", -1, NONE, 'v')                                                                       \
+  X(DisableVertexAttribArray, "v", -1, NONE, 'v')                                                                      \
+  X(VertexAttribPointer, "vvvvvx", -1, NONE, 'v')                                                                      \
+  X(VertexAttribIPointer, "vvvvx", -1, NONE, 'v')                                                                      \
+  X(VertexAttribDivisor, "vv", -1, NONE, 'v')                                                                          \
+  X(GenTextures, "vT", -1, NONE, 'v')                                                                                  \
+  X(DeleteTextures, "vT", -1, NONE, 'v')                                                                               \
+  X(ActiveTexture, "v", 0, NONE, 'v')                                                                                  \
+  X(BindTexture, "vt", 1, UNIT, 'v')                                                                                   \
+  X(TexParameteri, "vvv", -1, NONE, 'v')                                                                               \
+  X(TexImage2D, "vvvvvvvvd", -1, NONE, 'v')                                                                            \
+  X(TexImage3D, "vvvvvvvvvd", -1, NONE, 'v')                                                                           \
+  X(TexSubImage2D, "vvvvvvvvd", -1, NONE, 'v')                                                                         \
+  X(TexSubImage3D, "vvvvvvvvvvd", -1, NONE, 'v')                                                                       \
+  X(CompressedTexImage2D, "vvvvvvvd", -1, NONE, 'v')                                                                   \
+  X(GenerateMipmap, "v", -1, NONE, 'v')                                                                                \
+  X(TexBuffer, "vvb", -1, NONE, 'v')                                                                                   \
+  X(GetTexImage, "vvvvO", -1, NONE, 'v')                                                                               \
+  X(ReadPixels, "vvvvvvO", -1, NONE, 'v')                                                                              \
+  X(GenFramebuffers, "vF", -1, NONE, 'v')                                                                              \
+  X(DeleteFramebuffers, "vF", -1, NONE, 'v')                                                                           \
+  X(GenRenderbuffers, "vR", -1, NONE, 'v')                                                                             \
+  X(DeleteRenderbuffers, "vR", -1, NONE, 'v')                                                                          \
+  X(BindFramebuffer, "vf", 1, NONE, 'v')                                                                               \
+  X(FramebufferTexture, "vvtv", -1, NONE, 'v')                                                                         \
+  X(FramebufferTexture2D, "vvvtv", -1, NONE, 'v')                                                                      \
+  X(FramebufferTextureLayer, "vvtvv", -1, NONE, 'v')                                                                   \
+  X(CheckFramebufferStatus, "v", -1, NONE, 'v')                                                                        \
+  X(DrawBuffer, "v", -1, NONE, 'v')                                                                                    \
+  X(DrawBuffers, "vd", -1, NONE, 'v')                                                                                  \
+  X(ReadBuffer, "v", -1, NONE, 'v')                                                                                    \
+  X(BlitFramebuffer, "vvvvvvvvvv", -1, NONE, 'v')                                                                      \
+  X(CreateShader, "v", -1, NONE, 's')                                                                                  \
+  X(ShaderSource, "svSz", -1, NONE, 'v')                                                                               \
+  X(CompileShader, "s", -1, NONE, 'v')                                                                                 \
+  X(GetShaderiv, "svo", -1, NONE, 'v')                                                                                 \
+  X(GetShaderInfoLog, "svoo", -1, NONE, 'v')                                                                           \
+  X(DeleteShader, "s", -1, NONE, 'v')                                                                                  \
+  X(CreateProgram, "", -1, NONE, 'P')                                                                                  \
+  X(AttachShader, "Ps", -1, NONE, 'v')                                                                                 \
+  X(LinkProgram, "P", -1, NONE, 'v')                                                                                   \
+  X(GetProgramiv, "Pvo", -1, NONE, 'v')                                                                                \
+  X(GetProgramInfoLog, "Pvoo", -1, NONE, 'v')                                                                          \
+  X(DeleteProgram, "P", -1, NONE, 'v')                                                                                 \
+  X(UseProgram, "P", 0, NONE, 'v')                                                                                     \
+  X(GetUniformLocation, "Pc", -1, NONE, 'l')                                                                           \
+  X(GetUniformBlockIndex, "Pc", -1, NONE, 'v')                                                                         \
+  X(UniformBlockBinding, "Pvv", 2, NONE, 'v')                                                                          \
+  X(Uniform1i, "lv", 1, PROGRAM, 'v')                                                                                  \
+  X(Uniform1ui, "lv", 1, PROGRAM, 'v')                                                                                 \
+  X(Uniform1f, "lv", 1, PROGRAM, 'v')                                                                                  \
+  X(Uniform2i, "lvv", 1, PROGRAM, 'v')                                                                                 \
+  X(Uniform3f, "lvvv", 1, PROGRAM, 'v')                                                                                \
+  X(Uniform3fv, "lvd", 1, PROGRAM, 'v')                                                                                \
+  X(Uniform4fv, "lvd", 1, PROGRAM, 'v')                                                                                \
+  X(UniformMatrix4fv, "lvvd", 1, PROGRAM, 'v')                                                                         \
+  X(ProgramUniform1i, "Plv", 2, NONE, 'v')                                                                             \
+  X(ProgramUniform1f, "Plv", 2, NONE, 'v')                                                                             \
+  X(ProgramUniform3fv, "Plvd", 2, NONE, 'v')                                                                           \
+  X(ProgramUniform4fv, "Plvd", 2, NONE, 'v')                                                                           \
+  X(ProgramUniformMatrix4fv, "Plvvd", 2, NONE, 'v')                                                                    \
+  X(DrawArrays, "vvv", -1, NONE, 'v')                                                                                  \
+  X(DrawArraysInstanced, "vvvv", -1, NONE, 'v')                                                                        \
+  X(DrawElements, "vvvx", -1, NONE, 'v')                                                                               \
+  X(DrawElementsInstanced, "vvvxv", -1, NONE, 'v')                                                                     \
+  X(MultiDrawElements, "vdvdv", -1, NONE, 'v')                                                                         \
+  X(GenQueries, "vQ", -1, NONE, 'v')                                                                                   \
+  X(DeleteQueries, "vQ", -1, NONE, 'v')                                                                                \
+  X(BeginQuery, "vq", -1, NONE, 'v')                                                                                   \
+  X(EndQuery, "v", -1, NONE, 'v')                                                                                      \
+  X(GetQueryObjectiv, "qvo", -1, NONE, 'v')                                                                            \
+  X(GetQueryObjectui64v, "qvo", -1, NONE, 'v')                                                                         \
+  X(FenceSync, "vv", -1, NONE, 'y')                                                                                    \
+  X(ClientWaitSync, "yvv", -1, NONE, 'v')                                                                              \
+  X(DeleteSync, "y", -1, NONE, 'v')
+
+enum Id : uint16_t {
+#define GLTRACE_ID(name, ...) ID_##name,
+  GLTRACE_FUNCTIONS(GLTRACE_ID)
+#undef GLTRACE_ID
+      FUNCTION_COUNT
+};
+
+struct Function {
+  const char *name;
+  const char *args;
+  int state;
+  Context context;
+  char result;
+  int arity;
+  // bytes of every argument in the trace
+  const uint8_t *sizes;
+  // the glad pointer, the wrapper installed into it and where the driver entry point is kept meanwhile
+  void **slot;
+  void *wrapper;
+  void **original;
+  // calls through the glad pointer with arguments in their trace representation
+  uint64_t (*invoke)(const uint64_t *values);
+};
+
+struct FunctionStats {
+  const char *name;
+  uint64_t calls;
+  uint64_t redundant;
+  double cpuMs;
+};
+
+struct Stats {
+  uint64_t frames = 0;
+  uint64_t calls = 0;
+  uint64_t redundant = 0;
+  double cpuMs = 0.0;
+  // the functions called, most expensive first
+  std::vector<FunctionStats> functions;
+};
+
+// swaps the intercepted glad pointers for the wrappers, call after gladLoadGL
+void install();
+void uninstall();
+bool installed();
+
+// a replayable trace has to start before the resources it uses are created, ideally right after install()
+bool startRecording(const char *path);
+void stopRecording();
+bool recording();
+
+// ends a frame: the counters of the frame become getStats() and the trace gets a frame marker
+void frame();
+// the last frame and everything since install()
+const Stats &getStats();
+const Stats &getTotals();
+// calls, redundant calls and CPU time of a frame averaged over stats.frames, followed by the top functions
+std::string report(const Stats &stats, int top = 8);
+
+// replays a trace. names the trace refers to are remapped to the names the replay context generates, data the
+// application wrote through mapped pointers isn't part of the trace.
+class Player {
+public:
+  bool load(const char *path, std::string &error);
+
+  int width() const { return viewport[0]; }
+  int height() const { return viewport[1]; }
+  // frames are the calls between two gltrace::frame() markers, setup is everything before the first one
+  size_t frames() const { return frameEnds.size(); }
+  void replaySetup() { replay(callsBegin, setupEnd); }
+  void replayFrame(size_t frame) { replay(frame ? frameEnds[frame - 1] + 2 : setupEnd + 2, frameEnds[frame]); }
+  uint64_t replayedCalls() const { return calls; }
+
+private:
+  std::vector<uint8_t> trace;
+  // local ids of the recorded function ids
+  std::vector<int> ids;
+  int viewport[2] = {};
+  size_t callsBegin = 0, setupEnd = 0;
+  std::vector<size_t> frameEnds;
+  uint64_t calls = 0;
+
+  std::unordered_map<uint64_t, uint64_t> names[9];
+  // uniform locations by replayed program and recorded location
+  std::unordered_map<uint64_t, uint64_t> locations;
+  uint64_t program = 0;
+  std::vector<uint8_t> scratch;
+  std::vector<GLuint> array;
+  std::vector<const GLchar *> strings;
+
+  void replay(size_t begin, size_t end);
+  // first call of the frame or the marker ending it, -1 past the end
+  bool skip(size_t &offset) const;
+  uint64_t remap(char kind, uint64_t name) const;
+};
+
+namespace detail {
+
+// arrays of names are written in upper case
+inline bool isArray(char kind) { return kind && std::strchr("BTAFRQ", kind); }
+
+inline int nameType(char kind) {
+  const char *types = "btafrPsqy";
+  if (isArray(kind))
+    kind = kind - 'A' + 'a';
+  const char *t = kind ? std::strchr(types, kind) : nullptr;
+  return t ? (int)(t - types) : -1;
+}
+
+template <typename T> uint64_t bits(T value) {
+  if constexpr (std::is_pointer_v<T>) {
+    return (uint64_t)(uintptr_t)value;
+  } else if constexpr (std::is_floating_point_v<T>) {
+    if constexpr (sizeof(T) == 4) {
+      uint32_t u;
+      std::memcpy(&u, &value, 4);
+      return u;
+    } else {
+      uint64_t u;
+      std::memcpy(&u, &value, 8);
+      return u;
+    }
+  } else {
+    return (uint64_t)value;
+  }
+}
+
+template <typename T> T fromBits(uint64_t value) {
+  if constexpr (std::is_pointer_v<T>) {
+    return (T)(uintptr_t)value;
+  } else if constexpr (std::is_floating_point_v<T>) {
+    T f;
+    if constexpr (sizeof(T) == 4) {
+      uint32_t u = (uint32_t)value;
+      std::memcpy(&f, &u, 4);
+    } else {
+      std::memcpy(&f, &value, 8);
+    }
+    return f;
+  } else {
+    return (T)value;
+  }
+}
+
+struct Counter {
+  uint64_t calls = 0;
+  uint64_t redundant = 0;
+  uint64_t ns = 0;
+};
+
+struct State {
+  bool installed = false;
+  Counter frame[FUNCTION_COUNT];
+  Counter total[FUNCTION_COUNT];
+  uint64_t frames = 0;
+  Stats last, totals;
+
+  // what the redundancy check and the payload sizes depend on
+  GLuint program = 0, vao = 0, unpackBuffer = 0, packBuffer = 0;
+  GLenum unit = GL_TEXTURE0;
+  GLint unpackAlignment = 4, packAlignment = 4;
+  // value bytes of every state by the hash of its key
+  std::unordered_map<uint64_t, std::string> shadow;
+  std::string value;
+
+  FILE *file = nullptr;
+  std::vector<uint8_t> buffer;
+  uint64_t written = 0;
+};
+
+inline State &state() {
+  static State s;
+  return s;
+}
+
+template <int Id, typename Fn> struct Hook;
+
+template <int Id, typename R, typename... Args> struct Hook<Id, R(APIENTRY *)(Args...)> {
+  using Fn = R(APIENTRY *)(Args...);
+  static const int ARITY = sizeof...(Args);
+  static constexpr uint8_t sizes[sizeof...(Args) + 1] = {(uint8_t)sizeof(Args)..., 0};
+  static inline Fn original = nullptr;
+  static inline Fn *slot = nullptr;
+
+  static R APIENTRY call(Args... args);
+
+  static uint64_t invoke(const uint64_t *values) { return invoke(values, std::index_sequence_for<Args...>()); }
+
+  template <size_t... I> static uint64_t invoke(const uint64_t *values, std::index_sequence<I...>) {
+    if constexpr (std::is_void_v<R>) {
+      (*slot)(fromBits<Args>(values[I])...);
+      return 0;
+    } else {
+      return bits((*slot)(fromBits<Args>(values[I])...));
+    }
+  }
+};
+
+// the entry points gl_ext.h loads outside glad
+using glext::glad_glClipControl;
+
+template <typename Fn> struct Arity;
+template <typename R, typename... Args> struct Arity<R(APIENTRY *)(Args...)> {
+  static const int value = sizeof...(Args);
+};
+
+template <int Id, typename Fn>
+Function function(const char *name, const char *args, int state, Context context, char result, Fn *slot) {
+  using H = Hook<Id, Fn>;
+  H::slot = slot;
+  return {name,         args, state, context, result, H::ARITY, H::sizes, reinterpret_cast<void **>(slot),
+          (void *)&H::call, reinterpret_cast<void **>(&H::original), &H::invoke};
+}
+
+#define GLTRACE_CHECK(name, args, ...)                                                                                 \
+  static_assert(sizeof(args) - 1 == Arity<decltype(glad_gl##name)>::value, "gl" #name " argument kinds");
+GLTRACE_FUNCTIONS(GLTRACE_CHECK)
+#undef GLTRACE_CHECK
+
+inline const Function *functions() {
+#define GLTRACE_FUNCTION(name, args, state, context, result)                                                           \
+  function<ID_##name>("gl" #name, args, state, context, result, &glad_gl##name),
+  static const Function table[] = {GLTRACE_FUNCTIONS(GLTRACE_FUNCTION)};
+#undef GLTRACE_FUNCTION
+  return table;
+}
+
+inline uint64_t hash(uint64_t h, uint64_t value) {
+  // FNV-1a over the 8 bytes
+  for (int i = 0; i < 8; ++i) {
+    h ^= (value >> (i * 8)) & 0xff;
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+inline size_t imageBytes(uint64_t width, uint64_t height, uint64_t depth, GLenum format, GLenum type, GLint alignment) {
+  size_t components = 4;
+  switch (format) {
+  case GL_RED:
+  case GL_RED_INTEGER:
+  case GL_DEPTH_COMPONENT:
+  case GL_STENCIL_INDEX:
+  case GL_DEPTH_STENCIL:
+    components = 1;
+    break;
+  case GL_RG:
+  case GL_RG_INTEGER:
+    components = 2;
+    break;
+  case GL_RGB:
+  case GL_BGR:
+  case GL_RGB_INTEGER:
+    components = 3;
+    break;
+  }
+  size_t pixel;
+  switch (type) {
+  case GL_UNSIGNED_BYTE:
+  case GL_BYTE:
+    pixel = components;
+    break;
+  case GL_UNSIGNED_SHORT:
+  case GL_SHORT:
+  case GL_HALF_FLOAT:
+    pixel = components * 2;
+    break;
+  case GL_UNSIGNED_SHORT_5_6_5:
+  case GL_UNSIGNED_SHORT_4_4_4_4:
+  case GL_UNSIGNED_SHORT_5_5_5_1:
+    pixel = 2;
+    break;
+  case GL_UNSIGNED_INT_24_8:
+  case GL_UNSIGNED_INT_10F_11F_11F_REV:
+  case GL_UNSIGNED_INT_5_9_9_9_REV:
+  case GL_UNSIGNED_INT_2_10_10_10_REV:
+  case GL_UNSIGNED_INT_8_8_8_8:
+  case GL_UNSIGNED_INT_8_8_8_8_REV:
+    pixel = 4;
+    break;
+  case GL_FLOAT_32_UNSIGNED_INT_24_8_REV:
+    pixel = 8;
+    break;
+  default:
+    pixel = components * 4;
+  }
+  size_t row = (width * pixel + alignment - 1) / alignment * alignment;
+  return row * height * depth;
+}
+
+// bytes behind the 'd' argument arg, SIZE_MAX when it is an offset into the bound unpack buffer
+inline size_t dataBytes(int id, int arg, const uint64_t *v, const State &s) {
+  bool unpack = s.unpackBuffer != 0;
+  switch (id) {
+  case ID_ClearBufferfv:
+    return v[0] == GL_COLOR ? 16 : 4;
+  case ID_ClearBufferuiv:
+    return 16;
+  case ID_BufferData:
+    return v[1];
+  case ID_BufferSubData:
+    return v[2];
+  case ID_TexImage2D:
+    return unpack ? SIZE_MAX : imageBytes(v[3], v[4], 1, (GLenum)v[6], (GLenum)v[7], s.unpackAlignment);
+  case ID_TexImage3D:
+    return unpack ? SIZE_MAX : imageBytes(v[3], v[4], v[5], (GLenum)v[7], (GLenum)v[8], s.unpackAlignment);
+  case ID_TexSubImage2D:
+    return unpack ? SIZE_MAX : imageBytes(v[4], v[5], 1, (GLenum)v[6], (GLenum)v[7], s.unpackAlignment);
+  case ID_TexSubImage3D:
+    return unpack ? SIZE_MAX : imageBytes(v[5], v[6], v[7], (GLenum)v[8], (GLenum)v[9], s.unpackAlignment);
+  case ID_CompressedTexImage2D:
+    return unpack ? SIZE_MAX : (uint32_t)v[6];
+  case ID_DrawBuffers:
+    return (uint32_t)v[0] * sizeof(GLenum);
+  case ID_Uniform3fv:
+    return (uint32_t)v[1] * 12;
+  case ID_Uniform4fv:
+    return (uint32_t)v[1] * 16;
+  case ID_UniformMatrix4fv:
+    return (uint32_t)v[1] * 64;
+  case ID_ProgramUniform3fv:
+    return (uint32_t)v[2] * 12;
+  case ID_ProgramUniform4fv:
+    return (uint32_t)v[2] * 16;
+  case ID_ProgramUniformMatrix4fv:
+    return (uint32_t)v[2] * 64;
+  case ID_MultiDrawElements:
+    // drawcount counts and as many offsets into the element buffer
+    return (uint32_t)v[4] * (arg == 1 ? sizeof(GLsizei) : sizeof(const void *));
+  }
+  return 0;
+}
+
+// bytes written to an 'O' argument, 0 when it is an offset into the bound pack buffer
+inline size_t pixelBytes(int id, const uint64_t *v, const State &s) {
+  if (s.packBuffer) {
+    return 0;
+  }
+  if (id == ID_ReadPixels) {
+    return imageBytes(v[2], v[3], 1, (GLenum)v[4], (GLenum)v[5], s.packAlignment);
+  }
+  // glGetTexImage writes the whole level, which only GL knows the size of
+  GLint width = 0, height = 0, depth = 0;
+  auto getLevel = (PFNGLGETTEXLEVELPARAMETERIVPROC)glad_glGetTexLevelParameteriv;
+  getLevel((GLenum)v[0], (GLint)v[1], GL_TEXTURE_WIDTH, &width);
+  getLevel((GLenum)v[0], (GLint)v[1], GL_TEXTURE_HEIGHT, &height);
+  getLevel((GLenum)v[0], (GLint)v[1], GL_TEXTURE_DEPTH, &depth);
+  return imageBytes(width, height, std::max(depth, 1), (GLenum)v[2], (GLenum)v[3], s.packAlignment);
+}
+
+inline uint64_t stateKey(int id, uint64_t context, const uint64_t *v, int keys) {
+  uint64_t h = hash(hash(14695981039346656037ull, id), context);
+  for (int i = 0; i < keys; ++i) {
+    h = hash(h, v[i]);
+  }
+  return h;
+}
+
+// true when the call sets state to the value it already has
+inline bool redundant(int id, const Function &f, const uint64_t *v, State &s) {
+  // enable and disable set the same state
+  int group = id == ID_Disable ? ID_Enable : id;
+  uint64_t context = 0;
+  switch (f.context) {
+  case PROGRAM:
+    context = s.program;
+    break;
+  case UNIT:
+    context = s.unit;
+    break;
+  case VAO:
+    // only the element array binding belongs to the vertex array
+    context = v[0] == GL_ELEMENT_ARRAY_BUFFER ? s.vao + 1ull : 0;
+    break;
+  default:
+    break;
+  }
+  uint64_t key = stateKey(group, context, v, f.state);
+
+  s.value.clear();
+  if (group == ID_Enable) {
+    s.value.push_back(id == ID_Enable);
+  }
+  for (int i = f.state; i < f.arity; ++i) {
+    if (f.args[i] == 'd') {
+      s.value.append((const char *)(uintptr_t)v[i], dataBytes(id, i, v, s));
+    } else {
+      s.value.append((const char *)&v[i], f.sizes[i]);
+    }
+  }
+
+  // binding GL_FRAMEBUFFER binds both the draw and the read framebuffer and the other way round
+  if (id == ID_BindFramebuffer) {
+    for (GLenum target : {GL_FRAMEBUFFER, GL_DRAW_FRAMEBUFFER, GL_READ_FRAMEBUFFER}) {
+      if (target != v[0]) {
+        uint64_t other = target;
+        s.shadow.erase(stateKey(id, 0, &other, 1));
+      }
+    }
+  } else if (id == ID_BindBufferBase) {
+    s.shadow.erase(stateKey(ID_BindBuffer, 0, v, 1));
+  } else if (id == ID_BlendFunc) {
+    // the blend function of every draw buffer, at least 8 of them
+    for (uint64_t buffer = 0; buffer < 8; ++buffer)
+      s.shadow.erase(stateKey(ID_BlendFunci, 0, &buffer, 1));
+  } else if (id == ID_BlendFunci) {
+    s.shadow.erase(stateKey(ID_BlendFunc, 0, v, 0));
+  }
+
+  auto [it, inserted] = s.shadow.try_emplace(key);
+  bool same = !inserted && it->second == s.value;
+  if (!same) {
+    it->second.swap(s.value);
+  }
+  return same;
+}
+
+inline void track(int id, const uint64_t *v, State &s) {
+  switch (id) {
+  case ID_UseProgram:
+    s.program = (GLuint)v[0];
+    break;
+  case ID_BindVertexArray:
+    s.vao = (GLuint)v[0];
+    break;
+  case ID_ActiveTexture:
+    s.unit = (GLenum)v[0];
+    break;
+  case ID_BindBuffer:
+    if (v[0] == GL_PIXEL_UNPACK_BUFFER)
+      s.unpackBuffer = (GLuint)v[1];
+    else if (v[0] == GL_PIXEL_PACK_BUFFER)
+      s.packBuffer = (GLuint)v[1];
+    break;
+  case ID_PixelStorei:
+    if (v[0] == GL_UNPACK_ALIGNMENT)
+      s.unpackAlignment = (GLint)v[1];
+    else if (v[0] == GL_PACK_ALIGNMENT)
+      s.packAlignment = (GLint)v[1];
+    break;
+  case ID_LinkProgram:
+    // linking resets the uniforms
+    s.shadow.clear();
+    break;
+  case ID_DeleteBuffers:
+  case ID_DeleteVertexArrays:
+  case ID_DeleteTextures:
+  case ID_DeleteFramebuffers:
+  case ID_DeleteRenderbuffers:
+  case ID_DeleteProgram:
+    // deleting a bound object unbinds it
+    s.shadow.clear();
+    break;
+  }
+}
+
+inline void put(std::vector<uint8_t> &out, const void *data, size_t bytes) {
+  const uint8_t *p = (const uint8_t *)data;
+  out.insert(out.end(), p, p + bytes);
+}
+
+inline void put32(std::vector<uint8_t> &out, uint32_t value) { put(out, &value, 4); }
+
+// payloads start 4 byte aligned in the file so the player can hand them to GL in place
+inline void putPayload(State &s, const void *data, size_t bytes) {
+  put32(s.buffer, (uint32_t)bytes);
+  s.buffer.resize(s.buffer.size() + (-(s.written + s.buffer.size()) & 3));
+  put(s.buffer, data, bytes);
+}
+
+inline void flush(State &s) {
+  if (s.file && !s.buffer.empty()) {
+    fwrite(s.buffer.data(), 1, s.buffer.size(), s.file);
+    s.written += s.buffer.size();
+  }
+  s.buffer.clear();
+}
+
+inline void record(int id, const Function &f, const uint64_t *v, uint64_t result, State &s) {
+  std::vector<uint8_t> &out = s.buffer;
+  uint16_t id16 = (uint16_t)id;
+  put(out, &id16, 2);
+  // little endian, so the low bytes of every value are the value
+  for (int i = 0; i < f.arity; ++i) {
+    put(out, &v[i], f.sizes[i]);
+  }
+  for (int i = 0; i < f.arity; ++i) {
+    const void *p = (const void *)(uintptr_t)v[i];
+    switch (f.args[i]) {
+    case 'd': {
+      size_t bytes = dataBytes(id, i, v, s);
+      if (bytes == SIZE_MAX)
+        put32(out, UINT32_MAX);
+      else
+        putPayload(s, p, p ? bytes : 0);
+      break;
+    }
+    case 'c':
+      putPayload(s, p, std::strlen((const char *)p) + 1);
+      break;
+    case 'S': {
+      // glShaderSource(shader, count, strings, lengths)
+      auto sources = (const GLchar *const *)p;
+      auto lengths = (const GLint *)(uintptr_t)v[i + 1];
+      for (uint32_t j = 0; j < (uint32_t)v[1]; ++j) {
+        // replayed null terminated
+        std::string source = lengths && lengths[j] >= 0 ? std::string(sources[j], lengths[j]) : sources[j];
+        putPayload(s, source.c_str(), source.size() + 1);
+      }
+      break;
+    }
+    case 'O':
+      put32(out, (uint32_t)pixelBytes(id, v, s));
+      break;
+    default:
+      if (isArray(f.args[i])) {
+        put(out, p, (uint32_t)v[0] * sizeof(GLuint));
+      }
+    }
+  }
+  if (f.result != 'v') {
+    put(out, &result, 8);
+  }
+  if (out.size() >= (1 << 20)) {
+    flush(s);
+  }
+}
+
+inline void after(int id, const uint64_t *values, uint64_t ns, uint64_t result) {
+  State &s = state();
+  const Function &f = functions()[id];
+  Counter &c = s.frame[id];
+  ++c.calls;
+  c.ns += ns;
+  if (f.state >= 0 && redundant(id, f, values, s)) {
+    ++c.redundant;
+  }
+  if (s.file) {
+    record(id, f, values, result, s);
+  }
+  track(id, values, s);
+}
+
+template <int Id, typename R, typename... Args> R APIENTRY Hook<Id, R(APIENTRY *)(Args...)>::call(Args... args) {
+  uint64_t values[sizeof...(Args) + 1] = {bits(args)...};
+  auto start = std::chrono::steady_clock::now();
+  if constexpr (std::is_void_v<R>) {
+    original(args...);
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    after(Id, values, ns, 0);
+  } else {
+    R result = original(args...);
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    after(Id, values, ns, bits(result));
+    return result;
+  }
+}
+
+inline void summarize(const Counter *counters, uint64_t frames, Stats &stats) {
+  const Function *table = functions();
+  stats = Stats();
+  stats.frames = frames;
+  for (int i = 0; i < FUNCTION_COUNT; ++i) {
+    const Counter &c = counters[i];
+    if (!c.calls)
+      continue;
+    stats.functions.push_back({table[i].name, c.calls, c.redundant, c.ns / 1.0e6});
+    stats.calls += c.calls;
+    stats.redundant += c.redundant;
+    stats.cpuMs += c.ns / 1.0e6;
+  }
+  std::sort(stats.functions.begin(), stats.functions.end(),
+            [](const FunctionStats &a, const FunctionStats &b) { return a.cpuMs > b.cpuMs; });
+}
+
+const uint32_t MAGIC = 0x52544c47; // "GLTR"
+const uint32_t VERSION = 1;
+const uint16_t FRAME = 0xffff;
+
+} // namespace detail
+
+inline void install() {
+  detail::State &s = detail::state();
+  if (s.installed)
+    return;
+  // load the entry points outside glad before their slots are swapped
+  glext::clipControl();
+  const Function *table = detail::functions();
+  for (int i = 0; i < FUNCTION_COUNT; ++i) {
+    const Function &f = table[i];
+    // entry points the driver doesn't have stay null
+    if (*f.slot) {
+      *f.original = *f.slot;
+      *f.slot = f.wrapper;
+    }
+  }
+  s.installed = true;
+}
+
+inline void uninstall() {
+  detail::State &s = detail::state();
+  if (!s.installed)
+    return;
+  stopRecording();
+  const Function *table = detail::functions();
+  for (int i = 0; i < FUNCTION_COUNT; ++i) {
+    const Function &f = table[i];
+    if (*f.original) {
+      *f.slot = *f.original;
+      *f.original = nullptr;
+    }
+  }
+  s.installed = false;
+}
+
+inline bool installed() { return detail::state().installed; }
+
+inline bool startRecording(const char *path) {
+  detail::State &s = detail::state();
+  if (!s.installed || s.file)
+    return false;
+  if (s.file = fopen(path, "wb"); !s.file) {
+    return false;
+  }
+  // the header lists the functions by name so a replayer built from another table still finds them
+  s.written = 0;
+  std::vector<uint8_t> &out = s.buffer;
+  detail::put32(out, detail::MAGIC);
+  detail::put32(out, detail::VERSION);
+  GLint viewport[4] = {};
+  auto getIntegerv = (PFNGLGETINTEGERVPROC) * detail::functions()[ID_GetIntegerv].original;
+  getIntegerv(GL_VIEWPORT, viewport);
+  detail::put32(out, viewport[2]);
+  detail::put32(out, viewport[3]);
+  detail::put32(out, FUNCTION_COUNT);
+  const Function *table = detail::functions();
+  for (int i = 0; i < FUNCTION_COUNT; ++i) {
+    for (const char *text : {table[i].name, table[i].args}) {
+      out.push_back((uint8_t)std::strlen(text));
+      detail::put(out, text, std::strlen(text));
+    }
+  }
+  return true;
+}
+
+inline void stopRecording() {
+  detail::State &s = detail::state();
+  if (!s.file)
+    return;
+  detail::flush(s);
+  fclose(s.file);
+  s.file = nullptr;
+}
+
+inline bool recording() { return detail::state().file != nullptr; }
+
+inline void frame() {
+  detail::State &s = detail::state();
+  if (s.file) {
+    detail::put(s.buffer, &detail::FRAME, 2);
+  }
+  for (int i = 0; i < FUNCTION_COUNT; ++i) {
+    detail::Counter &c = s.frame[i], &t = s.total[i];
+    t.calls += c.calls;
+    t.redundant += c.redundant;
+    t.ns += c.ns;
+  }
+  ++s.frames;
+  detail::summarize(s.frame, 1, s.last);
+  std::fill(std::begin(s.frame), std::end(s.frame), detail::Counter());
+}
+
+inline const Stats &getStats() { return detail::state().last; }
+
+inline const Stats &getTotals() {
+  detail::State &s = detail::state();
+  detail::summarize(s.total, s.frames, s.totals);
+  return s.totals;
+}
+
+inline std::string report(const Stats &stats, int top) {
+  double frames = (double)std::max<uint64_t>(stats.frames, 1);
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(3) << "gl calls: " << stats.calls / frames
+      << ", redundant: " << stats.redundant / frames << ", cpu: " << stats.cpuMs / frames << " ms";
+  for (int i = 0; i < top && i < (int)stats.functions.size(); ++i) {
+    const FunctionStats &f = stats.functions[i];
+    out << "\n  " << std::left << std::setw(26) << f.name << std::right << std::setw(10) << f.calls / frames
+        << " calls " << std::setw(10) << f.redundant / frames << " redundant " << std::setw(8) << f.cpuMs / frames
+        << " ms";
+  }
+  return out.str();
+}
+
+inline bool Player::load(const char *path, std::string &error) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    error = std::string("can't open ") + path;
+    return false;
+  }
+  fseek(file, 0, SEEK_END);
+  trace.resize(ftell(file));
+  fseek(file, 0, SEEK_SET);
+  size_t read = fread(trace.data(), 1, trace.size(), file);
+  fclose(file);
+
+  const uint8_t *p = trace.data(), *end = p + read;
+  auto get32 = [&]() {
+    uint32_t value = 0;
+    if (p + 4 <= end)
+      std::memcpy(&value, p, 4);
+    p += 4;
+    return value;
+  };
+  if (get32() != detail::MAGIC || get32() != detail::VERSION) {
+    error = std::string(path) + " is not a trace of this version";
+    return false;
+  }
+  viewport[0] = get32();
+  viewport[1] = get32();
+  ids.assign(get32(), -1);
+  glext::clipControl();
+  const Function *table = detail::functions();
+  for (int &id : ids) {
+    std::string text[2];
+    for (std::string &t : text) {
+      size_t length = p < end ? *p++ : 0;
+      t.assign((const char *)p, std::min<size_t>(length, end - p));
+      p += length;
+    }
+    for (int i = 0; i < FUNCTION_COUNT; ++i) {
+      if (text[0] == table[i].name) {
+        if (text[1] != table[i].args) {
+          error = text[0] + " was recorded with other arguments";
+          return false;
+        }
+        id = i;
+      }
+    }
+  }
+  if (p > end) {
+    error = std::string(path) + " is truncated";
+    return false;
+  }
+
+  // index the frames
+  trace.resize(read);
+  size_t offset = callsBegin = p - trace.data();
+  frameEnds.clear();
+  setupEnd = SIZE_MAX;
+  while (skip(offset)) {
+    if (setupEnd == SIZE_MAX)
+      setupEnd = offset;
+    else
+      frameEnds.push_back(offset);
+    offset += 2;
+  }
+  if (setupEnd == SIZE_MAX) {
+    // a trace without frame markers is all setup
+    setupEnd = offset;
+  }
+  return true;
+}
+
+inline bool Player::skip(size_t &offset) const {
+  const Function *table = detail::functions();
+  while (offset + 2 <= trace.size()) {
+    uint16_t recorded;
+    std::memcpy(&recorded, &trace[offset], 2);
+    if (recorded == detail::FRAME)
+      return true;
+    if (recorded >= ids.size() || ids[recorded] < 0)
+      return false;
+    int id = ids[recorded];
+    const Function &f = table[id];
+    size_t p = offset + 2;
+    uint64_t v[16] = {};
+    for (int i = 0; i < f.arity; ++i) {
+      if (p + f.sizes[i] > trace.size())
+        return false;
+      std::memcpy(&v[i], &trace[p], f.sizes[i]);
+      p += f.sizes[i];
+    }
+    auto get32 = [&]() {
+      uint32_t value = 0;
+      if (p + 4 <= trace.size())
+        std::memcpy(&value, &trace[p], 4);
+      p += 4;
+      return value;
+    };
+    auto payload = [&]() {
+      uint32_t bytes = get32();
+      p = (p + 3) & ~(size_t)3;
+      p += bytes;
+    };
+    for (int i = 0; i < f.arity; ++i) {
+      char kind = f.args[i];
+      if (kind == 'd') {
+        if (get32() != UINT32_MAX) {
+          p -= 4;
+          payload();
+        }
+      } else if (kind == 'c') {
+        payload();
+      } else if (kind == 'S') {
+        for (uint32_t j = 0; j < (uint32_t)v[1]; ++j)
+          payload();
+      } else if (kind == 'O') {
+        p += 4;
+      } else if (detail::isArray(kind)) {
+        p += (uint32_t)v[0] * sizeof(GLuint);
+      }
+    }
+    if (f.result != 'v')
+      p += 8;
+    if (p > trace.size())
+      return false;
+    offset = p;
+  }
+  return false;
+}
+
+inline uint64_t Player::remap(char kind, uint64_t name) const {
+  const auto &map = names[detail::nameType(kind)];
+  auto it = map.find(name);
+  return it == map.end() ? name : it->second;
+}
+
+inline void Player::replay(size_t begin, size_t end) {
+  const Function *table = detail::functions();
+  if (scratch.size() < 65536)
+    scratch.resize(65536);
+  size_t offset = begin;
+  while (offset < end) {
+    uint16_t recorded;
+    std::memcpy(&recorded, &trace[offset], 2);
+    int id = ids[recorded];
+    const Function &f = table[id];
+    const uint8_t *p = &trace[offset + 2];
+    uint64_t v[16] = {};
+    for (int i = 0; i < f.arity; ++i) {
+      std::memcpy(&v[i], p, f.sizes[i]);
+      p += f.sizes[i];
+    }
+    auto get32 = [&]() {
+      uint32_t value;
+      std::memcpy(&value, p, 4);
+      p += 4;
+      return value;
+    };
+    auto payload = [&](uint32_t bytes) {
+      p = trace.data() + ((p - trace.data() + 3) & ~(size_t)3);
+      const uint8_t *data = p;
+      p += bytes;
+      return data;
+    };
+
+    // translate the arguments: names, pointers into the trace and scratch memory for outputs
+    const uint8_t *recordedNames = nullptr;
+    bool gen = false;
+    uint64_t locationProgram = program;
+    for (int i = 0; i < f.arity; ++i) {
+      char kind = f.args[i];
+      int type = detail::nameType(kind);
+      if (kind == 'l') {
+        auto it = locations.find(locationProgram << 32 | (uint32_t)v[i]);
+        if (it != locations.end())
+          v[i] = it->second;
+      } else if (kind == 'd') {
+        if (uint32_t bytes = get32(); bytes != UINT32_MAX) {
+          const uint8_t *data = payload(bytes);
+          v[i] = bytes ? (uint64_t)(uintptr_t)data : 0;
+        }
+      } else if (kind == 'c') {
+        v[i] = (uint64_t)(uintptr_t)payload(get32());
+      } else if (kind == 'S') {
+        strings.clear();
+        for (uint32_t j = 0; j < (uint32_t)v[1]; ++j) {
+          strings.push_back((const GLchar *)payload(get32()));
+        }
+        v[i] = (uint64_t)(uintptr_t)strings.data();
+      } else if (kind == 'z') {
+        v[i] = 0;
+      } else if (kind == 'o') {
+        v[i] = (uint64_t)(uintptr_t)scratch.data();
+      } else if (kind == 'O') {
+        uint32_t bytes = get32();
+        if (bytes) {
+          if (scratch.size() < bytes)
+            scratch.resize(bytes);
+          v[i] = (uint64_t)(uintptr_t)scratch.data();
+        }
+      } else if (detail::isArray(kind)) {
+        uint32_t n = (uint32_t)v[0];
+        gen = std::strncmp(f.name, "glGen", 5) == 0;
+        recordedNames = p;
+        array.resize(n);
+        for (uint32_t j = 0; j < n; ++j) {
+          GLuint name;
+          std::memcpy(&name, p + j * sizeof(GLuint), sizeof(GLuint));
+          array[j] = gen ? 0 : (GLuint)remap(kind, name);
+        }
+        p += n * sizeof(GLuint);
+        v[i] = (uint64_t)(uintptr_t)array.data();
+      } else if (type >= 0) {
+        v[i] = remap(kind, v[i]);
+        if (kind == 'P')
+          locationProgram = v[i];
+      }
+    }
+    uint64_t recordedResult = 0;
+    if (f.result != 'v') {
+      std::memcpy(&recordedResult, p, 8);
+      p += 8;
+    }
+
+    // entry points the replay context doesn't have, like glClipControl before GL 4.5, are skipped
+    uint64_t result = *f.slot ? f.invoke(v) : 0;
+    ++calls;
+
+    // learn the names the replay context handed out
+    if (recordedNames) {
+      char kind = f.args[1];
+      auto &map = names[detail::nameType(kind)];
+      for (size_t j = 0; j < array.size(); ++j) {
+        GLuint name;
+        std::memcpy(&name, recordedNames + j * sizeof(GLuint), sizeof(GLuint));
+        if (gen)
+          map[name] = array[j];
+        else
+          map.erase(name);
+      }
+    }
+    if (f.result == 'l') {
+      locations[locationProgram << 32 | (uint32_t)recordedResult] = (uint32_t)result;
+    } else if (f.result != 'v') {
+      names[detail::nameType(f.result)][recordedResult] = result;
+    }
+    if (id == ID_UseProgram) {
+      program = v[0];
+    }
+    offset = p - trace.data();
+  }
+}
+
+} // namespace gltrace
@@ -0,0 +1,485 @@
+#pragma once
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <base/bounds.h>
+#include <base/json.h>
+#include <base/mapped_file.h>
+
+// glTF 2.0 (.glb and .gltf with external buffers) without an intermediate scene.
+//
+// the file is mapped, the JSON is parsed into plain descriptions of buffer views, accessors, meshes, nodes, materials
+// and images, and the binary data is never touched on the CPU: every buffer view that vertex attributes or indices
+// read from is handed to glBufferData straight from the mapping, and each primitive gets a VAO that reads the
+// accessors in their stored format. that covers KHR_mesh_quantization for free, normalized or integer bytes and shorts
+// are just other glVertexAttribPointer types, and the dequantization transform is an ordinary node transform. bounds
+// come from the accessors' min/max, which the spec requires for positions.
+//
+// files that require extensions other than KHR_mesh_quantization, use sparse accessors or data: URIs are rejected so
+// the caller can fall back to a general importer. EXT_meshopt_compression views are read from their uncompressed
+// fallback when the file provides one.
+namespace gltf {
+
+struct BufferView {
+  int buffer = 0;
+  size_t byteOffset = 0;
+  size_t byteLength = 0;
+  // 0 means tightly packed
+  size_t byteStride = 0;
+};
+
+struct Accessor {
+  int bufferView = -1;
+  size_t byteOffset = 0;
+  GLenum componentType = GL_FLOAT;
+  bool normalized = false;
+  size_t count = 0;
+  int components = 1;
+  bool hasBounds = false;
+  glm::vec3 min = glm::vec3(0.0f);
+  glm::vec3 max = glm::vec3(0.0f);
+};
+
+struct Primitive {
+  // accessor indices, -1 when missing
+  int position = -1;
+  int normal = -1;
+  int texCoord = -1;
+  int indices = -1;
+  int material = -1;
+  GLenum mode = GL_TRIANGLES;
+};
+
+struct Mesh {
+  std::string name;
+  std::vector<Primitive> primitives;
+};
+
+struct Node {
+  std::string name;
+  glm::vec3 translation = glm::vec3(0.0f);
+  glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+  glm::vec3 scale = glm::vec3(1.0f);
+  int mesh = -1;
+  std::vector<int> children;
+};
+
+struct Image {
+  // either embedded in a buffer view or a file next to the model
+  int bufferView = -1;
+  std::string uri;
+};
+
+struct Material {
+  std::string name;
+  glm::vec4 baseColor = glm::vec4(1.0f);
+  // image index or -1
+  int baseColorImage = -1;
+};
+
+struct Document {
+  std::vector<BufferView> bufferViews;
+  std::vector<Accessor> accessors;
+  std::vector<Mesh> meshes;
+  std::vector<Node> nodes;
+  // root nodes of the default scene
+  std::vector<int> roots;
+  std::vector<Image> images;
+  std::vector<Material> materials;
+  std::string directory;
+
+  // start of a buffer view's bytes inside the mapped file
+  const uint8_t *viewData(int view) const {
+    const BufferView &v = bufferViews[view];
+    return buffers[v.buffer].first + v.byteOffset;
+  }
+
+  // mapped files and the byte range of every buffer inside them, null for buffers without data
+  std::vector<std::unique_ptr<MappedFile>> files;
+  std::vector<std::pair<const uint8_t *, size_t>> buffers;
+};
+
+namespace detail {
+
+inline size_t componentSize(GLenum type) {
+  switch (type) {
+  case GL_BYTE:
+  case GL_UNSIGNED_BYTE:
+    return 1;
+  case GL_SHORT:
+  case GL_UNSIGNED_SHORT:
+    return 2;
+  default:
+    return 4;
+  }
+}
+
+inline int componentCount(const std::string &type) {
+  if (type == "VEC2")
+    return 2;
+  if (type == "VEC3")
+    return 3;
+  if (type == "VEC4")
+    return 4;
+  if (type == "MAT2")
+    return 4;
+  if (type == "MAT3")
+    return 9;
+  if (type == "MAT4")
+    return 16;
+  return 1;
+}
+
+// what a normalized integer maps to in the shader
+inline float normalizedValue(double v, GLenum type) {
+  switch (type) {
+  case GL_BYTE:
+    return std::max((float)v / 127.0f, -1.0f);
+  case GL_UNSIGNED_BYTE:
+    return (float)v / 255.0f;
+  case GL_SHORT:
+    return std::max((float)v / 32767.0f, -1.0f);
+  case GL_UNSIGNED_SHORT:
+    return (float)v / 65535.0f;
+  default:
+    return (float)v;
+  }
+}
+
+inline bool fail(std::string *error, const std::string &message) {
+  if (error)
+    *error = message;
+  return false;
+}
+
+// does the accessor stay inside its buffer view
+inline bool accessorFits(const Document &doc, const Accessor &a) {
+  if (a.bufferView < 0 || a.bufferView >= (int)doc.bufferViews.size())
+    return false;
+  const BufferView &view = doc.bufferViews[a.bufferView];
+  if (!doc.buffers[view.buffer].first)
+    return false;
+  size_t element = componentSize(a.componentType) * a.components;
+  size_t stride = view.byteStride ? view.byteStride : element;
+  return a.count == 0 || a.byteOffset + stride * (a.count - 1) + element <= view.byteLength;
+}
+
+inline bool parseJson(const json::Value &root, Document &doc, std::string *error) {
+  if (root["asset"]["version"].asString().compare(0, 1, "2") != 0)
+    return fail(error, "not a glTF 2.0 asset");
+  for (const auto &extension : root["extensionsRequired"].array) {
+    if (extension.asString() != "KHR_mesh_quantization")
+      return fail(error, "unsupported required extension " + extension.asString());
+  }
+
+  const json::Value &buffers = root["buffers"];
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    const json::Value &buffer = buffers[i];
+    size_t length = (size_t)buffer["byteLength"].asNumber();
+    if (buffer.has("uri")) {
+      const std::string &uri = buffer["uri"].asString();
+      if (uri.compare(0, 5, "data:") == 0)
+        return fail(error, "data: URIs are not supported");
+      auto file = std::make_unique<MappedFile>(doc.directory + '/' + uri);
+      if (!file->valid() || file->size() < length)
+        return fail(error, "can't read buffer " + uri);
+      doc.buffers.emplace_back(reinterpret_cast<const uint8_t *>(file->data()), length);
+      doc.files.push_back(std::move(file));
+    } else if (i == 0 && i < doc.buffers.size()) {
+      // the GLB binary chunk, already in place
+      if (doc.buffers[0].second < length)
+        return fail(error, "binary chunk is shorter than buffer 0");
+      doc.buffers[0].second = length;
+    } else {
+      // e.g. an EXT_meshopt_compression fallback buffer that has no data
+      doc.buffers.emplace_back(nullptr, length);
+    }
+  }
+  // a GLB binary chunk nobody declared
+  doc.buffers.resize(std::max<size_t>(buffers.size(), 1));
+
+  for (const auto &v : root["bufferViews"].array) {
+    BufferView view;
+    view.buffer = v["buffer"].asInt();
+    view.byteOffset = (size_t)v["byteOffset"].asNumber();
+    view.byteLength = (size_t)v["byteLength"].asNumber();
+    view.byteStride = (size_t)v["byteStride"].asNumber();
+    if (view.buffer < 0 || view.buffer >= (int)doc.buffers.size() ||
+        (doc.buffers[view.buffer].first && view.byteOffset + view.byteLength > doc.buffers[view.buffer].second))
+      return fail(error, "buffer view out of range");
+    doc.bufferViews.push_back(view);
+  }
+
+  for (const auto &a : root["accessors"].array) {
+    if (a.has("sparse"))
+      return fail(error, "sparse accessors are not supported");
+    Accessor accessor;
+    accessor.bufferView = a["bufferView"].asInt(-1);
+    accessor.byteOffset = (size_t)a["byteOffset"].asNumber();
+    accessor.componentType = (GLenum)a["componentType"].asInt(GL_FLOAT);
+    accessor.normalized = a["normalized"].asBool();
+    accessor.count = (size_t)a["count"].asNumber();
+    accessor.components = componentCount(a["type"].asString());
+    if (a["min"].size() >= 3 && a["max"].size() >= 3) {
+      accessor.hasBounds = true;
+      for (int k = 0; k < 3; ++k) {
+        double lo = a["min"][k].asNumber(), hi = a["max"][k].asNumber();
+        accessor.min[k] = accessor.normalized ? normalizedValue(lo, accessor.componentType) : (float)lo;
+        accessor.max[k] = accessor.normalized ? normalizedValue(hi, accessor.componentType) : (float)hi;
+      }
+    }
+    doc.accessors.push_back(accessor);
+  }
+
+  for (const auto &m : root["meshes"].array) {
+    Mesh mesh;
+    mesh.name = m["name"].asString();
+    for (const auto &p : m["primitives"].array) {
+      Primitive primitive;
+      const json::Value &attributes = p["attributes"];
+      primitive.position = attributes["POSITION"].asInt(-1);
+      primitive.normal = attributes["NORMAL"].asInt(-1);
+      primitive.texCoord = attributes["TEXCOORD_0"].asInt(-1);
+      primitive.indices = p["indices"].asInt(-1);
+      primitive.material = p["material"].asInt(-1);
+      primitive.mode = (GLenum)p["mode"].asInt(GL_TRIANGLES);
+      for (int accessor : {primitive.position, primitive.normal, primitive.texCoord, primitive.indices}) {
+        if (accessor >= (int)doc.accessors.size() ||
+            (accessor >= 0 && !accessorFits(doc, doc.accessors[accessor])))
+          return fail(error, "accessor out of range in mesh " + mesh.name);
+      }
+      if (primitive.position < 0)
+        return fail(error, "primitive without positions in mesh " + mesh.name);
+      mesh.primitives.push_back(primitive);
+    }
+    doc.meshes.push_back(mesh);
+  }
+
+  for (const auto &n : root["nodes"].array) {
+    Node node;
+    node.name = n["name"].asString();
+    node.mesh = n["mesh"].asInt(-1);
+    for (const auto &child : n["children"].array) {
+      node.children.push_back(child.asInt());
+    }
+    if (n["matrix"].size() == 16) {
+      glm::mat4 m;
+      for (int k = 0; k < 16; ++k) {
+        m[k / 4][k % 4] = (float)n["matrix"][k].asNumber();
+      }
+      // TRS as the spec demands for matrices, no shear
+      node.translation = glm::vec3(m[3]);
+      glm::vec3 axes[3];
+      int collapsed = 0;
+      for (int k = 0; k < 3; ++k) {
+        node.scale[k] = glm::length(glm::vec3(m[k]));
+        axes[k] = node.scale[k] > 0.0f ? glm::vec3(m[k]) / node.scale[k] : glm::vec3(0.0f);
+        collapsed += node.scale[k] > 0.0f ? 0 : 1;
+      }
+      // a rotation can't mirror, a negative determinant goes into the x scale
+      if (glm::determinant(glm::mat3(m)) < 0.0f) {
+        node.scale.x = -node.scale.x;
+        axes[0] = -axes[0];
+      }
+      // a zero scale leaves its axis without a direction, which would make the rotation NaN. one such axis is
+      // completed from the other two, with more than one the rotation stays identity
+      for (int k = 0; k < 3 && collapsed == 1; ++k) {
+        if (node.scale[k] == 0.0f)
+          axes[k] = glm::cross(axes[(k + 1) % 3], axes[(k + 2) % 3]);
+      }
+      if (collapsed <= 1)
+        node.rotation = glm::quat_cast(glm::mat3(axes[0], axes[1], axes[2]));
+    } else {
+      for (int k = 0; k < 3; ++k) {
+        node.translation[k] = (float)n["translation"][k].asNumber(0.0);
+        node.scale[k] = (float)n["scale"][k].asNumber(1.0);
+      }
+      // glTF stores x, y, z, w
+      const json::Value &r = n["rotation"];
+      if (r.size() == 4)
+        node.rotation = glm::quat((float)r[3].asNumber(), (float)r[0].asNumber(), (float)r[1].asNumber(),
+                                  (float)r[2].asNumber());
+    }
+    doc.nodes.push_back(node);
+  }
+  for (const auto &node : doc.nodes) {
+    if (node.mesh >= (int)doc.meshes.size())
+      return fail(error, "node refers to a missing mesh");
+    for (int child : node.children) {
+      if (child < 0 || child >= (int)doc.nodes.size())
+        return fail(error, "node refers to a missing child");
+    }
+  }
+
+  const json::Value &scenes = root["scenes"];
+  const json::Value &scene = scenes[(size_t)root["scene"].asInt(0)];
+  for (const auto &node : scene["nodes"].array) {
+    if (node.asInt(-1) < 0 || node.asInt() >= (int)doc.nodes.size())
+      return fail(error, "scene refers to a missing node");
+    doc.roots.push_back(node.asInt());
+  }
+  // no scene: every node that isn't a child is a root
+  if (scenes.size() == 0) {
+    std::vector<char> isChild(doc.nodes.size(), 0);
+    for (const auto &node : doc.nodes) {
+      for (int child : node.children) {
+        isChild[child] = 1;
+      }
+    }
+    for (size_t i = 0; i < doc.nodes.size(); ++i) {
+      if (!isChild[i])
+        doc.roots.push_back((int)i);
+    }
+  }
+
+  const json::Value &textures = root["textures"];
+  for (const auto &i : root["images"].array) {
+    Image image;
+    image.bufferView = i["bufferView"].asInt(-1);
+    image.uri = i["uri"].asString();
+    if (image.bufferView >= (int)doc.bufferViews.size())
+      return fail(error, "image refers to a missing buffer view");
+    doc.images.push_back(image);
+  }
+  for (const auto &m : root["materials"].array) {
+    Material material;
+    material.name = m["name"].asString();
+    const json::Value &pbr = m["pbrMetallicRoughness"];
+    if (pbr["baseColorFactor"].size() == 4) {
+      for (int k = 0; k < 4; ++k) {
+        material.baseColor[k] = (float)pbr["baseColorFactor"][k].asNumber(1.0);
+      }
+    }
+    if (pbr.has("baseColorTexture")) {
+      int image = textures[(size_t)pbr["baseColorTexture"]["index"].asInt(-1)]["source"].asInt(-1);
+      if (image >= 0 && image < (int)doc.images.size())
+        material.baseColorImage = image;
+    }
+    doc.materials.push_back(material);
+  }
+  return true;
+}
+
+} // namespace detail
+
+// map and parse a .glb or .gltf file. false with a message in error if it can't be loaded
+inline bool load(const std::string &path, Document &doc, std::string *error = nullptr) {
+  size_t slash = path.find_last_of('/');
+  doc.directory = slash == std::string::npos ? "." : path.substr(0, slash);
+  auto file = std::make_unique<MappedFile>(path);
+  if (!file->valid())
+    return detail::fail(error, "can't open " + path);
+  const char *data = file->data();
+  size_t size = file->size();
+
+  const char *jsonData = data;
+  size_t jsonSize = size;
+  // GLB: 12 byte header, then chunks of length, type and data. the JSON chunk comes first, the optional binary one
+  // second
+  if (size >= 12 && std::memcmp(data, "glTF", 4) == 0) {
+    uint32_t header[3], chunk[2];
+    std::memcpy(header, data, sizeof(header));
+    if (header[1] != 2 || header[2] > size)
+      return detail::fail(error, "unsupported GLB version or truncated file");
+    size = header[2];
+    size_t offset = 12;
+    jsonSize = 0;
+    while (offset + 8 <= size) {
+      std::memcpy(chunk, data + offset, sizeof(chunk));
+      offset += 8;
+      if (offset + chunk[0] > size)
+        return detail::fail(error, "truncated GLB chunk");
+      if (chunk[1] == 0x4e4f534a) { // JSON
+        jsonData = data + offset;
+        jsonSize = chunk[0];
+      } else if (chunk[1] == 0x004e4942 && doc.buffers.empty()) { // BIN
+        doc.buffers.emplace_back(reinterpret_cast<const uint8_t *>(data + offset), chunk[0]);
+      }
+      offset += (chunk[0] + 3) & ~3u;
+    }
+    if (jsonSize == 0)
+      return detail::fail(error, "GLB without a JSON chunk");
+  }
+  doc.files.push_back(std::move(file));
+
+  json::Value root;
+  std::string jsonError;
+  if (!json::parse(jsonData, jsonSize, root, &jsonError))
+    return detail::fail(error, "invalid JSON: " + jsonError);
+  return detail::parseJson(root, doc, error);
+}
+
+// one GL buffer per buffer view that attributes or indices read from, uploaded straight from the mapped file. views
+// nothing draws from (images, animation data) get 0
+inline std::vector<GLuint> uploadBufferViews(const Document &doc) {
+  std::vector<char> used(doc.bufferViews.size(), 0);
+  for (const auto &mesh : doc.meshes) {
+    for (const auto &p : mesh.primitives) {
+      for (int accessor : {p.position, p.normal, p.texCoord, p.indices}) {
+        if (accessor >= 0)
+          used[doc.accessors[accessor].bufferView] = 1;
+      }
+    }
+  }
+  std::vector<GLuint> buffers(doc.bufferViews.size(), 0);
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    if (!used[i])
+      continue;
+    glGenBuffers(1, &buffers[i]);
+    // the target doesn't matter for the data store, the VAO decides how it is read
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[i]);
+    glBufferData(GL_ARRAY_BUFFER, doc.bufferViews[i].byteLength, doc.viewData((int)i), GL_STATIC_DRAW);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  return buffers;
+}
+
+// a VAO reading the primitive's accessors from the uploaded buffer views in their stored formats, attribute locations
+// as in Mesh: 0 position, 1 normal, 2 texcoord
+inline GLuint createVertexArray(const Document &doc, const Primitive &primitive, const std::vector<GLuint> &buffers) {
+  GLuint vao;
+  glGenVertexArrays(1, &vao);
+  glBindVertexArray(vao);
+  int attributes[] = {primitive.position, primitive.normal, primitive.texCoord};
+  for (GLuint location = 0; location < 3; ++location) {
+    if (attributes[location] < 0)
+      continue;
+    const Accessor &a = doc.accessors[attributes[location]];
+    const BufferView &view = doc.bufferViews[a.bufferView];
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[a.bufferView]);
+    glEnableVertexAttribArray(location);
+    glVertexAttribPointer(location, a.components, a.componentType, a.normalized ? GL_TRUE : GL_FALSE,
+                          (GLsizei)view.byteStride, (void *)a.byteOffset);
+  }
+  if (primitive.indices >= 0)
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[doc.accessors[primitive.indices].bufferView]);
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  return vao;
+}
+
+// object space bounds of a primitive from the accessor's min/max
+inline AABB primitiveBounds(const Document &doc, const Primitive &primitive) {
+  AABB bounds;
+  const Accessor &a = doc.accessors[primitive.position];
+  if (a.hasBounds) {
+    bounds.expand(a.min);
+    bounds.expand(a.max);
+  }
+  return bounds;
+}
+
+} // namespace gltf
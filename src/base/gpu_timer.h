@@ -0,0 +1,47 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// measures GPU time spent between begin() and end() with GL_TIME_ELAPSED queries. results are read a few frames later
+// from a small ring of queries so the CPU never waits for the GPU.
+class GpuTimer {
+public:
+  GpuTimer() { glGenQueries(COUNT, queries); }
+  ~GpuTimer() { glDeleteQueries(COUNT, queries); }
+  GpuTimer(const GpuTimer &) = delete;
+  GpuTimer &operator=(const GpuTimer &) = delete;
+
+  void begin() {
+    // collect the oldest query first, if it is still in flight skip its result rather than stall
+    if (issued[index]) {
+      GLint available = 0;
+      glGetQueryObjectiv(queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+      if (available) {
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(queries[index], GL_QUERY_RESULT, &ns);
+        lastMs = ns / 1.0e6;
+        ++results;
+      }
+    }
+    glBeginQuery(GL_TIME_ELAPSED, queries[index]);
+  }
+
+  void end() {
+    glEndQuery(GL_TIME_ELAPSED);
+    issued[index] = true;
+    index = (index + 1) % COUNT;
+  }
+
+  // GPU time of the most recently completed begin()/end() pair in milliseconds
+  double getMs() const { return lastMs; }
+  // results read so far. getMs() repeats the last one until this changes, averages should only count new ones
+  unsigned int getResults() const { return results; }
+
+private:
+  static const int COUNT = 4;
+  GLuint queries[COUNT];
+  bool issued[COUNT] = {};
+  int index = 0;
+  double lastMs = 0.0;
+  unsigned int results = 0;
+};
@@ -0,0 +1,328 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <base/bounds.h>
+#include <base/gl_resource.h>
+#include <base/shader.h>
+
+// hierarchical-Z occlusion culling.
+//
+// every frame the scene depth is reduced into a max-depth pyramid on the GPU. a coarse level of that pyramid is read
+// back asynchronously through a pixel buffer, and once it arrives (usually one or two frames later) the remaining
+// levels are rebuilt on the CPU. bounds are then projected with the view-projection matrix that produced the depth
+// and rejected when their nearest point lies behind the farthest occluder covering them. with reversed-Z the farthest
+// depth is the smallest one, the pyramid keeps minimums then and the comparisons flip.
+class HiZBuffer {
+public:
+  struct Stats {
+    unsigned int tested = 0;
+    unsigned int occluded = 0;
+  };
+
+  HiZBuffer(int width, int height);
+  ~HiZBuffer();
+  HiZBuffer(const HiZBuffer &) = delete;
+  HiZBuffer &operator=(const HiZBuffer &) = delete;
+
+  void resize(int width, int height);
+
+  // the depth is rendered with a reversed projection and [0, 1] clip depth, see depth.h. drops the current data
+  void setReversedZ(bool enabled) {
+    reversedZ = enabled;
+    hasData = false;
+  }
+
+  // reduce the given depth texture (same size as this buffer) into the pyramid and start reading it back. the
+  // view-projection matrix is the one the depth was rendered with.
+  void build(GLuint depthTexture, const glm::mat4 &viewProj);
+
+  // false if the box is completely hidden behind the depth of a previous frame
+  bool isVisible(const AABB &box);
+
+  bool ready() const { return hasData; }
+  const Stats &getStats() const { return stats; }
+  void resetStats() { stats = Stats(); }
+
+private:
+  // the largest pyramid level that is read back to the CPU
+  static const int MAX_READBACK_SIZE = 128;
+  // number of readbacks that may be in flight
+  static const int READBACK_COUNT = 3;
+
+  Shader shader;
+  GLTexture pyramid;
+  GLuint fbo = 0;
+  GLVertexArray vao;
+  int width, height;
+  int levels = 0;
+  int readLevel = 0;
+  glm::ivec2 readSize;
+
+  struct Readback {
+    GLBuffer pbo;
+    GLsync fence = nullptr;
+    glm::mat4 viewProj;
+  };
+  Readback readbacks[READBACK_COUNT];
+  int writeIndex = 0;
+
+  // pyramid levels on the CPU, level 0 is the level that was read back
+  std::vector<std::vector<float>> cpuLevels;
+  std::vector<glm::ivec2> cpuSizes;
+  glm::mat4 cpuViewProj;
+  bool hasData = false;
+  bool reversedZ = false;
+
+  Stats stats;
+
+  void allocate();
+  void release();
+  void collect();
+  void buildCpuLevels();
+};
+
+inline HiZBuffer::HiZBuffer(int width, int height)
+    : shader("shaders/fullscreen.vert", "shaders/hiz-downsample.frag"), width(width), height(height) {
+  glGenFramebuffers(1, &fbo);
+  // core profile needs a bound VAO even though the fullscreen triangle has no attributes
+  vao = GLVertexArray::create("hi-z");
+  allocate();
+}
+
+inline HiZBuffer::~HiZBuffer() {
+  release();
+  glDeleteFramebuffers(1, &fbo);
+}
+
+inline void HiZBuffer::resize(int w, int h) {
+  if (w == width && h == height)
+    return;
+  width = w;
+  height = h;
+  release();
+  allocate();
+}
+
+inline void HiZBuffer::allocate() {
+  levels = 1 + (int)std::floor(std::log2((float)std::max(width, height)));
+
+  pyramid = GLTexture::create("hi-z pyramid");
+  glBindTexture(GL_TEXTURE_2D, pyramid.get());
+  int w = width, h = height;
+  readLevel = -1;
+  for (int level = 0; level < levels; ++level) {
+    glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, w, h, 0, GL_RED, GL_FLOAT, nullptr);
+    if (readLevel < 0 && w <= MAX_READBACK_SIZE && h <= MAX_READBACK_SIZE) {
+      readLevel = level;
+      readSize = glm::ivec2(w, h);
+    }
+    w = std::max(1, w / 2);
+    h = std::max(1, h / 2);
+  }
+  pyramid.setBytes(vram::textureBytes(GL_R32F, width, height, levels));
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  for (auto &rb : readbacks) {
+    rb.pbo = GLBuffer::create("hi-z readback");
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, rb.pbo.get());
+    glBufferData(GL_PIXEL_PACK_BUFFER, readSize.x * readSize.y * sizeof(float), nullptr, GL_STREAM_READ);
+    rb.pbo.setBytes(readSize.x * readSize.y * sizeof(float));
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  hasData = false;
+}
+
+inline void HiZBuffer::release() {
+  pyramid.reset();
+  for (auto &rb : readbacks) {
+    rb.pbo.reset();
+    if (rb.fence) {
+      glDeleteSync(rb.fence);
+      rb.fence = nullptr;
+    }
+  }
+}
+
+inline void HiZBuffer::build(GLuint depthTexture, const glm::mat4 &viewProj) {
+  collect();
+
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+  glDisable(GL_DEPTH_TEST);
+
+  shader.use();
+  shader.setInt("srcDepth", 0);
+  shader.setBool("reversedZ", reversedZ);
+  glActiveTexture(GL_TEXTURE0);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glBindVertexArray(vao.get());
+
+  // level 0: copy the scene depth
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pyramid.get(), 0);
+  glViewport(0, 0, width, height);
+  glBindTexture(GL_TEXTURE_2D, depthTexture);
+  shader.setBool("copyDepth", true);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+
+  // remaining levels: reduce the previous one. clamping the base/max level keeps the level being written out of the
+  // sampled range so there is no feedback loop
+  shader.setBool("copyDepth", false);
+  glBindTexture(GL_TEXTURE_2D, pyramid.get());
+  int w = width, h = height;
+  for (int level = 1; level <= readLevel; ++level) {
+    int dw = std::max(1, w / 2), dh = std::max(1, h / 2);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pyramid.get(), level);
+    glViewport(0, 0, dw, dh);
+    glUniform2i(glGetUniformLocation(shader.get_id(), "srcSize"), w, h);
+    glUniform2i(glGetUniformLocation(shader.get_id(), "dstSize"), dw, dh);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    w = dw;
+    h = dh;
+  }
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+  // start the readback of the coarse level, the fence tells us when the copy has landed in the buffer
+  Readback &rb = readbacks[writeIndex];
+  if (rb.fence) {
+    // the ring wrapped around before this readback completed, drop it
+    glDeleteSync(rb.fence);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, rb.pbo.get());
+  glGetTexImage(GL_TEXTURE_2D, readLevel, GL_RED, GL_FLOAT, nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  rb.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  rb.viewProj = viewProj;
+  writeIndex = (writeIndex + 1) % READBACK_COUNT;
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glBindVertexArray(0);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+  if (depthTest)
+    glEnable(GL_DEPTH_TEST);
+}
+
+// pick up the newest readback that has completed without waiting for the GPU
+inline void HiZBuffer::collect() {
+  for (int i = 1; i <= READBACK_COUNT; ++i) {
+    // walk from the newest to the oldest request
+    Readback &rb = readbacks[(writeIndex - i + READBACK_COUNT) % READBACK_COUNT];
+    if (!rb.fence)
+      continue;
+    if (GLenum r = glClientWaitSync(rb.fence, 0, 0); r != GL_ALREADY_SIGNALED && r != GL_CONDITION_SATISFIED)
+      continue;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, rb.pbo.get());
+    size_t count = readSize.x * readSize.y;
+    if (auto *data = (const float *)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, count * sizeof(float), GL_MAP_READ_BIT)) {
+      cpuLevels.resize(1);
+      cpuLevels[0].assign(data, data + count);
+      glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+      cpuViewProj = rb.viewProj;
+      buildCpuLevels();
+      hasData = true;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    // this and every older readback are now stale
+    for (int j = i; j <= READBACK_COUNT; ++j) {
+      Readback &old = readbacks[(writeIndex - j + READBACK_COUNT) % READBACK_COUNT];
+      if (old.fence) {
+        glDeleteSync(old.fence);
+        old.fence = nullptr;
+      }
+    }
+    break;
+  }
+}
+
+inline void HiZBuffer::buildCpuLevels() {
+  cpuSizes.resize(1);
+  cpuSizes[0] = readSize;
+  while (cpuSizes.back().x > 1 || cpuSizes.back().y > 1) {
+    glm::ivec2 src = cpuSizes.back();
+    glm::ivec2 dst(std::max(1, src.x / 2), std::max(1, src.y / 2));
+    const std::vector<float> &s = cpuLevels.back();
+    std::vector<float> d(dst.x * dst.y);
+    for (int y = 0; y < dst.y; ++y) {
+      int y1 = (y == dst.y - 1) ? src.y - 1 : std::min(2 * y + 1, src.y - 1);
+      for (int x = 0; x < dst.x; ++x) {
+        int x1 = (x == dst.x - 1) ? src.x - 1 : std::min(2 * x + 1, src.x - 1);
+        float m = reversedZ ? 1.0f : 0.0f;
+        for (int sy = 2 * y; sy <= y1; ++sy) {
+          for (int sx = 2 * x; sx <= x1; ++sx) {
+            m = reversedZ ? std::min(m, s[sy * src.x + sx]) : std::max(m, s[sy * src.x + sx]);
+          }
+        }
+        d[y * dst.x + x] = m;
+      }
+    }
+    cpuLevels.push_back(std::move(d));
+    cpuSizes.push_back(dst);
+  }
+}
+
+inline bool HiZBuffer::isVisible(const AABB &box) {
+  ++stats.tested;
+  if (!hasData)
+    return true;
+
+  // project the corners into the window space of the frame the depth came from
+  glm::vec2 lo(1.0f), hi(0.0f);
+  float nearest = reversedZ ? 0.0f : 1.0f;
+  for (int i = 0; i < 8; ++i) {
+    glm::vec3 corner((i & 1) ? box.max.x : box.min.x, (i & 2) ? box.max.y : box.min.y,
+                     (i & 4) ? box.max.z : box.min.z);
+    glm::vec4 clip = cpuViewProj * glm::vec4(corner, 1.0f);
+    // the box crosses the near plane, it can't be hidden behind anything
+    if (clip.w <= 1e-5f)
+      return true;
+    glm::vec3 ndc = glm::vec3(clip) / clip.w;
+    glm::vec2 uv = glm::vec2(ndc.x, ndc.y) * 0.5f + 0.5f;
+    lo = glm::min(lo, uv);
+    hi = glm::max(hi, uv);
+    nearest = reversedZ ? std::max(nearest, ndc.z) : std::min(nearest, ndc.z * 0.5f + 0.5f);
+  }
+  // off screen boxes are left to frustum culling
+  if (hi.x < 0.0f || hi.y < 0.0f || lo.x > 1.0f || lo.y > 1.0f)
+    return true;
+  lo = glm::clamp(lo, 0.0f, 1.0f);
+  hi = glm::clamp(hi, 0.0f, 1.0f);
+
+  // choose the level on which the footprint covers at most 2x2 texels
+  glm::vec2 texels = (hi - lo) * glm::vec2(cpuSizes[0]);
+  float extent = std::max(1.0f, std::max(texels.x, texels.y));
+  int level = std::min((int)std::ceil(std::log2(extent)), (int)cpuLevels.size() - 1);
+
+  const glm::ivec2 size = cpuSizes[level];
+  const std::vector<float> &depth = cpuLevels[level];
+  int x0 = std::min((int)(lo.x * size.x), size.x - 1), x1 = std::min((int)(hi.x * size.x), size.x - 1);
+  int y0 = std::min((int)(lo.y * size.y), size.y - 1), y1 = std::min((int)(hi.y * size.y), size.y - 1);
+  float farthest = reversedZ ? 1.0f : 0.0f;
+  for (int y = y0; y <= y1; ++y) {
+    for (int x = x0; x <= x1; ++x) {
+      farthest = reversedZ ? std::min(farthest, depth[y * size.x + x]) : std::max(farthest, depth[y * size.x + x]);
+    }
+  }
+
+  if (reversedZ ? nearest < farthest : nearest > farthest) {
+    ++stats.occluded;
+    return false;
+  }
+  return true;
+}
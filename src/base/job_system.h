@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// a small fixed-size thread pool for data parallel work: culling, command recording, transform updates...
+//
+// parallelFor splits [0, count) into chunks of at least `grain` items which the workers and the calling thread pull
+// from a shared counter until everything is done, so the call returns only once the whole range has been processed.
+// the callback receives the chunk and the index of the thread running it (0 is the caller), which is handy for
+// writing into per-thread storage without locks. workers never touch GL, the calling thread keeps the context.
+class JobSystem {
+public:
+  using RangeFn = std::function<void(size_t begin, size_t end, unsigned int thread)>;
+
+  // threads counts the calling thread, 0 picks one per hardware thread
+  explicit JobSystem(unsigned int threads = 0);
+  ~JobSystem();
+  JobSystem(const JobSystem &) = delete;
+  JobSystem &operator=(const JobSystem &) = delete;
+
+  // number of threads taking part in parallelFor, including the caller
+  unsigned int threadCount() const { return (unsigned int)workers.size() + 1; }
+
+  void parallelFor(size_t count, size_t grain, const RangeFn &fn);
+
+private:
+  void workerLoop(unsigned int thread);
+  // pull chunks of the current job until none are left
+  void runChunks(unsigned int thread);
+
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+  bool quit = false;
+
+  // the job in flight, only one parallelFor runs at a time
+  const RangeFn *job = nullptr;
+  size_t jobCount = 0;
+  size_t jobGrain = 1;
+  unsigned long generation = 0;
+  std::atomic<size_t> next{0};
+  // workers still inside the current job
+  unsigned int busy = 0;
+};
+
+inline JobSystem::JobSystem(unsigned int threads) {
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  for (unsigned int i = 1; i < threads; ++i) {
+    workers.emplace_back(&JobSystem::workerLoop, this, i);
+  }
+}
+
+inline JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    quit = true;
+  }
+  wake.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+inline void JobSystem::parallelFor(size_t count, size_t grain, const RangeFn &fn) {
+  if (count == 0)
+    return;
+  grain = std::max<size_t>(grain, 1);
+  // not worth waking anybody up
+  if (workers.empty() || count <= grain) {
+    fn(0, count, 0);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    job = &fn;
+    jobCount = count;
+    jobGrain = grain;
+    next = 0;
+    busy = (unsigned int)workers.size();
+    ++generation;
+  }
+  wake.notify_all();
+
+  runChunks(0);
+
+  // the range is exhausted but workers may still be finishing their last chunk
+  std::unique_lock<std::mutex> lock(mutex);
+  done.wait(lock, [this] { return busy == 0; });
+  job = nullptr;
+}
+
+inline void JobSystem::workerLoop(unsigned int thread) {
+  unsigned long seen = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      wake.wait(lock, [&] { return quit || generation != seen; });
+      if (quit)
+        return;
+      seen = generation;
+    }
+
+    runChunks(thread);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (--busy == 0)
+      done.notify_one();
+  }
+}
+
+inline void JobSystem::runChunks(unsigned int thread) {
+  while (true) {
+    size_t begin = next.fetch_add(jobGrain);
+    if (begin >= jobCount)
+      return;
+    (*job)(begin, std::min(begin + jobGrain, jobCount), thread);
+  }
+}
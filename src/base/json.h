@@ -0,0 +1,316 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+// a small JSON reader: parses a document into a tree of Values. enough for glTF headers and the tools' own files, not
+// meant for huge documents.
+//
+//   json::Value root;
+//   if (json::parse(text, size, root))
+//     double x = root["accessors"][0]["count"].asNumber();
+//
+// missing keys and out of range indices give a null value, so lookups can be chained without checks.
+namespace json {
+
+struct Value {
+  enum Type { NUL, BOOL, NUMBER, STRING, ARRAY, OBJECT };
+
+  Type type = NUL;
+  bool boolean = false;
+  double number = 0.0;
+  std::string string;
+  std::vector<Value> array;
+  // in document order
+  std::vector<std::pair<std::string, Value>> object;
+
+  bool isNull() const { return type == NUL; }
+  bool isNumber() const { return type == NUMBER; }
+  bool isString() const { return type == STRING; }
+  bool isArray() const { return type == ARRAY; }
+  bool isObject() const { return type == OBJECT; }
+
+  // null when there is no such key
+  const Value *find(const std::string &key) const {
+    for (const auto &member : object) {
+      if (member.first == key)
+        return &member.second;
+    }
+    return nullptr;
+  }
+  bool has(const std::string &key) const { return find(key) != nullptr; }
+  const Value &operator[](const std::string &key) const {
+    const Value *v = find(key);
+    return v ? *v : null();
+  }
+  const Value &operator[](size_t index) const { return index < array.size() ? array[index] : null(); }
+  size_t size() const { return type == ARRAY ? array.size() : object.size(); }
+
+  double asNumber(double fallback = 0.0) const { return type == NUMBER ? number : fallback; }
+  int asInt(int fallback = 0) const { return type == NUMBER ? (int)number : fallback; }
+  bool asBool(bool fallback = false) const { return type == BOOL ? boolean : fallback; }
+  const std::string &asString() const { return type == STRING ? string : null().string; }
+
+  static const Value &null() {
+    static const Value value;
+    return value;
+  }
+};
+
+namespace detail {
+
+class Parser {
+public:
+  Parser(const char *data, size_t size) : p(data), begin(data), end(data + size) {}
+
+  bool document(Value &out) {
+    if (!value(out, 0))
+      return false;
+    skipSpace();
+    return p == end || fail("trailing characters");
+  }
+
+  std::string error;
+
+private:
+  // deeper documents are rejected instead of overflowing the stack
+  static const int MAX_DEPTH = 256;
+
+  const char *p;
+  const char *begin;
+  const char *end;
+
+  bool fail(const char *message) {
+    if (error.empty())
+      error = std::string(message) + " at offset " + std::to_string(p - begin);
+    return false;
+  }
+
+  void skipSpace() {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+      ++p;
+    }
+  }
+
+  bool literal(const char *word) {
+    size_t n = std::strlen(word);
+    if ((size_t)(end - p) < n || std::memcmp(p, word, n) != 0)
+      return fail("invalid literal");
+    p += n;
+    return true;
+  }
+
+  bool value(Value &out, int depth) {
+    if (depth > MAX_DEPTH)
+      return fail("nested too deeply");
+    skipSpace();
+    if (p >= end)
+      return fail("unexpected end");
+    switch (*p) {
+    case '{':
+      return object(out, depth);
+    case '[':
+      return array(out, depth);
+    case '"':
+      out.type = Value::STRING;
+      return string(out.string);
+    case 't':
+      out.type = Value::BOOL;
+      out.boolean = true;
+      return literal("true");
+    case 'f':
+      out.type = Value::BOOL;
+      out.boolean = false;
+      return literal("false");
+    case 'n':
+      out.type = Value::NUL;
+      return literal("null");
+    default:
+      return number(out);
+    }
+  }
+
+  bool object(Value &out, int depth) {
+    out.type = Value::OBJECT;
+    ++p;
+    skipSpace();
+    if (p < end && *p == '}') {
+      ++p;
+      return true;
+    }
+    while (true) {
+      skipSpace();
+      std::pair<std::string, Value> member;
+      if (p >= end || *p != '"')
+        return fail("expected a key");
+      if (!string(member.first))
+        return false;
+      skipSpace();
+      if (p >= end || *p != ':')
+        return fail("expected ':'");
+      ++p;
+      if (!value(member.second, depth + 1))
+        return false;
+      out.object.push_back(std::move(member));
+      skipSpace();
+      if (p < end && *p == ',') {
+        ++p;
+      } else if (p < end && *p == '}') {
+        ++p;
+        return true;
+      } else {
+        return fail("expected ',' or '}'");
+      }
+    }
+  }
+
+  bool array(Value &out, int depth) {
+    out.type = Value::ARRAY;
+    ++p;
+    skipSpace();
+    if (p < end && *p == ']') {
+      ++p;
+      return true;
+    }
+    while (true) {
+      out.array.emplace_back();
+      if (!value(out.array.back(), depth + 1))
+        return false;
+      skipSpace();
+      if (p < end && *p == ',') {
+        ++p;
+      } else if (p < end && *p == ']') {
+        ++p;
+        return true;
+      } else {
+        return fail("expected ',' or ']'");
+      }
+    }
+  }
+
+  bool number(Value &out) {
+    // the text isn't null terminated, copy the token for strtod
+    const char *start = p;
+    while (p < end && (std::strchr("+-.eE", *p) || (*p >= '0' && *p <= '9'))) {
+      ++p;
+    }
+    std::string token(start, p);
+    char *stop = nullptr;
+    out.type = Value::NUMBER;
+    out.number = std::strtod(token.c_str(), &stop);
+    if (token.empty() || stop != token.c_str() + token.size()) {
+      p = start;
+      return fail("invalid number");
+    }
+    return true;
+  }
+
+  static void appendUtf8(std::string &s, uint32_t c) {
+    if (c < 0x80) {
+      s += (char)c;
+    } else if (c < 0x800) {
+      s += (char)(0xc0 | c >> 6);
+      s += (char)(0x80 | (c & 0x3f));
+    } else if (c < 0x10000) {
+      s += (char)(0xe0 | c >> 12);
+      s += (char)(0x80 | (c >> 6 & 0x3f));
+      s += (char)(0x80 | (c & 0x3f));
+    } else {
+      s += (char)(0xf0 | c >> 18);
+      s += (char)(0x80 | (c >> 12 & 0x3f));
+      s += (char)(0x80 | (c >> 6 & 0x3f));
+      s += (char)(0x80 | (c & 0x3f));
+    }
+  }
+
+  bool hex4(uint32_t &c) {
+    if (end - p < 4)
+      return fail("truncated escape");
+    c = 0;
+    for (int i = 0; i < 4; ++i, ++p) {
+      char h = *p;
+      c <<= 4;
+      if (h >= '0' && h <= '9')
+        c |= h - '0';
+      else if (h >= 'a' && h <= 'f')
+        c |= h - 'a' + 10;
+      else if (h >= 'A' && h <= 'F')
+        c |= h - 'A' + 10;
+      else
+        return fail("invalid escape");
+    }
+    return true;
+  }
+
+  bool string(std::string &out) {
+    ++p;
+    while (p < end && *p != '"') {
+      const char *run = p;
+      while (p < end && *p != '"' && *p != '\\') {
+        ++p;
+      }
+      out.append(run, p);
+      if (p < end && *p == '\\') {
+        if (++p >= end)
+          return fail("truncated escape");
+        char e = *p++;
+        switch (e) {
+        case 'b':
+          out += '\b';
+          break;
+        case 'f':
+          out += '\f';
+          break;
+        case 'n':
+          out += '\n';
+          break;
+        case 'r':
+          out += '\r';
+          break;
+        case 't':
+          out += '\t';
+          break;
+        case 'u': {
+          uint32_t c;
+          if (!hex4(c))
+            return false;
+          // a surrogate pair encodes one code point above the BMP
+          if (c >= 0xd800 && c < 0xdc00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+            p += 2;
+            uint32_t low;
+            if (!hex4(low))
+              return false;
+            c = 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+          }
+          appendUtf8(out, c);
+          break;
+        }
+        default:
+          out += e;
+        }
+      }
+    }
+    if (p >= end)
+      return fail("unterminated string");
+    ++p;
+    return true;
+  }
+};
+
+} // namespace detail
+
+// false on malformed input, error receives a message with the byte offset
+inline bool parse(const char *data, size_t size, Value &out, std::string *error = nullptr) {
+  detail::Parser parser(data, size);
+  out = Value();
+  bool ok = parser.document(out);
+  if (!ok && error)
+    *error = parser.error;
+  return ok;
+}
+
+} // namespace json
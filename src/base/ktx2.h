@@ -0,0 +1,306 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <base/gl_ext.h>
+#include <base/gl_resource.h>
+
+// S3TC is an extension on every desktop driver but not part of core GL
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+// reading and writing of KTX 2.0 files (https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html) limited to what
+// the texture baker produces: single 2D images with a full mip chain, no supercompression, in RGBA8 or one of the BCn
+// formats.
+namespace ktx2 {
+
+// the subset of VkFormat values we use
+enum VkFormat : uint32_t {
+  R8G8B8A8_UNORM = 37,
+  R8G8B8A8_SRGB = 43,
+  BC1_RGB_UNORM_BLOCK = 131,
+  BC1_RGB_SRGB_BLOCK = 132,
+  BC3_UNORM_BLOCK = 137,
+  BC3_SRGB_BLOCK = 138,
+  BC4_UNORM_BLOCK = 139,
+  BC5_UNORM_BLOCK = 141,
+};
+
+struct Image {
+  uint32_t vkFormat = R8G8B8A8_UNORM;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  // level 0 is the full resolution image
+  std::vector<std::vector<uint8_t>> levels;
+};
+
+const uint8_t IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+inline bool isCompressed(uint32_t vkFormat) { return vkFormat != R8G8B8A8_UNORM && vkFormat != R8G8B8A8_SRGB; }
+
+inline bool isSrgb(uint32_t vkFormat) {
+  return vkFormat == R8G8B8A8_SRGB || vkFormat == BC1_RGB_SRGB_BLOCK || vkFormat == BC3_SRGB_BLOCK;
+}
+
+inline uint32_t blockBytes(uint32_t vkFormat) {
+  switch (vkFormat) {
+  case BC1_RGB_UNORM_BLOCK:
+  case BC1_RGB_SRGB_BLOCK:
+  case BC4_UNORM_BLOCK:
+    return 8;
+  case BC3_UNORM_BLOCK:
+  case BC3_SRGB_BLOCK:
+  case BC5_UNORM_BLOCK:
+    return 16;
+  default:
+    return 4;
+  }
+}
+
+// GL internal format matching a VkFormat, 0 if unsupported
+inline GLenum glInternalFormat(uint32_t vkFormat) {
+  switch (vkFormat) {
+  case R8G8B8A8_UNORM:
+    return GL_RGBA8;
+  case R8G8B8A8_SRGB:
+    return GL_SRGB8_ALPHA8;
+  case BC1_RGB_UNORM_BLOCK:
+    return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+  case BC1_RGB_SRGB_BLOCK:
+    return GL_COMPRESSED_SRGB_S3TC_DXT1_EXT;
+  case BC3_UNORM_BLOCK:
+    return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+  case BC3_SRGB_BLOCK:
+    return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+  case BC4_UNORM_BLOCK:
+    return GL_COMPRESSED_RED_RGTC1;
+  case BC5_UNORM_BLOCK:
+    return GL_COMPRESSED_RG_RGTC2;
+  default:
+    return 0;
+  }
+}
+
+namespace detail {
+
+inline void put32(std::vector<uint8_t> &out, uint32_t v) {
+  for (int i = 0; i < 4; ++i) {
+    out.push_back((v >> (8 * i)) & 0xFF);
+  }
+}
+
+inline void put64(std::vector<uint8_t> &out, uint64_t v) {
+  put32(out, (uint32_t)v);
+  put32(out, (uint32_t)(v >> 32));
+}
+
+inline uint32_t get32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+inline uint64_t get64(const uint8_t *p) { return get32(p) | ((uint64_t)get32(p + 4) << 32); }
+
+// the basic data format descriptor every KTX2 file has to carry
+inline std::vector<uint8_t> dataFormatDescriptor(uint32_t vkFormat) {
+  struct Sample {
+    uint32_t bitOffset, bitLength, channel, upper;
+  };
+  std::vector<Sample> samples;
+  uint32_t colorModel;
+  bool srgb = isSrgb(vkFormat);
+  switch (vkFormat) {
+  case BC1_RGB_UNORM_BLOCK:
+  case BC1_RGB_SRGB_BLOCK:
+    colorModel = 128; // KHR_DF_MODEL_BC1A
+    samples = {{0, 64, 0, 0xFFFFFFFF}};
+    break;
+  case BC3_UNORM_BLOCK:
+  case BC3_SRGB_BLOCK:
+    colorModel = 130; // KHR_DF_MODEL_BC3
+    samples = {{0, 64, 15 | 0x80, 0xFFFFFFFF}, {64, 64, 0, 0xFFFFFFFF}};
+    break;
+  case BC4_UNORM_BLOCK:
+    colorModel = 131; // KHR_DF_MODEL_BC4
+    samples = {{0, 64, 0, 0xFFFFFFFF}};
+    break;
+  case BC5_UNORM_BLOCK:
+    colorModel = 132; // KHR_DF_MODEL_BC5
+    samples = {{0, 64, 0, 0xFFFFFFFF}, {64, 64, 1, 0xFFFFFFFF}};
+    break;
+  default:
+    colorModel = 1; // KHR_DF_MODEL_RGBSDA
+    samples = {{0, 8, 0, 255}, {8, 8, 1, 255}, {16, 8, 2, 255}, {24, 8, 15 | 0x80, 255}};
+    break;
+  }
+  // alpha is always stored linearly, flag it as such in sRGB formats only
+  if (!srgb) {
+    for (auto &s : samples) {
+      s.channel &= 0x0F;
+    }
+  }
+  bool compressed = isCompressed(vkFormat);
+
+  std::vector<uint8_t> out;
+  uint32_t blockSize = 24 + 16 * samples.size();
+  put32(out, 4 + blockSize); // dfdTotalSize
+  put32(out, 0);             // vendorId, descriptorType
+  put32(out, 2 | (blockSize << 16));
+  put32(out, colorModel | (1 << 8) | ((srgb ? 2 : 1) << 16)); // BT709 primaries, linear or sRGB transfer
+  put32(out, compressed ? (3 | (3 << 8)) : 0);                 // texel block dimensions minus one
+  put32(out, blockBytes(vkFormat));                            // bytesPlane0
+  put32(out, 0);
+  for (const auto &s : samples) {
+    put32(out, s.bitOffset | ((s.bitLength - 1) << 16) | (s.channel << 24));
+    put32(out, 0);
+    put32(out, 0);
+    put32(out, s.upper);
+  }
+  return out;
+}
+
+} // namespace detail
+
+inline bool write(const std::string &path, const Image &image) {
+  using namespace detail;
+  uint32_t levelCount = image.levels.size();
+  std::vector<uint8_t> dfd = dataFormatDescriptor(image.vkFormat);
+  // levels must be aligned to lcm(texel block size, 4)
+  uint64_t alignment = blockBytes(image.vkFormat);
+
+  std::vector<uint8_t> out(IDENTIFIER, IDENTIFIER + 12);
+  put32(out, image.vkFormat);
+  put32(out, 1); // typeSize
+  put32(out, image.width);
+  put32(out, image.height);
+  put32(out, 0); // pixelDepth
+  put32(out, 0); // layerCount
+  put32(out, 1); // faceCount
+  put32(out, levelCount);
+  put32(out, 0); // supercompressionScheme
+
+  uint32_t levelIndexOffset = out.size() + 32;
+  uint32_t dfdOffset = levelIndexOffset + 24 * levelCount;
+  put32(out, dfdOffset);
+  put32(out, dfd.size());
+  put32(out, 0); // kvdByteOffset
+  put32(out, 0); // kvdByteLength
+  put64(out, 0); // sgdByteOffset
+  put64(out, 0); // sgdByteLength
+
+  // the smallest level is stored first
+  std::vector<uint64_t> offsets(levelCount);
+  uint64_t offset = dfdOffset + dfd.size();
+  for (int level = levelCount - 1; level >= 0; --level) {
+    offset = (offset + alignment - 1) / alignment * alignment;
+    offsets[level] = offset;
+    offset += image.levels[level].size();
+  }
+  for (uint32_t level = 0; level < levelCount; ++level) {
+    put64(out, offsets[level]);
+    put64(out, image.levels[level].size());
+    put64(out, image.levels[level].size());
+  }
+  out.insert(out.end(), dfd.begin(), dfd.end());
+  for (int level = levelCount - 1; level >= 0; --level) {
+    out.resize(offsets[level], 0);
+    out.insert(out.end(), image.levels[level].begin(), image.levels[level].end());
+  }
+
+  std::ofstream file(path, std::ios::binary);
+  file.write((const char *)out.data(), out.size());
+  return (bool)file;
+}
+
+inline bool read(const std::string &path, Image &image) {
+  using namespace detail;
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return false;
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  if (data.size() < 80 || std::memcmp(data.data(), IDENTIFIER, 12) != 0) {
+    std::cerr << "ktx2: not a KTX2 file: " << path << std::endl;
+    return false;
+  }
+  const uint8_t *header = data.data() + 12;
+  image.vkFormat = get32(header);
+  image.width = get32(header + 8);
+  image.height = get32(header + 12);
+  uint32_t levelCount = std::max(1u, get32(header + 28));
+  if (get32(header + 32) != 0) {
+    std::cerr << "ktx2: supercompressed files are not supported: " << path << std::endl;
+    return false;
+  }
+  if (data.size() < 80 + 24 * (size_t)levelCount)
+    return false;
+  image.levels.resize(levelCount);
+  for (uint32_t level = 0; level < levelCount; ++level) {
+    const uint8_t *entry = data.data() + 80 + 24 * level;
+    uint64_t offset = get64(entry), length = get64(entry + 8);
+    if (offset + length > data.size())
+      return false;
+    image.levels[level].assign(data.begin() + offset, data.begin() + offset + length);
+  }
+  return true;
+}
+
+// true if the driver can sample the given format
+inline bool supported(uint32_t vkFormat) {
+  static int s3tc = -1;
+  if (vkFormat == BC1_RGB_UNORM_BLOCK || vkFormat == BC1_RGB_SRGB_BLOCK || vkFormat == BC3_UNORM_BLOCK ||
+      vkFormat == BC3_SRGB_BLOCK) {
+    if (s3tc < 0)
+      s3tc = glext::hasExtension("GL_EXT_texture_compression_s3tc");
+    return s3tc == 1;
+  }
+  return glInternalFormat(vkFormat) != 0;
+}
+
+// upload every level as is, returns 0 if the file can't be read or the format isn't supported
+inline unsigned int loadTexture(const std::string &path) {
+  Image image;
+  if (!read(path, image) || !supported(image.vkFormat))
+    return 0;
+
+  GLenum internalFormat = glInternalFormat(image.vkFormat);
+  unsigned int textureID;
+  glGenTextures(1, &textureID);
+  glBindTexture(GL_TEXTURE_2D, textureID);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  int width = image.width, height = image.height;
+  size_t bytes = 0;
+  for (unsigned int level = 0; level < image.levels.size(); ++level) {
+    const auto &data = image.levels[level];
+    bytes += data.size();
+    if (isCompressed(image.vkFormat)) {
+      glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, 0, data.size(), data.data());
+    } else {
+      glTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
+    }
+    width = std::max(1, width / 2);
+    height = std::max(1, height / 2);
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.levels.size() - 1);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                  image.levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  // the caller owns the texture, it is tracked so the leak report names it when nobody deletes it
+  vram::track(vram::Category::TEXTURE, textureID, bytes, path.c_str());
+  return textureID;
+}
+
+} // namespace ktx2
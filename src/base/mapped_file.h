@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#include <vector>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// a whole file mapped read only into memory. the pages are faulted in by the OS as they are touched, nothing is copied
+// into a buffer first, so parsers can walk the file as one big char range. windows reads the file into memory instead.
+class MappedFile {
+public:
+  explicit MappedFile(const std::string &path);
+  ~MappedFile();
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  // false when the file couldn't be opened
+  bool valid() const { return ok; }
+  const char *data() const { return bytes; }
+  size_t size() const { return length; }
+
+private:
+  bool ok = false;
+  const char *bytes = "";
+  size_t length = 0;
+#ifdef _WIN32
+  std::vector<char> buffer;
+#else
+  void *mapping = nullptr;
+#endif
+};
+
+#ifdef _WIN32
+inline MappedFile::MappedFile(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return;
+  buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  ok = true;
+  length = buffer.size();
+  if (length > 0)
+    bytes = buffer.data();
+}
+
+inline MappedFile::~MappedFile() {}
+#else
+inline MappedFile::MappedFile(const std::string &path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return;
+  struct stat info;
+  if (fstat(fd, &info) == 0) {
+    ok = true;
+    // mapping an empty file fails, it is still a valid file
+    if (info.st_size > 0) {
+      void *p = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p == MAP_FAILED) {
+        ok = false;
+      } else {
+        // parsers read front to back, let the kernel read ahead aggressively
+        madvise(p, (size_t)info.st_size, MADV_SEQUENTIAL);
+        mapping = p;
+        bytes = static_cast<const char *>(p);
+        length = (size_t)info.st_size;
+      }
+    }
+  }
+  close(fd);
+}
+
+inline MappedFile::~MappedFile() {
+  if (mapping)
+    munmap(mapping, length);
+}
+#endif
@@ -0,0 +1,194 @@
+#pragma once
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <base/gl_resource.h>
+#include <base/mipmap.h>
+#include <base/shader.h>
+
+// material parameters as the shaders see them, std140 layout. layers index the library's texture array, -1 means the
+// material has no such map
+struct Material {
+  glm::vec4 color = glm::vec4(1.0f);
+  float shininess = 32.0f;
+  int diffuseLayer = -1;
+  int specularLayer = -1;
+  int normalLayer = -1;
+};
+static_assert(sizeof(Material) == 32, "Material has to match the std140 layout of the Materials block");
+
+// every material of a scene in one place: all textures are layers of a single GL_TEXTURE_2D_ARRAY and all parameters
+// live in one uniform buffer, both bound once. switching material between draws is then a single integer uniform
+// instead of a round of glActiveTexture/glBindTexture and sampler uniforms looked up by name.
+//
+// textures are squeezed to one layer size: larger ones are box filtered down, anything that still doesn't match is
+// point sampled to it. materials and textures are collected on the CPU first, upload() creates the GL objects.
+//
+//   MaterialLibrary library;
+//   Material m;
+//   m.diffuseLayer = library.addTexture("diffuse.png", pixels, width, height, true);
+//   int index = library.add(m);
+//   library.upload();
+//   ...
+//   shader.use();
+//   library.bind(shader);
+//   shader.setInt("materialIndex", index);
+class MaterialLibrary {
+public:
+  // has to match the array size in the shaders, 256 materials are 8KB, well below the 16KB every GL 4.1 driver offers
+  static const int MAX_MATERIALS = 256;
+  // uniform block binding point of the Materials block
+  static const GLuint BLOCK_BINDING = 0;
+  // a plain white material without maps the library starts with, for meshes that have none of their own
+  static const int DEFAULT_MATERIAL = 0;
+
+  struct Stats {
+    size_t materials = 0;
+    size_t layers = 0;
+    size_t textureBytes = 0;
+  };
+
+  explicit MaterialLibrary(int layerSize = 1024) : layerSize(layerSize), materials(1) {}
+  MaterialLibrary(const MaterialLibrary &) = delete;
+  MaterialLibrary &operator=(const MaterialLibrary &) = delete;
+
+  // layer of a texture added under this key before or -1
+  int findTexture(const std::string &key) const {
+    auto it = layerKeys.find(key);
+    return it == layerKeys.end() ? -1 : it->second;
+  }
+  // add an RGBA8 image as a new layer, or return the layer it got the first time it was added under this key.
+  // color maps are sRGB encoded and get gamma correct mipmaps
+  int addTexture(const std::string &key, const uint8_t *rgba, int width, int height, bool srgb);
+  // returns the material index or -1 when the library is full
+  int add(const Material &material);
+
+  // create the texture array and the uniform buffer, the CPU copies of the textures are dropped
+  void upload();
+  // bind the texture array to the unit and the parameters to BLOCK_BINDING, and point the shader's "textures"
+  // sampler and Materials block at them, the shader has to be in use
+  void bind(const Shader &shader, GLuint unit = 0) const;
+
+  size_t size() const { return materials.size(); }
+  const Material &get(int index) const { return materials[index]; }
+  Stats getStats() const { return stats; }
+
+private:
+  // the chain of one layer, level 0 is layerSize x layerSize
+  std::vector<std::vector<uint8_t>> fit(const uint8_t *rgba, int width, int height, bool srgb) const;
+
+  int layerSize;
+  std::vector<Material> materials;
+  // per layer mip chains waiting for upload()
+  std::vector<std::vector<std::vector<uint8_t>>> layers;
+  std::unordered_map<std::string, int> layerKeys;
+  size_t layerCount = 0;
+
+  GLTexture texture;
+  GLBuffer buffer;
+  Stats stats;
+};
+
+inline std::vector<std::vector<uint8_t>> MaterialLibrary::fit(const uint8_t *rgba, int width, int height,
+                                                              bool srgb) const {
+  mipmap::ColorSpace space = srgb ? mipmap::ColorSpace::SRGB : mipmap::ColorSpace::LINEAR;
+  std::vector<uint8_t> image(rgba, rgba + (size_t)width * height * 4);
+  // halve with the box filter while bigger than a layer
+  while (width > layerSize || height > layerSize) {
+    int w = std::max(1, width / 2), h = std::max(1, height / 2);
+    std::vector<uint8_t> next((size_t)w * h * 4);
+    mipmap::downsample(image.data(), width, height, 4, space, next.data());
+    image = std::move(next);
+    width = w;
+    height = h;
+  }
+  // non power of two or smaller than a layer: point sample
+  if (width != layerSize || height != layerSize) {
+    std::vector<uint8_t> resized((size_t)layerSize * layerSize * 4);
+    for (int y = 0; y < layerSize; ++y) {
+      const uint8_t *row = image.data() + (size_t)(y * height / layerSize) * width * 4;
+      for (int x = 0; x < layerSize; ++x) {
+        std::copy_n(row + (size_t)(x * width / layerSize) * 4, 4, resized.data() + ((size_t)y * layerSize + x) * 4);
+      }
+    }
+    image = std::move(resized);
+  }
+  return mipmap::generate(image.data(), layerSize, layerSize, 4, space);
+}
+
+inline int MaterialLibrary::addTexture(const std::string &key, const uint8_t *rgba, int width, int height, bool srgb) {
+  if (int layer = findTexture(key); layer >= 0)
+    return layer;
+  GLint maxLayers = 0;
+  glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+  if (texture || (GLint)layerCount >= maxLayers)
+    return -1;
+  layers.push_back(fit(rgba, width, height, srgb));
+  int layer = (int)layerCount++;
+  layerKeys[key] = layer;
+  return layer;
+}
+
+inline int MaterialLibrary::add(const Material &material) {
+  if ((int)materials.size() >= MAX_MATERIALS)
+    return -1;
+  materials.push_back(material);
+  return (int)materials.size() - 1;
+}
+
+inline void MaterialLibrary::upload() {
+  // the default material isn't counted
+  stats.materials = materials.size() - 1;
+  stats.layers = layerCount;
+
+  texture = GLTexture::create("material textures");
+  glBindTexture(GL_TEXTURE_2D_ARRAY, texture.get());
+  // at least one layer so the sampler is always complete
+  GLsizei depth = std::max<GLsizei>(1, (GLsizei)layerCount);
+  int levels = layers.empty() ? 1 : (int)layers[0].size();
+  for (int level = 0, size = layerSize; level < levels; ++level, size = std::max(1, size / 2)) {
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, size, size, depth, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    for (size_t layer = 0; layer < layers.size(); ++layer) {
+      glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, (GLint)layer, size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                      layers[layer][level].data());
+    }
+    stats.textureBytes += (size_t)size * size * 4 * depth;
+  }
+  texture.setBytes(stats.textureBytes);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  layers.clear();
+  layers.shrink_to_fit();
+
+  // the block is declared with a fixed size, fill the whole of it
+  std::vector<Material> block(MAX_MATERIALS);
+  std::copy(materials.begin(), materials.end(), block.begin());
+  buffer = GLBuffer::create("materials");
+  glBindBuffer(GL_UNIFORM_BUFFER, buffer.get());
+  glBufferData(GL_UNIFORM_BUFFER, block.size() * sizeof(Material), block.data(), GL_STATIC_DRAW);
+  buffer.setBytes(block.size() * sizeof(Material));
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+inline void MaterialLibrary::bind(const Shader &shader, GLuint unit) const {
+  glActiveTexture(GL_TEXTURE0 + unit);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, texture.get());
+  glBindBufferBase(GL_UNIFORM_BUFFER, BLOCK_BINDING, buffer.get());
+  GLuint block = glGetUniformBlockIndex(shader.get_id(), "Materials");
+  if (block != GL_INVALID_INDEX)
+    glUniformBlockBinding(shader.get_id(), block, BLOCK_BINDING);
+  shader.setInt("textures", (int)unit);
+}
@@ -0,0 +1,106 @@
+#include <base/mesh.h>
+
+#include <cstddef>
+
+Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures)
+    : vertices(vertices), indices(indices), textures(textures), count((GLsizei)this->indices.size()) {
+  for (const auto &v : this->vertices) {
+    bounds.expand(v.position);
+    skinned = skinned || v.boneWeights[0] != 0;
+  }
+  setup();
+}
+
+Mesh::Mesh(unsigned int vao, GLenum mode, GLsizei count, GLenum indexType, size_t indexOffset, const AABB &bounds,
+           std::vector<Texture> textures)
+    : textures(textures), bounds(bounds), VAO(vao), mode(mode), count(count), indexType(indexType),
+      indexOffset(indexOffset) {}
+
+void Mesh::setup() {
+  vertexArray = GLVertexArray::create("mesh");
+  VBO = GLBuffer::create("mesh vertices");
+  EBO = GLBuffer::create("mesh indices");
+  VAO = vertexArray.get();
+
+  glBindVertexArray(VAO);
+  glBindBuffer(GL_ARRAY_BUFFER, VBO.get());
+
+  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+  VBO.setBytes(vertices.size() * sizeof(Vertex));
+
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO.get());
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+  EBO.setBytes(indices.size() * sizeof(unsigned int));
+
+  // vertex position
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), nullptr);
+  // vertex normal
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, normal));
+  // vertex texture coord
+  glEnableVertexAttribArray(2);
+  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, texCoords));
+  // joint indices stay integers, weights are normalized to [0, 1]
+  glEnableVertexAttribArray(3);
+  glVertexAttribIPointer(3, MAX_BONE_INFLUENCE, GL_UNSIGNED_BYTE, sizeof(Vertex), (void *)offsetof(Vertex, boneIds));
+  glEnableVertexAttribArray(4);
+  glVertexAttribPointer(4, MAX_BONE_INFLUENCE, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex),
+                        (void *)offsetof(Vertex, boneWeights));
+
+  glBindVertexArray(0);
+}
+
+void Mesh::draw(const Shader &shader) {
+  bindTextures(shader);
+
+  // draw mesh
+  glBindVertexArray(VAO);
+  if (indexType)
+    glDrawElements(mode, count, indexType, (void *)indexOffset);
+  else
+    glDrawArrays(mode, 0, count);
+  glBindVertexArray(0);
+}
+
+void Mesh::bindTextures(const Shader &shader) const {
+  unsigned int differNr = 0;
+  unsigned int specularNr = 0;
+  for (unsigned int i = 0; i < textures.size(); ++i) {
+    glActiveTexture(GL_TEXTURE0 + i); // active texture unit before binding
+    // retrieve texture number ( the N in diffuer_textureN )
+    std::string number;
+    std::string name = textures[i].type;
+    if (name == "texture_diffuse")
+      number = std::to_string(++differNr);
+    else if (name == "texture_specular")
+      number = std::to_string(++specularNr);
+
+    shader.setFloat(("material." + name + number).c_str(), i);
+    glBindTexture(GL_TEXTURE_2D, textures[i].id);
+  }
+  glActiveTexture(GL_TEXTURE0);
+}
+
+void Mesh::drawGeometry() {
+  glBindVertexArray(VAO);
+  if (indexType)
+    glDrawElements(mode, count, indexType, (void *)indexOffset);
+  else
+    glDrawArrays(mode, 0, count);
+  glBindVertexArray(0);
+}
+
+void Mesh::drawRanges(const GLsizei *counts, const void *const *offsets, GLsizei n) {
+  if (!indexType || n == 0)
+    return;
+  glBindVertexArray(VAO);
+  glMultiDrawElements(mode, counts, indexType, offsets, n);
+  glBindVertexArray(0);
+}
+
+void Mesh::updateVertices(const Vertex *data, size_t count) {
+  glBindBuffer(GL_ARRAY_BUFFER, VBO.get());
+  glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(Vertex), data);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -6,15 +6,24 @@
 
 #include <glm/glm.hpp>
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
+#include <base/bounds.h>
+#include <base/gl_resource.h>
 #include <base/shader.h>
 
+// joints a skinned vertex can be bound to
+const int MAX_BONE_INFLUENCE = 4;
+
 struct Vertex {
   glm::vec3 position;
   glm::vec3 normal;
   glm::vec2 texCoords;
+  // indices into the model's joint palette and their weights in 1/255ths, summing to 255. all zero for rigid vertices
+  uint8_t boneIds[MAX_BONE_INFLUENCE] = {0, 0, 0, 0};
+  uint8_t boneWeights[MAX_BONE_INFLUENCE] = {0, 0, 0, 0};
 };
 
 struct Texture {
@@ -26,71 +35,48 @@ struct Texture {
 class Mesh {
 public:
   Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures);
+  // wrap geometry that is already on the GPU, e.g. glTF buffer views uploaded as they are. indexType is 0 for non
+  // indexed draws, indexOffset is in bytes. the vertex array and its buffers stay owned by the caller
+  Mesh(unsigned int vao, GLenum mode, GLsizei count, GLenum indexType, size_t indexOffset, const AABB &bounds,
+       std::vector<Texture> textures);
   // render the mesh
   void draw(const Shader &shader);
+  // render the mesh without binding any textures, e.g. for a depth-only pass
+  void drawGeometry();
+  // bind the textures to the shader's material samplers the way draw() does
+  void bindTextures(const Shader &shader) const;
+  // draw n ranges of an indexed mesh in one call, offsets are in bytes into the index buffer
+  void drawRanges(const GLsizei *counts, const void *const *offsets, GLsizei n);
+  const std::vector<Texture> &getTextures() const { return textures; }
+  // true when any vertex has bone weights
+  bool isSkinned() const { return skinned; }
+  // the vertices as loaded, empty for meshes wrapping GPU geometry
+  const std::vector<Vertex> &getVertices() const { return vertices; }
+  const std::vector<unsigned int> &getIndices() const { return indices; }
+  // replace the vertex buffer's contents, e.g. with vertices skinned on the CPU. count must match the loaded vertices
+  void updateVertices(const Vertex *data, size_t count);
+  // object space bounds of the vertices
+  const AABB &getBounds() const { return bounds; }
+  // index into the MaterialLibrary the model was loaded with, -1 when it was loaded with plain textures
+  int getMaterial() const { return material; }
+  void setMaterial(int index) { material = index; }
 
 private:
   // mesh data
   std::vector<Vertex> vertices;
   std::vector<unsigned int> indices;
   std::vector<Texture> textures;
-  // render data
-  unsigned int VAO, VBO, EBO;
+  AABB bounds;
+  int material = -1;
+  bool skinned = false;
+  // render data. VAO is the vertex array drawn from, owned by vertexArray unless the mesh wraps the caller's geometry
+  unsigned int VAO;
+  GLVertexArray vertexArray;
+  GLBuffer VBO, EBO;
+  GLenum mode = GL_TRIANGLES;
+  GLsizei count = 0;
+  GLenum indexType = GL_UNSIGNED_INT;
+  size_t indexOffset = 0;
   // initialize all the buffer objects/arrays
   void setup();
 };
-
-Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures)
-    : vertices(vertices), indices(indices), textures(textures) {
-  setup();
-}
-
-void Mesh::setup() {
-  glGenVertexArrays(1, &VAO);
-  glGenBuffers(1, &VBO);
-  glGenBuffers(1, &EBO);
-
-  glBindVertexArray(VAO);
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-  // vertex position
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), nullptr);
-  // vertex normal
-  glEnableVertexAttribArray(1);
-  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, normal));
-  // vertex texture coord
-  glEnableVertexAttribArray(2);
-  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, texCoords));
-
-  glBindVertexArray(0);
-}
-
-void Mesh::draw(const Shader &shader) {
-  unsigned int differNr = 0;
-  unsigned int specularNr = 0;
-  for (unsigned int i = 0; i < textures.size(); ++i) {
-    glActiveTexture(GL_TEXTURE0 + i); // active texture unit before binding
-    // retrieve texture number ( the N in diffuer_textureN )
-    std::string number;
-    std::string name = textures[i].type;
-    if (name == "texture_diffuse")
-      number = std::to_string(++differNr);
-    else if (name == "texture_specular")
-      number = std::to_string(++specularNr);
-
-    shader.setFloat(("material." + name + number).c_str(), i);
-    glBindTexture(GL_TEXTURE_2D, textures[i].id);
-  }
-  glActiveTexture(GL_TEXTURE0);
-
-  // draw mesh
-  glBindVertexArray(VAO);
-  glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-  glBindVertexArray(0);
-}
@@ -0,0 +1,315 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define MIPMAP_X86 1
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MIPMAP_NEON 1
+#endif
+
+// CPU mip chain generation with a 2x2 box filter.
+//
+// color maps are stored sRGB encoded, averaging their bytes directly darkens every level, so they are decoded to
+// linear light, averaged and encoded again. specular and normal maps hold linear data and are averaged as is. alpha is
+// always linear. 4 channel images go through SSE2/AVX2/NEON, any other channel count and the borders of odd sized
+// levels use the scalar code.
+namespace mipmap {
+
+enum class ColorSpace { LINEAR, SRGB };
+enum class Path { SCALAR, SSE2, AVX2, NEON };
+
+namespace detail {
+
+inline float srgbToLinear(float c) { return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f); }
+inline float linearToSrgb(float c) { return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f; }
+
+// byte -> linear float
+inline const float *decodeTable() {
+  static const std::vector<float> table = [] {
+    std::vector<float> t(256);
+    for (int i = 0; i < 256; ++i) {
+      t[i] = srgbToLinear(i / 255.0f);
+    }
+    return t;
+  }();
+  return table.data();
+}
+
+// linear float quantized to ENCODE_SIZE steps -> byte. the table is fine enough that every byte is reachable
+const int ENCODE_SIZE = 16384;
+inline const uint8_t *encodeTable() {
+  static const std::vector<uint8_t> table = [] {
+    std::vector<uint8_t> t(ENCODE_SIZE + 1);
+    for (int i = 0; i <= ENCODE_SIZE; ++i) {
+      t[i] = (uint8_t)std::lround(linearToSrgb((float)i / ENCODE_SIZE) * 255.0f);
+    }
+    return t;
+  }();
+  return table.data();
+}
+
+inline uint8_t encode(float linear) {
+  return encodeTable()[std::clamp((int)(linear * ENCODE_SIZE + 0.5f), 0, ENCODE_SIZE)];
+}
+
+// decode a row of RGBA bytes to linear floats, alpha is only rescaled
+inline void decodeRow(const uint8_t *src, int pixels, float *dst) {
+  const float *table = decodeTable();
+  for (int i = 0; i < pixels; ++i) {
+    dst[4 * i + 0] = table[src[4 * i + 0]];
+    dst[4 * i + 1] = table[src[4 * i + 1]];
+    dst[4 * i + 2] = table[src[4 * i + 2]];
+    dst[4 * i + 3] = src[4 * i + 3] / 255.0f;
+  }
+}
+
+inline void encodePixel(const float *p, uint8_t *dst) {
+  dst[0] = encode(p[0]);
+  dst[1] = encode(p[1]);
+  dst[2] = encode(p[2]);
+  dst[3] = (uint8_t)std::clamp((int)(p[3] * 255.0f + 0.5f), 0, 255);
+}
+
+// scalar reference, handles any channel count and columns [x0, x1) of one destination row
+inline void rowScalar(const uint8_t *row0, const uint8_t *row1, int srcWidth, int channels, ColorSpace space,
+                      uint8_t *dst, int x0, int x1) {
+  const float *table = decodeTable();
+  // only the color channels are sRGB encoded, 2 and 4 channel images keep alpha last
+  int colorChannels = (channels == 2 || channels == 4) ? channels - 1 : channels;
+  for (int x = x0; x < x1; ++x) {
+    int sx0 = std::min(2 * x, srcWidth - 1), sx1 = std::min(2 * x + 1, srcWidth - 1);
+    for (int c = 0; c < channels; ++c) {
+      int a = row0[sx0 * channels + c], b = row0[sx1 * channels + c];
+      int d = row1[sx0 * channels + c], e = row1[sx1 * channels + c];
+      if (space == ColorSpace::SRGB && c < colorChannels) {
+        dst[x * channels + c] = encode((table[a] + table[b] + table[d] + table[e]) * 0.25f);
+      } else {
+        dst[x * channels + c] = (uint8_t)((a + b + d + e + 2) >> 2);
+      }
+    }
+  }
+}
+
+#if MIPMAP_X86
+// 4 source pixels of two rows -> 2 destination pixels
+inline void rowLinearSse2(const uint8_t *row0, const uint8_t *row1, uint8_t *dst, int count) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i two = _mm_set1_epi16(2);
+  int x = 0;
+  for (; x + 2 <= count; x += 2) {
+    __m128i a = _mm_loadu_si128((const __m128i *)(row0 + 8 * x));
+    __m128i b = _mm_loadu_si128((const __m128i *)(row1 + 8 * x));
+    // vertical sums of pixels 0,1 and 2,3 as 16 bit
+    __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+    __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+    // horizontal sums: pixel 0 + 1 in the low half, 2 + 3 in the high half
+    __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+    sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+    _mm_storel_epi64((__m128i *)(dst + 4 * x), _mm_packus_epi16(sum, sum));
+  }
+  if (x < count) {
+    rowScalar(row0, row1, 2 * count, 4, ColorSpace::LINEAR, dst, x, count);
+  }
+}
+
+inline void rowSrgbSse2(const float *row0, const float *row1, uint8_t *dst, int count) {
+  const __m128 quarter = _mm_set1_ps(0.25f);
+  alignas(16) float p[4];
+  for (int x = 0; x < count; ++x) {
+    __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(row0 + 8 * x), _mm_loadu_ps(row0 + 8 * x + 4)),
+                            _mm_add_ps(_mm_loadu_ps(row1 + 8 * x), _mm_loadu_ps(row1 + 8 * x + 4)));
+    _mm_store_ps(p, _mm_mul_ps(sum, quarter));
+    encodePixel(p, dst + 4 * x);
+  }
+}
+
+#if defined(__GNUC__)
+#define MIPMAP_AVX2 1
+// 8 source pixels of two rows -> 4 destination pixels
+__attribute__((target("avx2"))) inline void rowLinearAvx2(const uint8_t *row0, const uint8_t *row1, uint8_t *dst,
+                                                          int count) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i two = _mm256_set1_epi16(2);
+  int x = 0;
+  for (; x + 4 <= count; x += 4) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(row0 + 8 * x));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(row1 + 8 * x));
+    // the same steps as the SSE2 version, independently in both 128 bit lanes
+    __m256i lo = _mm256_add_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero));
+    __m256i hi = _mm256_add_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero));
+    __m256i sum = _mm256_add_epi16(_mm256_unpacklo_epi64(lo, hi), _mm256_unpackhi_epi64(lo, hi));
+    sum = _mm256_srli_epi16(_mm256_add_epi16(sum, two), 2);
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(sum, sum), 0x08);
+    _mm_storeu_si128((__m128i *)(dst + 4 * x), _mm256_castsi256_si128(packed));
+  }
+  if (x < count) {
+    rowLinearSse2(row0 + 8 * x, row1 + 8 * x, dst + 4 * x, count - x);
+  }
+}
+
+__attribute__((target("avx2"))) inline void rowSrgbAvx2(const float *row0, const float *row1, uint8_t *dst,
+                                                        int count) {
+  const __m256 quarter = _mm256_set1_ps(0.25f);
+  alignas(32) float p[8];
+  int x = 0;
+  for (; x + 2 <= count; x += 2) {
+    // two source pixel pairs per row, sum the pairs across the lanes afterwards
+    __m256 r0a = _mm256_loadu_ps(row0 + 8 * x), r0b = _mm256_loadu_ps(row0 + 8 * x + 8);
+    __m256 r1a = _mm256_loadu_ps(row1 + 8 * x), r1b = _mm256_loadu_ps(row1 + 8 * x + 8);
+    __m256 va = _mm256_add_ps(r0a, r1a), vb = _mm256_add_ps(r0b, r1b);
+    __m256 sum = _mm256_add_ps(_mm256_permute2f128_ps(va, vb, 0x20), _mm256_permute2f128_ps(va, vb, 0x31));
+    _mm256_store_ps(p, _mm256_mul_ps(sum, quarter));
+    encodePixel(p, dst + 4 * x);
+    encodePixel(p + 4, dst + 4 * x + 4);
+  }
+  if (x < count) {
+    rowSrgbSse2(row0 + 8 * x, row1 + 8 * x, dst + 4 * x, count - x);
+  }
+}
+#endif
+#endif
+
+#if MIPMAP_NEON
+// 8 source pixels of two rows -> 4 destination pixels
+inline void rowLinearNeon(const uint8_t *row0, const uint8_t *row1, uint8_t *dst, int count) {
+  int x = 0;
+  for (; x + 4 <= count; x += 4) {
+    // split even and odd pixels, then widen and add all four neighbours
+    uint32x4x2_t a = vld2q_u32((const uint32_t *)(row0 + 8 * x));
+    uint32x4x2_t b = vld2q_u32((const uint32_t *)(row1 + 8 * x));
+    uint8x16_t a0 = vreinterpretq_u8_u32(a.val[0]), a1 = vreinterpretq_u8_u32(a.val[1]);
+    uint8x16_t b0 = vreinterpretq_u8_u32(b.val[0]), b1 = vreinterpretq_u8_u32(b.val[1]);
+    uint16x8_t lo = vaddq_u16(vaddl_u8(vget_low_u8(a0), vget_low_u8(a1)), vaddl_u8(vget_low_u8(b0), vget_low_u8(b1)));
+    uint16x8_t hi =
+        vaddq_u16(vaddl_u8(vget_high_u8(a0), vget_high_u8(a1)), vaddl_u8(vget_high_u8(b0), vget_high_u8(b1)));
+    // rounding narrowing shift: (sum + 2) >> 2
+    vst1q_u8(dst + 4 * x, vcombine_u8(vrshrn_n_u16(lo, 2), vrshrn_n_u16(hi, 2)));
+  }
+  if (x < count) {
+    rowScalar(row0 + 8 * x, row1 + 8 * x, 2 * (count - x), 4, ColorSpace::LINEAR, dst + 4 * x, 0, count - x);
+  }
+}
+
+inline void rowSrgbNeon(const float *row0, const float *row1, uint8_t *dst, int count) {
+  float p[4];
+  for (int x = 0; x < count; ++x) {
+    float32x4_t sum = vaddq_f32(vaddq_f32(vld1q_f32(row0 + 8 * x), vld1q_f32(row0 + 8 * x + 4)),
+                                vaddq_f32(vld1q_f32(row1 + 8 * x), vld1q_f32(row1 + 8 * x + 4)));
+    vst1q_f32(p, vmulq_f32(sum, vdupq_n_f32(0.25f)));
+    encodePixel(p, dst + 4 * x);
+  }
+}
+#endif
+
+} // namespace detail
+
+// the fastest path the CPU supports
+inline Path bestPath() {
+#if MIPMAP_NEON
+  return Path::NEON;
+#elif MIPMAP_X86
+#if MIPMAP_AVX2
+  static const bool avx2 = __builtin_cpu_supports("avx2");
+  if (avx2)
+    return Path::AVX2;
+#endif
+  return Path::SSE2;
+#else
+  return Path::SCALAR;
+#endif
+}
+
+inline const char *pathName(Path path) {
+  switch (path) {
+  case Path::SSE2:
+    return "sse2";
+  case Path::AVX2:
+    return "avx2";
+  case Path::NEON:
+    return "neon";
+  default:
+    return "scalar";
+  }
+}
+
+// downsample one level, dst receives max(1, width / 2) x max(1, height / 2) pixels
+inline void downsample(const uint8_t *src, int width, int height, int channels, ColorSpace space, uint8_t *dst,
+                       Path path = bestPath()) {
+  int w = std::max(1, width / 2), h = std::max(1, height / 2);
+  // columns every source pixel pair exists for, the SIMD paths only handle those
+  int simdWidth = (channels == 4 && path != Path::SCALAR) ? width / 2 : 0;
+  std::vector<float> linear0, linear1;
+  if (space == ColorSpace::SRGB && simdWidth > 0) {
+    linear0.resize(simdWidth * 8);
+    linear1.resize(simdWidth * 8);
+  }
+
+  for (int y = 0; y < h; ++y) {
+    const uint8_t *row0 = src + (size_t)std::min(2 * y, height - 1) * width * channels;
+    const uint8_t *row1 = src + (size_t)std::min(2 * y + 1, height - 1) * width * channels;
+    uint8_t *out = dst + (size_t)y * w * channels;
+
+    if (simdWidth > 0) {
+      if (space == ColorSpace::SRGB) {
+        detail::decodeRow(row0, simdWidth * 2, linear0.data());
+        detail::decodeRow(row1, simdWidth * 2, linear1.data());
+      }
+      switch (path) {
+#if MIPMAP_X86
+      case Path::SSE2:
+        if (space == ColorSpace::SRGB)
+          detail::rowSrgbSse2(linear0.data(), linear1.data(), out, simdWidth);
+        else
+          detail::rowLinearSse2(row0, row1, out, simdWidth);
+        break;
+#if MIPMAP_AVX2
+      case Path::AVX2:
+        if (space == ColorSpace::SRGB)
+          detail::rowSrgbAvx2(linear0.data(), linear1.data(), out, simdWidth);
+        else
+          detail::rowLinearAvx2(row0, row1, out, simdWidth);
+        break;
+#endif
+#endif
+#if MIPMAP_NEON
+      case Path::NEON:
+        if (space == ColorSpace::SRGB)
+          detail::rowSrgbNeon(linear0.data(), linear1.data(), out, simdWidth);
+        else
+          detail::rowLinearNeon(row0, row1, out, simdWidth);
+        break;
+#endif
+      default:
+        detail::rowScalar(row0, row1, width, channels, space, out, 0, simdWidth);
+        break;
+      }
+    }
+    detail::rowScalar(row0, row1, width, channels, space, out, simdWidth, w);
+  }
+}
+
+// the whole chain down to 1x1, level 0 is a copy of the input
+inline std::vector<std::vector<uint8_t>> generate(const uint8_t *pixels, int width, int height, int channels,
+                                                  ColorSpace space, Path path = bestPath()) {
+  std::vector<std::vector<uint8_t>> levels;
+  levels.emplace_back(pixels, pixels + (size_t)width * height * channels);
+  while (width > 1 || height > 1) {
+    int w = std::max(1, width / 2), h = std::max(1, height / 2);
+    std::vector<uint8_t> next((size_t)w * h * channels);
+    downsample(levels.back().data(), width, height, channels, space, next.data(), path);
+    levels.push_back(std::move(next));
+    width = w;
+    height = h;
+  }
+  return levels;
+}
+
+} // namespace mipmap
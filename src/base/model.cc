@@ -0,0 +1,552 @@
+#include <base/model.h>
+
+#include <functional>
+#include <iostream>
+
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <stb_image.h>
+
+#include <base/gltf.h>
+#include <base/job_system.h>
+#include <base/ktx2.h>
+#include <base/mipmap.h>
+#include <base/obj.h>
+
+void Model::loadModel(std::string path) {
+  // retrieve the directory path of the filepath
+  directory = path.substr(0, path.find_last_of('/'));
+
+  // plain OBJ files are read straight into meshes, assimp handles every other format and whatever the OBJ reader
+  // rejects
+  if (path.size() > 4 && path.compare(path.size() - 4, 4, ".obj") == 0 && loadObj(path))
+    return;
+  // glTF buffer views go to the GPU as they are
+  std::string extension = path.substr(path.find_last_of('.') + 1);
+  if ((extension == "glb" || extension == "gltf") && loadGltf(path))
+    return;
+
+  Assimp::Importer importer;
+  const aiScene *scene =
+      importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_LimitBoneWeights);
+  // check error
+  if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+    std::cout << "error:assimp: " << importer.GetErrorString() << std::endl;
+    return;
+  }
+
+  // joints are numbered before the meshes are built so the vertices can refer to them
+  collectJoints(scene);
+  // process root node recursively
+  processNode(scene->mRootNode, scene, -1);
+  updateBounds();
+  loadAnimations(scene);
+}
+
+void Model::collectJoints(const aiScene *scene) {
+  for (unsigned int m = 0; m < scene->mNumMeshes; ++m) {
+    const aiMesh *mesh = scene->mMeshes[m];
+    for (unsigned int b = 0; b < mesh->mNumBones; ++b) {
+      const aiBone *bone = mesh->mBones[b];
+      if (jointIndices.count(bone->mName.C_Str()) || skeleton.inverseBind.size() >= animation::MAX_JOINTS)
+        continue;
+      jointIndices[bone->mName.C_Str()] = (int)skeleton.inverseBind.size();
+      // assimp matrices are row major
+      skeleton.inverseBind.push_back(glm::transpose(glm::make_mat4(&bone->mOffsetMatrix.a1)));
+    }
+  }
+}
+
+void Model::loadAnimations(const aiScene *scene) {
+  if (jointIndices.empty())
+    return;
+  skeleton.rest.resize(nodes.size());
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    skeleton.parents.push_back(nodes.getParent((int)i));
+    skeleton.names.push_back(nodes.getName((int)i));
+    skeleton.rest.set(i, nodes.getPosition((int)i), nodes.getRotation((int)i), nodes.getScale((int)i));
+  }
+  skeleton.jointNodes.resize(skeleton.inverseBind.size(), 0);
+  for (const auto &joint : jointIndices) {
+    skeleton.jointNodes[joint.second] = std::max(0, nodes.find(joint.first));
+  }
+
+  for (unsigned int a = 0; a < scene->mNumAnimations; ++a) {
+    const aiAnimation *animation = scene->mAnimations[a];
+    float ticks = animation->mTicksPerSecond > 0.0 ? (float)animation->mTicksPerSecond : 25.0f;
+    animation::Clip clip;
+    clip.name = animation->mName.C_Str();
+    clip.duration = (float)animation->mDuration / ticks;
+    for (unsigned int c = 0; c < animation->mNumChannels; ++c) {
+      const aiNodeAnim *source = animation->mChannels[c];
+      animation::Channel channel;
+      channel.node = nodes.find(source->mNodeName.C_Str());
+      if (channel.node < 0)
+        continue;
+      for (unsigned int k = 0; k < source->mNumPositionKeys; ++k) {
+        const aiVectorKey &key = source->mPositionKeys[k];
+        channel.positions.times.push_back((float)key.mTime / ticks);
+        channel.positions.values.emplace_back(key.mValue.x, key.mValue.y, key.mValue.z);
+      }
+      for (unsigned int k = 0; k < source->mNumRotationKeys; ++k) {
+        const aiQuatKey &key = source->mRotationKeys[k];
+        channel.rotations.times.push_back((float)key.mTime / ticks);
+        channel.rotations.values.emplace_back(key.mValue.w, key.mValue.x, key.mValue.y, key.mValue.z);
+      }
+      for (unsigned int k = 0; k < source->mNumScalingKeys; ++k) {
+        const aiVectorKey &key = source->mScalingKeys[k];
+        channel.scales.times.push_back((float)key.mTime / ticks);
+        channel.scales.values.emplace_back(key.mValue.x, key.mValue.y, key.mValue.z);
+      }
+      clip.channels.push_back(std::move(channel));
+    }
+    clips.push_back(std::move(clip));
+  }
+}
+
+bool Model::loadObj(const std::string &path) {
+  obj::Scene scene;
+  if (!obj::load(path, scene, jobs))
+    return false;
+
+  // like assimp: a root node with one child per mesh, OBJ has no transforms
+  int root = nodes.addNode(-1, glm::vec3(0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f),
+                           path.substr(path.find_last_of('/') + 1));
+  std::vector<int> materials(scene.materials.size(), -1);
+  for (auto &mesh : scene.meshes) {
+    std::vector<Texture> textures;
+    int material = -1;
+    if (mesh.material >= 0) {
+      const obj::Material &m = scene.materials[mesh.material];
+      if (library) {
+        if (materials[mesh.material] < 0) {
+          Material libraryMaterial;
+          libraryMaterial.shininess = m.shininess;
+          libraryMaterial.color = glm::vec4(m.diffuse, 1.0f);
+          libraryMaterial.diffuseLayer = m.diffuseMap.empty() ? -1 : libraryTexture(m.diffuseMap, true);
+          libraryMaterial.specularLayer = m.specularMap.empty() ? -1 : libraryTexture(m.specularMap, false);
+          if (libraryMaterial.diffuseLayer >= 0)
+            libraryMaterial.color = glm::vec4(1.0f);
+          materials[mesh.material] = library->add(libraryMaterial);
+        }
+        material = materials[mesh.material];
+      } else {
+        if (!m.diffuseMap.empty())
+          textures.push_back(loadTexture(m.diffuseMap, "texture_diffuse"));
+        if (!m.specularMap.empty())
+          textures.push_back(loadTexture(m.specularMap, "texture_specular"));
+      }
+    }
+    meshes.emplace_back(std::move(mesh.vertices), std::move(mesh.indices), textures);
+    meshes.back().setMaterial(material);
+    meshNodes.push_back(nodes.addNode(root, glm::vec3(0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f),
+                                      mesh.name));
+  }
+  updateBounds();
+  return true;
+}
+
+bool Model::loadGltf(const std::string &path) {
+  gltf::Document doc;
+  std::string error;
+  if (!gltf::load(path, doc, &error)) {
+    std::cout << "gltf: " << error << ", falling back to assimp" << std::endl;
+    return false;
+  }
+  std::vector<GLuint> views = gltf::uploadBufferViews(doc);
+  for (size_t i = 0; i < views.size(); ++i) {
+    if (views[i])
+      gpuBuffers.emplace_back(views[i], doc.bufferViews[i].byteLength, path.c_str());
+  }
+
+  // base color images become diffuse textures or library layers
+  auto imageTexture = [&](int image, std::vector<Texture> &textures) -> int {
+    const gltf::Image &img = doc.images[image];
+    if (!img.uri.empty()) {
+      if (library)
+        return libraryTexture(img.uri, true);
+      textures.push_back(loadTexture(img.uri, "texture_diffuse"));
+      return -1;
+    }
+    std::string key = path + "#image" + std::to_string(image);
+    if (library) {
+      if (int layer = library->findTexture(key); layer >= 0)
+        return layer;
+    } else {
+      for (const auto &t : textures_loaded) {
+        if (t.path == key) {
+          textures.push_back(t);
+          return -1;
+        }
+      }
+    }
+    const gltf::BufferView &view = doc.bufferViews[img.bufferView];
+    int width, height, nrComponents;
+    unsigned char *data = stbi_load_from_memory(doc.viewData(img.bufferView), (int)view.byteLength, &width, &height,
+                                                &nrComponents, library ? 4 : 0);
+    if (!data) {
+      std::cout << "Texture failed to load: " << key << std::endl;
+      return -1;
+    }
+    int layer = -1;
+    if (library) {
+      layer = library->addTexture(key, data, width, height, true);
+    } else {
+      unsigned int id = streamer ? streamer->add(data, width, height, nrComponents, true)
+                                 : textureFromPixels(data, width, height, nrComponents, true);
+      if (!streamer)
+        ownedTextures.emplace_back(id, 0, key.c_str());
+      Texture texture = {id, "texture_diffuse", key};
+      textures_loaded.push_back(texture);
+      textures.push_back(texture);
+    }
+    stbi_image_free(data);
+    return layer;
+  };
+  std::vector<int> materials(doc.materials.size(), -1);
+  std::vector<std::vector<Texture>> materialTextures(doc.materials.size());
+  for (size_t i = 0; i < doc.materials.size(); ++i) {
+    const gltf::Material &m = doc.materials[i];
+    int layer = m.baseColorImage >= 0 ? imageTexture(m.baseColorImage, materialTextures[i]) : -1;
+    if (library) {
+      Material libraryMaterial;
+      libraryMaterial.color = m.baseColor;
+      libraryMaterial.diffuseLayer = layer;
+      materials[i] = library->add(libraryMaterial);
+    }
+  }
+
+  // one VAO per primitive, shared by every node that instances the mesh
+  std::vector<std::vector<GLuint>> vaos(doc.meshes.size());
+  std::vector<char> visited(doc.nodes.size(), 0);
+  std::function<void(int, int)> addNode = [&](int node, int parent) {
+    // the spec forbids cycles and shared children, a broken file shouldn't hang the loader
+    if (visited[node])
+      return;
+    visited[node] = 1;
+    const gltf::Node &n = doc.nodes[node];
+    int index = nodes.addNode(parent, n.translation, n.rotation, n.scale, n.name);
+    if (n.mesh >= 0) {
+      const gltf::Mesh &mesh = doc.meshes[n.mesh];
+      if (vaos[n.mesh].empty()) {
+        for (const auto &primitive : mesh.primitives) {
+          vaos[n.mesh].push_back(gltf::createVertexArray(doc, primitive, views));
+        }
+      }
+      for (size_t i = 0; i < mesh.primitives.size(); ++i) {
+        const gltf::Primitive &primitive = mesh.primitives[i];
+        const gltf::Accessor *indices = primitive.indices >= 0 ? &doc.accessors[primitive.indices] : nullptr;
+        GLsizei count = (GLsizei)(indices ? indices->count : doc.accessors[primitive.position].count);
+        std::vector<Texture> textures;
+        if (primitive.material >= 0 && primitive.material < (int)materials.size())
+          textures = materialTextures[primitive.material];
+        meshes.emplace_back(vaos[n.mesh][i], primitive.mode, count, indices ? indices->componentType : 0,
+                            indices ? indices->byteOffset : 0, gltf::primitiveBounds(doc, primitive), textures);
+        if (primitive.material >= 0 && primitive.material < (int)materials.size())
+          meshes.back().setMaterial(materials[primitive.material]);
+        meshNodes.push_back(index);
+      }
+    }
+    for (int child : n.children) {
+      addNode(child, index);
+    }
+  };
+  for (int root : doc.roots) {
+    addNode(root, -1);
+  }
+  for (const auto &v : vaos) {
+    for (GLuint vao : v) {
+      gpuVertexArrays.emplace_back(vao, 0, path.c_str());
+    }
+  }
+  updateBounds();
+  return true;
+}
+
+void Model::updateBounds() {
+  nodes.update();
+  for (unsigned int i = 0; i < meshes.size(); ++i) {
+    bounds.expand(meshes[i].getBounds().transformed(nodes.getWorld(meshNodes[i])));
+  }
+}
+
+void Model::processNode(aiNode *node, const aiScene *scene, int parent) {
+  // keep the node's transform relative to its parent, the recursion visits nodes depth first just like the scene graph
+  // wants them
+  aiVector3D scaling, position;
+  aiQuaternion rotation;
+  node->mTransformation.Decompose(scaling, rotation, position);
+  int index = nodes.addNode(parent, glm::vec3(position.x, position.y, position.z),
+                            glm::quat(rotation.w, rotation.x, rotation.y, rotation.z),
+                            glm::vec3(scaling.x, scaling.y, scaling.z), node->mName.C_Str());
+
+  // process each mesh located at the current node
+  for (unsigned int i = 0; i < node->mNumMeshes; ++i) {
+    // the node object only contains indices to index the actual objects in the scene.
+    // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
+    aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
+    meshes.push_back(processMesh(mesh, scene));
+    meshNodes.push_back(index);
+  }
+
+  for (unsigned int i = 0; i < node->mNumChildren; ++i) {
+    processNode(node->mChildren[i], scene, index);
+  }
+}
+
+Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene) {
+  // data to fill
+  std::vector<Vertex> vertices;
+  std::vector<unsigned int> indices;
+  std::vector<Texture> textures;
+
+  // walk through each of the mesh's vertices
+  for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
+    glm::vec3 vector; // we declare a placeholder vector since assimp uses its own vector class that doesn't directly
+                      // convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
+    // positions
+    vector.x = mesh->mVertices[i].x;
+    vector.y = mesh->mVertices[i].y;
+    vector.z = mesh->mVertices[i].z;
+
+    Vertex vertex;
+    vertex.position = vector;
+
+    // normals
+    if (mesh->HasNormals()) {
+      vector.x = mesh->mNormals[i].x;
+      vector.y = mesh->mNormals[i].y;
+      vector.z = mesh->mNormals[i].z;
+      vertex.normal = vector;
+    }
+    // texture coordinates
+    vertex.texCoords = glm::vec2(0.0f, 0.0f);
+    if (mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
+    {
+      glm::vec2 vec;
+      // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't
+      // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
+      vec.x = mesh->mTextureCoords[0][i].x;
+      vec.y = mesh->mTextureCoords[0][i].y;
+      vertex.texCoords = vec;
+    }
+
+    vertices.push_back(vertex);
+  }
+  // bone weights, aiProcess_LimitBoneWeights leaves at most 4 per vertex
+  if (mesh->HasBones()) {
+    std::vector<int> joints(vertices.size() * MAX_BONE_INFLUENCE);
+    std::vector<float> weights(vertices.size() * MAX_BONE_INFLUENCE);
+    std::vector<int> counts(vertices.size(), 0);
+    for (unsigned int b = 0; b < mesh->mNumBones; ++b) {
+      const aiBone *bone = mesh->mBones[b];
+      auto joint = jointIndices.find(bone->mName.C_Str());
+      if (joint == jointIndices.end())
+        continue;
+      for (unsigned int w = 0; w < bone->mNumWeights; ++w) {
+        unsigned int v = bone->mWeights[w].mVertexId;
+        if (v >= vertices.size() || counts[v] >= MAX_BONE_INFLUENCE)
+          continue;
+        joints[v * MAX_BONE_INFLUENCE + counts[v]] = joint->second;
+        weights[v * MAX_BONE_INFLUENCE + counts[v]++] = bone->mWeights[w].mWeight;
+      }
+    }
+    for (size_t v = 0; v < vertices.size(); ++v) {
+      animation::packWeights(vertices[v], &joints[v * MAX_BONE_INFLUENCE], &weights[v * MAX_BONE_INFLUENCE],
+                             counts[v]);
+    }
+  }
+  // wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex
+  // indices
+  for (unsigned int i = 0; i < mesh->mNumFaces; ++i) {
+    aiFace face = mesh->mFaces[i];
+    // retrieve all indices of the face and store them in the indices vector
+    for (unsigned int j = 0; j < face.mNumIndices; ++j) {
+      indices.push_back(face.mIndices[j]);
+    }
+  }
+  // process materials
+  if (library) {
+    Mesh result(vertices, indices, textures);
+    result.setMaterial(libraryMaterial(mesh->mMaterialIndex, scene));
+    return result;
+  }
+  if (mesh->mMaterialIndex >= 0) {
+    aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
+    // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
+    // as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER.
+    // Same applies to other texture as the following list summarizes:
+    // diffuse: texture_diffuseN
+    // specular: texture_specularN
+    // normal: texture_normalN
+
+    // 1. diffuse maps
+    std::vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
+    textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+    // 2. specular maps
+    std::vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
+    textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+  }
+
+  // return a mesh object created from the extracted mesh data
+  return Mesh(vertices, indices, textures);
+}
+
+int Model::libraryMaterial(unsigned int index, const aiScene *scene) {
+  if (auto it = libraryMaterials.find(index); it != libraryMaterials.end())
+    return it->second;
+  aiMaterial *material = scene->mMaterials[index];
+  Material m;
+  aiColor4D color;
+  if (material->Get(AI_MATKEY_COLOR_DIFFUSE, color) == AI_SUCCESS)
+    m.color = glm::vec4(color.r, color.g, color.b, color.a);
+  float shininess;
+  if (material->Get(AI_MATKEY_SHININESS, shininess) == AI_SUCCESS && shininess > 0.0f)
+    m.shininess = shininess;
+  m.diffuseLayer = libraryTexture(material, aiTextureType_DIFFUSE, true);
+  m.specularLayer = libraryTexture(material, aiTextureType_SPECULAR, false);
+  // a texture multiplies the color, assimp reports black or grey for many textured OBJ materials
+  if (m.diffuseLayer >= 0)
+    m.color = glm::vec4(1.0f);
+  int result = library->add(m);
+  libraryMaterials[index] = result;
+  return result;
+}
+
+int Model::libraryTexture(aiMaterial *material, unsigned int textureType, bool srgb) {
+  aiTextureType type = (aiTextureType)textureType;
+  if (material->GetTextureCount(type) == 0)
+    return -1;
+  aiString str;
+  material->GetTexture(type, 0, &str);
+  return libraryTexture(str.C_Str(), srgb);
+}
+
+int Model::libraryTexture(const std::string &path, bool srgb) {
+  std::string filename = directory + '/' + path;
+  if (int layer = library->findTexture(filename); layer >= 0)
+    return layer;
+  int width, height, nrComponents;
+  unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 4);
+  if (!data) {
+    std::cout << "Texture failed to load at path: " << filename << std::endl;
+    return -1;
+  }
+  int layer = library->addTexture(filename, data, width, height, srgb);
+  stbi_image_free(data);
+  return layer;
+}
+
+std::vector<Texture> Model::loadMaterialTextures(aiMaterial *mat, unsigned int textureType, std::string typeName) {
+  aiTextureType type = (aiTextureType)textureType;
+  std::vector<Texture> textures;
+  for (unsigned int i = 0; i < mat->GetTextureCount(type); ++i) {
+    aiString str;
+    mat->GetTexture(type, i, &str);
+    textures.push_back(loadTexture(str.C_Str(), typeName));
+  }
+  return textures;
+}
+
+Texture Model::loadTexture(const std::string &path, const std::string &typeName) {
+  // check if texture was loaded before and if so, reuse it instead of loading a new texture
+  for (unsigned int j = 0; j < textures_loaded.size(); ++j) {
+    if (textures_loaded[j].path == path)
+      return textures_loaded[j];
+  }
+  Texture texture;
+  // diffuse maps are sRGB encoded and get gamma-correct mipmaps
+  bool gamma = typeName == "texture_diffuse";
+  if (streamer) {
+    texture.id = streamTexture(path, gamma);
+  } else {
+    texture.id = textureFromFile(path.c_str(), directory, gamma);
+    ownedTextures.emplace_back(texture.id);
+  }
+  texture.type = typeName;
+  texture.path = path;
+  textures_loaded.push_back(texture);
+  return texture;
+}
+
+unsigned int Model::streamTexture(const std::string &path, bool gamma) {
+  std::string filename = directory + '/' + path;
+  ktx2::Image image;
+  if (ktx2::read(filename.substr(0, filename.find_last_of('.')) + ".ktx2", image)) {
+    if (unsigned int id = streamer->add(std::move(image)); id != 0)
+      return id;
+  }
+  int width, height, nrComponents;
+  unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
+  if (!data) {
+    std::cout << "Texture failed to load at path: " << path << std::endl;
+    return 0;
+  }
+  unsigned int id = streamer->add(data, width, height, nrComponents, gamma);
+  stbi_image_free(data);
+  return id;
+}
+
+unsigned int textureFromFile(const char *path, const std::string &directory, bool gamma) {
+  std::string filename = std::string(path);
+  filename = directory + '/' + filename;
+
+  // prefer a copy baked offline by texbake, it sits next to the source image with a .ktx2 extension
+  std::string baked = filename.substr(0, filename.find_last_of('.')) + ".ktx2";
+  if (unsigned int id = ktx2::loadTexture(baked); id != 0)
+    return id;
+
+  int width, height, nrComponents;
+  unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
+  if (!data) {
+    std::cout << "Texture failed to load at path: " << path << std::endl;
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    vram::track(vram::Category::TEXTURE, textureID, 0, filename.c_str());
+    return textureID;
+  }
+  unsigned int textureID = textureFromPixels(data, width, height, nrComponents, gamma);
+  vram::track(vram::Category::TEXTURE, textureID, 0, filename.c_str());
+  stbi_image_free(data);
+  return textureID;
+}
+
+unsigned int textureFromPixels(const unsigned char *data, int width, int height, int nrComponents, bool gamma) {
+  unsigned int textureID;
+  glGenTextures(1, &textureID);
+
+  GLenum format;
+  if (nrComponents == 1)
+    format = GL_RED;
+  else if (nrComponents == 3)
+    format = GL_RGB;
+  else if (nrComponents == 4)
+    format = GL_RGBA;
+
+  // build the mip chain on the CPU, glGenerateMipmap averages in whatever space the data is in and its filter
+  // differs between drivers
+  auto levels = mipmap::generate(data, width, height, nrComponents,
+                                 gamma ? mipmap::ColorSpace::SRGB : mipmap::ColorSpace::LINEAR);
+  // the caller owns the texture, it is tracked so the leak report names it when nobody deletes it
+  vram::track(vram::Category::TEXTURE, textureID,
+              vram::textureBytes(nrComponents == 1 ? GL_R8 : GL_RGBA8, width, height, (int)levels.size()));
+  glBindTexture(GL_TEXTURE_2D, textureID);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // rows of RGB and single channel levels aren't 4 byte aligned
+  for (unsigned int level = 0; level < levels.size(); ++level) {
+    glTexImage2D(GL_TEXTURE_2D, level, format, width, height, 0, format, GL_UNSIGNED_BYTE, levels[level].data());
+    width = std::max(1, width / 2);
+    height = std::max(1, height / 2);
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  return textureID;
+}
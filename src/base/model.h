@@ -1,195 +1,140 @@
 #pragma once
 
-#include <iostream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
-#include <assimp/Importer.hpp>
-#include <assimp/postprocess.h>
-#include <assimp/scene.h>
-
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
+#include <glm/glm.hpp>
 
+#include <base/animation.h>
+#include <base/material.h>
 #include <base/mesh.h>
+#include <base/scene_graph.h>
 #include <base/shader.h>
+#include <base/texture_streamer.h>
+
+// assimp and stb only appear in model.cc, users of the model don't pay for parsing them
+struct aiMaterial;
+struct aiMesh;
+struct aiNode;
+struct aiScene;
 
 unsigned int textureFromFile(const char *path, const std::string &directory, bool gamma = false);
+unsigned int textureFromPixels(const unsigned char *data, int width, int height, int nrComponents, bool gamma);
 
 class Model {
 public:
-  Model(const char *path) { loadModel(path); }
-  void draw(Shader shader) {
+  // with a material library the textures become layers of its texture array and every mesh gets a material index
+  // instead of its own textures, draw such models with drawMaterials(). the library still has to be uploaded.
+  // with a streamer the plain textures start with their small mips only, see requestTextures(). OBJ files are parsed
+  // on the job system when one is given, the caller keeps it so loading several models doesn't start threads each time
+  Model(const char *path, MaterialLibrary *materials = nullptr, TextureStreamer *streamer = nullptr,
+        JobSystem *jobs = nullptr)
+      : library(materials), streamer(streamer), jobs(jobs) {
+    loadModel(path);
+  }
+  Model(const Model &) = delete;
+  Model &operator=(const Model &) = delete;
+  void draw(const Shader &shader) {
     for (unsigned int i = 0; i < meshes.size(); ++i) {
       meshes[i].draw(shader);
     }
   }
 
-private:
-  // model data
-  std::vector<Mesh> meshes;
-  std::string directory;
-
-  std::vector<Texture> textures_loaded;
-
-  // load a model from file and store the resulting meshes in the meshes vector
-  void loadModel(std::string path) {
-    Assimp::Importer importer;
-    const aiScene *scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
-    // check error
-    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-      std::cout << "error:assimp: " << importer.GetErrorString() << std::endl;
-      return;
+  // draw every mesh with the world transform of the node it hangs off, model is the transform of the whole model
+  void draw(const Shader &shader, const glm::mat4 &model) {
+    for (unsigned int i = 0; i < meshes.size(); ++i) {
+      shader.setMat4("model", model * nodes.getWorld(meshNodes[i]));
+      meshes[i].draw(shader);
     }
-    // retrieve the directory path of the filepath
-    directory = path.substr(0, path.find_last_of('/'));
-
-    // process root node recursively
-    processNode(scene->mRootNode, scene);
   }
 
-  void processNode(aiNode *node, const aiScene *scene) {
-    // process each mesh located at the current node
-    for (unsigned int i = 0; i < node->mNumMeshes; ++i) {
-      // the node object only contains indices to index the actual objects in the scene.
-      // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-      aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
-      meshes.push_back(processMesh(mesh, scene));
-    }
-
-    for (unsigned int i = 0; i < node->mNumChildren; ++i) {
-      processNode(node->mChildren[i], scene);
+  // draw every mesh with its material from the library, the library has to be bound to the shader. only an integer
+  // uniform changes between meshes. meshes the library has no material for get its default one
+  void drawMaterials(const Shader &shader, const glm::mat4 &model) {
+    for (unsigned int i = 0; i < meshes.size(); ++i) {
+      int material = meshes[i].getMaterial();
+      shader.setMat4("model", model * nodes.getWorld(meshNodes[i]));
+      shader.setInt("materialIndex", material >= 0 ? material : MaterialLibrary::DEFAULT_MATERIAL);
+      meshes[i].drawGeometry();
     }
   }
 
-  Mesh processMesh(aiMesh *mesh, const aiScene *scene) {
-    // data to fill
-    std::vector<Vertex> vertices;
-    std::vector<unsigned int> indices;
-    std::vector<Texture> textures;
-
-    // walk through each of the mesh's vertices
-    for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
-      glm::vec3 vector; // we declare a placeholder vector since assimp uses its own vector class that doesn't directly
-                        // convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
-      // positions
-      vector.x = mesh->mVertices[i].x;
-      vector.y = mesh->mVertices[i].y;
-      vector.z = mesh->mVertices[i].z;
-
-      Vertex vertex;
-      vertex.position = vector;
-
-      // normals
-      if (mesh->HasNormals()) {
-        vector.x = mesh->mNormals[i].x;
-        vector.y = mesh->mNormals[i].y;
-        vector.z = mesh->mNormals[i].z;
-        vertex.normal = vector;
-      }
-      // texture coordinates
-      vertex.texCoords = glm::vec2(0.0f, 0.0f);
-      if (mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
-      {
-        glm::vec2 vec;
-        // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't
-        // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
-        vec.x = mesh->mTextureCoords[0][i].x;
-        vec.y = mesh->mTextureCoords[0][i].y;
-        vertex.texCoords = vec;
-      }
-
-      vertices.push_back(vertex);
-    }
-    // wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex
-    // indices
-    for (unsigned int i = 0; i < mesh->mNumFaces; ++i) {
-      aiFace face = mesh->mFaces[i];
-      // retrieve all indices of the face and store them in the indices vector
-      for (unsigned int j = 0; j < face.mNumIndices; ++j) {
-        indices.push_back(face.mIndices[j]);
+  // tell the streamer the model was loaded with how big each mesh's textures appear, call it between its beginFrame()
+  // and update() with the transform the model is drawn with
+  void requestTextures(const glm::mat4 &model) {
+    if (!streamer)
+      return;
+    for (unsigned int i = 0; i < meshes.size(); ++i) {
+      AABB box = meshes[i].getBounds().transformed(model * nodes.getWorld(meshNodes[i]));
+      for (const auto &texture : meshes[i].getTextures()) {
+        streamer->request(texture.id, box);
       }
     }
-    // process materials
-    if (mesh->mMaterialIndex >= 0) {
-      aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
-      // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
-      // as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER.
-      // Same applies to other texture as the following list summarizes:
-      // diffuse: texture_diffuseN
-      // specular: texture_specularN
-      // normal: texture_normalN
-
-      // 1. diffuse maps
-      std::vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-      textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-      // 2. specular maps
-      std::vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-      textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-    }
-
-    // return a mesh object created from the extracted mesh data
-    return Mesh(vertices, indices, textures);
   }
 
-  std::vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, std::string typeName) {
-    std::vector<Texture> textures;
-    for (unsigned int i = 0; i < mat->GetTextureCount(type); ++i) {
-      aiString str;
-      mat->GetTexture(type, i, &str);
-      // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-      bool skip = false;
-      for (unsigned int j = 0; j < textures_loaded.size(); ++j) {
-        if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0) {
-          textures.push_back(textures_loaded[j]);
-          skip = true;
-          break;
-        }
-      }
-      if (!skip) {
-        Texture texture;
-        texture.id = textureFromFile(str.C_Str(), directory);
-        texture.type = typeName;
-        texture.path = str.C_Str();
-        textures.push_back(texture);
-      }
+  // like draw() but for shaders/skinning.vert: skinned meshes are already in model space after skinning, so they only
+  // get the model transform, the palette has to be bound and its offset set
+  void drawSkinned(const Shader &shader, const glm::mat4 &model) {
+    for (unsigned int i = 0; i < meshes.size(); ++i) {
+      shader.setMat4("model", meshes[i].isSkinned() ? model : model * nodes.getWorld(meshNodes[i]));
+      meshes[i].draw(shader);
     }
-    return textures;
   }
-};
 
-unsigned int textureFromFile(const char *path, const std::string &directory, bool gamma) {
-  std::string filename = std::string(path);
-  filename = directory + '/' + filename;
+  std::vector<Mesh> &getMeshes() { return meshes; }
+  // the imported node hierarchy, call update() on it after changing node transforms
+  SceneGraph &getNodes() { return nodes; }
+  // node the mesh with the same index belongs to
+  int getMeshNode(unsigned int mesh) const { return meshNodes[mesh]; }
+  // object space bounds of all meshes, placed by their node transforms at load time
+  const AABB &getBounds() const { return bounds; }
+  // the joints the skinned meshes are bound to, empty when the model has no bones
+  const animation::Skeleton &getSkeleton() const { return skeleton; }
+  // the model's animations, their channels address the skeleton's nodes
+  const std::vector<animation::Clip> &getClips() const { return clips; }
 
-  unsigned int textureID;
-  glGenTextures(1, &textureID);
-
-  int width, height, nrComponents;
-  unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-  if (data) {
-    GLenum format;
-    if (nrComponents == 1)
-      format = GL_RED;
-    else if (nrComponents == 3)
-      format = GL_RGB;
-    else if (nrComponents == 4)
-      format = GL_RGBA;
-
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+private:
+  // model data
+  std::vector<Mesh> meshes;
+  std::vector<int> meshNodes;
+  SceneGraph nodes;
+  std::string directory;
+  AABB bounds;
 
-    stbi_image_free(data);
-  } else {
-    std::cout << "Texture failed to load at path: " << path << std::endl;
-    stbi_image_free(data);
-  }
+  std::vector<Texture> textures_loaded;
+  // the plain textures among them, streamed ones belong to the streamer and library layers to the library
+  std::vector<GLTexture> ownedTextures;
+
+  MaterialLibrary *library;
+  TextureStreamer *streamer;
+  JobSystem *jobs;
+  // glTF buffer views and vertex arrays the meshes draw from
+  std::vector<GLBuffer> gpuBuffers;
+  std::vector<GLVertexArray> gpuVertexArrays;
+  // assimp material index -> library index
+  std::unordered_map<unsigned int, int> libraryMaterials;
+  animation::Skeleton skeleton;
+  std::vector<animation::Clip> clips;
+  // bone name -> joint index, while loading
+  std::unordered_map<std::string, int> jointIndices;
 
-  return textureID;
-}
+  // load a model from file and store the resulting meshes in the meshes vector
+  void loadModel(std::string path);
+  void collectJoints(const aiScene *scene);
+  // the skeleton mirrors the node graph, clips are resampled from ticks to seconds
+  void loadAnimations(const aiScene *scene);
+  bool loadObj(const std::string &path);
+  bool loadGltf(const std::string &path);
+  void updateBounds();
+  void processNode(aiNode *node, const aiScene *scene, int parent);
+  Mesh processMesh(aiMesh *mesh, const aiScene *scene);
+  int libraryMaterial(unsigned int index, const aiScene *scene);
+  // first texture of the type as a layer of the library's array, type is an aiTextureType
+  int libraryTexture(aiMaterial *material, unsigned int type, bool srgb);
+  int libraryTexture(const std::string &path, bool srgb);
+  std::vector<Texture> loadMaterialTextures(aiMaterial *mat, unsigned int type, std::string typeName);
+  Texture loadTexture(const std::string &path, const std::string &typeName);
+  // like textureFromFile() but handing the mip chain to the streamer
+  unsigned int streamTexture(const std::string &path, bool gamma);
+};
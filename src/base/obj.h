@@ -0,0 +1,497 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <base/job_system.h>
+#include <base/mapped_file.h>
+#include <base/mesh.h>
+
+// a Wavefront OBJ/MTL reader for the common case, filling Vertex and index arrays directly.
+//
+// the file is mapped and cut into chunks at line boundaries that are parsed in parallel, each into its own position,
+// texcoord, normal and face corner arrays. the chunks are then concatenated (negative indices are relative to the end
+// of the chunk so far and get rebased here), and every run of faces with the same object and material becomes a mesh
+// whose corners are welded into unique vertices, again one mesh per task. faces are triangulated as fans and texture
+// coordinates are flipped vertically, which is what Model asked assimp for.
+//
+// only polygons, objects/groups, usemtl and mtllib are understood, lines, points, smoothing groups, vertex colors and
+// free-form geometry are skipped. anything malformed makes load() fail so the caller can fall back to a general
+// importer.
+namespace obj {
+
+struct Material {
+  std::string name;
+  glm::vec3 diffuse = glm::vec3(1.0f);
+  float shininess = 32.0f;
+  // texture file names relative to the MTL file
+  std::string diffuseMap, specularMap, normalMap;
+};
+
+struct Mesh {
+  std::string name;
+  // index into Scene::materials or -1
+  int material = -1;
+  std::vector<Vertex> vertices;
+  std::vector<unsigned int> indices;
+};
+
+struct Scene {
+  std::vector<Mesh> meshes;
+  std::vector<Material> materials;
+};
+
+namespace detail {
+
+inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+inline const char *skipSpace(const char *p, const char *end) {
+  while (p < end && isSpace(*p)) {
+    ++p;
+  }
+  return p;
+}
+
+// the rest of the line without surrounding white space
+inline std::string restOfLine(const char *p, const char *end) {
+  p = skipSpace(p, end);
+  while (end > p && isSpace(end[-1])) {
+    --end;
+  }
+  return std::string(p, end);
+}
+
+// anything the fast path doesn't cover: inf, nan, hex floats, huge exponents. the mapped file isn't null terminated so
+// the token is copied first
+inline const char *parseFloatSlow(const char *p, const char *end, float &value) {
+  char token[64];
+  size_t n = 0;
+  while (p + n < end && n < sizeof(token) - 1 && !isSpace(p[n]) && p[n] != '\n' && p[n] != '/') {
+    token[n] = p[n];
+    ++n;
+  }
+  token[n] = 0;
+  char *stop;
+  value = std::strtof(token, &stop);
+  return stop == token ? nullptr : p + (stop - token);
+}
+
+} // namespace detail
+
+// decimal text to float without strtof's locale handling and generality: [sign] digits [. digits] [e [sign] digits]
+// with up to 19 significant digits and exponents small enough that the powers of ten are exact doubles, which is every
+// number exporters write. the result is within an ulp of strtof's. returns the end of the number or null if there is
+// none
+inline const char *parseFloat(const char *p, const char *end, float &value) {
+  static const double POWERS[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+  const char *start = p;
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    ++p;
+  }
+  uint64_t mantissa = 0;
+  int digits = 0, exponent = 0;
+  bool any = false;
+  for (; p < end && detail::isDigit(*p); ++p) {
+    any = true;
+    if (digits < 19) {
+      mantissa = mantissa * 10 + (*p - '0');
+      digits += mantissa != 0;
+    } else {
+      ++exponent;
+    }
+  }
+  if (p < end && *p == '.') {
+    for (++p; p < end && detail::isDigit(*p); ++p) {
+      any = true;
+      if (digits < 19) {
+        mantissa = mantissa * 10 + (*p - '0');
+        digits += mantissa != 0;
+        --exponent;
+      }
+    }
+  }
+  if (!any)
+    return detail::parseFloatSlow(start, end, value);
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    const char *q = p + 1;
+    bool negativeExponent = false;
+    if (q < end && (*q == '-' || *q == '+')) {
+      negativeExponent = *q == '-';
+      ++q;
+    }
+    if (q < end && detail::isDigit(*q)) {
+      int e = 0;
+      for (; q < end && detail::isDigit(*q); ++q) {
+        e = std::min(e * 10 + (*q - '0'), 10000);
+      }
+      exponent += negativeExponent ? -e : e;
+      p = q;
+    }
+  }
+  if (exponent < -22 || exponent > 22)
+    return detail::parseFloatSlow(start, end, value);
+  double d = (double)mantissa;
+  d = exponent < 0 ? d / POWERS[-exponent] : d * POWERS[exponent];
+  value = (float)(negative ? -d : d);
+  return p;
+}
+
+inline const char *parseInt(const char *p, const char *end, int &value) {
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    ++p;
+  }
+  if (p >= end || !detail::isDigit(*p))
+    return nullptr;
+  int v = 0;
+  for (; p < end && detail::isDigit(*p); ++p) {
+    v = v * 10 + (*p - '0');
+  }
+  value = negative ? -v : v;
+  return p;
+}
+
+// newmtl, Kd, Ns, map_Kd, map_Ks and map_Bump/bump/norm, the rest is ignored
+inline void parseMtl(const char *data, size_t size, std::vector<Material> &materials) {
+  const char *end = data + size;
+  for (const char *line = data; line < end;) {
+    const char *eol = static_cast<const char *>(std::memchr(line, '\n', end - line));
+    if (!eol)
+      eol = end;
+    const char *p = detail::skipSpace(line, eol);
+    const char *word = p;
+    while (p < eol && !detail::isSpace(*p)) {
+      ++p;
+    }
+    std::string keyword(word, p);
+    if (keyword == "newmtl") {
+      materials.emplace_back();
+      materials.back().name = detail::restOfLine(p, eol);
+    } else if (!materials.empty()) {
+      Material &m = materials.back();
+      if (keyword == "Kd") {
+        for (int i = 0; i < 3 && p; ++i) {
+          p = parseFloat(detail::skipSpace(p, eol), eol, m.diffuse[i]);
+        }
+      } else if (keyword == "Ns") {
+        parseFloat(detail::skipSpace(p, eol), eol, m.shininess);
+      } else if (keyword == "map_Kd") {
+        m.diffuseMap = detail::restOfLine(p, eol);
+      } else if (keyword == "map_Ks") {
+        m.specularMap = detail::restOfLine(p, eol);
+      } else if (keyword == "map_Bump" || keyword == "bump" || keyword == "norm") {
+        m.normalMap = detail::restOfLine(p, eol);
+      }
+    }
+    line = eol + 1;
+  }
+}
+
+namespace detail {
+
+// one face corner, indices are 0 based. relative ones count from the start of the chunk and can be negative
+struct Corner {
+  int index[3];
+  // bit per index: 1 present, 2 relative
+  uint8_t flags[3];
+};
+
+struct Event {
+  enum Kind { OBJECT, MATERIAL, LIBRARY };
+  // number of corners in the chunk before the event
+  size_t corner;
+  Kind kind;
+  std::string name;
+};
+
+struct Chunk {
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec2> texCoords;
+  std::vector<glm::vec3> normals;
+  std::vector<Corner> corners;
+  std::vector<Event> events;
+  bool error = false;
+};
+
+inline const char *parseCorner(const char *p, const char *end, const size_t counts[3], Corner &corner) {
+  for (int i = 0; i < 3; ++i) {
+    corner.flags[i] = 0;
+    corner.index[i] = 0;
+  }
+  for (int i = 0; i < 3; ++i) {
+    if (i > 0) {
+      if (p >= end || *p != '/')
+        break;
+      ++p;
+      // v//vn
+      if (p < end && *p == '/')
+        continue;
+    }
+    int value;
+    if (!(p = parseInt(p, end, value)) || value == 0)
+      return nullptr;
+    if (value > 0) {
+      corner.index[i] = value - 1;
+      corner.flags[i] = 1;
+    } else {
+      corner.index[i] = (int)counts[i] + value;
+      corner.flags[i] = 3;
+    }
+  }
+  return p;
+}
+
+inline void parseChunk(const char *begin, const char *end, Chunk &chunk) {
+  for (const char *line = begin; line < end && !chunk.error;) {
+    const char *eol = static_cast<const char *>(std::memchr(line, '\n', end - line));
+    if (!eol)
+      eol = end;
+    const char *p = skipSpace(line, eol);
+    line = eol + 1;
+    if (eol - p < 2)
+      continue;
+
+    if (p[0] == 'v' && isSpace(p[1])) {
+      glm::vec3 v;
+      p += 1;
+      for (int i = 0; i < 3 && p; ++i) {
+        p = parseFloat(skipSpace(p, eol), eol, v[i]);
+      }
+      chunk.error = !p;
+      chunk.positions.push_back(v);
+    } else if (p[0] == 'v' && p[1] == 't') {
+      glm::vec2 t(0.0f);
+      p = parseFloat(skipSpace(p + 2, eol), eol, t.x);
+      // a missing v is 0
+      if (p && skipSpace(p, eol) < eol)
+        p = parseFloat(skipSpace(p, eol), eol, t.y);
+      chunk.error = !p;
+      chunk.texCoords.emplace_back(t.x, 1.0f - t.y);
+    } else if (p[0] == 'v' && p[1] == 'n') {
+      glm::vec3 n;
+      p += 2;
+      for (int i = 0; i < 3 && p; ++i) {
+        p = parseFloat(skipSpace(p, eol), eol, n[i]);
+      }
+      chunk.error = !p;
+      chunk.normals.push_back(n);
+    } else if (p[0] == 'f' && isSpace(p[1])) {
+      size_t counts[3] = {chunk.positions.size(), chunk.texCoords.size(), chunk.normals.size()};
+      Corner first, previous, corner;
+      int n = 0;
+      for (p = skipSpace(p + 1, eol); p < eol; p = skipSpace(p, eol), ++n) {
+        if (!(p = parseCorner(p, eol, counts, corner))) {
+          chunk.error = true;
+          break;
+        }
+        if (n == 0) {
+          first = corner;
+        } else if (n >= 2) {
+          chunk.corners.push_back(first);
+          chunk.corners.push_back(previous);
+          chunk.corners.push_back(corner);
+        }
+        previous = corner;
+      }
+    } else if ((p[0] == 'o' || p[0] == 'g') && isSpace(p[1])) {
+      chunk.events.push_back({chunk.corners.size(), Event::OBJECT, restOfLine(p + 1, eol)});
+    } else if (eol - p > 6 && std::memcmp(p, "usemtl", 6) == 0 && isSpace(p[6])) {
+      chunk.events.push_back({chunk.corners.size(), Event::MATERIAL, restOfLine(p + 6, eol)});
+    } else if (eol - p > 6 && std::memcmp(p, "mtllib", 6) == 0 && isSpace(p[6])) {
+      chunk.events.push_back({chunk.corners.size(), Event::LIBRARY, restOfLine(p + 6, eol)});
+    }
+  }
+}
+
+// weld the corners of one mesh into unique vertices with an open addressing table keyed by the index triple
+inline void buildMesh(const Corner *corners, size_t count, const std::vector<glm::vec3> &positions,
+                      const std::vector<glm::vec2> &texCoords, const std::vector<glm::vec3> &normals, Mesh &mesh) {
+  size_t capacity = 16;
+  while (capacity < count * 2) {
+    capacity *= 2;
+  }
+  std::vector<int> table(capacity, -1);
+  std::vector<const Corner *> unique;
+  mesh.indices.resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    const Corner &c = corners[i];
+    size_t hash = ((size_t)c.index[0] * 73856093u) ^ ((size_t)c.index[1] * 19349663u) ^ ((size_t)c.index[2] * 83492791u);
+    size_t slot = hash & (capacity - 1);
+    while (table[slot] >= 0 && std::memcmp(unique[table[slot]]->index, c.index, sizeof(c.index)) != 0) {
+      slot = (slot + 1) & (capacity - 1);
+    }
+    if (table[slot] < 0) {
+      table[slot] = (int)unique.size();
+      unique.push_back(&c);
+    }
+    mesh.indices[i] = (unsigned int)table[slot];
+  }
+  mesh.vertices.resize(unique.size());
+  for (size_t i = 0; i < unique.size(); ++i) {
+    const Corner &c = *unique[i];
+    Vertex &v = mesh.vertices[i];
+    v.position = positions[c.index[0]];
+    v.texCoords = c.index[1] >= 0 ? texCoords[c.index[1]] : glm::vec2(0.0f);
+    v.normal = c.index[2] >= 0 ? normals[c.index[2]] : glm::vec3(0.0f);
+  }
+}
+
+} // namespace detail
+
+// parse OBJ text, mtllib files are looked up in directory. false if the file is malformed
+inline bool parse(const char *data, size_t size, const std::string &directory, Scene &scene,
+                  JobSystem *jobs = nullptr) {
+  using namespace detail;
+  // chunks of at least 256KB, a few per thread so uneven content still balances
+  const size_t MIN_CHUNK = 256 * 1024;
+  unsigned int threads = jobs ? jobs->threadCount() : 1;
+  size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threads * 4, size / MIN_CHUNK));
+  std::vector<const char *> bounds = {data};
+  for (size_t i = 1; i < chunkCount; ++i) {
+    const char *p = std::max(bounds.back(), data + size * i / chunkCount);
+    const char *eol = static_cast<const char *>(std::memchr(p, '\n', data + size - p));
+    bounds.push_back(eol ? eol + 1 : data + size);
+  }
+  bounds.push_back(data + size);
+
+  std::vector<Chunk> chunks(chunkCount);
+  auto forEachChunk = [&](const std::function<void(size_t)> &fn) {
+    if (!jobs) {
+      for (size_t i = 0; i < chunkCount; ++i) {
+        fn(i);
+      }
+      return;
+    }
+    jobs->parallelFor(chunkCount, 1, [&](size_t begin, size_t end, unsigned int) {
+      for (size_t i = begin; i < end; ++i) {
+        fn(i);
+      }
+    });
+  };
+  forEachChunk([&](size_t i) { parseChunk(bounds[i], bounds[i + 1], chunks[i]); });
+
+  // where every chunk's data starts in the concatenated arrays
+  std::vector<size_t> bases[4];
+  size_t totals[4] = {0, 0, 0, 0};
+  for (const auto &chunk : chunks) {
+    if (chunk.error)
+      return false;
+    size_t sizes[4] = {chunk.positions.size(), chunk.texCoords.size(), chunk.normals.size(), chunk.corners.size()};
+    for (int k = 0; k < 4; ++k) {
+      bases[k].push_back(totals[k]);
+      totals[k] += sizes[k];
+    }
+  }
+  std::vector<glm::vec3> positions(totals[0]);
+  std::vector<glm::vec2> texCoords(totals[1]);
+  std::vector<glm::vec3> normals(totals[2]);
+  std::vector<Corner> corners(totals[3]);
+  std::vector<char> invalid(chunkCount, 0);
+  forEachChunk([&](size_t i) {
+    Chunk &chunk = chunks[i];
+    std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + bases[0][i]);
+    std::copy(chunk.texCoords.begin(), chunk.texCoords.end(), texCoords.begin() + bases[1][i]);
+    std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + bases[2][i]);
+    for (size_t c = 0; c < chunk.corners.size(); ++c) {
+      Corner corner = chunk.corners[c];
+      for (int k = 0; k < 3; ++k) {
+        if (!(corner.flags[k] & 1)) {
+          corner.index[k] = -1;
+          continue;
+        }
+        if (corner.flags[k] & 2)
+          corner.index[k] += (int)bases[k][i];
+        invalid[i] |= corner.index[k] < 0 || (size_t)corner.index[k] >= totals[k];
+      }
+      corners[bases[3][i] + c] = corner;
+    }
+    // only the events are still needed
+    chunk.positions = {};
+    chunk.texCoords = {};
+    chunk.normals = {};
+    chunk.corners = {};
+  });
+  if (std::find(invalid.begin(), invalid.end(), 1) != invalid.end())
+    return false;
+
+  // split the corners into meshes at every object or material change
+  struct Range {
+    size_t begin, end;
+    std::string name, material;
+  };
+  std::vector<Range> ranges;
+  std::vector<std::string> libraries;
+  std::string object, material;
+  size_t start = 0;
+  auto close = [&](size_t end) {
+    if (end > start)
+      ranges.push_back({start, end, object, material});
+    start = end;
+  };
+  for (size_t i = 0; i < chunkCount; ++i) {
+    for (const auto &event : chunks[i].events) {
+      if (event.kind == Event::LIBRARY) {
+        libraries.push_back(event.name);
+        continue;
+      }
+      close(bases[3][i] + event.corner);
+      (event.kind == Event::OBJECT ? object : material) = event.name;
+    }
+  }
+  close(corners.size());
+
+  for (const auto &library : libraries) {
+    MappedFile file(directory + '/' + library);
+    if (file.valid())
+      parseMtl(file.data(), file.size(), scene.materials);
+  }
+  std::unordered_map<std::string, int> materialIndices;
+  for (size_t i = 0; i < scene.materials.size(); ++i) {
+    materialIndices.emplace(scene.materials[i].name, (int)i);
+  }
+
+  size_t first = scene.meshes.size();
+  scene.meshes.resize(first + ranges.size());
+  auto build = [&](size_t i) {
+    Mesh &mesh = scene.meshes[first + i];
+    mesh.name = ranges[i].name;
+    auto it = materialIndices.find(ranges[i].material);
+    mesh.material = it == materialIndices.end() ? -1 : it->second;
+    buildMesh(corners.data() + ranges[i].begin, ranges[i].end - ranges[i].begin, positions, texCoords, normals, mesh);
+  };
+  if (jobs) {
+    jobs->parallelFor(ranges.size(), 1, [&](size_t begin, size_t end, unsigned int) {
+      for (size_t i = begin; i < end; ++i) {
+        build(i);
+      }
+    });
+  } else {
+    for (size_t i = 0; i < ranges.size(); ++i) {
+      build(i);
+    }
+  }
+  return true;
+}
+
+inline bool load(const std::string &path, Scene &scene, JobSystem *jobs = nullptr) {
+  MappedFile file(path);
+  if (!file.valid())
+    return false;
+  size_t slash = path.find_last_of('/');
+  return parse(file.data(), file.size(), slash == std::string::npos ? "." : path.substr(0, slash), scene, jobs);
+}
+
+} // namespace obj
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <base/gl_resource.h>
+#include <base/shader.h>
+
+// weighted blended order independent transparency (McGuire and Bavoil).
+//
+// transparent surfaces are drawn in any order, without depth writes, into two targets: an RGBA16F accumulation of
+// their premultiplied colors and alphas scaled by a weight that falls off with distance, and an R8 revealage holding
+// the product of their (1 - alpha). the composite divides the accumulated color by the accumulated alpha and lays it
+// over the opaque image with 1 - revealage coverage. nothing has to be sorted, so transparent objects can be batched
+// and instanced like opaque ones, and intersecting surfaces blend per pixel instead of popping per object. the result
+// approximates the sorted one, it is exact for a single layer and close for layers of similar color.
+//
+// the transparent shaders write the two targets themselves, see shaders/transparent-oit.frag for the weight.
+class WeightedBlendedOIT {
+public:
+  WeightedBlendedOIT(int width, int height);
+  ~WeightedBlendedOIT();
+  WeightedBlendedOIT(const WeightedBlendedOIT &) = delete;
+  WeightedBlendedOIT &operator=(const WeightedBlendedOIT &) = delete;
+
+  void resize(int width, int height);
+
+  // bind and clear the targets for the transparent draws. depthTexture is the depth of the opaque pass, same size as
+  // this pass; it is tested against but not written. attachment is GL_DEPTH_STENCIL_ATTACHMENT for packed formats
+  void begin(GLuint depthTexture, GLenum attachment = GL_DEPTH_ATTACHMENT);
+  // restore the framebuffer, viewport, depth writes and blending begin() found. the blend function is restored with
+  // glBlendFunc, separate alpha factors are not kept
+  void end();
+  // blend the transparent layers over the currently bound framebuffer
+  void composite();
+
+private:
+  Shader compositeShader;
+  int width, height;
+  GLuint fbo = 0;
+  GLVertexArray vao;
+  GLTexture accumulation;
+  GLTexture revealage;
+  GLenum depthAttachment = GL_DEPTH_ATTACHMENT;
+  GLint previousFramebuffer = 0;
+  GLint previousViewport[4] = {};
+  GLint previousDepthMask = GL_TRUE;
+  GLboolean previousBlend = GL_FALSE;
+  GLint previousBlendSrc = GL_ONE, previousBlendDst = GL_ZERO;
+
+  void allocate();
+};
+
+inline WeightedBlendedOIT::WeightedBlendedOIT(int width, int height)
+    : compositeShader("shaders/fullscreen.vert", "shaders/oit-composite.frag"), width(width), height(height) {
+  glGenFramebuffers(1, &fbo);
+  // core profile needs a bound VAO even though the fullscreen triangle has no attributes
+  vao = GLVertexArray::create("oit");
+  allocate();
+}
+
+inline WeightedBlendedOIT::~WeightedBlendedOIT() { glDeleteFramebuffers(1, &fbo); }
+
+inline void WeightedBlendedOIT::resize(int w, int h) {
+  if (w == width && h == height)
+    return;
+  width = w;
+  height = h;
+  allocate();
+}
+
+inline void WeightedBlendedOIT::allocate() {
+  // replacing a handle deletes the previous target
+  auto target = [&](GLTexture &texture, const char *label, GLenum internalFormat, GLenum format, GLenum type) {
+    texture = GLTexture::create(label);
+    glBindTexture(GL_TEXTURE_2D, texture.get());
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+    texture.setBytes(vram::textureBytes(internalFormat, width, height));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  };
+  target(accumulation, "oit accumulation", GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT);
+  target(revealage, "oit revealage", GL_R8, GL_RED, GL_UNSIGNED_BYTE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, accumulation.get(), 0);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, revealage.get(), 0);
+  const GLenum drawBuffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+  glDrawBuffers(2, drawBuffers);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+inline void WeightedBlendedOIT::begin(GLuint depthTexture, GLenum attachment) {
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+  glGetIntegerv(GL_VIEWPORT, previousViewport);
+  glGetIntegerv(GL_DEPTH_WRITEMASK, &previousDepthMask);
+  previousBlend = glIsEnabled(GL_BLEND);
+  glGetIntegerv(GL_BLEND_SRC_RGB, &previousBlendSrc);
+  glGetIntegerv(GL_BLEND_DST_RGB, &previousBlendDst);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  if (attachment != depthAttachment)
+    glFramebufferTexture2D(GL_FRAMEBUFFER, depthAttachment, GL_TEXTURE_2D, 0, 0);
+  depthAttachment = attachment;
+  glFramebufferTexture2D(GL_FRAMEBUFFER, depthAttachment, GL_TEXTURE_2D, depthTexture, 0);
+  glViewport(0, 0, width, height);
+
+  const GLfloat zero[] = {0.0f, 0.0f, 0.0f, 0.0f};
+  const GLfloat one[] = {1.0f, 0.0f, 0.0f, 0.0f};
+  glClearBufferfv(GL_COLOR, 0, zero);
+  glClearBufferfv(GL_COLOR, 1, one);
+
+  // accumulation adds up, revealage multiplies by (1 - alpha)
+  glEnable(GL_BLEND);
+  glBlendFunci(0, GL_ONE, GL_ONE);
+  glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+  glDepthMask(GL_FALSE);
+}
+
+inline void WeightedBlendedOIT::end() {
+  glDepthMask((GLboolean)previousDepthMask);
+  if (!previousBlend)
+    glDisable(GL_BLEND);
+  // sets the function of every draw buffer, undoing the glBlendFunci calls
+  glBlendFunc(previousBlendSrc, previousBlendDst);
+  glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+  glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+}
+
+inline void WeightedBlendedOIT::composite() {
+  GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+  glDisable(GL_DEPTH_TEST);
+  // the shader outputs the average color with the revealage as alpha
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+
+  compositeShader.use();
+  compositeShader.setInt("accumulation", 0);
+  compositeShader.setInt("revealage", 1);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, accumulation.get());
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, revealage.get());
+  glBindVertexArray(vao.get());
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+  glBindVertexArray(0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  glBlendFunc(GL_ONE, GL_ZERO);
+  glDisable(GL_BLEND);
+  if (depthTest)
+    glEnable(GL_DEPTH_TEST);
+}
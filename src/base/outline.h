@@ -0,0 +1,143 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+
+#include <base/gl_resource.h>
+#include <base/shader.h>
+
+// screen space outlines for any number of selected objects.
+//
+// the scene pass writes a non-zero object id into an integer color attachment for every selected object. the id
+// buffer is turned into a distance field with the jump flood algorithm and every pixel outside the selection that lies
+// within `width` pixels of it is painted with the outline color. the cost depends on the resolution and the outline
+// width, not on the number or complexity of the selected objects.
+class Outline {
+public:
+  Outline(int width, int height);
+  ~Outline();
+  Outline(const Outline &) = delete;
+  Outline &operator=(const Outline &) = delete;
+
+  void resize(int width, int height);
+
+  // blend the outline into the currently bound framebuffer. objectIds is a GL_R32UI texture of the same size as this
+  // outline. depth and stencil test and the blend state are left as they were found
+  void draw(GLuint objectIds, const glm::vec3 &color, float width);
+
+private:
+  Shader seedShader;
+  Shader jfaShader;
+  Shader compositeShader;
+  int width, height;
+  GLuint fbo = 0;
+  GLVertexArray vao;
+  // ping-pong targets holding the nearest seed coordinate of every pixel
+  GLTexture seeds[2];
+
+  void allocate();
+};
+
+inline Outline::Outline(int width, int height)
+    : seedShader("shaders/fullscreen.vert", "shaders/outline-seed.frag"),
+      jfaShader("shaders/fullscreen.vert", "shaders/outline-jfa.frag"),
+      compositeShader("shaders/fullscreen.vert", "shaders/outline-composite.frag"), width(width), height(height) {
+  glGenFramebuffers(1, &fbo);
+  vao = GLVertexArray::create("outline");
+  allocate();
+}
+
+inline Outline::~Outline() { glDeleteFramebuffers(1, &fbo); }
+
+inline void Outline::resize(int w, int h) {
+  if (w == width && h == height)
+    return;
+  width = w;
+  height = h;
+  allocate();
+}
+
+inline void Outline::allocate() {
+  // replacing a handle deletes the previous target
+  for (GLTexture &texture : seeds) {
+    texture = GLTexture::create("outline seeds");
+    glBindTexture(GL_TEXTURE_2D, texture.get());
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16I, width, height, 0, GL_RG_INTEGER, GL_SHORT, nullptr);
+    texture.setBytes(vram::textureBytes(GL_RG16I, width, height));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+inline void Outline::draw(GLuint objectIds, const glm::vec3 &color, float outlineWidth) {
+  GLint target, viewport[4];
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+  GLboolean stencilTest = glIsEnabled(GL_STENCIL_TEST);
+  GLboolean blend = glIsEnabled(GL_BLEND);
+  GLint blendSrc, blendDst;
+  glGetIntegerv(GL_BLEND_SRC_RGB, &blendSrc);
+  glGetIntegerv(GL_BLEND_DST_RGB, &blendDst);
+  glDisable(GL_DEPTH_TEST);
+  glDisable(GL_STENCIL_TEST);
+
+  glBindVertexArray(vao.get());
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glViewport(0, 0, width, height);
+
+  // seed pass
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, objectIds);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, seeds[0].get(), 0);
+  seedShader.use();
+  seedShader.setInt("objectIds", 0);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+
+  // flood with halving step sizes, starting at the smallest power of two covering the outline width
+  jfaShader.use();
+  jfaShader.setInt("seeds", 0);
+  int src = 0;
+  int step = 1;
+  while (step < outlineWidth) {
+    step <<= 1;
+  }
+  for (; step >= 1; step >>= 1) {
+    glBindTexture(GL_TEXTURE_2D, seeds[src].get());
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, seeds[1 - src].get(), 0);
+    jfaShader.setInt("stepSize", step);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    src = 1 - src;
+  }
+
+  // composite into the caller's framebuffer
+  glBindFramebuffer(GL_FRAMEBUFFER, target);
+  glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  compositeShader.use();
+  compositeShader.setInt("objectIds", 0);
+  compositeShader.setInt("seeds", 1);
+  compositeShader.setVec3("color", color);
+  compositeShader.setFloat("width", outlineWidth);
+  glBindTexture(GL_TEXTURE_2D, objectIds);
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, seeds[src].get());
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glActiveTexture(GL_TEXTURE0);
+  // the caller's blending, like WeightedBlendedOIT::end() separate alpha factors are not kept
+  glBlendFunc(blendSrc, blendDst);
+  if (!blend)
+    glDisable(GL_BLEND);
+
+  glBindVertexArray(0);
+  if (depthTest)
+    glEnable(GL_DEPTH_TEST);
+  if (stencilTest)
+    glEnable(GL_STENCIL_TEST);
+}
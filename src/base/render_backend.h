@@ -0,0 +1,296 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <base/gl_resource.h>
+#include <base/shader.h>
+
+namespace soft {
+class Program;
+}
+
+// a thin render backend interface: buffers, textures, programs, fixed function state and draws. the GL backend maps
+// it onto the context one to one, the software backend (see base/soft_raster.h) renders the same calls on the CPU so
+// scenes written against the interface run, and can be regression tested, without a GPU.
+namespace render {
+
+using Handle = uint32_t;
+
+enum class CompareFunc { NEVER, LESS, EQUAL, LEQUAL, GREATER, NOTEQUAL, GEQUAL, ALWAYS };
+enum class StencilOp { KEEP, ZERO, REPLACE, INCR, DECR, INVERT };
+enum class CullMode { NONE, BACK, FRONT };
+
+struct DepthStencilState {
+  bool depthTest = true;
+  bool depthWrite = true;
+  CompareFunc depthFunc = CompareFunc::LESS;
+
+  bool stencilTest = false;
+  CompareFunc stencilFunc = CompareFunc::ALWAYS;
+  uint8_t stencilRef = 0;
+  uint8_t stencilReadMask = 0xff;
+  uint8_t stencilWriteMask = 0xff;
+  // stencil fails, stencil passes but depth fails, both pass
+  StencilOp stencilFail = StencilOp::KEEP;
+  StencilOp depthFail = StencilOp::KEEP;
+  StencilOp depthPass = StencilOp::KEEP;
+};
+
+// float attributes interleaved in one vertex buffer
+struct VertexLayout {
+  static const int MAX_ATTRIBUTES = 8;
+  struct Attribute {
+    int location;
+    int components;
+    uint32_t offset;
+  };
+
+  uint32_t stride = 0;
+  Attribute attributes[MAX_ATTRIBUTES];
+  int count = 0;
+
+  VertexLayout &add(int location, int components, uint32_t offset) {
+    attributes[count++] = {location, components, offset};
+    return *this;
+  }
+};
+
+struct Draw {
+  Handle program = 0;
+  Handle vertexBuffer = 0;
+  VertexLayout layout;
+  // 32 bit indices, 0 draws the vertices in order
+  Handle indexBuffer = 0;
+  uint32_t first = 0;
+  uint32_t count = 0;
+  Handle textures[4] = {};
+  DepthStencilState depthStencil;
+  CullMode cull = CullMode::NONE;
+  bool colorWrite = true;
+};
+
+// a program has a GLSL implementation for the GL backend and a C++ port for the software backend, a backend uses
+// the half it understands
+struct ProgramDesc {
+  const char *vertexPath = nullptr;
+  const char *fragmentPath = nullptr;
+  std::shared_ptr<soft::Program> software;
+};
+
+class Backend {
+public:
+  virtual ~Backend() = default;
+
+  virtual const char *name() const = 0;
+
+  virtual Handle createBuffer(const void *data, size_t bytes) = 0;
+  // tightly packed RGBA8 texels, bottom row first like glTexImage2D
+  virtual Handle createTexture(int width, int height, const uint8_t *rgba) = 0;
+  virtual Handle createProgram(const ProgramDesc &desc) = 0;
+  virtual void destroyBuffer(Handle buffer) = 0;
+  virtual void destroyTexture(Handle texture) = 0;
+  virtual void destroyProgram(Handle program) = 0;
+
+  virtual void setUniform(Handle program, const std::string &name, const glm::mat4 &value) = 0;
+  virtual void setUniform(Handle program, const std::string &name, const glm::vec4 &value) = 0;
+  virtual void setUniform(Handle program, const std::string &name, const glm::vec3 &value) = 0;
+  virtual void setUniform(Handle program, const std::string &name, float value) = 0;
+  virtual void setUniform(Handle program, const std::string &name, int value) = 0;
+
+  // size of the render target, the viewport always covers all of it
+  virtual void resize(int width, int height) = 0;
+  virtual void clear(const glm::vec4 &color, float depth = 1.0f, uint8_t stencil = 0) = 0;
+  virtual void draw(const Draw &draw) = 0;
+  // wait until everything submitted so far has been rendered
+  virtual void finish() = 0;
+  // RGBA8 pixels of the render target, bottom row first like glReadPixels
+  virtual void readPixels(std::vector<uint8_t> &rgba) = 0;
+};
+
+// renders into the framebuffer bound when the backend was created, the context must be current
+class GLBackend : public Backend {
+public:
+  GLBackend();
+
+  const char *name() const override { return "gl"; }
+
+  Handle createBuffer(const void *data, size_t bytes) override;
+  Handle createTexture(int width, int height, const uint8_t *rgba) override;
+  Handle createProgram(const ProgramDesc &desc) override;
+  void destroyBuffer(Handle buffer) override {
+    vram::untrack(vram::Category::BUFFER, buffer);
+    glDeleteBuffers(1, &buffer);
+  }
+  void destroyTexture(Handle texture) override {
+    vram::untrack(vram::Category::TEXTURE, texture);
+    glDeleteTextures(1, &texture);
+  }
+  void destroyProgram(Handle program) override;
+
+  void setUniform(Handle program, const std::string &name, const glm::mat4 &value) override {
+    glProgramUniformMatrix4fv(program, location(program, name), 1, GL_FALSE, &value[0][0]);
+  }
+  void setUniform(Handle program, const std::string &name, const glm::vec4 &value) override {
+    glProgramUniform4fv(program, location(program, name), 1, &value[0]);
+  }
+  void setUniform(Handle program, const std::string &name, const glm::vec3 &value) override {
+    glProgramUniform3fv(program, location(program, name), 1, &value[0]);
+  }
+  void setUniform(Handle program, const std::string &name, float value) override {
+    glProgramUniform1f(program, location(program, name), value);
+  }
+  void setUniform(Handle program, const std::string &name, int value) override {
+    glProgramUniform1i(program, location(program, name), value);
+  }
+
+  void resize(int width, int height) override {
+    this->width = width;
+    this->height = height;
+    glViewport(0, 0, width, height);
+  }
+  void clear(const glm::vec4 &color, float depth, uint8_t stencil) override;
+  void draw(const Draw &draw) override;
+  void finish() override { glFinish(); }
+  void readPixels(std::vector<uint8_t> &rgba) override;
+
+private:
+  // programs keep their Shader so it is deleted with the program
+  std::vector<std::unique_ptr<Shader>> programs;
+  GLVertexArray vao;
+  int width = 0, height = 0;
+
+  GLint location(Handle program, const std::string &name) const {
+    return glGetUniformLocation(program, name.c_str());
+  }
+};
+
+namespace detail {
+
+inline GLenum toGL(CompareFunc func) {
+  static const GLenum funcs[] = {GL_NEVER, GL_LESS, GL_EQUAL, GL_LEQUAL, GL_GREATER, GL_NOTEQUAL, GL_GEQUAL, GL_ALWAYS};
+  return funcs[(int)func];
+}
+
+inline GLenum toGL(StencilOp op) {
+  static const GLenum ops[] = {GL_KEEP, GL_ZERO, GL_REPLACE, GL_INCR, GL_DECR, GL_INVERT};
+  return ops[(int)op];
+}
+
+} // namespace detail
+
+inline GLBackend::GLBackend() : vao(GLVertexArray::create("gl backend")) {}
+
+inline Handle GLBackend::createBuffer(const void *data, size_t bytes) {
+  GLuint buffer;
+  glGenBuffers(1, &buffer);
+  glBindBuffer(GL_ARRAY_BUFFER, buffer);
+  glBufferData(GL_ARRAY_BUFFER, bytes, data, GL_STATIC_DRAW);
+  vram::track(vram::Category::BUFFER, buffer, bytes, "backend buffer");
+  return buffer;
+}
+
+inline Handle GLBackend::createTexture(int width, int height, const uint8_t *rgba) {
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+  // bilinear without mipmaps, which is what the software sampler does
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  vram::track(vram::Category::TEXTURE, texture, vram::textureBytes(GL_RGBA8, width, height), "backend texture");
+  return texture;
+}
+
+inline Handle GLBackend::createProgram(const ProgramDesc &desc) {
+  programs.push_back(std::make_unique<Shader>(desc.vertexPath, desc.fragmentPath));
+  return programs.back()->get_id();
+}
+
+inline void GLBackend::destroyProgram(Handle program) {
+  for (auto it = programs.begin(); it != programs.end(); ++it) {
+    if ((*it)->get_id() == program) {
+      programs.erase(it);
+      return;
+    }
+  }
+}
+
+inline void GLBackend::clear(const glm::vec4 &color, float depth, uint8_t stencil) {
+  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  glDepthMask(GL_TRUE);
+  glStencilMask(0xff);
+  glClearColor(color.r, color.g, color.b, color.a);
+  glClearDepth(depth);
+  glClearStencil(stencil);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+}
+
+inline void GLBackend::draw(const Draw &d) {
+  const DepthStencilState &ds = d.depthStencil;
+  if (ds.depthTest) {
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(detail::toGL(ds.depthFunc));
+  } else {
+    glDisable(GL_DEPTH_TEST);
+  }
+  glDepthMask(ds.depthWrite ? GL_TRUE : GL_FALSE);
+  if (ds.stencilTest) {
+    glEnable(GL_STENCIL_TEST);
+    glStencilFunc(detail::toGL(ds.stencilFunc), ds.stencilRef, ds.stencilReadMask);
+    glStencilOp(detail::toGL(ds.stencilFail), detail::toGL(ds.depthFail),
+                detail::toGL(ds.depthPass));
+    glStencilMask(ds.stencilWriteMask);
+  } else {
+    glDisable(GL_STENCIL_TEST);
+  }
+  if (d.cull == CullMode::NONE) {
+    glDisable(GL_CULL_FACE);
+  } else {
+    glEnable(GL_CULL_FACE);
+    glCullFace(d.cull == CullMode::BACK ? GL_BACK : GL_FRONT);
+  }
+  GLboolean color = d.colorWrite ? GL_TRUE : GL_FALSE;
+  glColorMask(color, color, color, color);
+
+  for (int i = 0; i < 4; ++i) {
+    glActiveTexture(GL_TEXTURE0 + i);
+    glBindTexture(GL_TEXTURE_2D, d.textures[i]);
+  }
+  glUseProgram(d.program);
+
+  // GL 4.1 has no separate vertex buffer bindings, so one VAO is respecified for every draw
+  glBindVertexArray(vao.get());
+  glBindBuffer(GL_ARRAY_BUFFER, d.vertexBuffer);
+  for (GLuint i = 0; i < (GLuint)VertexLayout::MAX_ATTRIBUTES; ++i) {
+    glDisableVertexAttribArray(i);
+  }
+  for (int i = 0; i < d.layout.count; ++i) {
+    const auto &a = d.layout.attributes[i];
+    glEnableVertexAttribArray(a.location);
+    glVertexAttribPointer(a.location, a.components, GL_FLOAT, GL_FALSE, d.layout.stride, (void *)(uintptr_t)a.offset);
+  }
+  if (d.indexBuffer) {
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, d.indexBuffer);
+    glDrawElements(GL_TRIANGLES, d.count, GL_UNSIGNED_INT, (void *)(uintptr_t)(d.first * sizeof(uint32_t)));
+  } else {
+    glDrawArrays(GL_TRIANGLES, d.first, d.count);
+  }
+  glBindVertexArray(0);
+}
+
+inline void GLBackend::readPixels(std::vector<uint8_t> &rgba) {
+  rgba.resize((size_t)width * height * 4);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+}
+
+} // namespace render
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <base/job_system.h>
+
+// a transform hierarchy stored as flat arrays instead of a tree of node objects.
+//
+// nodes live in depth first order: a parent always comes before its children and every subtree occupies the contiguous
+// range [i, subtreeEnd(i)). world matrices can therefore be updated in one forward sweep, and disjoint subtrees are
+// disjoint index ranges that can be handed to different threads. setting a local transform only marks the node dirty,
+// update() recomputes the world matrices of dirty nodes and their descendants and leaves the rest of the cache alone.
+class SceneGraph {
+public:
+  struct Stats {
+    // world matrices recomputed by the last update
+    size_t updated = 0;
+    // ranges the last update was split into
+    size_t tasks = 0;
+  };
+
+  // nodes have to be added in depth first order, i.e. parent is either -1 for a new root or a node whose subtree is the
+  // last one in the graph. returns the index of the new node or -1 if that doesn't hold
+  int addNode(int parent, const glm::vec3 &position = glm::vec3(0.0f),
+              const glm::quat &rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), const glm::vec3 &scale = glm::vec3(1.0f),
+              const std::string &name = "");
+
+  size_t size() const { return parents.size(); }
+  int getParent(int node) const { return parents[node]; }
+  int subtreeEnd(int node) const { return ends[node]; }
+  const std::string &getName(int node) const { return names[node]; }
+  // first node with the given name or -1
+  int find(const std::string &name) const;
+
+  const glm::vec3 &getPosition(int node) const { return positions[node]; }
+  const glm::quat &getRotation(int node) const { return rotations[node]; }
+  const glm::vec3 &getScale(int node) const { return scales[node]; }
+  void setPosition(int node, const glm::vec3 &position) {
+    positions[node] = position;
+    markDirty(node);
+  }
+  void setRotation(int node, const glm::quat &rotation) {
+    rotations[node] = rotation;
+    markDirty(node);
+  }
+  void setScale(int node, const glm::vec3 &scale) {
+    scales[node] = scale;
+    markDirty(node);
+  }
+  void setLocal(int node, const glm::vec3 &position, const glm::quat &rotation, const glm::vec3 &scale) {
+    positions[node] = position;
+    rotations[node] = rotation;
+    scales[node] = scale;
+    markDirty(node);
+  }
+
+  // world matrix as of the last update()
+  const glm::mat4 &getWorld(int node) const { return worlds[node]; }
+  const std::vector<glm::mat4> &getWorlds() const { return worlds; }
+
+  // recompute the world matrices of dirty subtrees, spread over the job system's threads when given one
+  void update(JobSystem *jobs = nullptr);
+
+  const Stats &getStats() const { return stats; }
+
+  static glm::mat4 compose(const glm::vec3 &t, const glm::quat &r, const glm::vec3 &s);
+
+private:
+  void markDirty(int node) {
+    dirty[node] = 1;
+    anyDirty = true;
+  }
+  // forward sweep over [begin, end), the parents of begin must be up to date. returns the number of nodes updated
+  size_t updateRange(size_t begin, size_t end);
+  // split the graph into subtrees small enough to balance across threads
+  void buildTasks(unsigned int threads);
+
+  std::vector<int> parents;
+  std::vector<int> ends;
+  std::vector<std::string> names;
+  // local transforms
+  std::vector<glm::vec3> positions;
+  std::vector<glm::quat> rotations;
+  std::vector<glm::vec3> scales;
+  // world matrix cache
+  std::vector<glm::mat4> worlds;
+  // set by the setters, also set during update on every node that was recomputed so children see it
+  std::vector<unsigned char> dirty;
+  bool anyDirty = false;
+
+  // nodes updated on the calling thread before the tasks run and the subtree ranges handed to the workers
+  std::vector<int> serialNodes;
+  std::vector<std::pair<int, int>> tasks;
+  unsigned int taskThreads = 0;
+
+  Stats stats;
+};
+
+inline int SceneGraph::addNode(int parent, const glm::vec3 &position, const glm::quat &rotation,
+                               const glm::vec3 &scale, const std::string &name) {
+  int node = (int)parents.size();
+  if (parent >= node || (parent >= 0 && ends[parent] != node))
+    return -1;
+
+  parents.push_back(parent);
+  ends.push_back(node + 1);
+  names.push_back(name);
+  positions.push_back(position);
+  rotations.push_back(rotation);
+  scales.push_back(scale);
+  worlds.push_back(glm::mat4(1.0f));
+  dirty.push_back(1);
+  anyDirty = true;
+  // the new node extends the subtree of every ancestor
+  for (int p = parent; p >= 0; p = parents[p]) {
+    ends[p] = node + 1;
+  }
+  // the task split depends on the shape of the graph
+  taskThreads = 0;
+  return node;
+}
+
+inline int SceneGraph::find(const std::string &name) const {
+  auto it = std::find(names.begin(), names.end(), name);
+  return it == names.end() ? -1 : (int)(it - names.begin());
+}
+
+inline glm::mat4 SceneGraph::compose(const glm::vec3 &t, const glm::quat &r, const glm::vec3 &s) {
+  // translate * rotate * scale written out, much cheaper than multiplying three matrices
+  float xx = r.x * r.x, yy = r.y * r.y, zz = r.z * r.z;
+  float xy = r.x * r.y, xz = r.x * r.z, yz = r.y * r.z;
+  float wx = r.w * r.x, wy = r.w * r.y, wz = r.w * r.z;
+  glm::mat4 m;
+  m[0] = glm::vec4((1.0f - 2.0f * (yy + zz)) * s.x, 2.0f * (xy + wz) * s.x, 2.0f * (xz - wy) * s.x, 0.0f);
+  m[1] = glm::vec4(2.0f * (xy - wz) * s.y, (1.0f - 2.0f * (xx + zz)) * s.y, 2.0f * (yz + wx) * s.y, 0.0f);
+  m[2] = glm::vec4(2.0f * (xz + wy) * s.z, 2.0f * (yz - wx) * s.z, (1.0f - 2.0f * (xx + yy)) * s.z, 0.0f);
+  m[3] = glm::vec4(t, 1.0f);
+  return m;
+}
+
+inline size_t SceneGraph::updateRange(size_t begin, size_t end) {
+  size_t updated = 0;
+  for (size_t i = begin; i < end; ++i) {
+    int parent = parents[i];
+    if (!dirty[i] && (parent < 0 || !dirty[parent]))
+      continue;
+    glm::mat4 local = compose(positions[i], rotations[i], scales[i]);
+    worlds[i] = parent < 0 ? local : worlds[parent] * local;
+    dirty[i] = 1;
+    ++updated;
+  }
+  return updated;
+}
+
+inline void SceneGraph::buildTasks(unsigned int threads) {
+  serialNodes.clear();
+  tasks.clear();
+  taskThreads = threads;
+  // a few tasks per thread so uneven subtrees still balance
+  int limit = std::max<int>(1024, (int)(size() / (threads * 8)));
+
+  // walk down from the roots: small subtrees become tasks, the nodes above them are updated serially
+  std::vector<int> stack;
+  for (int root = 0; root < (int)size(); root = ends[root]) {
+    stack.push_back(root);
+  }
+  std::reverse(stack.begin(), stack.end());
+  while (!stack.empty()) {
+    int node = stack.back();
+    stack.pop_back();
+    if (ends[node] - node <= limit) {
+      tasks.emplace_back(node, ends[node]);
+      continue;
+    }
+    serialNodes.push_back(node);
+    std::vector<int> children;
+    for (int child = node + 1; child < ends[node]; child = ends[child]) {
+      children.push_back(child);
+    }
+    stack.insert(stack.end(), children.rbegin(), children.rend());
+  }
+  // serial nodes were visited parent first, keep them sorted so that still holds
+  std::sort(serialNodes.begin(), serialNodes.end());
+}
+
+inline void SceneGraph::update(JobSystem *jobs) {
+  stats = Stats();
+  if (!anyDirty)
+    return;
+
+  if (!jobs || jobs->threadCount() == 1) {
+    stats.updated = updateRange(0, size());
+    stats.tasks = 1;
+  } else {
+    if (taskThreads != jobs->threadCount())
+      buildTasks(jobs->threadCount());
+    for (int node : serialNodes) {
+      stats.updated += updateRange(node, node + 1);
+    }
+    std::vector<size_t> counts(jobs->threadCount(), 0);
+    jobs->parallelFor(tasks.size(), 1, [&](size_t begin, size_t end, unsigned int thread) {
+      size_t updated = 0;
+      for (size_t t = begin; t < end; ++t) {
+        updated += updateRange(tasks[t].first, tasks[t].second);
+      }
+      counts[thread] += updated;
+    });
+    for (size_t c : counts) {
+      stats.updated += c;
+    }
+    stats.tasks = tasks.size();
+  }
+
+  std::memset(dirty.data(), 0, dirty.size());
+  anyDirty = false;
+}
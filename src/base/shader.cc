@@ -0,0 +1,88 @@
+#include <base/shader.h>
+
+Shader::Shader(const GLchar *vertexPath, const GLchar *fragmentPath, const GLchar *geometryPath) {
+  try {
+    // 1 retrieve the vertex/fragment source code from file path
+
+    std::ifstream vShaderFile;
+    std::ifstream fShaderFile;
+
+    // open files
+    vShaderFile.open(vertexPath);
+    fShaderFile.open(fragmentPath);
+
+    // read file's buffer contents into streams
+    std::stringstream vShaderStream, fShaderStream;
+    vShaderStream << vShaderFile.rdbuf();
+    fShaderStream << fShaderFile.rdbuf();
+
+    // close file handlers
+    vShaderFile.close();
+    fShaderFile.close();
+
+    // convert stream into string
+    std::string vertexCode = vShaderStream.str();
+    std::string fragmentCode = fShaderStream.str();
+
+    // 2 compile shaders
+    // vertex shader
+    GLuint vertex = glad_glCreateShader(GL_VERTEX_SHADER);
+    const char *vShaderCode = vertexCode.c_str();
+    glad_glShaderSource(vertex, 1, &vShaderCode, nullptr);
+    glad_glCompileShader(vertex);
+    checkError(vertex, "VERTEX");
+    // fragment shader
+    GLuint fragment = glad_glCreateShader(GL_FRAGMENT_SHADER);
+    const char *fShaderCode = fragmentCode.c_str();
+    glad_glShaderSource(fragment, 1, &fShaderCode, nullptr);
+    glad_glCompileShader(fragment);
+    checkError(fragment, "FRAGMENT");
+    // geometry shader
+    GLuint geometry = 0;
+    if (geometryPath) {
+      std::ifstream gShaderFile(geometryPath);
+      std::stringstream gShaderStream;
+      gShaderStream << gShaderFile.rdbuf();
+      std::string geometryCode = gShaderStream.str();
+      const char *gShaderCode = geometryCode.c_str();
+      geometry = glad_glCreateShader(GL_GEOMETRY_SHADER);
+      glad_glShaderSource(geometry, 1, &gShaderCode, nullptr);
+      glad_glCompileShader(geometry);
+      checkError(geometry, "GEOMETRY");
+    }
+    // link shaders
+    // named after the fragment stage in the leak report, usually the more specific of the two
+    program = GLProgram(glad_glCreateProgram(), 0, fragmentPath);
+    GLuint id = program.get();
+    glad_glAttachShader(id, vertex);
+    glad_glAttachShader(id, fragment);
+    if (geometry)
+      glad_glAttachShader(id, geometry);
+    glad_glLinkProgram(id);
+    checkError(id, "PROGRAM");
+    // delete the shaders as they're linked into our program now and no longer
+    // necessary
+    glad_glDeleteShader(vertex);
+    glad_glDeleteShader(fragment);
+    if (geometry)
+      glad_glDeleteShader(geometry);
+  } catch (std::ifstream::failure &e) {
+    std::cerr << "read shader file error: " << e.what() << std::endl;
+  }
+}
+
+void Shader::checkError(unsigned int shader, std::string type) {
+  GLint success;
+  char infolog[1024];
+  if (type != "PROGRAM") {
+    if (glad_glGetShaderiv(shader, GL_COMPILE_STATUS, &success); !success) {
+      glad_glGetShaderInfoLog(shader, 1024, nullptr, infolog);
+      std::cerr << type << ": compile shader error: " << infolog << std::endl;
+    }
+  } else {
+    if (glad_glGetProgramiv(shader, GL_LINK_STATUS, &success); !success) {
+      glad_glGetProgramInfoLog(shader, 1024, nullptr, infolog);
+      std::cerr << "link program error: " << infolog << std::endl;
+    }
+  }
+}
@@ -2,113 +2,56 @@
 
 #include <fstream>
 #include <glad/glad.h>
+#include <glm/glm.hpp>
 #include <iostream>
 #include <sstream>
 #include <string>
 
+#include <base/gl_resource.h>
+
 class Shader {
 private:
-  GLuint id;
+  // move-only, a copy deleting the program of the original can't happen
+  GLProgram program;
   // utility function for checking shader compilation/linking errors
   void checkError(unsigned int shader, std::string type);
 
 public:
-  // constructor generates the shader on the fly
-  Shader(const GLchar *vertexPath, const GLchar *fragmentPath);
-  ~Shader() { glad_glDeleteProgram(id); };
-  GLuint get_id() const { return id; };
-  void use() { glad_glUseProgram(id); }
+  // constructor generates the shader on the fly, the geometry stage is optional
+  Shader(const GLchar *vertexPath, const GLchar *fragmentPath, const GLchar *geometryPath = nullptr);
+  GLuint get_id() const { return program.get(); };
+  void use() { glad_glUseProgram(program.get()); }
   // utility uniform functions
   void setBool(const std::string &name, bool value) const {
-    glad_glUniform1i(glad_glGetUniformLocation(id, name.c_str()), (int)value);
+    glad_glUniform1i(glad_glGetUniformLocation(program.get(), name.c_str()), (int)value);
   }
   void setInt(const std::string &name, int value) const {
-    glad_glUniform1i(glad_glGetUniformLocation(id, name.c_str()), value);
+    glad_glUniform1i(glad_glGetUniformLocation(program.get(), name.c_str()), value);
+  }
+  void setUint(const std::string &name, unsigned int value) const {
+    glad_glUniform1ui(glad_glGetUniformLocation(program.get(), name.c_str()), value);
   }
   void setFloat(const std::string &name, float value) const {
-    glad_glUniform1f(glad_glGetUniformLocation(id, name.c_str()), value);
+    glad_glUniform1f(glad_glGetUniformLocation(program.get(), name.c_str()), value);
   }
 
   void setVec3(const std::string &name, const glm::vec3 vec) const {
-	GLint loc = glad_glGetUniformLocation(id, name.c_str());
+	GLint loc = glad_glGetUniformLocation(program.get(), name.c_str());
     glad_glUniform3fv(loc, 1, &vec[0]);
   }
   
   void setVec3(const std::string &name, const float x, const float y, const float z) const {
-    GLint loc = glad_glGetUniformLocation(id, name.c_str());
+    GLint loc = glad_glGetUniformLocation(program.get(), name.c_str());
     glad_glUniform3f(loc, x, y, z);
   }
 
+  void setVec4(const std::string &name, const glm::vec4 &vec) const {
+    GLint loc = glad_glGetUniformLocation(program.get(), name.c_str());
+    glad_glUniform4fv(loc, 1, &vec[0]);
+  }
+
   void setMat4(const std::string &name, const glm::mat4 &mat) const {
-    GLint loc = glad_glGetUniformLocation(id, name.c_str());
+    GLint loc = glad_glGetUniformLocation(program.get(), name.c_str());
     glad_glUniformMatrix4fv(loc, 1, GL_FALSE, &mat[0][0]);
   }
 };
-
-Shader::Shader(const GLchar *vertexPath, const GLchar *fragmentPath) {
-  try {
-    // 1 retrieve the vertex/fragment source code from file path
-
-    std::ifstream vShaderFile;
-    std::ifstream fShaderFile;
-
-    // open files
-    vShaderFile.open(vertexPath);
-    fShaderFile.open(fragmentPath);
-
-    // read file's buffer contents into streams
-    std::stringstream vShaderStream, fShaderStream;
-    vShaderStream << vShaderFile.rdbuf();
-    fShaderStream << fShaderFile.rdbuf();
-
-    // close file handlers
-    vShaderFile.close();
-    fShaderFile.close();
-
-    // convert stream into string
-    std::string vertexCode = vShaderStream.str();
-    std::string fragmentCode = fShaderStream.str();
-
-    // 2 compile shaders
-    // vertex shader
-    GLuint vertex = glad_glCreateShader(GL_VERTEX_SHADER);
-    const char *vShaderCode = vertexCode.c_str();
-    glad_glShaderSource(vertex, 1, &vShaderCode, nullptr);
-    glad_glCompileShader(vertex);
-    checkError(vertex, "VERTEX");
-    // fragment shader
-    GLuint fragment = glad_glCreateShader(GL_FRAGMENT_SHADER);
-    const char *fShaderCode = fragmentCode.c_str();
-    glad_glShaderSource(fragment, 1, &fShaderCode, nullptr);
-    glad_glCompileShader(fragment);
-    checkError(fragment, "FRAGMENT");
-    // link shaders
-    id = glad_glCreateProgram();
-    glad_glAttachShader(id, vertex);
-    glad_glAttachShader(id, fragment);
-    glad_glLinkProgram(id);
-    checkError(id, "PROGRAM");
-    // delete the shaders as they're linked into our program now and no longer
-    // necessary
-    glad_glDeleteShader(vertex);
-    glad_glDeleteShader(fragment);
-  } catch (std::ifstream::failure &e) {
-    std::cerr << "read shader file error: " << e.what() << std::endl;
-  }
-}
-
-void Shader::checkError(unsigned int shader, std::string type) {
-  GLint success;
-  char infolog[1024];
-  if (type != "PROGRAM") {
-    if (glad_glGetShaderiv(shader, GL_COMPILE_STATUS, &success); !success) {
-      glad_glGetShaderInfoLog(shader, 1024, nullptr, infolog);
-      std::cerr << type << ": compile shader error: " << infolog << std::endl;
-    }
-  } else {
-    if (glad_glGetProgramiv(shader, GL_LINK_STATUS, &success); !success) {
-      glad_glGetProgramInfoLog(shader, 1024, nullptr, infolog);
-      std::cerr << "link program error: " << infolog << std::endl;
-    }
-  }
-}
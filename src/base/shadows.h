@@ -0,0 +1,349 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include <base/bounds.h>
+#include <base/gl_resource.h>
+#include <base/gpu_timer.h>
+#include <base/shader.h>
+
+// cascaded shadow maps for a directional light.
+//
+// the view frustum is cut into slices with the practical split scheme and every slice is enclosed in a sphere. the
+// sphere keeps the size of a shadow texel constant while the camera turns, and its center is snapped to whole texels
+// in light space so the shadows don't shimmer while the camera moves. all cascades live in the layers of one depth
+// texture array and are drawn in a single pass: a geometry shader with one invocation per cascade routes every
+// triangle to the layers whose bit is set in the caster's cascade mask.
+//
+// the far cascades are cached. they cover a padded sphere and only follow the camera once the slice leaves it, so they
+// are re-rendered when the camera moved far enough, the light changed or invalidate() was called after static
+// geometry changed. cached cascades hold static casters only, dynamic casters are drawn into the near cascades.
+class CascadedShadowMap {
+public:
+  static const int MAX_CASCADES = 4;
+
+  struct Settings {
+    int cascades = 4;
+    int resolution = 2048;
+    // shadows end at this view distance
+    float maxDistance = 50.0f;
+    // blend between logarithmic (1) and uniform (0) split distances
+    float splitLambda = 0.75f;
+    // number of far cascades that are cached
+    int cachedCascades = 2;
+    // cached cascades cover this much more than their slice
+    float cachePadding = 0.25f;
+    // casters up to this far in front of a cascade (towards the light) are kept at full depth precision, the rest is
+    // clamped to the near plane
+    float casterDistance = 10.0f;
+    // draw all cascades with one geometry shader pass, otherwise every cascade gets its own pass and timer
+    bool instanced = true;
+  };
+
+  struct CascadeStats {
+    float splitFar = 0.0f;
+    unsigned int draws = 0;
+    bool cached = false;
+    // rendered this frame rather than reused
+    bool rendered = false;
+    // GPU time of the cascade, a share of the pass time weighted by draws when the cascades are drawn together
+    double gpuMs = 0.0;
+  };
+
+  struct Stats {
+    int cascades = 0;
+    CascadeStats cascade[MAX_CASCADES];
+    unsigned int passes = 0;
+    unsigned int draws = 0;
+    double gpuMs = 0.0;
+    // cached cascades reused instead of rendered, since creation
+    size_t cacheHits = 0;
+  };
+
+  CascadedShadowMap();
+  explicit CascadedShadowMap(const Settings &settings);
+  ~CascadedShadowMap();
+  CascadedShadowMap(const CascadedShadowMap &) = delete;
+  CascadedShadowMap &operator=(const CascadedShadowMap &) = delete;
+
+  // fit the cascades to the camera. fovy is in radians, lightDir points from the light into the scene.
+  void update(const glm::mat4 &view, float fovy, float aspect, float near, const glm::vec3 &lightDir);
+
+  // static casters moved, re-render the cached cascades
+  void invalidate() { dirty = allMask(); }
+
+  // render the cascades that need it. draw(shader) is called once per pass and submits the casters: call
+  // beginCaster() before every draw and skip the draw when it returns false. the depth shader takes either the `model`
+  // uniform or per instance model matrices at locations 3-6 when the `instanced` uniform is set.
+  template <typename DrawFn> void render(DrawFn &&draw);
+
+  // select the cascades a caster with the given world bounds is drawn into. false if there are none.
+  bool beginCaster(const AABB &worldBox, bool isStatic = true);
+
+  // bind the shadow map and the cascade uniforms of the lighting shader, which must be in use
+  void bind(Shader &shader, int unit) const;
+
+  GLuint getTexture() const { return texture.get(); }
+  const Stats &getStats() const { return stats; }
+
+private:
+  struct Cascade {
+    glm::mat4 viewProj = glm::mat4(1.0f);
+    // frustum for culling casters, without a near plane since everything towards the light casts
+    Frustum casters;
+    // the sphere the cascade was fitted to, before snapping
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+    float texel = 0.0f;
+    float splitFar = 0.0f;
+  };
+
+  Settings settings;
+  Shader depthShader;
+  GLTexture texture;
+  GLuint fbo = 0;
+  // one framebuffer per layer so the layers can be cleared one at a time
+  GLuint layerFbos[MAX_CASCADES] = {};
+  Cascade cascades[MAX_CASCADES];
+  glm::vec3 lightDir = glm::vec3(0.0f);
+  glm::mat4 lightView = glm::mat4(1.0f);
+  // cascades to draw into this frame, those with cached contents that must be re-rendered, and those of the pass
+  // being drawn
+  unsigned int renderMask = 0;
+  unsigned int dirty = 0;
+  unsigned int passMask = 0;
+  int lastMask = -1;
+  GpuTimer timers[MAX_CASCADES + 1];
+  Stats stats;
+
+  unsigned int allMask() const { return (1u << settings.cascades) - 1; }
+  unsigned int cachedMask() const {
+    return allMask() & ~((1u << (settings.cascades - settings.cachedCascades)) - 1);
+  }
+  void fit(Cascade &cascade, const glm::vec3 &center, float radius);
+};
+
+inline CascadedShadowMap::CascadedShadowMap() : CascadedShadowMap(Settings()) {}
+
+inline CascadedShadowMap::CascadedShadowMap(const Settings &s)
+    : settings(s), depthShader("shaders/shadow-depth.vert", "shaders/shadow-depth.frag", "shaders/shadow-depth.geom") {
+  settings.cascades = std::clamp(settings.cascades, 1, MAX_CASCADES);
+  settings.cachedCascades = std::clamp(settings.cachedCascades, 0, settings.cascades - 1);
+  dirty = allMask();
+
+  texture = GLTexture::create("shadow cascades");
+  glBindTexture(GL_TEXTURE_2D_ARRAY, texture.get());
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, settings.resolution, settings.resolution,
+               settings.cascades, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+  texture.setBytes(
+      vram::textureBytes(GL_DEPTH_COMPONENT32F, settings.resolution, settings.resolution, 1, settings.cascades));
+  // hardware depth comparison, linear filtering gives 2x2 PCF for free
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+  glGenFramebuffers(1, &fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture.get(), 0);
+  glDrawBuffer(GL_NONE);
+  glReadBuffer(GL_NONE);
+  glGenFramebuffers(settings.cascades, layerFbos);
+  for (int i = 0; i < settings.cascades; ++i) {
+    glBindFramebuffer(GL_FRAMEBUFFER, layerFbos[i]);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture.get(), 0, i);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+inline CascadedShadowMap::~CascadedShadowMap() {
+  glDeleteFramebuffers(settings.cascades, layerFbos);
+  glDeleteFramebuffers(1, &fbo);
+}
+
+inline void CascadedShadowMap::fit(Cascade &cascade, const glm::vec3 &center, float radius) {
+  cascade.center = center;
+  cascade.radius = radius;
+  cascade.texel = 2.0f * radius / settings.resolution;
+  // move the light space center in whole texels, the rasterized depth then only changes where the scene does
+  glm::vec3 c = glm::vec3(lightView * glm::vec4(center, 1.0f));
+  c.x = std::floor(c.x / cascade.texel) * cascade.texel;
+  c.y = std::floor(c.y / cascade.texel) * cascade.texel;
+  glm::mat4 projection =
+      glm::ortho(c.x - radius, c.x + radius, c.y - radius, c.y + radius, -c.z - radius - settings.casterDistance,
+                 -c.z + radius);
+  cascade.viewProj = projection * lightView;
+  cascade.casters = Frustum(cascade.viewProj);
+  cascade.casters.setPlane(4, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+inline void CascadedShadowMap::update(const glm::mat4 &view, float fovy, float aspect, float near,
+                                      const glm::vec3 &direction) {
+  glm::vec3 dir = glm::normalize(direction);
+  if (glm::dot(dir, lightDir) < 0.99999f) {
+    lightDir = dir;
+    glm::vec3 up = std::abs(dir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    lightView = glm::lookAt(glm::vec3(0.0f), dir, up);
+    dirty = allMask();
+  }
+
+  // camera position and forward axis straight from the rows of the view matrix
+  glm::vec3 eye = -(glm::transpose(glm::mat3(view)) * glm::vec3(view[3]));
+  glm::vec3 forward = -glm::vec3(view[0][2], view[1][2], view[2][2]);
+  float ty = std::tan(fovy * 0.5f), tx = ty * aspect;
+  float k2 = tx * tx + ty * ty;
+
+  float far = settings.maxDistance;
+  float splitNear = near;
+  unsigned int cached = cachedMask();
+  renderMask = allMask() & ~cached;
+  for (int i = 0; i < settings.cascades; ++i) {
+    float t = float(i + 1) / settings.cascades;
+    float logSplit = near * std::pow(far / near, t);
+    float uniformSplit = near + (far - near) * t;
+    float splitFar = settings.splitLambda * logSplit + (1.0f - settings.splitLambda) * uniformSplit;
+
+    // smallest sphere around the slice: its center is equally far from the near and far corners, unless the slice is
+    // so wide that the far face alone decides
+    float z = std::min(0.5f * (splitNear + splitFar) * (1.0f + k2), splitFar);
+    float radius = std::sqrt((splitFar - z) * (splitFar - z) + splitFar * splitFar * k2);
+    glm::vec3 center = eye + forward * z;
+    Cascade &cascade = cascades[i];
+    cascade.splitFar = splitFar;
+    splitNear = splitFar;
+
+    if (!(cached & (1u << i))) {
+      fit(cascade, center, radius);
+      continue;
+    }
+    float padded = radius * (1.0f + settings.cachePadding);
+    bool moved = glm::length(center - cascade.center) > padded - radius;
+    if ((dirty & (1u << i)) || moved || std::abs(cascade.radius - padded) > 1e-4f * padded) {
+      fit(cascade, center, padded);
+      dirty |= 1u << i;
+    }
+  }
+  renderMask |= dirty;
+}
+
+inline bool CascadedShadowMap::beginCaster(const AABB &worldBox, bool isStatic) {
+  unsigned int mask = passMask & (isStatic ? ~0u : ~cachedMask());
+  for (int i = 0; i < settings.cascades; ++i) {
+    if ((mask & (1u << i)) && !cascades[i].casters.intersects(worldBox))
+      mask &= ~(1u << i);
+  }
+  if (!mask)
+    return false;
+  for (int i = 0; i < settings.cascades; ++i) {
+    if (mask & (1u << i))
+      stats.cascade[i].draws++;
+  }
+  stats.draws++;
+  if ((int)mask != lastMask) {
+    depthShader.setInt("cascadeMask", (int)mask);
+    lastMask = (int)mask;
+  }
+  return true;
+}
+
+template <typename DrawFn> void CascadedShadowMap::render(DrawFn &&draw) {
+  stats.cascades = settings.cascades;
+  stats.passes = 0;
+  stats.draws = 0;
+  stats.gpuMs = 0.0;
+  for (int i = 0; i < settings.cascades; ++i) {
+    CascadeStats &cs = stats.cascade[i];
+    bool cached = cachedMask() & (1u << i);
+    cs = CascadeStats();
+    cs.splitFar = cascades[i].splitFar;
+    cs.cached = cached;
+    cs.rendered = renderMask & (1u << i);
+    if (cached && !cs.rendered)
+      stats.cacheHits++;
+  }
+  if (!renderMask)
+    return;
+
+  GLint target, viewport[4];
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  glViewport(0, 0, settings.resolution, settings.resolution);
+  glEnable(GL_DEPTH_TEST);
+  glDepthMask(GL_TRUE);
+  for (int i = 0; i < settings.cascades; ++i) {
+    if (renderMask & (1u << i)) {
+      glBindFramebuffer(GL_FRAMEBUFFER, layerFbos[i]);
+      glClear(GL_DEPTH_BUFFER_BIT);
+    }
+  }
+
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  // casters in front of the near plane are flattened onto it instead of clipped, and the slope scaled offset keeps
+  // lit surfaces from shadowing themselves
+  glEnable(GL_DEPTH_CLAMP);
+  glEnable(GL_POLYGON_OFFSET_FILL);
+  glPolygonOffset(1.5f, 2.0f);
+  depthShader.use();
+  for (int i = 0; i < settings.cascades; ++i)
+    depthShader.setMat4("lightViewProj[" + std::to_string(i) + "]", cascades[i].viewProj);
+  lastMask = -1;
+
+  if (settings.instanced) {
+    passMask = renderMask;
+    timers[MAX_CASCADES].begin();
+    draw(depthShader);
+    timers[MAX_CASCADES].end();
+    stats.passes = 1;
+    stats.gpuMs = timers[MAX_CASCADES].getMs();
+    // one pass for all cascades, split its time by the draws every cascade received
+    unsigned int draws = 0;
+    for (int i = 0; i < settings.cascades; ++i)
+      draws += stats.cascade[i].draws;
+    for (int i = 0; draws && i < settings.cascades; ++i)
+      stats.cascade[i].gpuMs = stats.gpuMs * stats.cascade[i].draws / draws;
+  } else {
+    for (int i = 0; i < settings.cascades; ++i) {
+      if (!(renderMask & (1u << i)))
+        continue;
+      passMask = 1u << i;
+      timers[i].begin();
+      draw(depthShader);
+      timers[i].end();
+      stats.passes++;
+      stats.cascade[i].gpuMs = timers[i].getMs();
+      stats.gpuMs += stats.cascade[i].gpuMs;
+    }
+  }
+  passMask = 0;
+  dirty = 0;
+
+  glDisable(GL_POLYGON_OFFSET_FILL);
+  glDisable(GL_DEPTH_CLAMP);
+  glBindFramebuffer(GL_FRAMEBUFFER, target);
+  glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+inline void CascadedShadowMap::bind(Shader &shader, int unit) const {
+  glActiveTexture(GL_TEXTURE0 + unit);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, texture.get());
+  shader.setInt("shadowMap", unit);
+  shader.setInt("cascadeCount", settings.cascades);
+  for (int i = 0; i < settings.cascades; ++i) {
+    std::string index = "[" + std::to_string(i) + "]";
+    shader.setFloat("cascadeSplits" + index, cascades[i].splitFar);
+    shader.setFloat("cascadeTexels" + index, cascades[i].texel);
+    shader.setMat4("lightViewProj" + index, cascades[i].viewProj);
+  }
+}
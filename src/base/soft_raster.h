@@ -0,0 +1,724 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <base/job_system.h>
+#include <base/render_backend.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define SOFT_X86 1
+#endif
+
+// a tile based software rasterizer behind the render::Backend interface.
+//
+// draws are queued rather than rendered on the spot. every draw runs its vertex shader over all of its vertices in
+// parallel, then its triangles are clipped against the near plane, culled, set up as edge and interpolation planes
+// and binned into the 64x64 tiles they overlap. the queue is flushed when a result is needed (readPixels, finish,
+// clear) or when a uniform the fragment shader of a queued program reads changes: every tile is then rasterized by one thread, walking its
+// triangles in submission order so depth, stencil and color writes land exactly as the draws were issued. coverage
+// and the depth test are evaluated for 4 pixels of a row at once with SSE2, the fragment shader runs for every
+// pixel that survives them.
+//
+// shaders are C++ ports of the GLSL programs (see base/soft_shaders.h): a vertex and a fragment functor plus the
+// uniforms they read, registered under their GLSL names so the same setUniform() calls drive both backends.
+namespace soft {
+
+const int MAX_VARYINGS = 16;
+const int TILE_SIZE = 64;
+
+// RGBA8 texels, bottom row first, sampled bilinearly with repeat wrapping
+struct Texture {
+  int width = 0, height = 0;
+  std::vector<uint32_t> texels;
+
+  glm::vec4 fetch(int x, int y) const {
+    x = ((x % width) + width) % width;
+    y = ((y % height) + height) % height;
+    uint32_t t = texels[(size_t)y * width + x];
+    return glm::vec4(t & 0xff, (t >> 8) & 0xff, (t >> 16) & 0xff, t >> 24) * (1.0f / 255.0f);
+  }
+
+  glm::vec4 sample(const glm::vec2 &uv) const {
+    float x = uv.x * width - 0.5f, y = uv.y * height - 0.5f;
+    float fx = std::floor(x), fy = std::floor(y);
+    int x0 = (int)fx, y0 = (int)fy;
+    float tx = x - fx, ty = y - fy;
+    glm::vec4 bottom = glm::mix(fetch(x0, y0), fetch(x0 + 1, y0), tx);
+    glm::vec4 top = glm::mix(fetch(x0, y0 + 1), fetch(x0 + 1, y0 + 1), tx);
+    return glm::mix(bottom, top, ty);
+  }
+};
+
+// what a fragment shader gets besides its varyings
+struct FragmentContext {
+  const Texture *textures[4];
+  // window space x, y and depth of the pixel center and 1 / w, like gl_FragCoord
+  glm::vec4 fragCoord;
+};
+
+// a program ported to C++. vertex() reads the attributes by location and writes `varyings` floats, fragment() gets
+// them back perspective correct and returns false to discard.
+class Program {
+public:
+  virtual ~Program() = default;
+
+  virtual glm::vec4 vertex(const float *const *attributes, float *varyings) const = 0;
+  virtual bool fragment(const float *varyings, const FragmentContext &context, glm::vec4 &color) const = 0;
+
+  int getVaryings() const { return varyings; }
+  // whether fragment() can return false. programs that can't get the stencil test before shading, like early fragment
+  // tests in GL, the others are shaded first so a discarded fragment leaves the stencil buffer alone
+  bool canDiscard() const { return discards; }
+
+  // draws run their vertex shader when they are queued, only uniforms read by fragment() have to wait for them
+  bool readByFragment(const std::string &name) const {
+    auto it = uniforms.find(name);
+    return it != uniforms.end() && it->second.fragment;
+  }
+
+  // false if the program has no uniform of that name, like a location of -1 in GL
+  bool set(const std::string &name, const float *value, int count) {
+    auto it = uniforms.find(name);
+    if (it == uniforms.end() || it->second.integer)
+      return false;
+    std::memcpy(it->second.value, value, sizeof(float) * std::min(count, it->second.count));
+    return true;
+  }
+  bool set(const std::string &name, int value) {
+    auto it = uniforms.find(name);
+    if (it == uniforms.end() || !it->second.integer)
+      return false;
+    *(int *)it->second.value = value;
+    return true;
+  }
+
+protected:
+  int varyings = 0;
+  bool discards = true;
+
+  // register a member under its GLSL name, fragment tells whether fragment() reads it
+  void uniform(const std::string &name, glm::mat4 &value, bool fragment) {
+    uniforms[name] = {&value[0][0], 16, false, fragment};
+  }
+  void uniform(const std::string &name, glm::vec4 &value, bool fragment) {
+    uniforms[name] = {&value[0], 4, false, fragment};
+  }
+  void uniform(const std::string &name, glm::vec3 &value, bool fragment) {
+    uniforms[name] = {&value[0], 3, false, fragment};
+  }
+  void uniform(const std::string &name, float &value, bool fragment) { uniforms[name] = {&value, 1, false, fragment}; }
+  void uniform(const std::string &name, int &value, bool fragment) { uniforms[name] = {&value, 1, true, fragment}; }
+
+private:
+  struct Slot {
+    void *value;
+    int count;
+    bool integer;
+    bool fragment;
+  };
+  std::unordered_map<std::string, Slot> uniforms;
+
+  friend class Rasterizer;
+  // the program has draws waiting in the queue
+  bool queued = false;
+};
+
+class Rasterizer : public render::Backend {
+public:
+  struct Stats {
+    size_t draws = 0;
+    size_t triangles = 0;
+    // rejected by culling or because they were completely outside the view, and split by the near plane
+    size_t culled = 0;
+    size_t clipped = 0;
+    // triangle references in the tile bins, how often a triangle is visited by a tile
+    size_t binned = 0;
+    size_t fragments = 0;
+    size_t flushes = 0;
+  };
+
+  // threads counts the calling thread, 0 picks one per hardware thread
+  explicit Rasterizer(unsigned int threads = 0) : jobs(threads) {}
+
+  const char *name() const override { return "software"; }
+  unsigned int threadCount() const { return jobs.threadCount(); }
+
+  render::Handle createBuffer(const void *data, size_t bytes) override;
+  render::Handle createTexture(int width, int height, const uint8_t *rgba) override;
+  render::Handle createProgram(const render::ProgramDesc &desc) override;
+  void destroyBuffer(render::Handle buffer) override;
+  void destroyTexture(render::Handle texture) override;
+  void destroyProgram(render::Handle program) override;
+
+  void setUniform(render::Handle program, const std::string &name, const glm::mat4 &value) override {
+    setFloats(program, name, &value[0][0], 16);
+  }
+  void setUniform(render::Handle program, const std::string &name, const glm::vec4 &value) override {
+    setFloats(program, name, &value[0], 4);
+  }
+  void setUniform(render::Handle program, const std::string &name, const glm::vec3 &value) override {
+    setFloats(program, name, &value[0], 3);
+  }
+  void setUniform(render::Handle program, const std::string &name, float value) override {
+    setFloats(program, name, &value, 1);
+  }
+  void setUniform(render::Handle program, const std::string &name, int value) override;
+
+  void resize(int width, int height) override;
+  void clear(const glm::vec4 &color, float depth, uint8_t stencil) override;
+  void draw(const render::Draw &draw) override;
+  void finish() override { flush(); }
+  void readPixels(std::vector<uint8_t> &rgba) override;
+
+  const Stats &getStats() const { return stats; }
+  void resetStats() { stats = Stats(); }
+
+private:
+  // everything a tile needs to know about the draw a triangle came from
+  struct DrawState {
+    render::DepthStencilState depthStencil;
+    bool colorWrite;
+    const Program *program;
+    const Texture *textures[4];
+  };
+
+  // a triangle ready for rasterization. edge functions and interpolation planes are relative to the first vertex so
+  // large window coordinates don't eat the precision of the fractions
+  struct Triangle {
+    float ox, oy;
+    // edge i is a[i] * x + b[i] * y + c[i], positive inside
+    float a[3], b[3], c[3];
+    // ties on an edge only count when it is a top or left edge
+    bool topLeft[3];
+    // planes for depth, 1 / w and the varyings divided by w: value = x * dx + y * dy + base
+    float dx[MAX_VARYINGS + 2], dy[MAX_VARYINGS + 2], base[MAX_VARYINGS + 2];
+    int minX, minY, maxX, maxY;
+    uint32_t draw;
+  };
+
+  // a vertex after the vertex shader: clip position followed by the varyings
+  struct ClipVertex {
+    glm::vec4 position;
+    float varyings[MAX_VARYINGS];
+  };
+
+  JobSystem jobs;
+  Stats stats;
+  render::Handle nextHandle = 1;
+  std::unordered_map<render::Handle, std::vector<uint8_t>> buffers;
+  std::unordered_map<render::Handle, Texture> textures;
+  std::unordered_map<render::Handle, std::shared_ptr<Program>> programs;
+
+  int width = 0, height = 0;
+  // rows are padded to whole tiles so 4 wide loads never leave a row
+  int pitch = 0, tilesX = 0, tilesY = 0;
+  std::vector<uint32_t> color;
+  std::vector<float> depth;
+  std::vector<uint8_t> stencil;
+
+  // the queue
+  std::vector<DrawState> draws;
+  std::vector<Triangle> triangles;
+  std::vector<std::vector<uint32_t>> bins;
+  std::vector<ClipVertex> shaded;
+  // fragments shaded by the tile jobs of the current flush
+  std::atomic<size_t> shadedFragments{0};
+
+  void setFloats(render::Handle program, const std::string &name, const float *value, int count);
+  void flush();
+  void setupTriangle(const ClipVertex *v[3], int varyings, render::CullMode cull, uint32_t draw);
+  void rasterTile(size_t tile);
+};
+
+namespace detail {
+
+inline bool compare(render::CompareFunc func, float a, float b) {
+  switch (func) {
+  case render::CompareFunc::NEVER:
+    return false;
+  case render::CompareFunc::LESS:
+    return a < b;
+  case render::CompareFunc::EQUAL:
+    return a == b;
+  case render::CompareFunc::LEQUAL:
+    return a <= b;
+  case render::CompareFunc::GREATER:
+    return a > b;
+  case render::CompareFunc::NOTEQUAL:
+    return a != b;
+  case render::CompareFunc::GEQUAL:
+    return a >= b;
+  default:
+    return true;
+  }
+}
+
+inline uint8_t stencilOp(render::StencilOp op, uint8_t value, uint8_t ref) {
+  switch (op) {
+  case render::StencilOp::ZERO:
+    return 0;
+  case render::StencilOp::REPLACE:
+    return ref;
+  case render::StencilOp::INCR:
+    return value == 0xff ? value : value + 1;
+  case render::StencilOp::DECR:
+    return value == 0 ? value : value - 1;
+  case render::StencilOp::INVERT:
+    return ~value;
+  default:
+    return value;
+  }
+}
+
+inline uint32_t packColor(const glm::vec4 &c) {
+  glm::vec4 v = glm::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f;
+  return (uint32_t)v.r | ((uint32_t)v.g << 8) | ((uint32_t)v.b << 16) | ((uint32_t)v.a << 24);
+}
+
+#if SOFT_X86
+// bit i set where lane i passes the depth comparison
+inline int compareMask(render::CompareFunc func, __m128 a, __m128 b) {
+  switch (func) {
+  case render::CompareFunc::NEVER:
+    return 0;
+  case render::CompareFunc::LESS:
+    return _mm_movemask_ps(_mm_cmplt_ps(a, b));
+  case render::CompareFunc::EQUAL:
+    return _mm_movemask_ps(_mm_cmpeq_ps(a, b));
+  case render::CompareFunc::LEQUAL:
+    return _mm_movemask_ps(_mm_cmple_ps(a, b));
+  case render::CompareFunc::GREATER:
+    return _mm_movemask_ps(_mm_cmpgt_ps(a, b));
+  case render::CompareFunc::NOTEQUAL:
+    return _mm_movemask_ps(_mm_cmpneq_ps(a, b));
+  case render::CompareFunc::GEQUAL:
+    return _mm_movemask_ps(_mm_cmpge_ps(a, b));
+  default:
+    return 0xf;
+  }
+}
+#endif
+
+} // namespace detail
+
+inline render::Handle Rasterizer::createBuffer(const void *data, size_t bytes) {
+  render::Handle handle = nextHandle++;
+  auto &buffer = buffers[handle];
+  buffer.resize(bytes);
+  if (data)
+    std::memcpy(buffer.data(), data, bytes);
+  return handle;
+}
+
+inline render::Handle Rasterizer::createTexture(int w, int h, const uint8_t *rgba) {
+  render::Handle handle = nextHandle++;
+  Texture &texture = textures[handle];
+  texture.width = w;
+  texture.height = h;
+  texture.texels.resize((size_t)w * h);
+  std::memcpy(texture.texels.data(), rgba, texture.texels.size() * 4);
+  return handle;
+}
+
+inline render::Handle Rasterizer::createProgram(const render::ProgramDesc &desc) {
+  render::Handle handle = nextHandle++;
+  programs[handle] = desc.software;
+  return handle;
+}
+
+// resources still referenced by queued draws are rendered before they go away
+inline void Rasterizer::destroyBuffer(render::Handle buffer) { buffers.erase(buffer); }
+
+inline void Rasterizer::destroyTexture(render::Handle texture) {
+  flush();
+  textures.erase(texture);
+}
+
+inline void Rasterizer::destroyProgram(render::Handle program) {
+  flush();
+  programs.erase(program);
+}
+
+inline void Rasterizer::setFloats(render::Handle program, const std::string &name, const float *value, int count) {
+  auto it = programs.find(program);
+  if (it == programs.end() || !it->second)
+    return;
+  if (it->second->queued && it->second->readByFragment(name))
+    flush();
+  it->second->set(name, value, count);
+}
+
+inline void Rasterizer::setUniform(render::Handle program, const std::string &name, int value) {
+  auto it = programs.find(program);
+  if (it == programs.end() || !it->second)
+    return;
+  if (it->second->queued && it->second->readByFragment(name))
+    flush();
+  it->second->set(name, value);
+}
+
+inline void Rasterizer::resize(int w, int h) {
+  if (w == width && h == height)
+    return;
+  flush();
+  width = w;
+  height = h;
+  tilesX = (w + TILE_SIZE - 1) / TILE_SIZE;
+  tilesY = (h + TILE_SIZE - 1) / TILE_SIZE;
+  pitch = tilesX * TILE_SIZE;
+  size_t pixels = (size_t)pitch * tilesY * TILE_SIZE;
+  color.assign(pixels, 0);
+  depth.assign(pixels, 1.0f);
+  stencil.assign(pixels, 0);
+  bins.assign((size_t)tilesX * tilesY, {});
+}
+
+inline void Rasterizer::clear(const glm::vec4 &c, float d, uint8_t s) {
+  flush();
+  uint32_t packed = detail::packColor(c);
+  size_t rows = (size_t)tilesY * TILE_SIZE;
+  jobs.parallelFor(rows, 16, [&](size_t begin, size_t end, unsigned int) {
+    std::fill(color.begin() + begin * pitch, color.begin() + end * pitch, packed);
+    std::fill(depth.begin() + begin * pitch, depth.begin() + end * pitch, d);
+    std::fill(stencil.begin() + begin * pitch, stencil.begin() + end * pitch, s);
+  });
+}
+
+inline void Rasterizer::readPixels(std::vector<uint8_t> &rgba) {
+  flush();
+  rgba.resize((size_t)width * height * 4);
+  for (int y = 0; y < height; ++y) {
+    std::memcpy(&rgba[(size_t)y * width * 4], &color[(size_t)y * pitch], (size_t)width * 4);
+  }
+}
+
+inline void Rasterizer::draw(const render::Draw &d) {
+  auto program = programs.find(d.program);
+  auto vertices = buffers.find(d.vertexBuffer);
+  if (program == programs.end() || !program->second || vertices == buffers.end() || d.count < 3 || !width)
+    return;
+  const Program &p = *program->second;
+  int varyings = std::min(p.getVaryings(), MAX_VARYINGS);
+  stats.draws++;
+
+  // indexed draws shade the range of vertices they reference once, non-indexed ones shade their vertices in order
+  const uint32_t *indices = nullptr;
+  uint32_t firstVertex = d.first, vertexCount = d.count;
+  if (d.indexBuffer) {
+    auto it = buffers.find(d.indexBuffer);
+    if (it == buffers.end() || (d.first + d.count) * sizeof(uint32_t) > it->second.size())
+      return;
+    indices = (const uint32_t *)it->second.data() + d.first;
+    auto range = std::minmax_element(indices, indices + d.count);
+    firstVertex = *range.first;
+    vertexCount = *range.second - *range.first + 1;
+  }
+  const std::vector<uint8_t> &data = vertices->second;
+  if (d.layout.stride == 0 || (size_t)(firstVertex + vertexCount) * d.layout.stride > data.size())
+    return;
+
+  shaded.resize(vertexCount);
+  jobs.parallelFor(vertexCount, 256, [&](size_t begin, size_t end, unsigned int) {
+    // attributes the layout doesn't provide read as (0, 0, 0, 1) like in GL
+    static const float missing[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+    const float *attributes[render::VertexLayout::MAX_ATTRIBUTES];
+    for (size_t i = begin; i < end; ++i) {
+      const uint8_t *vertex = data.data() + (firstVertex + i) * d.layout.stride;
+      std::fill(std::begin(attributes), std::end(attributes), missing);
+      for (int a = 0; a < d.layout.count; ++a) {
+        const auto &attribute = d.layout.attributes[a];
+        attributes[attribute.location] = (const float *)(vertex + attribute.offset);
+      }
+      shaded[i].position = p.vertex(attributes, shaded[i].varyings);
+    }
+  });
+
+  DrawState state;
+  state.depthStencil = d.depthStencil;
+  state.colorWrite = d.colorWrite;
+  state.program = &p;
+  for (int i = 0; i < 4; ++i) {
+    auto it = textures.find(d.textures[i]);
+    state.textures[i] = it == textures.end() ? nullptr : &it->second;
+  }
+  uint32_t drawIndex = (uint32_t)draws.size();
+  draws.push_back(state);
+  program->second->queued = true;
+
+  for (uint32_t i = 0; i + 2 < d.count; i += 3) {
+    const ClipVertex *v[3];
+    for (int k = 0; k < 3; ++k) {
+      v[k] = &shaded[(indices ? indices[i + k] : firstVertex + i + k) - firstVertex];
+    }
+    stats.triangles++;
+
+    // trivially outside one of the clip planes
+    int outside = 0x3f;
+    for (int k = 0; k < 3; ++k) {
+      const glm::vec4 &c = v[k]->position;
+      outside &= (c.x < -c.w) | (c.x > c.w) << 1 | (c.y < -c.w) << 2 | (c.y > c.w) << 3 | (c.z < -c.w) << 4 |
+                 (c.z > c.w) << 5;
+    }
+    if (outside) {
+      stats.culled++;
+      continue;
+    }
+    bool crossesNear = false;
+    for (int k = 0; k < 3; ++k) {
+      crossesNear |= v[k]->position.z < -v[k]->position.w;
+    }
+    if (!crossesNear) {
+      setupTriangle(v, varyings, d.cull, drawIndex);
+      continue;
+    }
+
+    // clip against the near plane (z = -w), the other planes are handled by the scissor to the framebuffer and the
+    // depth range check while rasterizing
+    stats.clipped++;
+    ClipVertex polygon[4];
+    int n = 0;
+    for (int k = 0; k < 3; ++k) {
+      const ClipVertex &a = *v[k], &b = *v[(k + 1) % 3];
+      float da = a.position.z + a.position.w, db = b.position.z + b.position.w;
+      if (da >= 0.0f)
+        polygon[n++] = a;
+      if ((da >= 0.0f) != (db >= 0.0f)) {
+        float t = da / (da - db);
+        ClipVertex &out = polygon[n++];
+        out.position = glm::mix(a.position, b.position, t);
+        for (int j = 0; j < varyings; ++j) {
+          out.varyings[j] = a.varyings[j] + (b.varyings[j] - a.varyings[j]) * t;
+        }
+      }
+    }
+    for (int k = 1; k + 1 < n; ++k) {
+      const ClipVertex *fan[3] = {&polygon[0], &polygon[k], &polygon[k + 1]};
+      setupTriangle(fan, varyings, d.cull, drawIndex);
+    }
+  }
+}
+
+inline void Rasterizer::setupTriangle(const ClipVertex *v[3], int varyings, render::CullMode cull, uint32_t draw) {
+  // window coordinates, y up like GL
+  float x[3], y[3], z[3], invW[3];
+  for (int k = 0; k < 3; ++k) {
+    const glm::vec4 &c = v[k]->position;
+    invW[k] = 1.0f / c.w;
+    x[k] = (c.x * invW[k] * 0.5f + 0.5f) * width;
+    y[k] = (c.y * invW[k] * 0.5f + 0.5f) * height;
+    z[k] = c.z * invW[k] * 0.5f + 0.5f;
+  }
+  float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+  // counter-clockwise is front facing
+  if (area == 0.0f || (cull == render::CullMode::BACK && area < 0.0f) ||
+      (cull == render::CullMode::FRONT && area > 0.0f)) {
+    stats.culled++;
+    return;
+  }
+  // back faces that survived culling are flipped so inside is always positive
+  int i0 = 0, i1 = 1, i2 = 2;
+  if (area < 0.0f) {
+    std::swap(i1, i2);
+    area = -area;
+  }
+  const int order[3] = {i0, i1, i2};
+
+  Triangle t;
+  t.draw = draw;
+  t.ox = x[i0];
+  t.oy = y[i0];
+  float px[3], py[3];
+  for (int k = 0; k < 3; ++k) {
+    px[k] = x[order[k]] - t.ox;
+    py[k] = y[order[k]] - t.oy;
+  }
+  // edge k runs from vertex k to vertex k + 1 and is opposite of vertex k + 2
+  for (int k = 0; k < 3; ++k) {
+    int e = (k + 1) % 3;
+    t.a[k] = py[k] - py[e];
+    t.b[k] = px[e] - px[k];
+    t.c[k] = -(t.a[k] * px[k] + t.b[k] * py[k]);
+    t.topLeft[k] = t.a[k] > 0.0f || (t.a[k] == 0.0f && t.b[k] < 0.0f);
+  }
+
+  // barycentric weights of vertices 1 and 2 are edges 2 and 0 over the area
+  float inv = 1.0f / area;
+  auto plane = [&](int slot, float f0, float f1, float f2) {
+    float d1 = f1 - f0, d2 = f2 - f0;
+    t.dx[slot] = (d1 * t.a[2] + d2 * t.a[0]) * inv;
+    t.dy[slot] = (d1 * t.b[2] + d2 * t.b[0]) * inv;
+    t.base[slot] = f0 + (d1 * t.c[2] + d2 * t.c[0]) * inv;
+  };
+  plane(0, z[i0], z[i1], z[i2]);
+  plane(1, invW[i0], invW[i1], invW[i2]);
+  for (int j = 0; j < varyings; ++j) {
+    plane(2 + j, v[i0]->varyings[j] * invW[i0], v[i1]->varyings[j] * invW[i1], v[i2]->varyings[j] * invW[i2]);
+  }
+
+  float minX = std::min({x[0], x[1], x[2]}), maxX = std::max({x[0], x[1], x[2]});
+  float minY = std::min({y[0], y[1], y[2]}), maxY = std::max({y[0], y[1], y[2]});
+  t.minX = std::max(0, (int)std::floor(minX));
+  t.minY = std::max(0, (int)std::floor(minY));
+  t.maxX = std::min(width - 1, (int)std::ceil(maxX));
+  t.maxY = std::min(height - 1, (int)std::ceil(maxY));
+  if (t.minX > t.maxX || t.minY > t.maxY) {
+    stats.culled++;
+    return;
+  }
+
+  uint32_t index = (uint32_t)triangles.size();
+  triangles.push_back(t);
+  for (int ty = t.minY / TILE_SIZE; ty <= t.maxY / TILE_SIZE; ++ty) {
+    for (int tx = t.minX / TILE_SIZE; tx <= t.maxX / TILE_SIZE; ++tx) {
+      bins[(size_t)ty * tilesX + tx].push_back(index);
+      stats.binned++;
+    }
+  }
+}
+
+inline void Rasterizer::flush() {
+  if (!triangles.empty()) {
+    jobs.parallelFor(bins.size(), 1, [&](size_t begin, size_t end, unsigned int) {
+      for (size_t tile = begin; tile < end; ++tile) {
+        rasterTile(tile);
+      }
+    });
+    stats.flushes++;
+    stats.fragments += shadedFragments.exchange(0);
+  }
+  for (auto &draw : draws) {
+    const_cast<Program *>(draw.program)->queued = false;
+  }
+  for (auto &bin : bins) {
+    bin.clear();
+  }
+  draws.clear();
+  triangles.clear();
+}
+
+inline void Rasterizer::rasterTile(size_t tile) {
+  const auto &bin = bins[tile];
+  if (bin.empty())
+    return;
+  int tileX = (int)(tile % tilesX) * TILE_SIZE, tileY = (int)(tile / tilesX) * TILE_SIZE;
+  float varyings[MAX_VARYINGS];
+  size_t fragments = 0;
+
+  for (uint32_t index : bin) {
+    const Triangle &t = triangles[index];
+    const DrawState &state = draws[t.draw];
+    const render::DepthStencilState &ds = state.depthStencil;
+    int count = state.program->getVaryings();
+    bool earlyTests = !state.program->canDiscard();
+    FragmentContext context;
+    std::copy(std::begin(state.textures), std::end(state.textures), context.textures);
+
+    // 4 pixel blocks are aligned to 4 so the loads below stay aligned with the row padding
+    int x0 = std::max(t.minX, tileX) & ~3, x1 = std::min(t.maxX, tileX + TILE_SIZE - 1);
+    int y0 = std::max(t.minY, tileY), y1 = std::min(t.maxY, tileY + TILE_SIZE - 1);
+    for (int y = y0; y <= y1; ++y) {
+      float py = y + 0.5f - t.oy;
+      for (int x = x0; x <= x1; x += 4) {
+        float px = x + 0.5f - t.ox;
+        size_t pixel = (size_t)y * pitch + x;
+        // coverage (inside the triangle and the depth range) and depth test results, bit i for pixel x + i
+        int covered, passed;
+        float z[4];
+#if SOFT_X86
+        __m128 vx = _mm_add_ps(_mm_set1_ps(px), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f));
+        __m128 vy = _mm_set1_ps(py);
+        __m128 zero = _mm_setzero_ps();
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int k = 0; k < 3; ++k) {
+          __m128 e = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.a[k]), vx), _mm_mul_ps(_mm_set1_ps(t.b[k]), vy)),
+                                _mm_set1_ps(t.c[k]));
+          inside = _mm_and_ps(inside, t.topLeft[k] ? _mm_cmpge_ps(e, zero) : _mm_cmpgt_ps(e, zero));
+        }
+        covered = _mm_movemask_ps(inside);
+        if (!covered)
+          continue;
+        __m128 vz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.dx[0]), vx), _mm_mul_ps(_mm_set1_ps(t.dy[0]), vy)),
+                               _mm_set1_ps(t.base[0]));
+        // outside the depth range is behind the far plane, or numerically just in front of the near one
+        covered &= _mm_movemask_ps(_mm_and_ps(_mm_cmpge_ps(vz, zero), _mm_cmple_ps(vz, _mm_set1_ps(1.0f))));
+        passed = ds.depthTest ? detail::compareMask(ds.depthFunc, vz, _mm_load_ps(&depth[pixel])) : 0xf;
+        _mm_storeu_ps(z, vz);
+#else
+        covered = 0;
+        passed = 0;
+        for (int i = 0; i < 4; ++i) {
+          float qx = px + i;
+          bool in = true;
+          for (int k = 0; k < 3; ++k) {
+            float e = t.a[k] * qx + t.b[k] * py + t.c[k];
+            in &= t.topLeft[k] ? e >= 0.0f : e > 0.0f;
+          }
+          z[i] = t.dx[0] * qx + t.dy[0] * py + t.base[0];
+          covered |= (in && z[i] >= 0.0f && z[i] <= 1.0f) << i;
+          passed |= (!ds.depthTest || detail::compare(ds.depthFunc, z[i], depth[pixel + i])) << i;
+        }
+#endif
+        if (!ds.stencilTest)
+          covered &= passed;
+        for (int i = 0; covered >> i; ++i) {
+          // the last block of a row can reach past the triangle into pixels of the padding
+          if (!(covered & (1 << i)) || x + i > x1)
+            continue;
+          size_t p = pixel + i;
+          bool depthPassed = passed & (1 << i), stencilPassed = true;
+          auto apply = [&](render::StencilOp op) {
+            uint8_t s = stencil[p];
+            uint8_t value = detail::stencilOp(op, s, ds.stencilRef);
+            stencil[p] = (s & ~ds.stencilWriteMask) | (value & ds.stencilWriteMask);
+          };
+          if (ds.stencilTest) {
+            stencilPassed =
+                detail::compare(ds.stencilFunc, ds.stencilRef & ds.stencilReadMask, stencil[p] & ds.stencilReadMask);
+            if (earlyTests && !(stencilPassed && depthPassed)) {
+              apply(stencilPassed ? ds.depthFail : ds.stencilFail);
+              continue;
+            }
+          }
+
+          float qx = px + i;
+          float w = 1.0f / (t.dx[1] * qx + t.dy[1] * py + t.base[1]);
+          for (int j = 0; j < count; ++j) {
+            varyings[j] = (t.dx[2 + j] * qx + t.dy[2 + j] * py + t.base[2 + j]) * w;
+          }
+          context.fragCoord = glm::vec4(x + i + 0.5f, y + 0.5f, z[i], 1.0f / w);
+          glm::vec4 out;
+          fragments++;
+          // a discarded fragment leaves depth and stencil alone
+          if (!state.program->fragment(varyings, context, out))
+            continue;
+          if (ds.stencilTest) {
+            // late tests, only programs that can discard get here with a failing fragment
+            if (!(stencilPassed && depthPassed)) {
+              apply(stencilPassed ? ds.depthFail : ds.stencilFail);
+              continue;
+            }
+            apply(ds.depthPass);
+          }
+          if (ds.depthTest && ds.depthWrite)
+            depth[p] = z[i];
+          if (state.colorWrite)
+            color[p] = detail::packColor(out);
+        }
+      }
+    }
+  }
+  shadedFragments += fragments;
+}
+
+} // namespace soft
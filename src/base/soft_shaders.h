@@ -0,0 +1,90 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <memory>
+
+#include <base/render_backend.h>
+#include <base/soft_raster.h>
+
+// the example shaders ported to the software rasterizer. every port mirrors its GLSL file line by line and desc()
+// pairs the two so both backends can create the program.
+namespace soft {
+
+// shaders/stencil-testing.vert: position at 0 and texture coordinates at 1, transformed by model, view, projection
+class StencilTestingVertex : public Program {
+public:
+  glm::mat4 model = glm::mat4(1.0f), view = glm::mat4(1.0f), projection = glm::mat4(1.0f);
+
+  StencilTestingVertex() {
+    varyings = 2;
+    // none of the fragment shaders below discard
+    discards = false;
+    uniform("model", model, false);
+    uniform("view", view, false);
+    uniform("projection", projection, false);
+  }
+
+  glm::vec4 vertex(const float *const *in, float *out) const override {
+    // TexCoords
+    out[0] = in[1][0];
+    out[1] = in[1][1];
+    return projection * view * model * glm::vec4(in[0][0], in[0][1], in[0][2], 1.0f);
+  }
+};
+
+// shaders/stencil-testing.frag, the object id output has no counterpart here
+class StencilTesting : public StencilTestingVertex {
+public:
+  static render::ProgramDesc desc() {
+    return {"shaders/stencil-testing.vert", "shaders/stencil-testing.frag", std::make_shared<StencilTesting>()};
+  }
+
+  bool fragment(const float *in, const FragmentContext &context, glm::vec4 &color) const override {
+    const Texture *texture1 = context.textures[0];
+    color = texture1 ? texture1->sample(glm::vec2(in[0], in[1])) : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    return true;
+  }
+};
+
+// shaders/stencil-single-color.frag
+class StencilSingleColor : public StencilTestingVertex {
+public:
+  static render::ProgramDesc desc() {
+    return {"shaders/stencil-testing.vert", "shaders/stencil-single-color.frag",
+            std::make_shared<StencilSingleColor>()};
+  }
+
+  bool fragment(const float *, const FragmentContext &, glm::vec4 &color) const override {
+    color = glm::vec4(1.0f, 0.28f, 0.26f, 1.0f);
+    return true;
+  }
+};
+
+// shaders/1.light_cube.vert and shaders/1.light_cube.frag
+class LightCube : public Program {
+public:
+  glm::mat4 model = glm::mat4(1.0f), view = glm::mat4(1.0f), projection = glm::mat4(1.0f);
+
+  static render::ProgramDesc desc() {
+    return {"shaders/1.light_cube.vert", "shaders/1.light_cube.frag", std::make_shared<LightCube>()};
+  }
+
+  LightCube() {
+    discards = false;
+    uniform("model", model, false);
+    uniform("view", view, false);
+    uniform("projection", projection, false);
+  }
+
+  glm::vec4 vertex(const float *const *in, float *) const override {
+    return projection * view * model * glm::vec4(in[0][0], in[0][1], in[0][2], 1.0f);
+  }
+
+  bool fragment(const float *, const FragmentContext &, glm::vec4 &color) const override {
+    color = glm::vec4(1.0f);
+    return true;
+  }
+};
+
+} // namespace soft
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <map>
+#include <ostream>
+#include <vector>
+
+#include <base/bounds.h>
+#include <base/mesh.h>
+#include <base/model.h>
+#include <base/shader.h>
+
+// static geometry batching. small meshes that never move cost a draw call, a VAO bind and their uniforms each, which
+// for a few dozen triangles is far more CPU time than the GPU spends drawing them. the batcher merges meshes sharing
+// their textures (or their material in a MaterialLibrary) into one Mesh per material, with the vertices transformed to
+// world space at load, so the whole group is a single draw. every source mesh keeps its index range and world bounds:
+// the culled draws skip the ranges outside the frustum and submit the rest, joined where they are adjacent, with one
+// glMultiDrawElements per batch.
+//
+//   StaticBatch batch;
+//   batch.add(model, transform);
+//   batch.build();
+//   batch.report(std::cout);
+//   ...
+//   batch.drawMaterials(shader, camera.getFrustum());
+//
+// batched meshes are drawn with an identity model matrix, which the draw functions set. skinned meshes and meshes
+// wrapping GPU geometry (glTF) have no CPU vertices to merge and are left out, add() returns false for them.
+class StaticBatch {
+public:
+  // one source mesh, its indices in the batch's index buffer and its world space bounds
+  struct Range {
+    GLsizei firstIndex = 0;
+    GLsizei count = 0;
+    AABB bounds;
+  };
+
+  struct Batch {
+    Mesh mesh;
+    std::vector<Range> ranges;
+  };
+
+  struct Stats {
+    // meshes merged and left out
+    size_t meshes = 0;
+    size_t skipped = 0;
+    // draw calls after merging, one per batch
+    size_t batches = 0;
+    size_t vertices = 0;
+    size_t indices = 0;
+  };
+
+  // queue a mesh placed in the world by the given transform
+  bool add(const Mesh &mesh, const glm::mat4 &world);
+  // queue every mesh of the model with the transform of its node, returns how many were taken
+  size_t add(Model &model, const glm::mat4 &world);
+  // merge the queued meshes and upload one mesh per material
+  void build();
+
+  // all batches, with the textures bound like Mesh::draw() does
+  void draw(const Shader &shader);
+  // only the ranges intersecting the frustum
+  void draw(const Shader &shader, const Frustum &frustum);
+  // all batches with the materialIndex uniform of their material, the library has to be bound like for
+  // Model::drawMaterials(), which also picks the default material for meshes without one
+  void drawMaterials(const Shader &shader);
+  void drawMaterials(const Shader &shader, const Frustum &frustum);
+
+  const std::vector<Batch> &getBatches() const { return batches; }
+  const Stats &getStats() const { return stats; }
+  // draw calls before and after merging, and the size of the merged geometry
+  void report(std::ostream &out) const;
+
+private:
+  struct Pending {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<Texture> textures;
+    int material = -1;
+    std::vector<Range> ranges;
+  };
+
+  // material index followed by the texture names identify a batch
+  std::map<std::vector<unsigned int>, size_t> keys;
+  std::vector<Pending> pending;
+  std::vector<Batch> batches;
+  Stats stats;
+  // scratch for the culled draws
+  std::vector<GLsizei> counts;
+  std::vector<const void *> offsets;
+
+  void drawBatch(Batch &batch, const Frustum *frustum);
+};
+
+inline bool StaticBatch::add(const Mesh &mesh, const glm::mat4 &world) {
+  const std::vector<Vertex> &vertices = mesh.getVertices();
+  const std::vector<unsigned int> &indices = mesh.getIndices();
+  if (vertices.empty() || indices.empty() || mesh.isSkinned()) {
+    ++stats.skipped;
+    return false;
+  }
+
+  std::vector<unsigned int> key = {(unsigned int)mesh.getMaterial()};
+  for (const Texture &t : mesh.getTextures()) {
+    key.push_back(t.id);
+  }
+  auto [it, inserted] = keys.try_emplace(key, pending.size());
+  if (inserted) {
+    pending.emplace_back();
+    pending.back().textures = mesh.getTextures();
+    pending.back().material = mesh.getMaterial();
+  }
+  Pending &p = pending[it->second];
+
+  // normals take the inverse transpose, which only differs from the matrix itself under non-uniform scale
+  glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(world)));
+  unsigned int base = (unsigned int)p.vertices.size();
+  for (Vertex v : vertices) {
+    v.position = glm::vec3(world * glm::vec4(v.position, 1.0f));
+    v.normal = glm::normalize(normalMatrix * v.normal);
+    p.vertices.push_back(v);
+  }
+  Range range;
+  range.firstIndex = (GLsizei)p.indices.size();
+  range.count = (GLsizei)(indices.size() / 3 * 3);
+  range.bounds = mesh.getBounds().transformed(world);
+  // a mirroring transform turns the triangles inside out, swapping two corners restores their winding
+  bool mirrored = glm::determinant(glm::mat3(world)) < 0.0f;
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    p.indices.push_back(base + indices[i]);
+    p.indices.push_back(base + indices[mirrored ? i + 2 : i + 1]);
+    p.indices.push_back(base + indices[mirrored ? i + 1 : i + 2]);
+  }
+  p.ranges.push_back(range);
+  ++stats.meshes;
+  return true;
+}
+
+inline size_t StaticBatch::add(Model &model, const glm::mat4 &world) {
+  size_t added = 0;
+  std::vector<Mesh> &meshes = model.getMeshes();
+  for (unsigned int i = 0; i < meshes.size(); ++i) {
+    added += add(meshes[i], world * model.getNodes().getWorld(model.getMeshNode(i)));
+  }
+  return added;
+}
+
+inline void StaticBatch::build() {
+  for (Pending &p : pending) {
+    stats.vertices += p.vertices.size();
+    stats.indices += p.indices.size();
+    batches.push_back({Mesh(std::move(p.vertices), std::move(p.indices), std::move(p.textures)), std::move(p.ranges)});
+    batches.back().mesh.setMaterial(p.material);
+  }
+  stats.batches = batches.size();
+  pending.clear();
+  keys.clear();
+}
+
+inline void StaticBatch::drawBatch(Batch &batch, const Frustum *frustum) {
+  if (!frustum) {
+    batch.mesh.drawGeometry();
+    return;
+  }
+  // ranges are in the order they were added, neighbours that are both visible become one range
+  counts.clear();
+  offsets.clear();
+  GLsizei end = -1;
+  for (const Range &r : batch.ranges) {
+    if (!frustum->intersects(r.bounds))
+      continue;
+    if (r.firstIndex == end) {
+      counts.back() += r.count;
+    } else {
+      counts.push_back(r.count);
+      offsets.push_back((const void *)(r.firstIndex * sizeof(unsigned int)));
+    }
+    end = r.firstIndex + r.count;
+  }
+  batch.mesh.drawRanges(counts.data(), offsets.data(), (GLsizei)counts.size());
+}
+
+inline void StaticBatch::draw(const Shader &shader) {
+  shader.setMat4("model", glm::mat4(1.0f));
+  for (Batch &batch : batches) {
+    batch.mesh.bindTextures(shader);
+    drawBatch(batch, nullptr);
+  }
+}
+
+inline void StaticBatch::draw(const Shader &shader, const Frustum &frustum) {
+  shader.setMat4("model", glm::mat4(1.0f));
+  for (Batch &batch : batches) {
+    batch.mesh.bindTextures(shader);
+    drawBatch(batch, &frustum);
+  }
+}
+
+inline void StaticBatch::drawMaterials(const Shader &shader) {
+  shader.setMat4("model", glm::mat4(1.0f));
+  for (Batch &batch : batches) {
+    int material = batch.mesh.getMaterial();
+    shader.setInt("materialIndex", material >= 0 ? material : MaterialLibrary::DEFAULT_MATERIAL);
+    drawBatch(batch, nullptr);
+  }
+}
+
+inline void StaticBatch::drawMaterials(const Shader &shader, const Frustum &frustum) {
+  shader.setMat4("model", glm::mat4(1.0f));
+  for (Batch &batch : batches) {
+    int material = batch.mesh.getMaterial();
+    shader.setInt("materialIndex", material >= 0 ? material : MaterialLibrary::DEFAULT_MATERIAL);
+    drawBatch(batch, &frustum);
+  }
+}
+
+inline void StaticBatch::report(std::ostream &out) const {
+  out << "static batch: " << stats.meshes << " meshes in " << stats.batches << " draw calls";
+  if (stats.meshes)
+    out << " (" << 100 - stats.batches * 100 / stats.meshes << "% fewer)";
+  out << ", " << stats.vertices << " vertices, " << stats.indices << " indices, "
+      << (stats.vertices * sizeof(Vertex) + stats.indices * sizeof(unsigned int)) / 1024 << " KB";
+  if (stats.skipped)
+    out << ", " << stats.skipped << " meshes left out";
+  out << std::endl;
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <base/gl_ext.h>
+#include <base/gl_resource.h>
+
+// a ring buffer for data that changes every frame: instance transforms, debug lines, particles...
+//
+// the buffer is split into one region per frame in flight. each frame sub-allocates from its own region and fences it
+// when done, so the CPU only ever writes to a region the GPU has finished reading and nothing is reallocated. when
+// GL_ARB_buffer_storage is available the whole buffer stays persistently mapped and allocations point straight into
+// GPU visible memory. otherwise they point into a CPU copy that flush() uploads with glBufferSubData. the buffer is
+// only ever bound to GL_COPY_WRITE_BUFFER internally so no VAO or indexed binding is disturbed.
+//
+//   stream.beginFrame();
+//   auto a = stream.allocate(bytes);
+//   memcpy(a.ptr, data, bytes);
+//   stream.flush();
+//   ... draw using a.offset ...
+//   stream.endFrame();
+class StreamBuffer {
+public:
+  struct Allocation {
+    void *ptr = nullptr;
+    // offset from the start of the buffer, for glVertexAttribPointer, glBindBufferRange, ...
+    GLintptr offset = 0;
+    GLsizeiptr size = 0;
+  };
+
+  struct Stats {
+    // bytes handed out since the last reset
+    size_t allocated = 0;
+    // allocations that didn't fit into their frame's region
+    unsigned int overflows = 0;
+    // times beginFrame had to wait for the GPU
+    unsigned int stalls = 0;
+  };
+
+  // frameSize is rounded up so every region starts at a multiple of 256 and of GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+  StreamBuffer(GLsizeiptr frameSize, int frames = 3, bool allowPersistent = true);
+  ~StreamBuffer();
+  StreamBuffer(const StreamBuffer &) = delete;
+  StreamBuffer &operator=(const StreamBuffer &) = delete;
+
+  // move on to the next region, waiting for the GPU if it is still reading it
+  void beginFrame();
+  // ptr is null when the region has no room left. offset is a multiple of alignment as long as that is a power of two
+  // up to 256 or the uniform buffer offset alignment
+  Allocation allocate(GLsizeiptr bytes, GLsizeiptr alignment = 16);
+  // make everything allocated this frame visible to the GPU, a no-op when persistently mapped
+  void flush();
+  // fence the region after the last command that reads from it
+  void endFrame();
+
+  GLuint get_id() const { return buffer.get(); }
+  bool persistent() const { return mapped != nullptr; }
+  const Stats &getStats() const { return stats; }
+  void resetStats() { stats = Stats(); }
+
+private:
+  GLBuffer buffer;
+  GLsizeiptr frameSize;
+  int frames;
+  int frame = 0;
+  GLsizeiptr head = 0;
+  GLsizeiptr flushed = 0;
+  std::vector<GLsync> fences;
+  // persistent mapping of the whole buffer, or null in the fallback path
+  uint8_t *mapped = nullptr;
+  // CPU copy of the current region in the fallback path
+  std::vector<uint8_t> staging;
+  Stats stats;
+
+  // frameSize rounded up so aligning within a region aligns in the buffer as well
+  static GLsizeiptr regionSize(GLsizeiptr frameSize);
+};
+
+inline GLsizeiptr StreamBuffer::regionSize(GLsizeiptr frameSize) {
+  GLint uniformAlignment = 0;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+  // both are powers of two in practice, so the larger is a multiple of the other
+  GLsizeiptr alignment = std::max<GLsizeiptr>(256, uniformAlignment);
+  return (frameSize + alignment - 1) / alignment * alignment;
+}
+
+inline StreamBuffer::StreamBuffer(GLsizeiptr frameSize, int frames, bool allowPersistent)
+    : frameSize(regionSize(frameSize)), frames(frames), fences(frames, nullptr) {
+  buffer = GLBuffer::create("stream buffer");
+  glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.get());
+  GLsizeiptr size = this->frameSize * frames;
+  if (auto bufferStorage = glext::bufferStorage(); allowPersistent && bufferStorage) {
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    bufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+    mapped = (uint8_t *)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags);
+    if (!mapped) {
+      std::cerr << "stream buffer: persistent mapping failed, falling back to glBufferSubData" << std::endl;
+      // immutable storage can't be respecified, start over with a new buffer
+      buffer = GLBuffer::create("stream buffer");
+      glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.get());
+    }
+  }
+  if (!mapped) {
+    glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    staging.resize(this->frameSize);
+  }
+  buffer.setBytes(size);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  // start on the last region so the first beginFrame lands on region 0
+  frame = frames - 1;
+}
+
+inline StreamBuffer::~StreamBuffer() {
+  for (GLsync fence : fences) {
+    if (fence)
+      glDeleteSync(fence);
+  }
+  if (mapped) {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.get());
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  }
+}
+
+inline void StreamBuffer::beginFrame() {
+  frame = (frame + 1) % frames;
+  head = 0;
+  flushed = 0;
+  if (GLsync fence = fences[frame]) {
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+      ++stats.stalls;
+      // flush on the first wait so the fence is guaranteed to signal eventually
+      GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+      do {
+        result = glClientWaitSync(fence, flags, 1000000);
+        flags = 0;
+      } while (result == GL_TIMEOUT_EXPIRED);
+    }
+    glDeleteSync(fence);
+    fences[frame] = nullptr;
+  }
+}
+
+inline StreamBuffer::Allocation StreamBuffer::allocate(GLsizeiptr bytes, GLsizeiptr alignment) {
+  GLsizeiptr start = (head + alignment - 1) / alignment * alignment;
+  if (start + bytes > frameSize) {
+    ++stats.overflows;
+    return Allocation();
+  }
+  head = start + bytes;
+  stats.allocated += bytes;
+
+  Allocation a;
+  a.offset = frame * frameSize + start;
+  a.size = bytes;
+  a.ptr = mapped ? mapped + a.offset : staging.data() + start;
+  return a;
+}
+
+inline void StreamBuffer::flush() {
+  if (mapped || head == flushed)
+    return;
+  // the region is fenced, so the copy never has to wait for the GPU
+  glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.get());
+  glBufferSubData(GL_COPY_WRITE_BUFFER, frame * frameSize + flushed, head - flushed, staging.data() + flushed);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  flushed = head;
+}
+
+inline void StreamBuffer::endFrame() {
+  flush();
+  fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
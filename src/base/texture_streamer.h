@@ -0,0 +1,346 @@
+#pragma once
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <base/bounds.h>
+#include <base/gl_resource.h>
+#include <base/ktx2.h>
+#include <base/mipmap.h>
+
+// mip level streaming for 2D textures under a fixed VRAM budget. textures start out with only their small mips on the
+// GPU, every frame the meshes using them report their world bounds and the streamer works out how many texels they
+// cover on screen. levels that would be visible are uploaded finest last, a few megabytes per frame, and when the
+// budget is full the least recently used textures give back their finest levels.
+//
+// the GL texture names stay the same the whole time, meshes keep binding them as usual. GL 4.1 has no sparse or
+// immutable storage, residency is tracked with GL_TEXTURE_BASE_LEVEL and evicted levels are respecified with a zero
+// size so the driver can free them. the full mip chain stays in system memory.
+//
+//   TextureStreamer streamer(128 << 20);
+//   GLuint id = streamer.add(pixels, width, height, 4, true);
+//   ...
+//   streamer.beginFrame(view, projection, viewportHeight);
+//   streamer.request(id, worldBounds);  // for every visible mesh using the texture
+//   streamer.update();
+class TextureStreamer {
+public:
+  struct Stats {
+    size_t textures = 0;
+    size_t residentBytes = 0;
+    size_t budgetBytes = 0;
+    // textures that want finer levels than they have
+    size_t pending = 0;
+    // during the last update()
+    size_t uploadedBytes = 0;
+    size_t evictedBytes = 0;
+    size_t totalUploadedBytes = 0;
+    size_t totalEvictedBytes = 0;
+    // upload bandwidth averaged over the last second
+    double uploadBytesPerSecond = 0.0;
+  };
+
+  // levels up to initialSize texels on their longer side are uploaded right away and never evicted, at most
+  // uploadBytesPerFrame are streamed in per update()
+  explicit TextureStreamer(size_t budgetBytes = 256 << 20, size_t uploadBytesPerFrame = 4 << 20, int initialSize = 64)
+      : budget(budgetBytes), uploadBudget(uploadBytesPerFrame), initialSize(initialSize) {}
+  ~TextureStreamer() {
+    for (const auto &t : textures) {
+      vram::untrack(vram::Category::TEXTURE, t.id);
+      glDeleteTextures(1, &t.id);
+    }
+  }
+  TextureStreamer(const TextureStreamer &) = delete;
+  TextureStreamer &operator=(const TextureStreamer &) = delete;
+
+  // an 8 bit image with 1, 3 or 4 channels, the mip chain is built on the CPU like textureFromPixels does
+  GLuint add(const uint8_t *pixels, int width, int height, int channels, bool srgb);
+  // a texture baked by texbake, 0 if the driver can't sample its format
+  GLuint add(ktx2::Image &&image);
+
+  // camera of the frame, requests are weighed against it
+  void beginFrame(const glm::mat4 &view, const glm::mat4 &projection, int viewportHeight);
+  // a mesh using the texture covers this box in world space. boxes outside the frustum are ignored
+  void request(GLuint texture, const AABB &worldBounds);
+  // upload and evict levels for the requests since beginFrame()
+  void update();
+
+  void setBudget(size_t bytes) { budget = bytes; }
+  // finest level on the GPU, -1 for textures the streamer doesn't know
+  int residentLevel(GLuint texture) const;
+  Stats getStats() const;
+
+private:
+  struct Entry {
+    GLuint id = 0;
+    GLenum internalFormat = GL_RGBA8;
+    GLenum format = GL_RGBA;
+    bool compressed = false;
+    int width = 0;
+    int height = 0;
+    std::vector<std::vector<uint8_t>> levels;
+    // finest level on the GPU, all coarser ones are there as well
+    int resident = 0;
+    // of the resident levels
+    size_t residentBytes = 0;
+    // finest of the small levels uploaded at creation, they are never evicted
+    int pinned = 0;
+    // finest level asked for this frame, levels.size() when nobody asked
+    int wanted = 0;
+    uint64_t lastUsed = 0;
+  };
+
+  GLuint create(Entry &&entry);
+  void uploadLevel(Entry &entry, int level);
+  void evictLevel(Entry &entry);
+  // drop finest levels of least recently used textures until bytes fit, false if they don't
+  bool makeRoom(size_t bytes, const Entry *keep);
+
+  std::vector<Entry> textures;
+  std::unordered_map<GLuint, size_t> index;
+
+  size_t budget;
+  size_t uploadBudget;
+  int initialSize;
+  size_t residentBytes = 0;
+
+  uint64_t frame = 0;
+  glm::vec3 eye = glm::vec3(0.0f);
+  Frustum frustum;
+  // pixels per unit of size at distance 1
+  float pixelScale = 1.0f;
+
+  Stats stats;
+  std::chrono::steady_clock::time_point windowStart = std::chrono::steady_clock::now();
+  size_t windowBytes = 0;
+};
+
+inline GLuint TextureStreamer::add(const uint8_t *pixels, int width, int height, int channels, bool srgb) {
+  Entry entry;
+  entry.format = channels == 1 ? GL_RED : channels == 3 ? GL_RGB : GL_RGBA;
+  entry.internalFormat = entry.format;
+  entry.width = width;
+  entry.height = height;
+  entry.levels =
+      mipmap::generate(pixels, width, height, channels, srgb ? mipmap::ColorSpace::SRGB : mipmap::ColorSpace::LINEAR);
+  return create(std::move(entry));
+}
+
+inline GLuint TextureStreamer::add(ktx2::Image &&image) {
+  if (!ktx2::supported(image.vkFormat) || image.levels.empty())
+    return 0;
+  Entry entry;
+  entry.internalFormat = ktx2::glInternalFormat(image.vkFormat);
+  entry.compressed = ktx2::isCompressed(image.vkFormat);
+  entry.width = (int)image.width;
+  entry.height = (int)image.height;
+  entry.levels = std::move(image.levels);
+  return create(std::move(entry));
+}
+
+inline GLuint TextureStreamer::create(Entry &&entry) {
+  int last = (int)entry.levels.size() - 1;
+  entry.pinned = last;
+  while (entry.pinned > 0 &&
+         std::max(entry.width >> (entry.pinned - 1), entry.height >> (entry.pinned - 1)) <= initialSize) {
+    --entry.pinned;
+  }
+  entry.resident = last + 1;
+  entry.wanted = last + 1;
+  entry.lastUsed = frame;
+
+  glGenTextures(1, &entry.id);
+  vram::track(vram::Category::TEXTURE, entry.id, 0, "streamed texture");
+  glBindTexture(GL_TEXTURE_2D, entry.id);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, last);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, last > 0 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  // the small mips go up front so the texture can be sampled from the first frame on, they don't count against the
+  // per frame upload budget
+  for (int level = last; level >= entry.pinned; --level) {
+    uploadLevel(entry, level);
+  }
+
+  GLuint id = entry.id;
+  index[id] = textures.size();
+  textures.push_back(std::move(entry));
+  return id;
+}
+
+inline void TextureStreamer::uploadLevel(Entry &entry, int level) {
+  const auto &data = entry.levels[level];
+  int w = std::max(1, entry.width >> level), h = std::max(1, entry.height >> level);
+  glBindTexture(GL_TEXTURE_2D, entry.id);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  if (entry.compressed) {
+    glCompressedTexImage2D(GL_TEXTURE_2D, level, entry.internalFormat, w, h, 0, (GLsizei)data.size(), data.data());
+  } else {
+    glTexImage2D(GL_TEXTURE_2D, level, entry.internalFormat, w, h, 0, entry.format, GL_UNSIGNED_BYTE, data.data());
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  // levels below the base level don't take part in completeness, the texture samples fine from what is there
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+  entry.resident = level;
+  entry.residentBytes += data.size();
+  residentBytes += data.size();
+  vram::setBytes(vram::Category::TEXTURE, entry.id, entry.residentBytes);
+}
+
+inline void TextureStreamer::evictLevel(Entry &entry) {
+  int level = entry.resident;
+  glBindTexture(GL_TEXTURE_2D, entry.id);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+  // a zero sized image lets the driver release the level's memory
+  glTexImage2D(GL_TEXTURE_2D, level, entry.compressed ? GL_RGBA8 : entry.internalFormat, 0, 0, 0,
+               entry.compressed ? GL_RGBA : entry.format, GL_UNSIGNED_BYTE, nullptr);
+  entry.resident = level + 1;
+  entry.residentBytes -= entry.levels[level].size();
+  residentBytes -= entry.levels[level].size();
+  vram::setBytes(vram::Category::TEXTURE, entry.id, entry.residentBytes);
+  stats.evictedBytes += entry.levels[level].size();
+}
+
+inline void TextureStreamer::beginFrame(const glm::mat4 &view, const glm::mat4 &projection, int viewportHeight) {
+  ++frame;
+  // the camera position is the translation of the inverse view matrix, which is rigid
+  glm::mat3 rotation(view);
+  eye = -(glm::transpose(rotation) * glm::vec3(view[3]));
+  frustum = Frustum(projection * view);
+  // projection[1][1] is cot(fovy / 2), half the viewport spans one unit of it
+  pixelScale = projection[1][1] * viewportHeight * 0.5f;
+  for (auto &t : textures) {
+    t.wanted = (int)t.levels.size();
+  }
+}
+
+inline void TextureStreamer::request(GLuint texture, const AABB &worldBounds) {
+  auto it = index.find(texture);
+  if (it == index.end() || !worldBounds.valid() || !frustum.intersects(worldBounds))
+    return;
+  Entry &entry = textures[it->second];
+  entry.lastUsed = frame;
+
+  // the diameter of the bounding sphere in pixels, assuming the texture is stretched over the mesh once. tiling or
+  // atlases make this an under- or overestimate, either way it stays monotonic with distance
+  float radius = glm::length(worldBounds.extent());
+  float distance = glm::length(worldBounds.center() - eye) - radius;
+  int level = 0;
+  if (distance > 0.0f) {
+    float pixels = 2.0f * radius * pixelScale / distance;
+    float texels = (float)std::max(entry.width, entry.height);
+    level = pixels > 0.0f ? (int)std::floor(std::log2(std::max(1.0f, texels / pixels))) : (int)entry.levels.size();
+  }
+  entry.wanted = std::min(entry.wanted, std::max(0, level));
+}
+
+inline bool TextureStreamer::makeRoom(size_t bytes, const Entry *keep) {
+  if (residentBytes + bytes <= budget)
+    return true;
+  // don't evict anything for a level that won't fit anyway
+  if (keep) {
+    size_t reclaimable = 0;
+    for (const auto &t : textures) {
+      for (int level = t.resident; &t != keep && level < std::min(t.pinned, t.wanted); ++level) {
+        reclaimable += t.levels[level].size();
+      }
+    }
+    if (residentBytes + bytes > budget + reclaimable)
+      return false;
+  }
+  while (residentBytes + bytes > budget) {
+    // the least recently used texture with levels it doesn't need right now
+    Entry *victim = nullptr;
+    for (auto &t : textures) {
+      if (&t == keep || t.resident >= t.pinned || t.resident >= t.wanted)
+        continue;
+      if (!victim || t.lastUsed < victim->lastUsed)
+        victim = &t;
+    }
+    // everything on the GPU is needed, stop refining instead of thrashing
+    if (!victim)
+      return false;
+    evictLevel(*victim);
+  }
+  return true;
+}
+
+inline void TextureStreamer::update() {
+  stats.uploadedBytes = 0;
+  stats.evictedBytes = 0;
+
+  // textures over budget after setBudget() or those wanting less shrink first
+  makeRoom(0, nullptr);
+
+  // biggest shortfall first, one level at a time so every texture refines gradually
+  std::vector<Entry *> queue;
+  for (auto &t : textures) {
+    if (t.wanted < t.resident)
+      queue.push_back(&t);
+  }
+  std::sort(queue.begin(), queue.end(),
+            [](const Entry *a, const Entry *b) { return a->resident - a->wanted > b->resident - b->wanted; });
+  size_t pending = queue.size();
+  while (!queue.empty()) {
+    bool progress = false;
+    for (auto it = queue.begin(); it != queue.end();) {
+      Entry &t = **it;
+      size_t bytes = t.levels[t.resident - 1].size();
+      if (stats.uploadedBytes > 0 && stats.uploadedBytes + bytes > uploadBudget) {
+        queue.clear();
+        break;
+      }
+      if (!makeRoom(bytes, &t)) {
+        it = queue.erase(it);
+        continue;
+      }
+      uploadLevel(t, t.resident - 1);
+      stats.uploadedBytes += bytes;
+      progress = true;
+      if (t.resident <= t.wanted) {
+        it = queue.erase(it);
+        --pending;
+      } else {
+        ++it;
+      }
+    }
+    if (!progress)
+      break;
+  }
+
+  stats.pending = pending;
+  stats.totalUploadedBytes += stats.uploadedBytes;
+  stats.totalEvictedBytes += stats.evictedBytes;
+  windowBytes += stats.uploadedBytes;
+  auto now = std::chrono::steady_clock::now();
+  double seconds = std::chrono::duration<double>(now - windowStart).count();
+  if (seconds >= 1.0) {
+    stats.uploadBytesPerSecond = windowBytes / seconds;
+    windowBytes = 0;
+    windowStart = now;
+  }
+}
+
+inline int TextureStreamer::residentLevel(GLuint texture) const {
+  auto it = index.find(texture);
+  return it == index.end() ? -1 : textures[it->second].resident;
+}
+
+inline TextureStreamer::Stats TextureStreamer::getStats() const {
+  Stats result = stats;
+  result.textures = textures.size();
+  result.residentBytes = residentBytes;
+  result.budgetBytes = budget;
+  return result;
+}
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstddef>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define TRANSFORM_X86 1
+#endif
+
+// batched TRS -> model matrix and normal matrix for many objects at once.
+//
+// input is structure of arrays, one array per scalar, so the SIMD paths load 4 (SSE2) or 8 (AVX2) objects' worth of
+// the same component with a single instruction and compose all of them side by side. the results are transposed back
+// into one Instance per object, ready to be uploaded as per instance vertex attributes. for a TRS matrix the inverse
+// transpose of the upper 3x3 is just the rotation with its columns divided by the scale, so the normal matrix costs 3
+// divisions instead of a 3x3 inverse and the shaders don't have to compute one per vertex.
+namespace transform {
+
+enum class Path { SCALAR, SSE2, AVX2 };
+
+// positions, rotations (unit quaternions) and scales of n objects
+struct Batch {
+  std::vector<float> px, py, pz;
+  std::vector<float> qx, qy, qz, qw;
+  std::vector<float> sx, sy, sz;
+
+  size_t size() const { return px.size(); }
+  void resize(size_t n) {
+    for (auto *v : {&px, &py, &pz, &qx, &qy, &qz, &qw, &sx, &sy, &sz}) {
+      v->resize(n);
+    }
+  }
+  void set(size_t i, const glm::vec3 &position, const glm::quat &rotation, const glm::vec3 &scale) {
+    px[i] = position.x, py[i] = position.y, pz[i] = position.z;
+    qx[i] = rotation.x, qy[i] = rotation.y, qz[i] = rotation.z, qw[i] = rotation.w;
+    sx[i] = scale.x, sy[i] = scale.y, sz[i] = scale.z;
+  }
+};
+
+// per instance data as laid out in the instance buffer: the model matrix in attributes 3-6 and the normal matrix,
+// padded to vec4 columns, in attributes 7-9
+struct Instance {
+  glm::mat4 model;
+  glm::vec4 normal[3];
+};
+
+namespace detail {
+
+// one object, also used for the tails the SIMD paths leave over
+inline void composeOne(const Batch &b, size_t i, Instance &out) {
+  float x = b.qx[i], y = b.qy[i], z = b.qz[i], w = b.qw[i];
+  float xx = x * x, yy = y * y, zz = z * z, xy = x * y, xz = x * z, yz = y * z, wx = w * x, wy = w * y, wz = w * z;
+  glm::vec3 r0(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy));
+  glm::vec3 r1(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx));
+  glm::vec3 r2(2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy));
+  out.model[0] = glm::vec4(r0 * b.sx[i], 0.0f);
+  out.model[1] = glm::vec4(r1 * b.sy[i], 0.0f);
+  out.model[2] = glm::vec4(r2 * b.sz[i], 0.0f);
+  out.model[3] = glm::vec4(b.px[i], b.py[i], b.pz[i], 1.0f);
+  out.normal[0] = glm::vec4(r0 / b.sx[i], 0.0f);
+  out.normal[1] = glm::vec4(r1 / b.sy[i], 0.0f);
+  out.normal[2] = glm::vec4(r2 / b.sz[i], 0.0f);
+}
+
+#if TRANSFORM_X86
+// transpose 4 SoA registers into 4 vec4 columns and store one into each of 4 consecutive instances
+inline void storeColumnSse2(__m128 x, __m128 y, __m128 z, __m128 w, Instance *out, size_t offset) {
+  _MM_TRANSPOSE4_PS(x, y, z, w);
+  _mm_storeu_ps(reinterpret_cast<float *>(out + 0) + offset, x);
+  _mm_storeu_ps(reinterpret_cast<float *>(out + 1) + offset, y);
+  _mm_storeu_ps(reinterpret_cast<float *>(out + 2) + offset, z);
+  _mm_storeu_ps(reinterpret_cast<float *>(out + 3) + offset, w);
+}
+
+// objects [begin, end) in steps of 4, returns where the scalar tail starts
+inline size_t composeSse2(const Batch &b, size_t begin, size_t end, Instance *out) {
+  const __m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f), zero = _mm_setzero_ps();
+  size_t n = begin + (end - begin) / 4 * 4;
+  for (size_t i = begin; i < n; i += 4) {
+    __m128 x = _mm_loadu_ps(&b.qx[i]), y = _mm_loadu_ps(&b.qy[i]), z = _mm_loadu_ps(&b.qz[i]),
+           w = _mm_loadu_ps(&b.qw[i]);
+    __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+    __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+    __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+    // rotation matrix, rCR is column C row R
+    __m128 r00 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz)));
+    __m128 r01 = _mm_mul_ps(two, _mm_add_ps(xy, wz));
+    __m128 r02 = _mm_mul_ps(two, _mm_sub_ps(xz, wy));
+    __m128 r10 = _mm_mul_ps(two, _mm_sub_ps(xy, wz));
+    __m128 r11 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz)));
+    __m128 r12 = _mm_mul_ps(two, _mm_add_ps(yz, wx));
+    __m128 r20 = _mm_mul_ps(two, _mm_add_ps(xz, wy));
+    __m128 r21 = _mm_mul_ps(two, _mm_sub_ps(yz, wx));
+    __m128 r22 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)));
+
+    __m128 sx = _mm_loadu_ps(&b.sx[i]), sy = _mm_loadu_ps(&b.sy[i]), sz = _mm_loadu_ps(&b.sz[i]);
+    __m128 ix = _mm_div_ps(one, sx), iy = _mm_div_ps(one, sy), iz = _mm_div_ps(one, sz);
+
+    Instance *o = out + i;
+    storeColumnSse2(_mm_mul_ps(r00, sx), _mm_mul_ps(r01, sx), _mm_mul_ps(r02, sx), zero, o, 0);
+    storeColumnSse2(_mm_mul_ps(r10, sy), _mm_mul_ps(r11, sy), _mm_mul_ps(r12, sy), zero, o, 4);
+    storeColumnSse2(_mm_mul_ps(r20, sz), _mm_mul_ps(r21, sz), _mm_mul_ps(r22, sz), zero, o, 8);
+    storeColumnSse2(_mm_loadu_ps(&b.px[i]), _mm_loadu_ps(&b.py[i]), _mm_loadu_ps(&b.pz[i]), one, o, 12);
+    storeColumnSse2(_mm_mul_ps(r00, ix), _mm_mul_ps(r01, ix), _mm_mul_ps(r02, ix), zero, o, 16);
+    storeColumnSse2(_mm_mul_ps(r10, iy), _mm_mul_ps(r11, iy), _mm_mul_ps(r12, iy), zero, o, 20);
+    storeColumnSse2(_mm_mul_ps(r20, iz), _mm_mul_ps(r21, iz), _mm_mul_ps(r22, iz), zero, o, 24);
+  }
+  return n;
+}
+
+#if defined(__GNUC__)
+#define TRANSFORM_AVX2 1
+// the same transpose on 8 lanes: each 128 bit half holds 4 objects, the low halves go to objects 0-3 and the high
+// halves to objects 4-7
+__attribute__((target("avx2"))) inline void storeColumnAvx2(__m256 x, __m256 y, __m256 z, __m256 w, Instance *out,
+                                                            size_t offset) {
+  __m256 t0 = _mm256_unpacklo_ps(x, y), t1 = _mm256_unpackhi_ps(x, y);
+  __m256 t2 = _mm256_unpacklo_ps(z, w), t3 = _mm256_unpackhi_ps(z, w);
+  __m256 c0 = _mm256_shuffle_ps(t0, t2, 0x44), c1 = _mm256_shuffle_ps(t0, t2, 0xee);
+  __m256 c2 = _mm256_shuffle_ps(t1, t3, 0x44), c3 = _mm256_shuffle_ps(t1, t3, 0xee);
+  __m256 columns[4] = {c0, c1, c2, c3};
+  for (int k = 0; k < 4; ++k) {
+    _mm_storeu_ps(reinterpret_cast<float *>(out + k) + offset, _mm256_castps256_ps128(columns[k]));
+    _mm_storeu_ps(reinterpret_cast<float *>(out + 4 + k) + offset, _mm256_extractf128_ps(columns[k], 1));
+  }
+}
+
+__attribute__((target("avx2"))) inline size_t composeAvx2(const Batch &b, size_t begin, size_t end, Instance *out) {
+  const __m256 one = _mm256_set1_ps(1.0f), two = _mm256_set1_ps(2.0f), zero = _mm256_setzero_ps();
+  size_t n = begin + (end - begin) / 8 * 8;
+  for (size_t i = begin; i < n; i += 8) {
+    __m256 x = _mm256_loadu_ps(&b.qx[i]), y = _mm256_loadu_ps(&b.qy[i]), z = _mm256_loadu_ps(&b.qz[i]),
+           w = _mm256_loadu_ps(&b.qw[i]);
+    __m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+    __m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+    __m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+    __m256 r00 = _mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz)));
+    __m256 r01 = _mm256_mul_ps(two, _mm256_add_ps(xy, wz));
+    __m256 r02 = _mm256_mul_ps(two, _mm256_sub_ps(xz, wy));
+    __m256 r10 = _mm256_mul_ps(two, _mm256_sub_ps(xy, wz));
+    __m256 r11 = _mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz)));
+    __m256 r12 = _mm256_mul_ps(two, _mm256_add_ps(yz, wx));
+    __m256 r20 = _mm256_mul_ps(two, _mm256_add_ps(xz, wy));
+    __m256 r21 = _mm256_mul_ps(two, _mm256_sub_ps(yz, wx));
+    __m256 r22 = _mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy)));
+
+    __m256 sx = _mm256_loadu_ps(&b.sx[i]), sy = _mm256_loadu_ps(&b.sy[i]), sz = _mm256_loadu_ps(&b.sz[i]);
+    __m256 ix = _mm256_div_ps(one, sx), iy = _mm256_div_ps(one, sy), iz = _mm256_div_ps(one, sz);
+
+    Instance *o = out + i;
+    storeColumnAvx2(_mm256_mul_ps(r00, sx), _mm256_mul_ps(r01, sx), _mm256_mul_ps(r02, sx), zero, o, 0);
+    storeColumnAvx2(_mm256_mul_ps(r10, sy), _mm256_mul_ps(r11, sy), _mm256_mul_ps(r12, sy), zero, o, 4);
+    storeColumnAvx2(_mm256_mul_ps(r20, sz), _mm256_mul_ps(r21, sz), _mm256_mul_ps(r22, sz), zero, o, 8);
+    storeColumnAvx2(_mm256_loadu_ps(&b.px[i]), _mm256_loadu_ps(&b.py[i]), _mm256_loadu_ps(&b.pz[i]), one, o, 12);
+    storeColumnAvx2(_mm256_mul_ps(r00, ix), _mm256_mul_ps(r01, ix), _mm256_mul_ps(r02, ix), zero, o, 16);
+    storeColumnAvx2(_mm256_mul_ps(r10, iy), _mm256_mul_ps(r11, iy), _mm256_mul_ps(r12, iy), zero, o, 20);
+    storeColumnAvx2(_mm256_mul_ps(r20, iz), _mm256_mul_ps(r21, iz), _mm256_mul_ps(r22, iz), zero, o, 24);
+  }
+  return n;
+}
+#endif
+#endif
+
+} // namespace detail
+
+// the fastest path the CPU supports
+inline Path bestPath() {
+#if TRANSFORM_AVX2
+  static const bool avx2 = __builtin_cpu_supports("avx2");
+  if (avx2)
+    return Path::AVX2;
+#endif
+#if TRANSFORM_X86
+  return Path::SSE2;
+#else
+  return Path::SCALAR;
+#endif
+}
+
+inline const char *pathName(Path path) {
+  switch (path) {
+  case Path::SSE2:
+    return "sse2";
+  case Path::AVX2:
+    return "avx2";
+  default:
+    return "scalar";
+  }
+}
+
+// objects [begin, end) only, out[i] receives object i. disjoint ranges can be composed on different threads
+inline void compose(const Batch &batch, size_t begin, size_t end, Instance *out, Path path = bestPath()) {
+  size_t done = begin;
+  switch (path) {
+#if TRANSFORM_X86
+  case Path::SSE2:
+    done = detail::composeSse2(batch, begin, end, out);
+    break;
+#if TRANSFORM_AVX2
+  case Path::AVX2:
+    done = detail::composeAvx2(batch, begin, end, out);
+    break;
+#endif
+#endif
+  default:
+    break;
+  }
+  for (size_t i = done; i < end; ++i) {
+    detail::composeOne(batch, i, out[i]);
+  }
+}
+
+// out must hold batch.size() instances
+inline void compose(const Batch &batch, Instance *out, Path path = bestPath()) {
+  compose(batch, 0, batch.size(), out, path);
+}
+
+} // namespace transform
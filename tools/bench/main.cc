@@ -0,0 +1,909 @@
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+#include <base/framebuffer.h>
+#include <base/gl_ext.h>
+#include <base/gl_resource.h>
+#include <base/gpu_timer.h>
+#include <base/json.h>
+#include <base/material.h>
+#include <base/model.h>
+#include <base/oit.h>
+#include <base/outline.h>
+#include <base/shader.h>
+#include <base/static_batch.h>
+
+// bench: performance regression suite. every scenario is loaded, rendered for a number of frames in a hidden window
+// and torn down again; the load time, CPU frame time percentiles, GPU time and memory of each are printed and written
+// as JSON.
+//
+//   bench [--frames N] [--size WxH] [--scenario name]... [--software] [--out results.json]
+//         [--compare baseline.json [results.json]] [--threshold percent]
+//
+// run from the repository root so the shaders and the nanosuit are found. --software asks Mesa for llvmpipe, which
+// together with a virtual X server (xvfb-run) makes the suite run on machines without a GPU. --compare checks the
+// results of this run, or of an earlier results.json, against a baseline and fails when a metric got worse by more
+// than --threshold percent (default 10).
+
+const int MAX_LIGHTS = 256;
+
+void usage() {
+  std::cerr << "usage: bench [--frames N] [--size WxH] [--scenario name]... [--software] [--out results.json]"
+            << std::endl
+            << "             [--compare baseline.json [results.json]] [--threshold percent]" << std::endl;
+}
+
+double msSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// resident set size of the process in MB, 0 where it can't be read
+double residentMb() {
+#ifdef __linux__
+  long pages = 0, resident = 0;
+  if (FILE *file = fopen("/proc/self/statm", "r")) {
+    if (fscanf(file, "%ld %ld", &pages, &resident) != 2)
+      resident = 0;
+    fclose(file);
+  }
+  return resident * (double)sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+#else
+  return 0.0;
+#endif
+}
+
+// video memory in use in MB with GL_NVX_gpu_memory_info, -1 without it. software renderers allocate in the process,
+// their memory shows up in the resident size instead
+double gpuMemoryMb() {
+  static const bool available = glext::hasExtension("GL_NVX_gpu_memory_info");
+  if (!available)
+    return -1.0;
+  GLint total = 0, unused = 0;
+  glGetIntegerv(0x9048, &total);  // GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX
+  glGetIntegerv(0x9049, &unused); // GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX
+  return (total - unused) / 1024.0;
+}
+
+// a unit cube as 36 vertices of position, normal and texture coordinates, counter-clockwise seen from outside
+std::vector<float> cubeVertices() {
+  const glm::vec3 axes[6][3] = {
+      {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}},  {{-1, 0, 0}, {0, 0, 1}, {0, 1, 0}}, {{0, 1, 0}, {0, 0, 1}, {1, 0, 0}},
+      {{0, -1, 0}, {1, 0, 0}, {0, 0, 1}}, {{0, 0, 1}, {1, 0, 0}, {0, 1, 0}},  {{0, 0, -1}, {0, 1, 0}, {1, 0, 0}},
+  };
+  const float corners[6][2] = {{-1, -1}, {1, -1}, {1, 1}, {1, 1}, {-1, 1}, {-1, -1}};
+  std::vector<float> vertices;
+  for (const auto &face : axes) {
+    for (const auto &c : corners) {
+      glm::vec3 p = 0.5f * (face[0] + c[0] * face[1] + c[1] * face[2]);
+      vertices.insert(vertices.end(), {p.x, p.y, p.z, face[0].x, face[0].y, face[0].z, (c[0] + 1) / 2, (c[1] + 1) / 2});
+    }
+  }
+  return vertices;
+}
+
+// the cube with positions at 0 and, depending on the shader, normals or texture coordinates at 1
+class Cube {
+public:
+  explicit Cube(bool normals) {
+    std::vector<float> vertices = cubeVertices();
+    vao = GLVertexArray::create("bench cube");
+    vbo = GLBuffer::create("bench cube");
+    glBindVertexArray(vao.get());
+    glBindBuffer(GL_ARRAY_BUFFER, vbo.get());
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    vbo.setBytes(vertices.size() * sizeof(float));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, normals ? 3 : 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float),
+                          (void *)((normals ? 3 : 6) * sizeof(float)));
+    glBindVertexArray(0);
+  }
+
+  void bind() const { glBindVertexArray(vao.get()); }
+  void draw() const { glDrawArrays(GL_TRIANGLES, 0, 36); }
+
+private:
+  GLVertexArray vao;
+  GLBuffer vbo;
+};
+
+// a checkerboard so the scenarios don't depend on image files
+GLTexture checkerTexture() {
+  const int SIZE = 256;
+  std::vector<uint8_t> texels(SIZE * SIZE * 4);
+  for (int y = 0; y < SIZE; ++y) {
+    for (int x = 0; x < SIZE; ++x) {
+      uint8_t v = ((x / 32) ^ (y / 32)) & 1 ? 220 : 90;
+      uint8_t *t = &texels[(y * SIZE + x) * 4];
+      t[0] = v;
+      t[1] = v;
+      t[2] = 200;
+      t[3] = 255;
+    }
+  }
+  GLTexture texture = GLTexture::create("checker");
+  glBindTexture(GL_TEXTURE_2D, texture.get());
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, SIZE, SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+  glGenerateMipmap(GL_TEXTURE_2D);
+  texture.setBytes(vram::textureBytes(GL_RGBA8, SIZE, SIZE, 9));
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  return texture;
+}
+
+// a square grid of `count` positions on the ground, `spacing` apart and centered on the origin
+std::vector<glm::vec3> grid(int count, float spacing) {
+  int side = (int)std::ceil(std::sqrt((float)count));
+  std::vector<glm::vec3> positions;
+  for (int i = 0; i < count; ++i) {
+    positions.push_back(glm::vec3((i % side - (side - 1) * 0.5f) * spacing, 0.0f, (i / side - (side - 1) * 0.5f) * spacing));
+  }
+  return positions;
+}
+
+class Scenario {
+public:
+  virtual ~Scenario() = default;
+  virtual const char *name() const = 0;
+  // false when the scenario can't run here, e.g. because an asset is missing
+  virtual bool load() = 0;
+  virtual void frame(int width, int height, float t) = 0;
+
+protected:
+  // the camera circles the scene, t goes from 0 to 1 over the measured frames
+  static glm::mat4 orbit(float t, float radius, float height, glm::vec3 &eye) {
+    float angle = t * 2.0f * 3.14159265f;
+    eye = glm::vec3(std::sin(angle) * radius, height, std::cos(angle) * radius);
+    return glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+  }
+  static glm::mat4 projection(int width, int height) {
+    return glm::perspective(glm::radians(45.0f), (float)width / (float)height, 0.1f, 500.0f);
+  }
+};
+
+// loading the nanosuit through the material library and drawing it like example/model-loading does
+class NanosuitScenario : public Scenario {
+public:
+  // batched merges the submeshes sharing a material with StaticBatch
+  explicit NanosuitScenario(bool batched = false) : batched(batched) {}
+
+  const char *name() const override { return batched ? "nanosuit-batched" : "nanosuit"; }
+
+  bool load() override {
+    const char *path = "nanosuit/nanosuit.obj";
+    if (!std::ifstream(path)) {
+      std::cerr << "bench: " << path << " not found, run from the repository root" << std::endl;
+      return false;
+    }
+    shader = std::make_unique<Shader>("shaders/model_loading.vert", "shaders/material.frag");
+    materials = std::make_unique<MaterialLibrary>();
+    model = std::make_unique<Model>(path, materials.get());
+    materials->upload();
+    if (batched) {
+      batch = std::make_unique<StaticBatch>();
+      batch->add(*model, glm::mat4(1.0f));
+      batch->build();
+      batch->report(std::cout);
+    }
+    return true;
+  }
+
+  void frame(int width, int height, float t) override {
+    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    shader->use();
+    materials->bind(*shader);
+    glm::vec3 eye;
+    shader->setMat4("projection", projection(width, height));
+    shader->setMat4("view", orbit(t, 25.0f, 10.0f, eye) * glm::translate(glm::mat4(1.0f), glm::vec3(0, -8, 0)));
+    if (batch)
+      batch->drawMaterials(*shader);
+    else
+      model->drawMaterials(*shader, glm::mat4(1.0f));
+  }
+
+private:
+  bool batched;
+  std::unique_ptr<Shader> shader;
+  std::unique_ptr<MaterialLibrary> materials;
+  std::unique_ptr<Model> model;
+  std::unique_ptr<StaticBatch> batch;
+};
+
+// a draw call and a model matrix per cube, the submission cost of many small objects
+class CubesScenario : public Scenario {
+public:
+  const char *name() const override { return "cubes-10k"; }
+
+  bool load() override {
+    shader = std::make_unique<Shader>("shaders/stencil-testing.vert", "shaders/stencil-testing.frag");
+    cube = std::make_unique<Cube>(false);
+    texture = checkerTexture();
+    positions = grid(10000, 1.5f);
+    return true;
+  }
+
+  void frame(int width, int height, float t) override {
+    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    shader->use();
+    shader->setInt("texture1", 0);
+    shader->setUint("objectId", 0);
+    glm::vec3 eye;
+    shader->setMat4("projection", projection(width, height));
+    shader->setMat4("view", orbit(t, 110.0f, 70.0f, eye));
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture.get());
+    cube->bind();
+    for (const glm::vec3 &p : positions) {
+      shader->setMat4("model", glm::translate(glm::mat4(1.0f), p));
+      cube->draw();
+    }
+    glBindVertexArray(0);
+  }
+
+private:
+  std::unique_ptr<Shader> shader;
+  std::unique_ptr<Cube> cube;
+  GLTexture texture;
+  std::vector<glm::vec3> positions;
+};
+
+// cubes-10k merged into one mesh by StaticBatch, culled per cube and drawn with a glMultiDrawElements
+class BatchedCubesScenario : public Scenario {
+public:
+  const char *name() const override { return "cubes-10k-batched"; }
+
+  bool load() override {
+    shader = std::make_unique<Shader>("shaders/model_loading.vert", "shaders/model_loading.frag");
+    texture = checkerTexture();
+    std::vector<float> data = cubeVertices();
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    for (size_t i = 0; i < data.size(); i += 8) {
+      Vertex v;
+      v.position = glm::vec3(data[i], data[i + 1], data[i + 2]);
+      v.normal = glm::vec3(data[i + 3], data[i + 4], data[i + 5]);
+      v.texCoords = glm::vec2(data[i + 6], data[i + 7]);
+      indices.push_back((unsigned int)vertices.size());
+      vertices.push_back(v);
+    }
+    Mesh cube(vertices, indices, {{texture.get(), "texture_diffuse", "checker"}});
+    for (const glm::vec3 &p : grid(10000, 1.5f)) {
+      batch.add(cube, glm::translate(glm::mat4(1.0f), p));
+    }
+    batch.build();
+    batch.report(std::cout);
+    return true;
+  }
+
+  void frame(int width, int height, float t) override {
+    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    shader->use();
+    glm::vec3 eye;
+    glm::mat4 view = orbit(t, 110.0f, 70.0f, eye);
+    shader->setMat4("projection", projection(width, height));
+    shader->setMat4("view", view);
+    batch.draw(*shader, Frustum(projection(width, height) * view));
+  }
+
+private:
+  std::unique_ptr<Shader> shader;
+  GLTexture texture;
+  StaticBatch batch;
+};
+
+// a few objects shaded by many point lights, bound by fragment work
+class LightsScenario : public Scenario {
+public:
+  const char *name() const override { return "many-lights"; }
+
+  bool load() override {
+    shader = std::make_unique<Shader>("shaders/bench-lights.vert", "shaders/bench-lights.frag");
+    cube = std::make_unique<Cube>(true);
+    positions = grid(100, 4.0f);
+    // std140: two arrays of vec4, positions with their radius, then colors
+    std::vector<glm::vec4> lights(MAX_LIGHTS * 2);
+    uint32_t seed = 1;
+    auto random = [&]() {
+      seed = seed * 1664525u + 1013904223u;
+      return (seed >> 8) / 16777216.0f;
+    };
+    for (int i = 0; i < MAX_LIGHTS; ++i) {
+      lights[i] = glm::vec4((random() - 0.5f) * 40.0f, 0.5f + random() * 3.0f, (random() - 0.5f) * 40.0f, 8.0f);
+      lights[MAX_LIGHTS + i] = glm::vec4(random(), random(), random(), 1.0f) * 4.0f;
+    }
+    ubo = GLBuffer::create("lights");
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo.get());
+    glBufferData(GL_UNIFORM_BUFFER, lights.size() * sizeof(glm::vec4), lights.data(), GL_STATIC_DRAW);
+    ubo.setBytes(lights.size() * sizeof(glm::vec4));
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glUniformBlockBinding(shader->get_id(), glGetUniformBlockIndex(shader->get_id(), "Lights"), 0);
+    return true;
+  }
+
+  void frame(int width, int height, float t) override {
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 0, ubo.get());
+    shader->use();
+    shader->setInt("lightCount", MAX_LIGHTS);
+    glm::vec3 eye;
+    shader->setMat4("view", orbit(t, 30.0f, 14.0f, eye));
+    shader->setMat4("projection", projection(width, height));
+    shader->setVec3("viewPos", eye);
+    cube->bind();
+    shader->setVec3("albedo", glm::vec3(0.6f));
+    shader->setMat4("model", glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -0.6f, 0.0f)),
+                                        glm::vec3(44.0f, 0.2f, 44.0f)));
+    cube->draw();
+    shader->setVec3("albedo", glm::vec3(0.9f, 0.8f, 0.7f));
+    for (const glm::vec3 &p : positions) {
+      shader->setMat4("model", glm::translate(glm::mat4(1.0f), p));
+      cube->draw();
+    }
+    glBindVertexArray(0);
+  }
+
+private:
+  std::unique_ptr<Shader> shader;
+  std::unique_ptr<Cube> cube;
+  GLBuffer ubo;
+  std::vector<glm::vec3> positions;
+};
+
+// the outlined cubes of example/stencil-testing with either technique
+class OutlineScenario : public Scenario {
+public:
+  explicit OutlineScenario(bool stencil) : stencil(stencil) {}
+
+  const char *name() const override { return stencil ? "outline-stencil" : "outline-jump-flood"; }
+
+  bool load() override {
+    shader = std::make_unique<Shader>("shaders/stencil-testing.vert", "shaders/stencil-testing.frag");
+    singleColor = std::make_unique<Shader>("shaders/stencil-testing.vert", "shaders/stencil-single-color.frag");
+    cube = std::make_unique<Cube>(false);
+    texture = checkerTexture();
+    positions = grid(256, 1.5f);
+    return true;
+  }
+
+  void frame(int width, int height, float t) override {
+    if (!scene) {
+      scene = std::make_unique<Framebuffer>(width, height);
+      scene->addColor(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+      idAttachment = scene->addColor(GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT);
+      scene->setDepth(GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8);
+      outline = std::make_unique<Outline>(width, height);
+    }
+    scene->bind();
+    const GLfloat clearColor[] = {0.2f, 0.3f, 0.3f, 1.0f};
+    const GLuint clearId[] = {0, 0, 0, 0};
+    glStencilMask(0xFF);
+    glClearBufferfv(GL_COLOR, 0, clearColor);
+    glClearBufferuiv(GL_COLOR, idAttachment, clearId);
+    glClear(GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+    glm::vec3 eye;
+    glm::mat4 view = orbit(t, 30.0f, 18.0f, eye);
+    for (Shader *s : {shader.get(), singleColor.get()}) {
+      s->use();
+      s->setMat4("view", view);
+      s->setMat4("projection", projection(width, height));
+    }
+    shader->use();
+    shader->setInt("texture1", 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture.get());
+    cube->bind();
+    auto drawCubes = [&](const Shader &s, float scale, bool writeIds) {
+      for (size_t i = 0; i < positions.size(); ++i) {
+        s.setMat4("model", glm::scale(glm::translate(glm::mat4(1.0f), positions[i]), glm::vec3(scale)));
+        if (writeIds)
+          s.setUint("objectId", (unsigned int)i + 1);
+        cube->draw();
+      }
+    };
+
+    glEnable(GL_STENCIL_TEST);
+    if (stencil) {
+      shader->setUint("objectId", 0);
+      glStencilFunc(GL_ALWAYS, 1, 0xFF);
+      glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+      drawCubes(*shader, 1.0f, false);
+      glStencilFunc(GL_NOTEQUAL, 1, 0xFF);
+      glStencilMask(0x00);
+      glDisable(GL_DEPTH_TEST);
+      singleColor->use();
+      drawCubes(*singleColor, 1.05f, false);
+      glStencilMask(0xFF);
+      glEnable(GL_DEPTH_TEST);
+      scene->blitToScreen(width, height);
+    } else {
+      glStencilFunc(GL_ALWAYS, 0, 0xFF);
+      drawCubes(*shader, 1.0f, true);
+      shader->setUint("objectId", 0);
+      scene->blitToScreen(width, height);
+      glViewport(0, 0, width, height);
+      outline->draw(scene->colorTexture(idAttachment), glm::vec3(1.0f, 0.28f, 0.26f), 4.0f);
+    }
+    glDisable(GL_STENCIL_TEST);
+    glBindVertexArray(0);
+  }
+
+private:
+  bool stencil;
+  std::unique_ptr<Shader> shader, singleColor;
+  std::unique_ptr<Cube> cube;
+  std::unique_ptr<Framebuffer> scene;
+  std::unique_ptr<Outline> outline;
+  unsigned int idAttachment = 0;
+  GLTexture texture;
+  std::vector<glm::vec3> positions;
+};
+
+// many overlapping transparent cubes in front of opaque ones, either sorted back to front on the CPU every frame and
+// drawn with over blending, or drawn unsorted into the weighted blended OIT targets. both submit one instanced draw for
+// the transparent cubes, the difference is the sort and upload against the extra targets and the composite
+class TransparencyScenario : public Scenario {
+public:
+  explicit TransparencyScenario(bool oit) : oit(oit) {}
+
+  const char *name() const override { return oit ? "transparency-oit" : "transparency-sorted"; }
+
+  bool load() override {
+    shader = std::make_unique<Shader>("shaders/transparent.vert",
+                                      oit ? "shaders/transparent-oit.frag" : "shaders/transparent.frag");
+    opaqueShader = std::make_unique<Shader>("shaders/transparent.vert", "shaders/transparent.frag");
+    cube = std::make_unique<Cube>(true);
+
+    // a floor and a few pillars the transparent cubes have to be depth tested against
+    opaque.push_back({glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -12.0f, 0.0f)),
+                                 glm::vec3(60.0f, 1.0f, 60.0f)),
+                      glm::vec4(0.55f, 0.55f, 0.5f, 1.0f)});
+    for (const glm::vec3 &p : grid(9, 18.0f)) {
+      opaque.push_back({glm::scale(glm::translate(glm::mat4(1.0f), p), glm::vec3(2.0f, 24.0f, 2.0f)),
+                        glm::vec4(0.3f, 0.35f, 0.45f, 1.0f)});
+    }
+
+    // a fixed seed keeps the runs comparable
+    std::mt19937 rng(48);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const int SIDE = 28;
+    for (int i = 0; i < TRANSPARENT_COUNT; ++i) {
+      glm::vec3 cell(i % SIDE, (i / SIDE) % SIDE, i / (SIDE * SIDE));
+      glm::vec3 p = (cell - glm::vec3((SIDE - 1) * 0.5f) + glm::vec3(unit(rng), unit(rng), unit(rng)) - 0.5f) * 1.5f;
+      glm::mat4 model = glm::translate(glm::mat4(1.0f), p);
+      model = glm::rotate(model, unit(rng) * 6.2831853f, glm::normalize(glm::vec3(unit(rng), unit(rng), 0.5f)));
+      model = glm::scale(model, glm::vec3(0.6f + 0.6f * unit(rng)));
+      transparent.push_back({model, glm::vec4(unit(rng), unit(rng), unit(rng), 0.15f + 0.35f * unit(rng))});
+    }
+
+    instanceVbo = GLBuffer::create("transparency instances");
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVbo.get());
+    glBufferData(GL_ARRAY_BUFFER, (opaque.size() + transparent.size()) * sizeof(Instance), nullptr,
+                 oit ? GL_STATIC_DRAW : GL_DYNAMIC_DRAW);
+    instanceVbo.setBytes((opaque.size() + transparent.size()) * sizeof(Instance));
+    glBufferSubData(GL_ARRAY_BUFFER, 0, opaque.size() * sizeof(Instance), opaque.data());
+    glBufferSubData(GL_ARRAY_BUFFER, opaque.size() * sizeof(Instance), transparent.size() * sizeof(Instance),
+                    transparent.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    order.resize(transparent.size());
+    sorted.resize(transparent.size());
+    return true;
+  }
+
+  void frame(int width, int height, float t) override {
+    if (!scene) {
+      scene = std::make_unique<Framebuffer>(width, height);
+      scene->addColor(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+      scene->setDepth(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT);
+      if (oit)
+        wboit = std::make_unique<WeightedBlendedOIT>(width, height);
+    }
+    scene->bind();
+    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glm::vec3 eye;
+    glm::mat4 view = orbit(t, 60.0f, 30.0f, eye);
+    for (Shader *s : {shader.get(), opaqueShader.get()}) {
+      s->use();
+      s->setMat4("view", view);
+      s->setMat4("projection", projection(width, height));
+    }
+
+    cube->bind();
+    opaqueShader->use();
+    instances(0);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 36, (GLsizei)opaque.size());
+
+    shader->use();
+    if (oit) {
+      wboit->begin(scene->depthTexture());
+      instances(opaque.size());
+      glDrawArraysInstanced(GL_TRIANGLES, 0, 36, (GLsizei)transparent.size());
+      wboit->end();
+      wboit->composite();
+    } else {
+      // farthest first, by the distance of the cube centers from the eye
+      std::vector<float> distance(transparent.size());
+      for (size_t i = 0; i < transparent.size(); ++i) {
+        glm::vec3 d = glm::vec3(transparent[i].model[3]) - eye;
+        distance[i] = glm::dot(d, d);
+        order[i] = (unsigned int)i;
+      }
+      std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return distance[a] > distance[b]; });
+      for (size_t i = 0; i < order.size(); ++i) {
+        sorted[i] = transparent[order[i]];
+      }
+      glBindBuffer(GL_ARRAY_BUFFER, instanceVbo.get());
+      glBufferSubData(GL_ARRAY_BUFFER, opaque.size() * sizeof(Instance), sorted.size() * sizeof(Instance),
+                      sorted.data());
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+      glEnable(GL_BLEND);
+      glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+      glDepthMask(GL_FALSE);
+      instances(opaque.size());
+      glDrawArraysInstanced(GL_TRIANGLES, 0, 36, (GLsizei)sorted.size());
+      glDepthMask(GL_TRUE);
+      glDisable(GL_BLEND);
+    }
+    glBindVertexArray(0);
+    scene->blitToScreen(width, height);
+  }
+
+private:
+  static const int TRANSPARENT_COUNT = 20000;
+
+  struct Instance {
+    glm::mat4 model;
+    glm::vec4 color;
+  };
+
+  bool oit;
+  std::unique_ptr<Shader> shader, opaqueShader;
+  std::unique_ptr<Cube> cube;
+  std::unique_ptr<Framebuffer> scene;
+  std::unique_ptr<WeightedBlendedOIT> wboit;
+  GLBuffer instanceVbo;
+  std::vector<Instance> opaque, transparent, sorted;
+  std::vector<unsigned int> order;
+
+  // point the instance attributes of the bound cube at the instances from `first` on, GL 4.1 has no base instance
+  void instances(size_t first) const {
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVbo.get());
+    const char *base = (const char *)(first * sizeof(Instance));
+    for (int i = 0; i < 5; ++i) {
+      glEnableVertexAttribArray(3 + i);
+      glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), base + i * sizeof(glm::vec4));
+      glVertexAttribDivisor(3 + i, 1);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+};
+
+struct Result {
+  std::string name;
+  bool skipped = false;
+  double loadMs = 0.0;
+  int frames = 0;
+  double cpuMean = 0.0, cpuP50 = 0.0, cpuP95 = 0.0, cpuP99 = 0.0, cpuMax = 0.0;
+  double gpuMs = 0.0;
+  double rssMb = 0.0, rssDeltaMb = 0.0, gpuMemoryMb = -1.0;
+  // GL objects registered with vram while the scenario was loaded, and those it left behind when torn down
+  double trackedMb = 0.0;
+  size_t leakedObjects = 0;
+};
+
+double percentile(const std::vector<double> &sorted, double p) {
+  return sorted.empty() ? 0.0 : sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+}
+
+Result run(Scenario &scenario, GLFWwindow *window, int frames) {
+  const int WARMUP_FRAMES = 10;
+  Result result;
+  result.name = scenario.name();
+  double rssBefore = residentMb();
+  auto start = std::chrono::steady_clock::now();
+  if (!scenario.load()) {
+    result.skipped = true;
+    return result;
+  }
+  glFinish();
+  result.loadMs = msSince(start);
+
+  int width, height;
+  glfwGetFramebufferSize(window, &width, &height);
+  glViewport(0, 0, width, height);
+  glEnable(GL_DEPTH_TEST);
+  GpuTimer gpuTimer;
+  std::vector<double> cpuMs;
+  double gpuMs = 0.0;
+  int gpuFrames = 0;
+  unsigned int gpuResults = 0;
+  for (int i = 0; i < WARMUP_FRAMES + frames; ++i) {
+    start = std::chrono::steady_clock::now();
+    gpuTimer.begin();
+    scenario.frame(width, height, std::max(0, i - WARMUP_FRAMES) / (float)frames);
+    gpuTimer.end();
+    glfwSwapBuffers(window);
+    glfwPollEvents();
+    if (i >= WARMUP_FRAMES) {
+      cpuMs.push_back(msSince(start));
+      // the timer reports a frame that finished a few frames ago, skip the ones still from the warm up. frames whose
+      // query wasn't done in time add nothing rather than the previous result again
+      if (i >= WARMUP_FRAMES + 4 && gpuTimer.getResults() != gpuResults) {
+        gpuMs += gpuTimer.getMs();
+        ++gpuFrames;
+      }
+      gpuResults = gpuTimer.getResults();
+    }
+  }
+  glFinish();
+
+  std::vector<double> sorted = cpuMs;
+  std::sort(sorted.begin(), sorted.end());
+  result.frames = frames;
+  for (double ms : cpuMs)
+    result.cpuMean += ms / frames;
+  result.cpuP50 = percentile(sorted, 0.50);
+  result.cpuP95 = percentile(sorted, 0.95);
+  result.cpuP99 = percentile(sorted, 0.99);
+  result.cpuMax = sorted.back();
+  result.gpuMs = gpuFrames ? gpuMs / gpuFrames : 0.0;
+  result.rssMb = residentMb();
+  result.rssDeltaMb = result.rssMb - rssBefore;
+  result.gpuMemoryMb = gpuMemoryMb();
+  result.trackedMb = vram::totalBytes() / (1024.0 * 1024.0);
+  return result;
+}
+
+std::string escape(const std::string &text) {
+  std::string out;
+  for (char c : text) {
+    if (c == '"' || c == '\\')
+      out += '\\';
+    if ((unsigned char)c >= 0x20)
+      out += c;
+  }
+  return out;
+}
+
+std::string toJson(const std::string &renderer, const std::vector<Result> &results) {
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(3);
+  out << "{\n  \"version\": 1,\n  \"renderer\": \"" << escape(renderer) << "\",\n  \"scenarios\": [";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result &r = results[i];
+    out << (i ? "," : "") << "\n    {\"name\": \"" << r.name << "\"";
+    if (r.skipped) {
+      out << ", \"skipped\": true}";
+      continue;
+    }
+    out << ", \"loadMs\": " << r.loadMs << ", \"frames\": " << r.frames << ",\n     \"cpuMs\": {\"mean\": " << r.cpuMean
+        << ", \"p50\": " << r.cpuP50 << ", \"p95\": " << r.cpuP95 << ", \"p99\": " << r.cpuP99
+        << ", \"max\": " << r.cpuMax << "}, \"gpuMs\": " << r.gpuMs << ",\n     \"memory\": {\"rssMb\": " << r.rssMb
+        << ", \"rssDeltaMb\": " << r.rssDeltaMb;
+    if (r.gpuMemoryMb >= 0.0)
+      out << ", \"gpuMb\": " << r.gpuMemoryMb;
+    out << ", \"trackedMb\": " << r.trackedMb << ", \"leakedObjects\": " << r.leakedObjects;
+    out << "}}";
+  }
+  out << "\n  ]\n}\n";
+  return out.str();
+}
+
+bool readJson(const std::string &path, json::Value &root) {
+  std::ifstream file(path, std::ios::binary);
+  std::stringstream text;
+  text << file.rdbuf();
+  std::string s = text.str();
+  if (!file || !json::parse(s.data(), s.size(), root)) {
+    std::cerr << "bench: can't read " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// prints every metric of the current results next to the baseline, returns the number of regressions
+int compare(const json::Value &baseline, const json::Value &current, double threshold) {
+  if (baseline["renderer"].asString() != current["renderer"].asString()) {
+    std::cout << "warning: baseline renderer \"" << baseline["renderer"].asString() << "\" differs from \""
+              << current["renderer"].asString() << "\"" << std::endl;
+  }
+  // lower is better for all of them. changes below the noise floor are ignored, whatever their percentage
+  struct Metric {
+    const char *label;
+    const char *group;
+    const char *key;
+    double floor;
+  };
+  const Metric metrics[] = {{"load ms", nullptr, "loadMs", 1.0},       {"cpu p50", "cpuMs", "p50", 0.05},
+                            {"cpu p95", "cpuMs", "p95", 0.05},         {"gpu ms", nullptr, "gpuMs", 0.05},
+                            {"rss MB", "memory", "rssDeltaMb", 2.0},   {"tracked MB", "memory", "trackedMb", 1.0},
+                            {"leaked", "memory", "leakedObjects", 0.5}};
+  int regressions = 0;
+  std::cout << std::fixed << std::setprecision(2);
+  for (const json::Value &scenario : current["scenarios"].array) {
+    const std::string &name = scenario["name"].asString();
+    const json::Value *base = nullptr;
+    for (const json::Value &b : baseline["scenarios"].array) {
+      if (b["name"].asString() == name)
+        base = &b;
+    }
+    if (!base || base->has("skipped") || scenario.has("skipped")) {
+      std::cout << name << ": not in both runs" << std::endl;
+      continue;
+    }
+    std::cout << name << std::endl;
+    for (const Metric &m : metrics) {
+      const json::Value &b = m.group ? (*base)[m.group][m.key] : (*base)[m.key];
+      const json::Value &c = m.group ? scenario[m.group][m.key] : scenario[m.key];
+      if (!b.isNumber() || !c.isNumber())
+        continue;
+      double delta = c.asNumber() - b.asNumber();
+      double change = b.asNumber() > 0.0 ? delta / b.asNumber() * 100.0 : 0.0;
+      // no percentage of a zero baseline, e.g. no leaks before: any growth beyond the noise floor counts
+      bool regressed = (b.asNumber() <= 0.0 || change > threshold) && delta > m.floor;
+      regressions += regressed;
+      std::cout << "  " << std::left << std::setw(10) << m.label << std::right << std::setw(10) << b.asNumber()
+                << " -> " << std::setw(10) << c.asNumber() << std::setw(9) << std::showpos << change
+                << std::noshowpos << "%" << (regressed ? "  REGRESSION" : "") << std::endl;
+    }
+  }
+  std::cout << regressions << " regression(s) beyond " << threshold << "%" << std::endl;
+  return regressions;
+}
+
+int main(int argc, char **argv) {
+  int frames = 200, width = 800, height = 600;
+  bool software = false;
+  double threshold = 10.0;
+  std::vector<std::string> only;
+  std::string out, baseline, previous;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--frames" && i + 1 < argc) {
+      frames = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--size" && i + 1 < argc) {
+      if (std::sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+        usage();
+        return EXIT_FAILURE;
+      }
+    } else if (arg == "--scenario" && i + 1 < argc) {
+      only.push_back(argv[++i]);
+    } else if (arg == "--software") {
+      software = true;
+    } else if (arg == "--out" && i + 1 < argc) {
+      out = argv[++i];
+    } else if (arg == "--compare" && i + 1 < argc) {
+      baseline = argv[++i];
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+        previous = argv[++i];
+    } else if (arg == "--threshold" && i + 1 < argc) {
+      threshold = std::atof(argv[++i]);
+    } else {
+      usage();
+      return EXIT_FAILURE;
+    }
+  }
+
+  // comparing two result files needs no context
+  if (!previous.empty()) {
+    json::Value base, current;
+    if (!readJson(baseline, base) || !readJson(previous, current))
+      return EXIT_FAILURE;
+    return compare(base, current, threshold) ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
+
+  if (software) {
+#ifndef _WIN32
+    setenv("LIBGL_ALWAYS_SOFTWARE", "1", 1);
+    setenv("GALLIUM_DRIVER", "llvmpipe", 1);
+#endif
+  }
+  if (!glfwInit()) {
+    std::cerr << "failed to init GLFW" << std::endl;
+    return EXIT_FAILURE;
+  }
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  GLFWwindow *window;
+  if (window = glfwCreateWindow(width, height, "bench", nullptr, nullptr); !window) {
+    glfwTerminate();
+    return EXIT_FAILURE;
+  }
+  glfwMakeContextCurrent(window);
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+    std::cerr << "failed to initialize GLAD" << std::endl;
+    return EXIT_FAILURE;
+  }
+  // frame times shouldn't be those of the display
+  glfwSwapInterval(0);
+  std::string renderer = (const char *)glGetString(GL_RENDERER);
+  std::cout << "renderer: " << renderer << std::endl;
+
+  std::vector<std::unique_ptr<Scenario>> scenarios;
+  scenarios.push_back(std::make_unique<NanosuitScenario>(false));
+  scenarios.push_back(std::make_unique<NanosuitScenario>(true));
+  scenarios.push_back(std::make_unique<CubesScenario>());
+  scenarios.push_back(std::make_unique<BatchedCubesScenario>());
+  scenarios.push_back(std::make_unique<LightsScenario>());
+  scenarios.push_back(std::make_unique<OutlineScenario>(true));
+  scenarios.push_back(std::make_unique<OutlineScenario>(false));
+  scenarios.push_back(std::make_unique<TransparencyScenario>(false));
+  scenarios.push_back(std::make_unique<TransparencyScenario>(true));
+
+  std::vector<Result> results;
+  std::cout << std::fixed << std::setprecision(2) << "scenario               load ms   cpu p50   cpu p95   cpu p99"
+            << "    gpu ms    rss MB" << std::endl;
+  for (auto &scenario : scenarios) {
+    if (!only.empty() && std::find(only.begin(), only.end(), scenario->name()) == only.end())
+      continue;
+    size_t objectsBefore = vram::totalObjects();
+    Result r = run(*scenario, window, frames);
+    // tear it down before the next one so it doesn't count towards its memory
+    scenario.reset();
+    glFinish();
+    if (size_t objects = vram::totalObjects(); objects > objectsBefore) {
+      r.leakedObjects = objects - objectsBefore;
+      std::cerr << r.name << ": " << r.leakedObjects << " GL objects were not deleted" << std::endl;
+    }
+    std::cout << std::left << std::setw(20) << r.name << std::right;
+    if (r.skipped) {
+      std::cout << "   skipped" << std::endl;
+    } else {
+      std::cout << std::setw(10) << r.loadMs << std::setw(10) << r.cpuP50 << std::setw(10) << r.cpuP95
+                << std::setw(10) << r.cpuP99 << std::setw(10) << r.gpuMs << std::setw(10) << r.rssDeltaMb
+                << std::endl;
+    }
+    results.push_back(r);
+  }
+  // the ones that were filtered out still hold theirs
+  scenarios.clear();
+  glfwTerminate();
+
+  std::string document = toJson(renderer, results);
+  if (!out.empty()) {
+    std::ofstream(out) << document;
+    std::cout << "wrote " << out << std::endl;
+  }
+  if (!baseline.empty()) {
+    json::Value base, current;
+    if (!readJson(baseline, base) || !json::parse(document.data(), document.size(), current))
+      return EXIT_FAILURE;
+    return compare(base, current, threshold) ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
+  return EXIT_SUCCESS;
+}
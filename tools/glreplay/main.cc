@@ -0,0 +1,139 @@
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <base/gl_trace.h>
+
+// glreplay: replay a trace recorded with gltrace::startRecording in a hidden window and time its frames.
+//
+//   glreplay trace.gltrace [--loops N] [--finish] [--stats] [--size WxH]
+//
+// the setup part of the trace is replayed once, then every recorded frame --loops times (default 10). frame times
+// are the CPU time of submitting the calls, with --finish a glFinish ends every frame so they include the GPU.
+// --stats intercepts the replayed calls and prints the per frame counts, redundant state changes and costs. the
+// window is as large as the default framebuffer was when recording unless --size says otherwise.
+
+void usage() {
+  std::cerr << "usage: glreplay trace.gltrace [--loops N] [--finish] [--stats] [--size WxH]" << std::endl;
+}
+
+double percentile(std::vector<double> sorted, double p) {
+  return sorted.empty() ? 0.0 : sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+}
+
+int main(int argc, char **argv) {
+  std::string path;
+  int loops = 10, width = 0, height = 0;
+  bool finish = false, stats = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--loops" && i + 1 < argc) {
+      loops = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--finish") {
+      finish = true;
+    } else if (arg == "--stats") {
+      stats = true;
+    } else if (arg == "--size" && i + 1 < argc) {
+      if (std::sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+        usage();
+        return EXIT_FAILURE;
+      }
+    } else if (path.empty() && arg[0] != '-') {
+      path = arg;
+    } else {
+      usage();
+      return EXIT_FAILURE;
+    }
+  }
+  if (path.empty()) {
+    usage();
+    return EXIT_FAILURE;
+  }
+
+  gltrace::Player player;
+  std::string error;
+  if (!player.load(path.c_str(), error)) {
+    std::cerr << error << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!width) {
+    width = std::max(player.width(), 1);
+    height = std::max(player.height(), 1);
+  }
+
+  if (!glfwInit()) {
+    std::cerr << "failed to init GLFW" << std::endl;
+    return EXIT_FAILURE;
+  }
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  GLFWwindow *window;
+  if (window = glfwCreateWindow(width, height, "glreplay", nullptr, nullptr); !window) {
+    glfwTerminate();
+    return EXIT_FAILURE;
+  }
+  glfwMakeContextCurrent(window);
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+    std::cerr << "failed to initialize GLAD" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  player.replaySetup();
+  glFinish();
+  double setupMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  std::cout << path << ": " << player.frames() << " frames, setup " << player.replayedCalls() << " calls in "
+            << setupMs << " ms" << std::endl;
+  if (!player.frames()) {
+    glfwTerminate();
+    return EXIT_SUCCESS;
+  }
+
+  if (stats) {
+    gltrace::install();
+  }
+  std::vector<double> frameMs;
+  uint64_t setupCalls = player.replayedCalls();
+  for (int loop = 0; loop < loops; ++loop) {
+    for (size_t frame = 0; frame < player.frames(); ++frame) {
+      start = std::chrono::steady_clock::now();
+      player.replayFrame(frame);
+      if (finish)
+        glFinish();
+      frameMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+      if (stats)
+        gltrace::frame();
+    }
+  }
+  glFinish();
+
+  std::vector<double> sorted = frameMs;
+  std::sort(sorted.begin(), sorted.end());
+  double total = 0.0;
+  for (double ms : frameMs)
+    total += ms;
+  std::cout << frameMs.size() << " frames, " << (player.replayedCalls() - setupCalls) / frameMs.size()
+            << " calls per frame, ms mean: " << total / frameMs.size() << " min: " << sorted.front()
+            << " p50: " << percentile(sorted, 0.5) << " p95: " << percentile(sorted, 0.95)
+            << " max: " << sorted.back() << (finish ? " (with glFinish)" : "") << std::endl;
+  if (stats) {
+    std::cout << gltrace::report(gltrace::getTotals(), 16) << std::endl;
+    gltrace::uninstall();
+  }
+
+  glfwTerminate();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,712 @@
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <base/animation.h>
+#include <base/command_list.h>
+#include <base/components.h>
+#include <base/ecs.h>
+#include <base/gltf.h>
+#include <base/job_system.h>
+#include <base/mapped_file.h>
+#include <base/obj.h>
+#include <base/scene_graph.h>
+#include <base/transform_batch.h>
+
+// microbench: CPU side benchmarks of the base library that don't need a GL context.
+//
+//   microbench [benchmark...]
+//
+// runs every benchmark when none is named.
+
+double msSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// best of a few runs in milliseconds
+double timeMs(int runs, const std::function<void()> &fn) {
+  double best = 1e30;
+  for (int i = 0; i < runs; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    best = std::min(best, msSince(start));
+  }
+  return best;
+}
+
+glm::quat randomRotation(std::mt19937 &rng) {
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+  glm::vec4 q(unit(rng), unit(rng), unit(rng), unit(rng) + 2.0f);
+  q = glm::normalize(q);
+  return glm::quat(q.w, q.x, q.y, q.z);
+}
+
+// scene graph: a ~1.1M node hierarchy (fanout 10, depth 6) updated fully, partially and not at all, against a pointer
+// based tree that recomputes everything every frame
+int benchSceneGraph() {
+  const int FANOUT = 10;
+  const int DEPTH = 6;
+  const int RUNS = 5;
+
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+  SceneGraph graph;
+  std::function<void(int, int)> build = [&](int parent, int depth) {
+    int node = graph.addNode(parent, glm::vec3(unit(rng), unit(rng), unit(rng)), randomRotation(rng), glm::vec3(1.0f));
+    if (depth < DEPTH) {
+      for (int i = 0; i < FANOUT; ++i) {
+        build(node, depth + 1);
+      }
+    }
+  };
+  build(-1, 0);
+  std::cout << "scene graph: " << graph.size() << " nodes" << std::endl;
+
+  // the classic layout: heap allocated nodes with child pointers, every world matrix recomputed every frame
+  struct Node {
+    glm::vec3 position;
+    glm::quat rotation;
+    glm::vec3 scale;
+    glm::mat4 world;
+    std::vector<std::unique_ptr<Node>> children;
+  };
+  std::vector<Node *> flat(graph.size());
+  for (size_t i = 0; i < graph.size(); ++i) {
+    flat[i] = new Node{graph.getPosition(i), graph.getRotation(i), graph.getScale(i), glm::mat4(1.0f), {}};
+    if (graph.getParent(i) >= 0)
+      flat[graph.getParent(i)]->children.emplace_back(flat[i]);
+  }
+  std::unique_ptr<Node> root(flat[0]);
+  std::function<void(Node *, const glm::mat4 &)> traverse = [&](Node *node, const glm::mat4 &parent) {
+    node->world = parent * SceneGraph::compose(node->position, node->rotation, node->scale);
+    for (auto &child : node->children) {
+      traverse(child.get(), node->world);
+    }
+  };
+  double pointerMs = timeMs(RUNS, [&] { traverse(root.get(), glm::mat4(1.0f)); });
+  std::cout << "  pointer tree, full traversal: " << pointerMs << " ms" << std::endl;
+
+  // one in a hundred depth 4 nodes moves, which dirties about 1% of the graph
+  std::vector<int> animated;
+  for (int i = 0; i < (int)graph.size(); ++i) {
+    int depth = 0;
+    for (int p = graph.getParent(i); p >= 0; p = graph.getParent(p)) {
+      ++depth;
+    }
+    if (depth == 4 && rng() % 100 == 0)
+      animated.push_back(i);
+  }
+
+  // serial and parallel updates have to agree on every matrix
+  {
+    JobSystem jobs(4);
+    graph.setPosition(0, graph.getPosition(0));
+    graph.update();
+    std::vector<glm::mat4> reference = graph.getWorlds();
+    graph.setPosition(0, graph.getPosition(0));
+    graph.update(&jobs);
+    size_t mismatches = 0;
+    for (size_t i = 0; i < reference.size(); ++i) {
+      mismatches += reference[i] != graph.getWorld(i);
+    }
+    if (mismatches) {
+      std::cout << "  parallel update differs from the serial one in " << mismatches << " nodes" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::vector<unsigned int> threadCounts = {1};
+  if (std::thread::hardware_concurrency() > 1)
+    threadCounts.push_back(std::thread::hardware_concurrency());
+  for (unsigned int threads : threadCounts) {
+    JobSystem jobs(threads);
+    double fullMs = timeMs(RUNS, [&] {
+      graph.setPosition(0, graph.getPosition(0));
+      graph.update(&jobs);
+    });
+    size_t fullUpdated = graph.getStats().updated;
+    double partialMs = timeMs(RUNS, [&] {
+      for (int node : animated) {
+        graph.setRotation(node, randomRotation(rng));
+      }
+      graph.update(&jobs);
+    });
+    size_t partialUpdated = graph.getStats().updated;
+    double staticMs = timeMs(RUNS, [&] { graph.update(&jobs); });
+
+    std::cout << "  " << jobs.threadCount() << " thread(s): full " << fullMs << " ms (" << fullUpdated
+              << " nodes), 1% animated " << partialMs << " ms (" << partialUpdated << " nodes), static " << staticMs
+              << " ms" << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
+
+// ecs: 1M entities in three archetypes (static drawables, spinning drawables, lights) against the same data as an array
+// of fat objects, for a read only pass, the transform update and culling plus command recording
+int benchEcs() {
+  const int STATIC_COUNT = 700000;
+  const int SPINNING_COUNT = 250000;
+  const int LIGHT_COUNT = 50000;
+  const int RUNS = 5;
+
+  struct Spin {
+    glm::vec3 axis;
+    float speed;
+  };
+  // what an object tends to look like without an ecs: every field for every kind of object, whether used or not
+  struct GameObject {
+    Transform transform;
+    WorldTransform world;
+    Bounds bounds;
+    MeshRef mesh;
+    MaterialRef material;
+    Spin spin;
+    PointLight light;
+    bool drawable, spinning, isLight;
+  };
+
+  std::mt19937 rng(3);
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+  ecs::Registry registry;
+  std::vector<GameObject> objects;
+  objects.reserve(STATIC_COUNT + SPINNING_COUNT + LIGHT_COUNT);
+  AABB unitBox = {glm::vec3(-0.5f), glm::vec3(0.5f)};
+  for (int i = 0; i < STATIC_COUNT + SPINNING_COUNT + LIGHT_COUNT; ++i) {
+    GameObject o = {};
+    o.transform.position = glm::vec3(unit(rng), unit(rng), unit(rng)) * 500.0f;
+    o.transform.rotation = randomRotation(rng);
+    o.transform.scale = glm::vec3(1.0f);
+    o.bounds.local = unitBox;
+    o.mesh = {1, 36, 0};
+    o.material = {1 + (GLuint)(i % 4), glm::vec4(1.0f)};
+    o.spin = {glm::normalize(glm::vec3(unit(rng), unit(rng), 1.0f)), unit(rng)};
+    o.light = PointLight();
+    o.isLight = i >= STATIC_COUNT + SPINNING_COUNT;
+    o.drawable = !o.isLight;
+    o.spinning = i >= STATIC_COUNT && !o.isLight;
+    objects.push_back(o);
+
+    if (o.isLight)
+      registry.create(o.transform, o.light);
+    else if (o.spinning)
+      registry.create(o.transform, o.world, o.bounds, o.mesh, o.material, o.spin);
+    else
+      registry.create(o.transform, o.world, o.bounds, o.mesh, o.material);
+  }
+  std::cout << "ecs: " << registry.size() << " entities in " << registry.getArchetypes().size() << " archetypes, "
+            << sizeof(GameObject) << " bytes per fat object" << std::endl;
+
+  auto report = [](const char *name, double ms, size_t n) {
+    std::cout << "  " << name << ": " << ms << " ms (" << ms * 1.0e6 / n << " ns per entity)" << std::endl;
+  };
+
+  // read only pass over one component
+  glm::vec3 sum(0.0f);
+  report("objects, sum positions", timeMs(RUNS, [&] {
+           for (const auto &o : objects) {
+             sum += o.transform.position;
+           }
+         }),
+         objects.size());
+  report("ecs, sum positions", timeMs(RUNS, [&] {
+           registry.each<Transform>([&](Transform &t) { sum += t.position; });
+         }),
+         registry.size());
+
+  // world matrices and bounds
+  report("objects, update transforms", timeMs(RUNS, [&] {
+           for (auto &o : objects) {
+             o.world.matrix = SceneGraph::compose(o.transform.position, o.transform.rotation, o.transform.scale);
+             if (o.drawable)
+               o.bounds.world = o.bounds.local.transformed(o.world.matrix);
+           }
+         }),
+         objects.size());
+
+  glm::mat4 viewProj = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 1000.0f) *
+                       glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+  std::vector<unsigned int> threadCounts = {1};
+  if (std::thread::hardware_concurrency() > 1)
+    threadCounts.push_back(std::thread::hardware_concurrency());
+  for (unsigned int threads : threadCounts) {
+    JobSystem jobs(threads);
+    RenderQueue queue(jobs.threadCount());
+    std::string suffix = " (" + std::to_string(jobs.threadCount()) + " thread(s))";
+    report(("ecs, update transforms" + suffix).c_str(), timeMs(RUNS, [&] { updateTransforms(registry, jobs); }),
+           registry.size());
+    size_t recorded = 0;
+    report(("ecs, cull and record" + suffix).c_str(), timeMs(RUNS, [&] {
+             recorded = recordDraws(registry, jobs, queue, viewProj, glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f));
+           }),
+           STATIC_COUNT + SPINNING_COUNT);
+    std::cout << "    " << recorded << " draws recorded" << std::endl;
+  }
+  // keep the sums alive
+  return sum.x == 12345.0f ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// transforms: model and normal matrices for 1M objects, the textbook glm way (three matrix products and a 3x3 inverse
+// per object) against the batched kernel on every path the CPU supports
+int benchTransforms() {
+  const size_t COUNT = 1 << 20;
+  const int RUNS = 5;
+
+  std::mt19937 rng(4);
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+  std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+  transform::Batch batch;
+  batch.resize(COUNT);
+  for (size_t i = 0; i < COUNT; ++i) {
+    batch.set(i, glm::vec3(unit(rng), unit(rng), unit(rng)) * 100.0f, randomRotation(rng),
+              glm::vec3(scale(rng), scale(rng), scale(rng)));
+  }
+  std::cout << "transforms: " << COUNT << " objects" << std::endl;
+
+  auto report = [](const char *name, double ms) {
+    std::cout << "  " << name << ": " << ms << " ms (" << ms * 1.0e6 / COUNT << " ns per object)" << std::endl;
+  };
+
+  std::vector<glm::mat4> models(COUNT);
+  std::vector<glm::mat3> normals(COUNT);
+  report("glm", timeMs(RUNS, [&] {
+           for (size_t i = 0; i < COUNT; ++i) {
+             glm::quat r(batch.qw[i], batch.qx[i], batch.qy[i], batch.qz[i]);
+             glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(batch.px[i], batch.py[i], batch.pz[i]));
+             model = model * glm::mat4_cast(r);
+             model = glm::scale(model, glm::vec3(batch.sx[i], batch.sy[i], batch.sz[i]));
+             models[i] = model;
+             normals[i] = glm::transpose(glm::inverse(glm::mat3(model)));
+           }
+         }));
+
+  std::vector<transform::Instance> instances(COUNT);
+  std::vector<transform::Path> paths = {transform::Path::SCALAR};
+  if (transform::bestPath() != transform::Path::SCALAR)
+    paths.push_back(transform::Path::SSE2);
+  if (transform::bestPath() == transform::Path::AVX2)
+    paths.push_back(transform::Path::AVX2);
+  for (transform::Path path : paths) {
+    report(transform::pathName(path), timeMs(RUNS, [&] { transform::compose(batch, instances.data(), path); }));
+
+    // every path has to match glm up to rounding
+    float error = 0.0f;
+    for (size_t i = 0; i < COUNT; ++i) {
+      for (int c = 0; c < 4; ++c) {
+        glm::vec4 d = glm::abs(instances[i].model[c] - models[i][c]);
+        error = std::max(error, std::max(std::max(d.x, d.y), std::max(d.z, d.w)));
+      }
+      for (int c = 0; c < 3; ++c) {
+        glm::vec3 d = glm::abs(glm::vec3(instances[i].normal[c]) - normals[i][c]);
+        error = std::max(error, std::max(std::max(d.x, d.y), d.z));
+      }
+    }
+    if (error > 1.0e-3f) {
+      std::cout << "  " << transform::pathName(path) << " differs from glm by " << error << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
+
+// obj: parse throughput of the OBJ reader against assimp on the model the examples load, from the file on disk to
+// vertex and index arrays. assimp gets the flags Model uses
+int benchObj() {
+  const char *PATH = "nanosuit/nanosuit.obj";
+  const int RUNS = 5;
+
+  MappedFile file(PATH);
+  if (!file.valid()) {
+    std::cout << "obj: " << PATH << " not found, run from the repository root" << std::endl;
+    return EXIT_FAILURE;
+  }
+  double megabytes = file.size() / (1024.0 * 1024.0);
+  std::cout << "obj: " << PATH << ", " << megabytes << " MB" << std::endl;
+  auto report = [&](const std::string &name, double ms) {
+    std::cout << "  " << name << ": " << ms << " ms (" << megabytes * 1000.0 / ms << " MB/s)" << std::endl;
+  };
+
+  // float parsing alone, every number in the file
+  std::vector<const char *> numbers;
+  for (const char *p = file.data(), *end = p + file.size(); p < end; ++p) {
+    if ((*p == '-' || obj::detail::isDigit(*p)) && (p == file.data() || p[-1] == ' '))
+      numbers.push_back(p);
+  }
+  float sum = 0.0f;
+  const char *end = file.data() + file.size();
+  double fastMs = timeMs(RUNS, [&] {
+    for (const char *n : numbers) {
+      float value;
+      obj::parseFloat(n, end, value);
+      sum += value;
+    }
+  });
+  double strtofMs = timeMs(RUNS, [&] {
+    for (const char *n : numbers) {
+      float value;
+      obj::detail::parseFloatSlow(n, end, value);
+      sum += value;
+    }
+  });
+  std::cout << "  " << numbers.size() << " numbers: parseFloat " << fastMs * 1.0e6 / numbers.size() << " ns, strtof "
+            << strtofMs * 1.0e6 / numbers.size() << " ns per number" << std::endl;
+
+  size_t vertices = 0, indices = 0;
+  report("assimp", timeMs(RUNS, [&] {
+           Assimp::Importer importer;
+           const aiScene *scene = importer.ReadFile(PATH, aiProcess_Triangulate | aiProcess_FlipUVs);
+           vertices = indices = 0;
+           for (unsigned int i = 0; scene && i < scene->mNumMeshes; ++i) {
+             vertices += scene->mMeshes[i]->mNumVertices;
+             indices += scene->mMeshes[i]->mNumFaces * 3;
+           }
+         }));
+  std::cout << "    " << vertices << " vertices, " << indices << " indices" << std::endl;
+
+  std::vector<unsigned int> threadCounts = {1};
+  if (std::thread::hardware_concurrency() > 1)
+    threadCounts.push_back(std::thread::hardware_concurrency());
+  for (unsigned int threads : threadCounts) {
+    JobSystem jobs(threads);
+    bool ok = true;
+    report("obj::load, " + std::to_string(jobs.threadCount()) + " thread(s)", timeMs(RUNS, [&] {
+             obj::Scene scene;
+             ok &= obj::load(PATH, scene, &jobs);
+             vertices = indices = 0;
+             for (const auto &mesh : scene.meshes) {
+               vertices += mesh.vertices.size();
+               indices += mesh.indices.size();
+             }
+           }));
+    if (!ok) {
+      std::cout << "  failed to parse " << PATH << std::endl;
+      return EXIT_FAILURE;
+    }
+    // fewer vertices than assimp, corners sharing all three indices are welded
+    std::cout << "    " << vertices << " vertices, " << indices << " indices" << std::endl;
+  }
+  return sum == 12345.0f ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// write the meshes as a GLB with one buffer view per attribute. quantized stores positions as normalized shorts
+// dequantized by the node transform and normals as normalized bytes (KHR_mesh_quantization), otherwise everything is
+// float
+bool writeGlb(const std::string &path, const std::vector<obj::Mesh> &meshes, bool quantized) {
+  std::string bin;
+  std::ostringstream views, accessors, meshList, nodes;
+  int view = 0;
+  auto append = [&](const void *data, size_t size, int stride) {
+    if (view > 0)
+      views << ",";
+    views << "{\"buffer\":0,\"byteOffset\":" << bin.size() << ",\"byteLength\":" << size;
+    if (stride)
+      views << ",\"byteStride\":" << stride;
+    views << "}";
+    bin.append(static_cast<const char *>(data), size);
+    bin.resize((bin.size() + 3) & ~size_t(3));
+    return view++;
+  };
+  auto accessor = [&](int index, int v, int componentType, bool normalized, size_t count, const char *type,
+                      const std::string &bounds) {
+    if (index > 0)
+      accessors << ",";
+    accessors << "{\"bufferView\":" << v << ",\"componentType\":" << componentType
+              << ",\"normalized\":" << (normalized ? "true" : "false") << ",\"count\":" << count << ",\"type\":\""
+              << type << "\"" << bounds << "}";
+  };
+  int accessorCount = 0;
+  for (size_t m = 0; m < meshes.size(); ++m) {
+    const obj::Mesh &mesh = meshes[m];
+    AABB box;
+    for (const auto &v : mesh.vertices) {
+      box.expand(v.position);
+    }
+    glm::vec3 center = (box.min + box.max) * 0.5f, half = glm::max((box.max - box.min) * 0.5f, glm::vec3(1e-6f));
+    size_t n = mesh.vertices.size();
+    int position, normal, texCoord;
+    char bounds[256];
+    if (quantized) {
+      std::vector<int16_t> p(n * 4);
+      std::vector<int8_t> q(n * 4);
+      for (size_t i = 0; i < n; ++i) {
+        glm::vec3 u = (mesh.vertices[i].position - center) / half;
+        glm::vec3 nn = mesh.vertices[i].normal;
+        for (int k = 0; k < 3; ++k) {
+          p[i * 4 + k] = (int16_t)std::lround(glm::clamp(u[k], -1.0f, 1.0f) * 32767.0f);
+          q[i * 4 + k] = (int8_t)std::lround(glm::clamp(nn[k], -1.0f, 1.0f) * 127.0f);
+        }
+      }
+      position = append(p.data(), p.size() * 2, 8);
+      normal = append(q.data(), q.size(), 4);
+      std::snprintf(bounds, sizeof(bounds), ",\"min\":[-32767,-32767,-32767],\"max\":[32767,32767,32767]");
+      accessor(accessorCount, position, GL_SHORT, true, n, "VEC3", bounds);
+      accessor(accessorCount + 1, normal, GL_BYTE, true, n, "VEC3", "");
+    } else {
+      std::vector<glm::vec3> p(n), q(n);
+      for (size_t i = 0; i < n; ++i) {
+        p[i] = mesh.vertices[i].position;
+        q[i] = mesh.vertices[i].normal;
+      }
+      position = append(p.data(), p.size() * sizeof(glm::vec3), 0);
+      normal = append(q.data(), q.size() * sizeof(glm::vec3), 0);
+      std::snprintf(bounds, sizeof(bounds), ",\"min\":[%g,%g,%g],\"max\":[%g,%g,%g]", box.min.x, box.min.y, box.min.z,
+                    box.max.x, box.max.y, box.max.z);
+      accessor(accessorCount, position, GL_FLOAT, false, n, "VEC3", bounds);
+      accessor(accessorCount + 1, normal, GL_FLOAT, false, n, "VEC3", "");
+    }
+    std::vector<glm::vec2> t(n);
+    for (size_t i = 0; i < n; ++i) {
+      t[i] = mesh.vertices[i].texCoords;
+    }
+    texCoord = append(t.data(), t.size() * sizeof(glm::vec2), 0);
+    accessor(accessorCount + 2, texCoord, GL_FLOAT, false, n, "VEC2", "");
+    int indices = append(mesh.indices.data(), mesh.indices.size() * 4, 0);
+    accessor(accessorCount + 3, indices, GL_UNSIGNED_INT, false, mesh.indices.size(), "SCALAR", "");
+
+    meshList << (m ? "," : "") << "{\"name\":\"" << mesh.name << "\",\"primitives\":[{\"attributes\":{\"POSITION\":"
+             << accessorCount << ",\"NORMAL\":" << accessorCount + 1 << ",\"TEXCOORD_0\":" << accessorCount + 2
+             << "},\"indices\":" << accessorCount + 3 << "}]}";
+    nodes << (m ? "," : "") << "{\"mesh\":" << m;
+    if (quantized)
+      nodes << ",\"translation\":[" << center.x << "," << center.y << "," << center.z << "],\"scale\":[" << half.x
+            << "," << half.y << "," << half.z << "]";
+    nodes << "}";
+    accessorCount += 4;
+  }
+  std::ostringstream scene;
+  for (size_t m = 0; m < meshes.size(); ++m) {
+    scene << (m ? "," : "") << m;
+  }
+
+  std::ostringstream doc;
+  doc << "{\"asset\":{\"version\":\"2.0\"},";
+  if (quantized)
+    doc << "\"extensionsUsed\":[\"KHR_mesh_quantization\"],\"extensionsRequired\":[\"KHR_mesh_quantization\"],";
+  doc << "\"scene\":0,\"scenes\":[{\"nodes\":[" << scene.str() << "]}],\"nodes\":[" << nodes.str() << "],\"meshes\":["
+      << meshList.str() << "],\"accessors\":[" << accessors.str() << "],\"bufferViews\":[" << views.str()
+      << "],\"buffers\":[{\"byteLength\":" << bin.size() << "}]}";
+  std::string json = doc.str();
+  json.resize((json.size() + 3) & ~size_t(3), ' ');
+
+  std::ofstream file(path, std::ios::binary);
+  uint32_t header[3] = {0x46546c67, 2, (uint32_t)(12 + 8 + json.size() + 8 + bin.size())};
+  uint32_t jsonChunk[2] = {(uint32_t)json.size(), 0x4e4f534a};
+  uint32_t binChunk[2] = {(uint32_t)bin.size(), 0x004e4942};
+  file.write(reinterpret_cast<const char *>(header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(jsonChunk), sizeof(jsonChunk));
+  file.write(json.data(), json.size());
+  file.write(reinterpret_cast<const char *>(binChunk), sizeof(binChunk));
+  file.write(bin.data(), bin.size());
+  return (bool)file;
+}
+
+// gltf: nanosuit converted to GLB, float and quantized, loaded by the glTF reader and by assimp. the reader only
+// parses the JSON and validates ranges, the vertex data goes to glBufferData untouched, so the number to compare is
+// its time against assimp's full import
+int benchGltf() {
+  const int RUNS = 5;
+
+  obj::Scene source;
+  if (!obj::load("nanosuit/nanosuit.obj", source)) {
+    std::cout << "gltf: nanosuit/nanosuit.obj not found, run from the repository root" << std::endl;
+    return EXIT_FAILURE;
+  }
+  for (bool quantized : {false, true}) {
+    std::string path = quantized ? "microbench-quantized.glb" : "microbench.glb";
+    if (!writeGlb(path, source.meshes, quantized)) {
+      std::cout << "gltf: can't write " << path << std::endl;
+      return EXIT_FAILURE;
+    }
+    size_t size = MappedFile(path).size();
+    std::cout << "gltf: " << path << ", " << size / 1024 << " KB" << std::endl;
+
+    size_t uploaded = 0;
+    std::string error;
+    bool ok = true;
+    double readerMs = timeMs(RUNS, [&] {
+      gltf::Document doc;
+      ok &= gltf::load(path, doc, &error);
+      uploaded = 0;
+      for (const auto &view : doc.bufferViews) {
+        uploaded += view.byteLength;
+      }
+    });
+    if (!ok) {
+      std::cout << "  gltf::load failed: " << error << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::cout << "  gltf::load: " << readerMs << " ms, " << uploaded / 1024 << " KB ready for glBufferData as is"
+              << std::endl;
+
+    double assimpMs = timeMs(RUNS, [&] {
+      Assimp::Importer importer;
+      importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
+    });
+    std::cout << "  assimp: " << assimpMs << " ms" << std::endl;
+    std::remove(path.c_str());
+  }
+  return EXIT_SUCCESS;
+}
+
+// animation: 1000 characters with a 64 node skeleton, two clips blended per character, palettes on every path and CPU
+// skinning of a 10k vertex mesh
+int benchAnimation() {
+  const size_t CHARACTERS = 1000;
+  const int NODES = 64;
+  const int KEYS = 30;
+  const size_t VERTICES = 10000;
+  const int RUNS = 5;
+
+  std::mt19937 rng(6);
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+  animation::Skeleton skeleton;
+  skeleton.rest.resize(NODES);
+  for (int i = 0; i < NODES; ++i) {
+    skeleton.parents.push_back(i == 0 ? -1 : (int)(rng() % i));
+    skeleton.names.push_back("node" + std::to_string(i));
+    skeleton.rest.set(i, glm::vec3(unit(rng), unit(rng), unit(rng)), randomRotation(rng), glm::vec3(1.0f));
+    skeleton.jointNodes.push_back(i);
+    glm::mat4 inverseBind(1.0f);
+    inverseBind[3] = glm::vec4(unit(rng), unit(rng), unit(rng), 1.0f);
+    skeleton.inverseBind.push_back(inverseBind);
+  }
+  animation::Clip clips[2];
+  for (auto &clip : clips) {
+    clip.duration = 1.0f;
+    for (int i = 0; i < NODES; ++i) {
+      animation::Channel channel;
+      channel.node = i;
+      for (int k = 0; k < KEYS; ++k) {
+        float t = (float)k / (KEYS - 1);
+        channel.positions.times.push_back(t);
+        channel.positions.values.push_back(glm::vec3(unit(rng), unit(rng), unit(rng)));
+        channel.rotations.times.push_back(t);
+        channel.rotations.values.push_back(randomRotation(rng));
+      }
+      clip.channels.push_back(std::move(channel));
+    }
+  }
+  std::cout << "animation: " << CHARACTERS << " characters, " << NODES << " joints, " << KEYS << " keys per channel"
+            << std::endl;
+
+  transform::Batch poses;
+  poses.resize(CHARACTERS * NODES);
+  double sampleMs = timeMs(RUNS, [&] {
+    for (size_t c = 0; c < CHARACTERS; ++c) {
+      float time = c * 0.013f;
+      animation::sample(skeleton, clips[0], time, poses, c * NODES);
+      animation::sample(skeleton, clips[1], time, poses, c * NODES, 0.4f);
+    }
+  });
+  std::cout << "  sample + blend: " << sampleMs << " ms" << std::endl;
+
+  std::vector<animation::JointMatrix> reference(CHARACTERS * NODES), palettes(CHARACTERS * NODES);
+  std::vector<transform::Instance> scratch;
+  std::vector<transform::Path> paths = {transform::Path::SCALAR};
+  if (transform::bestPath() != transform::Path::SCALAR)
+    paths.push_back(transform::Path::SSE2);
+  if (transform::bestPath() == transform::Path::AVX2)
+    paths.push_back(transform::Path::AVX2);
+  auto maxDifference = [](const std::vector<animation::JointMatrix> &a, const std::vector<animation::JointMatrix> &b) {
+    float error = 0.0f;
+    for (size_t i = 0; i < a.size(); ++i) {
+      for (int r = 0; r < 3; ++r) {
+        glm::vec4 d = glm::abs(a[i].rows[r] - b[i].rows[r]);
+        error = std::max(error, std::max(std::max(d.x, d.y), std::max(d.z, d.w)));
+      }
+    }
+    return error;
+  };
+  for (transform::Path path : paths) {
+    auto &out = path == transform::Path::SCALAR ? reference : palettes;
+    double ms = timeMs(RUNS, [&] {
+      animation::computePalettes(skeleton, poses, CHARACTERS, out.data(), scratch, nullptr, path);
+    });
+    std::cout << "  palettes " << transform::pathName(path) << ": " << ms << " ms, "
+              << CHARACTERS / (sampleMs + ms) << " characters per ms including sampling" << std::endl;
+    // the chains are deep, allow for accumulated rounding
+    if (path != transform::Path::SCALAR) {
+      if (float error = maxDifference(reference, palettes); error > 1.0e-2f) {
+        std::cout << "  " << transform::pathName(path) << " differs from scalar by " << error << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+  JobSystem jobs;
+  double parallelMs = timeMs(RUNS, [&] {
+    animation::computePalettes(skeleton, poses, CHARACTERS, palettes.data(), scratch, &jobs);
+  });
+  std::cout << "  palettes " << transform::pathName(transform::bestPath()) << " on " << jobs.threadCount()
+            << " threads: " << parallelMs << " ms" << std::endl;
+
+  // CPU skinning against the first character's palette
+  std::vector<Vertex> vertices(VERTICES), skinned(VERTICES), expected(VERTICES);
+  for (auto &v : vertices) {
+    v.position = glm::vec3(unit(rng), unit(rng), unit(rng));
+    v.normal = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) + glm::vec3(0.0f, 0.0f, 2.0f));
+    int joints[4] = {(int)(rng() % NODES), (int)(rng() % NODES), (int)(rng() % NODES), (int)(rng() % NODES)};
+    float weights[4] = {unit(rng) + 1.0f, unit(rng) + 1.0f, unit(rng) + 1.0f, unit(rng) + 1.0f};
+    animation::packWeights(v, joints, weights, 4);
+  }
+  for (transform::Path path : {transform::Path::SCALAR, transform::bestPath()}) {
+    auto &out = path == transform::Path::SCALAR ? expected : skinned;
+    double ms = timeMs(RUNS, [&] { animation::skin(vertices.data(), VERTICES, reference.data(), out.data(), path); });
+    std::cout << "  skinning " << (path == transform::Path::SCALAR ? "scalar" : "sse2") << ": " << ms << " ms ("
+              << VERTICES / ms << " vertices per ms)" << std::endl;
+  }
+  float error = 0.0f;
+  for (size_t i = 0; i < VERTICES; ++i) {
+    glm::vec3 d = glm::abs(expected[i].position - skinned[i].position);
+    glm::vec3 n = glm::abs(expected[i].normal - skinned[i].normal);
+    error = std::max(error, std::max(std::max(d.x, d.y), std::max(d.z, std::max(n.x, std::max(n.y, n.z)))));
+  }
+  if (error > 1.0e-3f) {
+    std::cout << "  SIMD skinning differs from scalar by " << error << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+struct Benchmark {
+  const char *name;
+  int (*run)();
+};
+
+const Benchmark benchmarks[] = {
+    {"scene-graph", benchSceneGraph},
+    {"ecs", benchEcs},
+    {"transforms", benchTransforms},
+    {"obj", benchObj},
+    {"gltf", benchGltf},
+    {"animation", benchAnimation},
+};
+
+int main(int argc, char **argv) {
+  int result = EXIT_SUCCESS;
+  for (const auto &benchmark : benchmarks) {
+    bool selected = argc == 1;
+    for (int i = 1; i < argc; ++i) {
+      selected |= std::string(argv[i]) == benchmark.name;
+    }
+    if (selected && benchmark.run() != EXIT_SUCCESS)
+      result = EXIT_FAILURE;
+  }
+  return result;
+}
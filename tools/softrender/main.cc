@@ -0,0 +1,378 @@
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include <glad/glad.h>
+
+#include <stb_image.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <base/render_backend.h>
+#include <base/soft_raster.h>
+#include <base/soft_shaders.h>
+
+// softrender: render the stencil-testing scene through a render::Backend without a window.
+//
+//   softrender [--gl] [--size WxH] [--threads N] [--cubes N] [--frames N] [--out image.ppm]
+//              [--compare reference.ppm] [--tolerance N]
+//
+// the software rasterizer is used unless --gl asks for the GL backend in a hidden window, which makes it easy to
+// render the same frame on both and compare them. --cubes draws a grid of outlined cubes instead of the two of the
+// example, --frames renders the scene repeatedly and reports the average frame time. --compare fails when more than
+// 0.1% of the pixels differ from the reference by more than --tolerance (default 8) in any channel.
+
+void usage() {
+  std::cerr << "usage: softrender [--gl] [--size WxH] [--threads N] [--cubes N] [--frames N] [--out image.ppm]"
+            << std::endl
+            << "                  [--compare reference.ppm] [--tolerance N]" << std::endl;
+}
+
+// RGBA8 texels bottom row first, a checkerboard when the file is missing so the tool runs from anywhere
+std::vector<uint8_t> loadTexels(const char *path, int &width, int &height) {
+  stbi_set_flip_vertically_on_load(true);
+  int channels;
+  unsigned char *data = stbi_load(path, &width, &height, &channels, 4);
+  std::vector<uint8_t> texels;
+  if (data) {
+    texels.assign(data, data + (size_t)width * height * 4);
+    stbi_image_free(data);
+    return texels;
+  }
+  std::cerr << "failed to load " << path << ", using a checkerboard" << std::endl;
+  width = height = 64;
+  texels.resize((size_t)width * height * 4);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      uint8_t v = ((x / 8) ^ (y / 8)) & 1 ? 200 : 60;
+      uint8_t *t = &texels[((size_t)y * width + x) * 4];
+      t[0] = t[1] = t[2] = v;
+      t[3] = 255;
+    }
+  }
+  return texels;
+}
+
+// PPM stores the top row first, the backends return the bottom row first
+bool writePpm(const std::string &path, const std::vector<uint8_t> &rgba, int width, int height) {
+  std::ofstream file(path, std::ios::binary);
+  if (!file)
+    return false;
+  file << "P6\n" << width << " " << height << "\n255\n";
+  for (int y = height - 1; y >= 0; --y) {
+    for (int x = 0; x < width; ++x) {
+      file.write((const char *)&rgba[((size_t)y * width + x) * 4], 3);
+    }
+  }
+  return (bool)file;
+}
+
+bool readPpm(const std::string &path, std::vector<uint8_t> &rgba, int &width, int &height) {
+  std::ifstream file(path, std::ios::binary);
+  std::string magic;
+  int maxValue;
+  if (!(file >> magic >> width >> height >> maxValue) || magic != "P6" || maxValue != 255)
+    return false;
+  file.get();
+  rgba.resize((size_t)width * height * 4);
+  for (int y = height - 1; y >= 0; --y) {
+    for (int x = 0; x < width; ++x) {
+      uint8_t *p = &rgba[((size_t)y * width + x) * 4];
+      file.read((char *)p, 3);
+      p[3] = 255;
+    }
+  }
+  return (bool)file;
+}
+
+// the scene of example/stencil-testing: a floor and outlined cubes, the outlines drawn with the classic two pass
+// stencil technique
+class Scene {
+public:
+  Scene(render::Backend &backend, int cubes) : backend(backend) {
+    // clang-format off
+    const float cubeVertices[] = {
+        // positions          // texture Coords
+        -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
+         0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+         0.5f, -0.5f, -0.5f,  1.0f, 0.0f,
+         0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+        -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
+        -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
+
+        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+         0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
+         0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
+         0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
+        -0.5f,  0.5f,  0.5f,  0.0f, 1.0f,
+        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+
+        -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+        -0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+        -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+
+         0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+         0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+         0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+         0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+         0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+         0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+
+        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+         0.5f, -0.5f, -0.5f,  1.0f, 1.0f,
+         0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
+         0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
+        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+
+        -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
+         0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+         0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+         0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+        -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
+        -0.5f,  0.5f,  0.5f,  0.0f, 0.0f
+    };
+    const float planeVertices[] = {
+        // positions          // texture coords
+         5.0f, -0.5f,  5.0f,  2.0f, 0.0f,
+        -5.0f, -0.5f, -5.0f,  0.0f, 2.0f,
+        -5.0f, -0.5f,  5.0f,  0.0f, 0.0f,
+
+         5.0f, -0.5f,  5.0f,  2.0f, 0.0f,
+         5.0f, -0.5f, -5.0f,  2.0f, 2.0f,
+        -5.0f, -0.5f, -5.0f,  0.0f, 2.0f
+    };
+    // clang-format on
+    cubeBuffer = backend.createBuffer(cubeVertices, sizeof(cubeVertices));
+    planeBuffer = backend.createBuffer(planeVertices, sizeof(planeVertices));
+    layout.stride = 5 * sizeof(float);
+    layout.add(0, 3, 0).add(1, 2, 3 * sizeof(float));
+
+    int w, h;
+    auto texels = loadTexels("textures/marble.jpg", w, h);
+    cubeTexture = backend.createTexture(w, h, texels.data());
+    texels = loadTexels("textures/metal.png", w, h);
+    floorTexture = backend.createTexture(w, h, texels.data());
+
+    shader = backend.createProgram(soft::StencilTesting::desc());
+    shaderSingleColor = backend.createProgram(soft::StencilSingleColor::desc());
+
+    if (cubes <= 2) {
+      positions = {glm::vec3(-1.0f, 0.0f, -1.0f), glm::vec3(2.0f, 0.0f, 0.0f)};
+    } else {
+      // a square grid on the floor
+      int side = (int)std::ceil(std::sqrt((float)cubes));
+      float spacing = 9.0f / side;
+      for (int i = 0; i < cubes; ++i) {
+        positions.emplace_back(-4.5f + spacing * (i % side + 0.5f), 0.0f, -4.5f + spacing * (i / side + 0.5f));
+      }
+      scale = std::min(1.0f, spacing * 0.6f);
+    }
+  }
+
+  ~Scene() {
+    backend.destroyProgram(shader);
+    backend.destroyProgram(shaderSingleColor);
+    backend.destroyTexture(cubeTexture);
+    backend.destroyTexture(floorTexture);
+    backend.destroyBuffer(cubeBuffer);
+    backend.destroyBuffer(planeBuffer);
+  }
+
+  void render(int width, int height) {
+    backend.clear(glm::vec4(0.2f, 0.3f, 0.3f, 1.0f));
+
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 2.0f, 5.5f), glm::vec3(0.0f, -0.5f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)width / (float)height, 0.1f, 100.0f);
+    for (render::Handle program : {shader, shaderSingleColor}) {
+      backend.setUniform(program, "view", view);
+      backend.setUniform(program, "projection", projection);
+    }
+
+    // floor, without touching the stencil buffer
+    render::Draw floor;
+    floor.program = shader;
+    floor.vertexBuffer = planeBuffer;
+    floor.layout = layout;
+    floor.count = 6;
+    floor.textures[0] = floorTexture;
+    backend.setUniform(shader, "model", glm::mat4(1.0f));
+    backend.draw(floor);
+
+    // 1st pass: the cubes, writing 1 to the stencil buffer where they are
+    render::Draw cube = floor;
+    cube.vertexBuffer = cubeBuffer;
+    cube.count = 36;
+    cube.textures[0] = cubeTexture;
+    cube.cull = render::CullMode::BACK;
+    cube.depthStencil.stencilTest = true;
+    cube.depthStencil.stencilFunc = render::CompareFunc::ALWAYS;
+    cube.depthStencil.stencilRef = 1;
+    cube.depthStencil.depthPass = render::StencilOp::REPLACE;
+    drawCubes(cube, shader, 1.0f);
+
+    // 2nd pass: slightly larger cubes in a single color wherever the stencil is not 1, without the depth test
+    render::Draw border = cube;
+    border.program = shaderSingleColor;
+    border.depthStencil.depthTest = false;
+    border.depthStencil.stencilFunc = render::CompareFunc::NOTEQUAL;
+    border.depthStencil.stencilWriteMask = 0x00;
+    drawCubes(border, shaderSingleColor, 1.05f);
+  }
+
+private:
+  render::Backend &backend;
+  render::Handle cubeBuffer, planeBuffer, cubeTexture, floorTexture, shader, shaderSingleColor;
+  render::VertexLayout layout;
+  std::vector<glm::vec3> positions;
+  float scale = 1.0f;
+
+  void drawCubes(const render::Draw &draw, render::Handle program, float factor) {
+    for (const auto &position : positions) {
+      glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+      model = glm::scale(model, glm::vec3(scale * factor));
+      backend.setUniform(program, "model", model);
+      backend.draw(draw);
+    }
+  }
+};
+
+int main(int argc, char **argv) {
+  bool gl = false;
+  int width = 800, height = 600;
+  unsigned int threads = 0;
+  int cubes = 2, frames = 1, tolerance = 8;
+  std::string out, reference;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--gl") {
+      gl = true;
+    } else if (arg == "--size" && i + 1 < argc) {
+      if (std::sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+        usage();
+        return EXIT_FAILURE;
+      }
+    } else if (arg == "--threads" && i + 1 < argc) {
+      threads = std::atoi(argv[++i]);
+    } else if (arg == "--cubes" && i + 1 < argc) {
+      cubes = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--frames" && i + 1 < argc) {
+      frames = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--out" && i + 1 < argc) {
+      out = argv[++i];
+    } else if (arg == "--compare" && i + 1 < argc) {
+      reference = argv[++i];
+    } else if (arg == "--tolerance" && i + 1 < argc) {
+      tolerance = std::atoi(argv[++i]);
+    } else {
+      usage();
+      return EXIT_FAILURE;
+    }
+  }
+
+  GLFWwindow *window = nullptr;
+  std::unique_ptr<render::Backend> backend;
+  if (gl) {
+    if (!glfwInit()) {
+      std::cerr << "failed to init GLFW" << std::endl;
+      return EXIT_FAILURE;
+    }
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    if (window = glfwCreateWindow(width, height, "softrender", nullptr, nullptr); !window) {
+      glfwTerminate();
+      return EXIT_FAILURE;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+      std::cerr << "failed to initialize GLAD" << std::endl;
+      return EXIT_FAILURE;
+    }
+    // the hidden window's framebuffer may be smaller than asked for
+    glfwGetFramebufferSize(window, &width, &height);
+    backend = std::make_unique<render::GLBackend>();
+  } else {
+    backend = std::make_unique<soft::Rasterizer>(threads);
+  }
+
+  std::vector<uint8_t> pixels;
+  double frameMs = 0.0;
+  {
+    Scene scene(*backend, cubes);
+    backend->resize(width, height);
+    // one frame to warm up caches and the thread pool
+    scene.render(width, height);
+    backend->finish();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; ++i) {
+      scene.render(width, height);
+    }
+    backend->finish();
+    frameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+    backend->readPixels(pixels);
+  }
+
+  std::cout << backend->name() << " " << width << "x" << height << ", " << cubes << " cube(s): " << frameMs
+            << " ms/frame" << std::endl;
+  if (auto *rasterizer = dynamic_cast<soft::Rasterizer *>(backend.get())) {
+    const auto &stats = rasterizer->getStats();
+    size_t rendered = (size_t)frames + 1;
+    std::cout << "  " << rasterizer->threadCount() << " thread(s), per frame: " << stats.draws / rendered
+              << " draws, " << stats.triangles / rendered << " triangles (" << stats.culled / rendered << " culled, "
+              << stats.clipped / rendered << " clipped), " << stats.binned / rendered << " tile bins, "
+              << stats.fragments / rendered << " fragments, " << stats.flushes / rendered << " flushes" << std::endl;
+    std::cout << "  " << stats.fragments / rendered / frameMs / 1000.0 << " Mfragments/s" << std::endl;
+  }
+
+  int status = EXIT_SUCCESS;
+  if (!out.empty() && !writePpm(out, pixels, width, height)) {
+    std::cerr << "failed to write " << out << std::endl;
+    status = EXIT_FAILURE;
+  }
+  if (!reference.empty()) {
+    std::vector<uint8_t> expected;
+    int w, h;
+    if (!readPpm(reference, expected, w, h) || w != width || h != height) {
+      std::cerr << "failed to read " << reference << " or its size differs" << std::endl;
+      status = EXIT_FAILURE;
+    } else {
+      size_t differing = 0;
+      for (size_t i = 0; i < pixels.size(); i += 4) {
+        for (int c = 0; c < 3; ++c) {
+          if (std::abs(pixels[i + c] - expected[i + c]) > tolerance) {
+            differing++;
+            break;
+          }
+        }
+      }
+      size_t allowed = (size_t)width * height / 1000;
+      std::cout << differing << " pixel(s) differ from " << reference << " (" << allowed << " allowed)" << std::endl;
+      if (differing > allowed)
+        status = EXIT_FAILURE;
+    }
+  }
+
+  // the GL backend's objects go while its context is still current
+  backend.reset();
+  if (window)
+    glfwTerminate();
+  return status;
+}
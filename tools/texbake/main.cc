@@ -0,0 +1,272 @@
+#include <stb_image.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <base/bcn.h>
+#include <base/ktx2.h>
+#include <base/mipmap.h>
+
+// texbake: compress images into KTX2 files with a precomputed mip chain.
+//
+//   texbake [--format auto|rgba8|bc1|bc3|bc4|bc5] [--srgb] [--filter linear|srgb] image...
+//   texbake --bench-mips
+//   texbake --test
+//
+// every image is written next to its source with a .ktx2 extension, which is where textureFromFile looks for it.
+// auto picks BC1 for opaque color, BC3 when there is alpha, BC4 for one channel and BC5 for two. color maps should be
+// baked with --filter srgb (implied by --srgb) so their mips are averaged in linear light.
+// --bench-mips measures mip chain generation on every available SIMD path in megapixels per second.
+// --test checks the block encoders on blocks with known answers, it is what ctest runs.
+
+enum class OutputFormat { AUTO, RGBA8, BC1, BC3, BC4, BC5 };
+
+void usage() {
+  std::cerr << "usage: texbake [--format auto|rgba8|bc1|bc3|bc4|bc5] [--srgb] [--filter linear|srgb] image..."
+            << std::endl
+            << "       texbake --bench-mips" << std::endl
+            << "       texbake --test" << std::endl;
+}
+
+int benchMips() {
+  const int SIZE = 4096;
+  const int RUNS = 5;
+  std::vector<uint8_t> pixels((size_t)SIZE * SIZE * 4);
+  uint32_t seed = 1;
+  for (auto &p : pixels) {
+    seed = seed * 1664525u + 1013904223u;
+    p = seed >> 24;
+  }
+  std::vector<mipmap::Path> paths = {mipmap::Path::SCALAR};
+  if (mipmap::bestPath() == mipmap::Path::AVX2)
+    paths.push_back(mipmap::Path::SSE2);
+  if (mipmap::bestPath() != mipmap::Path::SCALAR)
+    paths.push_back(mipmap::bestPath());
+
+  std::cout << "mip chain of a " << SIZE << "x" << SIZE << " RGBA8 image" << std::endl;
+  for (auto space : {mipmap::ColorSpace::LINEAR, mipmap::ColorSpace::SRGB}) {
+    for (auto path : paths) {
+      double best = 1e30;
+      for (int run = 0; run < RUNS; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        auto levels = mipmap::generate(pixels.data(), SIZE, SIZE, 4, space, path);
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+      }
+      std::cout << (space == mipmap::ColorSpace::SRGB ? "srgb   " : "linear ") << mipmap::pathName(path) << ": "
+                << (double)SIZE * SIZE / 1.0e6 / best << " MP/s" << std::endl;
+    }
+  }
+  return EXIT_SUCCESS;
+}
+
+int test() {
+  int failed = 0;
+  auto check = [&](bool ok, const char *what) {
+    if (!ok) {
+      std::cerr << "texbake test failed: " << what << std::endl;
+      ++failed;
+    }
+  };
+
+  // a red|green edge: the channels are anticorrelated, both colors have to survive as endpoints
+  std::vector<uint8_t> split(4 * 4 * 4);
+  for (int i = 0; i < 16; ++i) {
+    bool left = i % 4 < 2;
+    split[i * 4 + 0] = left ? 255 : 0;
+    split[i * 4 + 1] = left ? 0 : 255;
+    split[i * 4 + 2] = 0;
+    split[i * 4 + 3] = 255;
+  }
+  std::vector<uint8_t> block = bcn::encode(bcn::Format::BC1, split.data(), 4, 4, 4);
+  int endpoints[2][3];
+  bcn::detail::unpack565((uint16_t)(block[0] | block[1] << 8), endpoints[0]);
+  bcn::detail::unpack565((uint16_t)(block[2] | block[3] << 8), endpoints[1]);
+  auto near = [](const int c[3], int r, int g) {
+    return std::abs(c[0] - r) < 64 && std::abs(c[1] - g) < 64 && c[2] < 64;
+  };
+  check((near(endpoints[0], 255, 0) && near(endpoints[1], 0, 255)) ||
+            (near(endpoints[0], 0, 255) && near(endpoints[1], 255, 0)),
+        "bc1 red|green endpoints");
+  uint32_t indices = block[4] | block[5] << 8 | block[6] << 16 | (uint32_t)block[7] << 24;
+  bool separated = true;
+  for (int i = 0; i < 16; ++i) {
+    separated &= ((indices >> (2 * i)) & 3) == ((indices >> (2 * (i % 4 < 2 ? 0 : 2))) & 3);
+  }
+  separated &= (indices & 3) != ((indices >> 4) & 3);
+  check(separated, "bc1 red|green indices");
+
+  // a flat block is one color
+  std::vector<uint8_t> flat(4 * 4 * 4, 128);
+  block = bcn::encode(bcn::Format::BC1, flat.data(), 4, 4, 4);
+  check(block[0] == block[2] && block[1] == block[3], "bc1 flat block");
+
+  if (!failed)
+    std::cout << "texbake: all tests passed" << std::endl;
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+bool hasAlpha(const std::vector<uint8_t> &pixels) {
+  for (size_t i = 3; i < pixels.size(); i += 4) {
+    if (pixels[i] != 255)
+      return true;
+  }
+  return false;
+}
+
+int main(int argc, char **argv) {
+  OutputFormat requested = OutputFormat::AUTO;
+  bool srgb = false;
+  bool srgbFilter = false;
+  std::vector<std::string> inputs;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--bench-mips") {
+      return benchMips();
+    } else if (arg == "--test") {
+      return test();
+    } else if (arg == "--srgb") {
+      srgb = true;
+      srgbFilter = true;
+    } else if (arg == "--filter" && i + 1 < argc) {
+      std::string name = argv[++i];
+      if (name != "linear" && name != "srgb") {
+        usage();
+        return EXIT_FAILURE;
+      }
+      srgbFilter = name == "srgb";
+    } else if (arg == "--format" && i + 1 < argc) {
+      std::string name = argv[++i];
+      if (name == "auto")
+        requested = OutputFormat::AUTO;
+      else if (name == "rgba8")
+        requested = OutputFormat::RGBA8;
+      else if (name == "bc1")
+        requested = OutputFormat::BC1;
+      else if (name == "bc3")
+        requested = OutputFormat::BC3;
+      else if (name == "bc4")
+        requested = OutputFormat::BC4;
+      else if (name == "bc5")
+        requested = OutputFormat::BC5;
+      else {
+        usage();
+        return EXIT_FAILURE;
+      }
+    } else if (arg.rfind("--", 0) == 0) {
+      usage();
+      return EXIT_FAILURE;
+    } else {
+      inputs.push_back(arg);
+    }
+  }
+  if (inputs.empty()) {
+    usage();
+    return EXIT_FAILURE;
+  }
+
+  int failed = 0;
+  double totalSeconds = 0.0, totalPixels = 0.0;
+  for (const auto &input : inputs) {
+    int width, height, nrComponents;
+    unsigned char *data = stbi_load(input.c_str(), &width, &height, &nrComponents, 4);
+    if (!data) {
+      std::cerr << "failed to load " << input << ": " << stbi_failure_reason() << std::endl;
+      ++failed;
+      continue;
+    }
+    std::vector<uint8_t> pixels(data, data + (size_t)width * height * 4);
+    stbi_image_free(data);
+
+    OutputFormat format = requested;
+    if (format == OutputFormat::AUTO) {
+      if (nrComponents == 1)
+        format = OutputFormat::BC4;
+      else if (nrComponents == 2)
+        format = OutputFormat::BC5;
+      else
+        format = hasAlpha(pixels) ? OutputFormat::BC3 : OutputFormat::BC1;
+    }
+    // stb expands grey+alpha to RGBA as g,g,g,a; BC5 wants the two source channels in red and green
+    if (format == OutputFormat::BC5 && nrComponents == 2) {
+      for (size_t i = 0; i < pixels.size(); i += 4) {
+        pixels[i + 1] = pixels[i + 3];
+      }
+    }
+
+    ktx2::Image image;
+    image.width = width;
+    image.height = height;
+    switch (format) {
+    case OutputFormat::BC1:
+      image.vkFormat = srgb ? ktx2::BC1_RGB_SRGB_BLOCK : ktx2::BC1_RGB_UNORM_BLOCK;
+      break;
+    case OutputFormat::BC3:
+      image.vkFormat = srgb ? ktx2::BC3_SRGB_BLOCK : ktx2::BC3_UNORM_BLOCK;
+      break;
+    case OutputFormat::BC4:
+      image.vkFormat = ktx2::BC4_UNORM_BLOCK;
+      break;
+    case OutputFormat::BC5:
+      image.vkFormat = ktx2::BC5_UNORM_BLOCK;
+      break;
+    default:
+      image.vkFormat = srgb ? ktx2::R8G8B8A8_SRGB : ktx2::R8G8B8A8_UNORM;
+      break;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto mips = mipmap::generate(pixels.data(), width, height, 4,
+                                 srgbFilter ? mipmap::ColorSpace::SRGB : mipmap::ColorSpace::LINEAR);
+    int w = width, h = height;
+    double pixelCount = 0.0;
+    for (auto &level : mips) {
+      pixelCount += (double)w * h;
+      switch (format) {
+      case OutputFormat::BC1:
+        image.levels.push_back(bcn::encode(bcn::Format::BC1, level.data(), w, h, 4));
+        break;
+      case OutputFormat::BC3:
+        image.levels.push_back(bcn::encode(bcn::Format::BC3, level.data(), w, h, 4));
+        break;
+      case OutputFormat::BC4:
+        image.levels.push_back(bcn::encode(bcn::Format::BC4, level.data(), w, h, 4));
+        break;
+      case OutputFormat::BC5:
+        image.levels.push_back(bcn::encode(bcn::Format::BC5, level.data(), w, h, 4));
+        break;
+      default:
+        image.levels.push_back(std::move(level));
+        break;
+      }
+      w = std::max(1, w / 2);
+      h = std::max(1, h / 2);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    totalSeconds += seconds;
+    totalPixels += pixelCount;
+
+    std::string output = input.substr(0, input.find_last_of('.')) + ".ktx2";
+    if (!ktx2::write(output, image)) {
+      std::cerr << "failed to write " << output << std::endl;
+      ++failed;
+      continue;
+    }
+    size_t bytes = 0;
+    for (const auto &level : image.levels) {
+      bytes += level.size();
+    }
+    std::cout << output << ": " << width << "x" << height << ", " << image.levels.size() << " levels, "
+              << bytes / 1024 << " KiB (" << (size_t)(pixelCount * 4) / 1024 << " KiB as RGBA8), "
+              << seconds * 1000.0 << " ms" << std::endl;
+  }
+  if (totalSeconds > 0.0) {
+    std::cout << "encoded " << totalPixels / 1.0e6 << " megapixels at " << totalPixels / 1.0e6 / totalSeconds
+              << " MP/s" << std::endl;
+  }
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}